@@ -0,0 +1,130 @@
+/*
+ * Copyright 2024 Humberto Gomes, José Lopes, José Matos
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+/**
+ * @file    bench/bench.h
+ * @brief   Timing and reporting of microbenchmarks.
+ * @details Every benchmark is repeated ::BENCH_REPETITIONS times (after a warm-up run whose timing
+ *          is discarded), and the minimum and median time per operation are reported. Results are
+ *          written to `stdout` as JSON, one object per line, so that they can be compared between
+ *          builds by scripts.
+ */
+
+#ifndef BENCH_H
+#define BENCH_H
+
+#include <stddef.h>
+#include <time.h>
+
+/** @brief Number of timed repetitions of every benchmark. */
+#define BENCH_REPETITIONS 7
+
+/**
+ * @struct bench_t
+ * @brief  Measurements of a benchmark.
+ *
+ * @var bench_t::start
+ *     @brief Time when the current repetition started being measured.
+ * @var bench_t::samples
+ *     @brief Nanoseconds per operation of each repetition.
+ * @var bench_t::nsamples
+ *     @brief Number of measured repetitions in bench_t::samples.
+ * @var bench_t::warmed_up
+ *     @brief Whether the warm-up run (not recorded) has already happened.
+ */
+typedef struct {
+    struct timespec start;
+    double          samples[BENCH_REPETITIONS];
+    size_t          nsamples;
+    int             warmed_up;
+} bench_t;
+
+/**
+ * @brief   Checks if a benchmark (or group of benchmarks) was selected in the command line.
+ * @details A benchmark is selected when its name contains the filter, or vice-versa (so that a
+ *          group, like `"priority_queue"`, is run when a benchmark in it is selected).
+ * @param   name Name of the benchmark or group.
+ * @retval  0 Not selected.
+ * @retval  1 Selected (or no filter given).
+ */
+int bench_is_selected(const char *name);
+
+/**
+ * @brief   Checks if the full (slower, larger) versions of the benchmarks should be run.
+ * @details Controlled by the `BENCH_FULL` environment variable.
+ * @retval  0 Only run the quick benchmarks.
+ * @retval  1 Run the full benchmarks.
+ */
+int bench_is_full(void);
+
+/**
+ * @brief Sets the filter for benchmark names (see ::bench_is_selected).
+ * @param filter Substring benchmark names must contain. Can be `NULL`, to select all benchmarks.
+ */
+void bench_set_filter(const char *filter);
+
+/**
+ * @brief Prepares a ::bench_t for a new benchmark.
+ * @param bench Benchmark to be reset. Mustn't be `NULL`.
+ */
+void bench_reset(bench_t *bench);
+
+/**
+ * @brief  Checks whether a benchmark should be run another time.
+ * @param  bench Benchmark being run. Mustn't be `NULL`.
+ * @retval 0 All repetitions (and warm-up) have been recorded.
+ * @retval 1 Another repetition is needed.
+ */
+int bench_keep_running(const bench_t *bench);
+
+/**
+ * @brief Starts timing a repetition of a benchmark.
+ * @param bench Benchmark being run. Mustn't be `NULL`.
+ */
+void bench_start(bench_t *bench);
+
+/**
+ * @brief Stops timing a repetition of a benchmark.
+ *
+ * @param bench      Benchmark being run. Mustn't be `NULL`.
+ * @param operations Number of operations performed in the repetition. Mustn't be `0`.
+ */
+void bench_stop(bench_t *bench, size_t operations);
+
+/**
+ * @brief   Outputs the results of a benchmark to `stdout`, as a line of JSON.
+ * @details The JSON object contains the benchmark's name, parameters, number of repetitions, and
+ *          the minimum, median and maximum nanoseconds per operation.
+ *
+ * @param bench      Benchmark to be reported. Mustn't be `NULL`.
+ * @param name       Name of the benchmark. Mustn't be `NULL`.
+ * @param parameters JSON object with the parameters of the benchmark. Mustn't be `NULL`.
+ */
+void bench_report(const bench_t *bench, const char *name, const char *parameters);
+
+/** @brief Runs the benchmarks of ::priority_queue_t. */
+void bench_priority_queue(void);
+
+/** @brief Runs the benchmarks of ::command_parser_parse_task. */
+void bench_command_parser(void);
+
+/** @brief Runs the benchmarks of ::log_file_t. */
+void bench_log_file(void);
+
+/** @brief Runs the benchmarks of message encoding and decoding in protocol.h. */
+void bench_protocol(void);
+
+#endif
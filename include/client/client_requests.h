@@ -27,6 +27,8 @@
 
 #include <inttypes.h>
 
+#include "protocol.h"
+
 /**
  * @brief   Submits a program (task that cannot contain pipelines) to the server.
  * @details This procedure will output to `stderr` in case of error.
@@ -54,9 +56,111 @@ int client_requests_send_task(const char *command_line, uint32_t expected_time);
 /**
  * @brief   Asks the server to send over its status.
  * @details This procedure will output to `stderr` in case of error.
+ *
+ * @param flags    Bitwise OR of `PROTOCOL_STATUS_FLAG_*` values, with extra information to be
+ *                 asked for.
+ * @param first_id Lowest identifier of the tasks to be reported.
+ * @param last_id  Highest identifier of the tasks to be reported (`UINT32_MAX` for all tasks).
+ *
  * @return  The value to be returned by `main()`. No `errno` is unspecified, as all errors are
  *          printed to `stderr`.
  */
-int client_request_ask_status(void);
+int client_request_ask_status(uint8_t flags, uint32_t first_id, uint32_t last_id);
+
+/**
+ * @brief   Asks the server to write completed tasks to a file.
+ * @details This procedure will output to `stderr` in case of error. The file is created (or
+ *          truncated) by the client and then written to by the server, so that exported tasks
+ *          don't go through the client's FIFO.
+ *
+ * @param format   Format of the file.
+ * @param first_id Lowest identifier of the tasks to be exported.
+ * @param last_id  Highest identifier of the tasks to be exported (`UINT32_MAX` for all tasks).
+ * @param path     Path of the file to be written. Mustn't be `NULL`.
+ *
+ * @return The value to be returned by `main()`. No `errno` is unspecified, as all errors are
+ *         printed to `stderr`.
+ */
+int client_requests_export(protocol_export_format_t format,
+                           uint32_t                 first_id,
+                           uint32_t                 last_id,
+                           const char              *path);
+
+/**
+ * @brief   Prints the state the server publishes in shared memory, without contacting it.
+ * @details This procedure will output to `stderr` in case of error. Only running tasks and the
+ *          most recently completed ones are printed, along with the load of the server.
+ *
+ * @param first_id Lowest identifier of the tasks to be printed.
+ * @param last_id  Highest identifier of the tasks to be printed (`UINT32_MAX` for all tasks).
+ *
+ * @return The value to be returned by `main()`. No `errno` is unspecified, as all errors are
+ *         printed to `stderr`.
+ */
+int client_requests_read_local_status(uint32_t first_id, uint32_t last_id);
+
+/**
+ * @brief   Asks the server for the aggregates of completed tasks and its current load.
+ * @details This procedure will output to `stderr` in case of error.
+ *
+ * @param json Whether to output JSON instead of text.
+ *
+ * @return  The value to be returned by `main()`. No `errno` is unspecified, as all errors are
+ *          printed to `stderr`.
+ */
+int client_requests_ask_stats(int json);
+
+/**
+ * @brief   Streams the output of a running task to `stdout` and `stderr`, until the task ends.
+ * @details This procedure will output to `stderr` in case of error. Output produced before this
+ *          call isn't streamed, and clients that can't keep up with the task stop being streamed
+ *          to.
+ *
+ * @param id Identifier of the task to be followed.
+ *
+ * @return The value to be returned by `main()`. No `errno` is unspecified, as all errors are
+ *         printed to `stderr`.
+ */
+int client_requests_follow(uint32_t id);
+
+/**
+ * @brief   Copies the stored output of a task to `stdout`.
+ * @details This procedure will output to `stderr` in case of error. The server sends the output
+ *          through a named pipe, so the client doesn't need access to the server's directory.
+ *
+ * @param id         Identifier of the task.
+ * @param stream     `STDOUT_FILENO` or `STDERR_FILENO`, depending on the output to be copied.
+ * @param first_byte Offset of the first byte of the output to be copied.
+ * @param last_byte  Offset of the last byte of the output to be copied (`UINT64_MAX` for the rest
+ *                   of the output).
+ *
+ * @return The value to be returned by `main()`. No `errno` is unspecified, as all errors are
+ *         printed to `stderr`.
+ */
+int client_requests_output(uint32_t id, int stream, uint64_t first_byte, uint64_t last_byte);
+
+/**
+ * @brief   Starts or stops recording trace events in the server.
+ * @details This procedure will output to `stderr` in case of error. The server isn't contacted, as
+ *          tracing is controlled through the memory it shares with its children.
+ *
+ * @param enabled Whether events should be recorded.
+ *
+ * @return The value to be returned by `main()`. No `errno` is unspecified, as all errors are
+ *         printed to `stderr`.
+ */
+int client_requests_set_tracing(int enabled);
+
+/**
+ * @brief   Writes the events recorded by the server as Chrome trace-event JSON.
+ * @details This procedure will output to `stderr` in case of error. The output can be opened in
+ *          Perfetto or `chrome://tracing`.
+ *
+ * @param path Path of the file to be written. `NULL` for `stdout`.
+ *
+ * @return The value to be returned by `main()`. No `errno` is unspecified, as all errors are
+ *         printed to `stderr`.
+ */
+int client_requests_dump_trace(const char *path);
 
 #endif
@@ -24,6 +24,7 @@
 
 #include <inttypes.h>
 #include <limits.h>
+#include <sys/types.h>
 
 /** @brief The type of endpoint (this program is) in an IPC. */
 typedef enum {
@@ -110,7 +111,7 @@ void ipc_free(ipc_t *ipc);
  * @retval 1 Failure (check `errno`).
  *
  * | `errno`    | Cause                                                               |
- * | ---------- |  ------------------------------------------------------------------ |
+ * | ---------- | ------------------------------------------------------------------- |
  * | `EINVAL`   | @p ipc is `NULL` or not ready for writing, or @p message is `NULL`. |
  * | `EMSGSIZE` | Message either empty or too long.                                   |
  * | other      | See `man 2 write`.                                                  |
@@ -139,7 +140,7 @@ int ipc_send(ipc_t *ipc, const void *message, size_t length);
  * @retval 1 Failure (check `errno`).
  *
  * | `errno`     | Cause                                                                                       |
- * | ----------- |  ------------------------------------------------------------------------------------------ |
+ * | ----------- | ------------------------------------------------------------------------------------------- |
  * | `EINVAL`    | @p ipc is `NULL` or not ready for writing, or @p message is `NULL`, or @p max_tries is `0`. |
  * | `EMSGSIZE`  | Message either empty or too long.                                                           |
  * | `ETIMEDOUT` | Maximum number of attempts reached.                                                         |
@@ -163,13 +164,57 @@ int ipc_send_retry(ipc_t *ipc, const void *message, size_t length, unsigned int
  * @retval 1 Failure (check `errno`).
  *
  * | `errno`  | Cause                                                                         |
- * | -------- |  ---------------------------------------------------------------------------- |
+ * | -------- | ----------------------------------------------------------------------------- |
  * | `EINVAL` | @p ipc is `NULL`, not ::IPC_ENDPOINT_SERVER, or already prepared for sending. |
  * | `ENOENT` | Named pipe doesn't exist (likely the wrong PID was given).                    |
  * | other    | See `man 2 open`.                                                             |
  */
 int ipc_server_open_sending(ipc_t *ipc, pid_t client_pid);
 
+/**
+ * @brief   Gets the user that owns the named pipe a connection sends data to a client through.
+ * @details Unlike the client's PID, that clients report about themselves, this can't be forged: a
+ *          client can only create named pipes owned by its own user. The pipe already open by
+ *          ::ipc_server_open_sending is checked, not its path, so it can't be replaced meanwhile.
+ *
+ * @param ipc Connection open for sending data to a client. Mustn't be `NULL`, must be a
+ *            ::IPC_ENDPOINT_SERVER connection and ::ipc_server_open_sending must have been called
+ *            before.
+ * @param uid Where to write the user identifier to. Mustn't be `NULL`.
+ *
+ * @retval 0 Success.
+ * @retval 1 Failure (check `errno`).
+ *
+ * | `errno`  | Cause                                                                     |
+ * | -------- | ------------------------------------------------------------------------- |
+ * | `EINVAL` | @p ipc or @p uid is `NULL`, or @p ipc isn't open for sending to a client. |
+ * | other    | See `man 2 fstat`.                                                        |
+ */
+int ipc_server_get_client_uid(const ipc_t *ipc, uid_t *uid);
+
+/**
+ * @brief   Creates a connection from the server to a single client, only for sending data.
+ * @details Unlike ::ipc_server_open_sending, this never blocks: it fails when the client isn't
+ *          reading from its named pipe, so that the caller can retry later or give up on the
+ *          client. Failed writes to a client that is gone don't block either (see
+ *          ::ipc_send_retry).
+ *
+ *          Freeing this connection with ::ipc_free doesn't remove the server's named pipe.
+ *
+ * @param client_pid The PID of the client.
+ *
+ * @return A new connection on success, `NULL` on failure (check `errno`).
+ *
+ * | `errno`  | Cause                                                      |
+ * | -------- | ---------------------------------------------------------- |
+ * | `EAGAIN` | The client is running, but isn't reading from its pipe.    |
+ * | `EPIPE`  | The client is gone.                                        |
+ * | `ENOENT` | Named pipe doesn't exist (likely the wrong PID was given). |
+ * | `ENOMEM` | Allocation failure.                                        |
+ * | other    | See `man 2 open`.                                          |
+ */
+ipc_t *ipc_server_connect(pid_t client_pid);
+
 /**
  * @brief Closes the side of a connection from the server to the client.
  *
@@ -183,9 +228,26 @@ int ipc_server_open_sending(ipc_t *ipc, pid_t client_pid);
  */
 int ipc_server_close_sending(ipc_t *ipc);
 
+/**
+ * @brief   Closes the side of a connection from the client to the server.
+ * @details Clients that don't expect to send more messages should call this before waiting for a
+ *          reply that the server may delay, as the server only notices that it has no more
+ *          messages to read when no client has its named pipe open.
+ *
+ * @param ipc Connection to have one of its sides closed. Mustn't be `NULL` and must be a
+ *            ::IPC_ENDPOINT_CLIENT connection still open for sending.
+ *
+ * @retval 0 Success (`close()` failures will be ignored).
+ * @retval 1 Failure (`errno = EINVAL` because @p is `NULL`, not a ::IPC_ENDPOINT_CLIENT connection
+ *           or closed for sending).
+ */
+int ipc_client_close_sending(ipc_t *ipc);
+
 /**
  * @brief   Listens for messages received in a connection.
- * @details Protocol / `read()` errors that are recovered from will be printed to `stderr`.
+ * @details Protocol / `read()` errors that are recovered from will be printed to `stderr`. A signal
+ *          caught without `SA_RESTART` interrupts listening: during `open()`, this function fails
+ *          with `errno = EINTR`; during `read()`, @p block_cb is called, so that it can stop.
  *
  * @param ipc        Connection to receive traffic from. Mustn't be `NULL`.
  * @param message_cb Callback called for every message. Mustn't be `NULL`.
@@ -203,4 +265,31 @@ int ipc_listen(ipc_t                         *ipc,
                ipc_on_before_block_callback_t block_cb,
                void                          *state);
 
+/**
+ * @brief   Generates the path to a named pipe a client reads a followed task's output from.
+ * @details These pipes don't carry framed messages, but the raw output of the task.
+ *
+ * @param client_pid The PID of the client following the task.
+ * @param stream     `STDOUT_FILENO` or `STDERR_FILENO`, depending on the output to be followed.
+ * @param path       Where to output the path to the FIFO. Mustn't be `NULL`.
+ *
+ * @retval 0 Success.
+ * @retval 1 Failure (`errno = EINVAL`, @p path is `NULL` or @p stream is invalid).
+ */
+int ipc_get_follow_fifo_path(pid_t client_pid, int stream, char path[PATH_MAX]);
+
+/**
+ * @brief   Moves data out of a pipe.
+ * @details `splice()` is used so that data doesn't need to be copied to user space. If the kernel
+ *          doesn't support splicing to @p out, the data is copied using `read()` and `write()`.
+ *
+ * @param in     File descriptor of the pipe to read from.
+ * @param out    File descriptor to write to.
+ * @param length Maximum number of bytes to be moved.
+ *
+ * @return The number of bytes moved (`0` on end-of-file), or `-1` on failure (check `errno`, see
+ *         `man 2 splice`, `man 2 read` and `man 2 write`).
+ */
+ssize_t ipc_splice(int in, int out, size_t length);
+
 #endif
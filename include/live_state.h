@@ -0,0 +1,169 @@
+/*
+ * Copyright 2024 Humberto Gomes, José Lopes, José Matos
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+/**
+ * @file    live_state.h
+ * @brief   State of the server published in shared memory, readable without contacting it.
+ * @details The server maps a file (::LIVE_STATE_PATH) and updates it as tasks are scheduled, run
+ *          and completed. Readers map the same file read-only, and use the sequence number in
+ *          ::live_state_region_t to get a consistent copy (a sequence lock).
+ */
+
+#ifndef LIVE_STATE_H
+#define LIVE_STATE_H
+
+#include <inttypes.h>
+#include <sys/types.h>
+#include <time.h>
+
+#include "server/tagged_task.h"
+
+/** @brief Path of the file shared between the server and its readers. */
+#define LIVE_STATE_PATH "/tmp/orchestrator.state"
+
+/** @brief Version of the layout of ::live_state_region_t, checked by readers. */
+#define LIVE_STATE_VERSION 1
+
+/** @brief Maximum number of running tasks published. The others are only counted. */
+#define LIVE_STATE_MAXIMUM_SLOTS 64
+
+/** @brief Number of recently completed tasks published. */
+#define LIVE_STATE_COMPLETIONS 64
+
+/** @brief Maximum length of live_state_task_t::command_line, including the null terminator. */
+#define LIVE_STATE_COMMAND_LENGTH 128
+
+/**
+ * @struct live_state_task_t
+ * @brief  A task published in a ::live_state_region_t.
+ *
+ * @var live_state_task_t::id
+ *     @brief Identifier of the task.
+ * @var live_state_task_t::error
+ *     @brief Whether an error happened while running the task.
+ * @var live_state_task_t::times
+ *     @brief Timestamps of the task (see ::tagged_task_time_t). Zero for unset times.
+ * @var live_state_task_t::command_line
+ *     @brief Null-terminated command line of the task, truncated if needed.
+ */
+typedef struct {
+    uint32_t        id;
+    uint8_t         error;
+    struct timespec times[TAGGED_TASK_TIME_COMPLETED + 1];
+    char            command_line[LIVE_STATE_COMMAND_LENGTH];
+} live_state_task_t;
+
+/**
+ * @struct live_state_region_t
+ * @brief  Contents of the file shared between the server and its readers.
+ *
+ * @var live_state_region_t::sequence
+ *     @brief Odd while the server is updating the region. Incremented twice on every update.
+ * @var live_state_region_t::version
+ *     @brief ::LIVE_STATE_VERSION of the server.
+ * @var live_state_region_t::server_pid
+ *     @brief PID of the server, to detect stale regions left by crashed servers.
+ * @var live_state_region_t::policy
+ *     @brief Scheduling policy of the server (a ::scheduler_policy_t).
+ * @var live_state_region_t::slots
+ *     @brief Maximum number of tasks running concurrently.
+ * @var live_state_region_t::running
+ *     @brief Number of tasks running.
+ * @var live_state_region_t::queued
+ *     @brief Number of tasks waiting to run.
+ * @var live_state_region_t::next_task_id
+ *     @brief Identifier that will be attributed to the next scheduled task.
+ * @var live_state_region_t::completed
+ *     @brief Number of tasks completed since the server started.
+ * @var live_state_region_t::failed
+ *     @brief Number of tasks completed with errors since the server started.
+ * @var live_state_region_t::running_tasks
+ *     @brief The first `min(running, ::LIVE_STATE_MAXIMUM_SLOTS)` running tasks.
+ * @var live_state_region_t::completions
+ *     @brief Ring of recently completed tasks. The most recent one is at index
+ *            `(completed - 1) % ::LIVE_STATE_COMPLETIONS`.
+ */
+typedef struct {
+    uint32_t          sequence;
+    uint32_t          version;
+    pid_t             server_pid;
+    uint32_t          policy;
+    uint32_t          slots, running, queued, next_task_id;
+    uint64_t          completed, failed;
+    live_state_task_t running_tasks[LIVE_STATE_MAXIMUM_SLOTS];
+    live_state_task_t completions[LIVE_STATE_COMPLETIONS];
+} live_state_region_t;
+
+/** @brief A shared memory region written to by the server. */
+typedef struct live_state live_state_t;
+
+/**
+ * @brief   Creates the file shared with readers and maps it into memory.
+ * @details A file left behind by a previous server is overwritten.
+ *
+ * @param server_pid PID of the server.
+ * @param policy     Scheduling policy of the server (a ::scheduler_policy_t).
+ *
+ * @return A region to write to on success, `NULL` on failure (check `errno`).
+ *
+ * | `errno`  | Cause                                                 |
+ * | -------- | ----------------------------------------------------- |
+ * | `ENOMEM` | Allocation failure.                                   |
+ * | other    | See `man 2 open`, `man 2 ftruncate` and `man 2 mmap`. |
+ */
+live_state_t *live_state_new(pid_t server_pid, uint32_t policy);
+
+/**
+ * @brief Unmaps and deletes the file shared with readers, and frees the memory used by a region.
+ * @param live_state Region to be deleted.
+ */
+void live_state_free(live_state_t *live_state);
+
+/**
+ * @brief   Starts updating a region.
+ * @details Readers will retry until ::live_state_end_update is called.
+ *
+ * @param  live_state Region to be updated. Mustn't be `NULL` (unchecked).
+ * @return The contents of @p live_state, to be written to.
+ */
+live_state_region_t *live_state_begin_update(live_state_t *live_state);
+
+/**
+ * @brief Finishes updating a region, making the changes visible to readers.
+ * @param live_state Region being updated. Mustn't be `NULL` (unchecked).
+ */
+void live_state_end_update(live_state_t *live_state);
+
+/**
+ * @brief Gets a consistent copy of the state published by the server.
+ *
+ * @param out Where to write the copy to. Mustn't be `NULL`.
+ *
+ * @retval 0 Success.
+ * @retval 1 Failure (check `errno`).
+ *
+ * | `errno`  | Cause                                                        |
+ * | -------- | ------------------------------------------------------------ |
+ * | `EINVAL` | @p out is `NULL`.                                            |
+ * | `ENOENT` | The server isn't running.                                    |
+ * | `ESRCH`  | The server that created the region isn't running anymore.    |
+ * | `EPROTO` | The region was created by a different version of the server. |
+ * | `EAGAIN` | The server kept updating the region while it was being read. |
+ * | other    | See `man 2 open`, `man 2 fstat` and `man 2 mmap`.            |
+ */
+int live_state_read(live_state_region_t *out);
+
+#endif
@@ -0,0 +1,72 @@
+/*
+ * Copyright 2024 Humberto Gomes, José Lopes, José Matos
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+/**
+ * @file    metrics.h
+ * @brief   Event counters shared between the server and all of its children.
+ * @details The server maps the counters in memory before forking any process, so that task runners
+ *          (and the schedulers' bookkeeping in the server) can count events with a single atomic
+ *          addition. In other processes, such as clients, counting does nothing.
+ */
+
+#ifndef METRICS_H
+#define METRICS_H
+
+#include <stdint.h>
+
+/** @brief Events counted in the shared counters. */
+typedef enum {
+    METRICS_COUNTER_SUBMITTED,      /**< @brief Tasks accepted by the server. */
+    METRICS_COUNTER_DISPATCHED,     /**< @brief Tasks taken from the queue to be run. */
+    METRICS_COUNTER_IPC_RETRIES,    /**< @brief Messages sent again by ::ipc_send_retry. */
+    METRICS_COUNTER_IPC_RECOVERED,  /**< @brief Synchronization errors recovered from. */
+    METRICS_COUNTER_DROPPED_FRAMES, /**< @brief Frames discarded by ::ipc_listen. */
+    METRICS_COUNTER_FORK_FAILURES,  /**< @brief Failed `fork()`s of runners and programs. */
+    METRICS_COUNTER_COUNT           /**< @brief Not a counter, but the number of counters. */
+} metrics_counter_t;
+
+/**
+ * @brief   Maps the counters in memory shared with future children, all starting at `0`.
+ * @details Must be called by the server before forking any process. Later calls fail.
+ *
+ * @retval 0 Success.
+ * @retval 1 Failure (check `errno`).
+ *
+ * | `errno`  | Cause                                             |
+ * | -------- | ------------------------------------------------- |
+ * | `EEXIST` | The counters were already mapped by this process. |
+ * | other    | See `man 2 open` and `man 2 mmap`.                |
+ */
+int metrics_init(void);
+
+/** @brief Unmaps the counters mapped by ::metrics_init, if they were mapped. */
+void metrics_free(void);
+
+/**
+ * @brief Adds to a counter, if the counters were mapped by this process or by its parent.
+ * @param counter Counter to be updated.
+ * @param value   Value to be added.
+ */
+void metrics_add(metrics_counter_t counter, uint64_t value);
+
+/**
+ * @brief  Reads a counter.
+ * @param  counter Counter to be read.
+ * @return The value of the counter (`0` if the counters weren't mapped).
+ */
+uint64_t metrics_get(metrics_counter_t counter);
+
+#endif
@@ -26,6 +26,7 @@
 #include <sys/types.h>
 
 #include "ipc.h"
+#include "server/statistics.h"
 #include "server/tagged_task.h"
 
 /* Ignore __attribute__((packed)) if it's unavailable. */
@@ -46,13 +47,24 @@ typedef enum {
     PROTOCOL_C2S_SEND_TASK,    /**< @brief Send a task that may contain pipelines to be executed. */
     PROTOCOL_C2S_TASK_DONE,    /**< @brief Server's child completed the execution of a task. */
     PROTOCOL_C2S_STATUS,       /**< @brief Client asks for the server's status. */
+    PROTOCOL_C2S_FOLLOW,       /**< @brief Client asks for the output of a running task. */
+    PROTOCOL_C2S_STATS,        /**< @brief Client asks for the aggregates of completed tasks. */
+    PROTOCOL_C2S_EXPORT,       /**< @brief Client asks for completed tasks to be exported. */
+    PROTOCOL_C2S_OUTPUT,       /**< @brief Client asks for the stored output of a task. */
 } protocol_c2s_msg_type;
 
 /** @brief Types of the messages sent from the server to the client. */
 typedef enum {
-    PROTOCOL_S2C_ERROR,   /**< @brief The server reports an error (a string) to the client. */
-    PROTOCOL_S2C_TASK_ID, /**< @brief Server received a task and returned its ID. */
-    PROTOCOL_S2C_STATUS,  /**< @brief Status response with a task. */
+    PROTOCOL_S2C_ERROR,        /**< @brief The server reports an error (a string) to the client. */
+    PROTOCOL_S2C_TASK_ID,      /**< @brief Server received a task and returned its ID. */
+    PROTOCOL_S2C_STATUS,       /**< @brief Status response with a task. */
+    PROTOCOL_S2C_POOL_STATUS,  /**< @brief Status response with the counters of a memory pool. */
+    PROTOCOL_S2C_STAGE_STATUS, /**< @brief Status response with the statistics of a task. */
+    PROTOCOL_S2C_FOLLOWING,    /**< @brief The task's runner was asked to stream its output. */
+    PROTOCOL_S2C_STATS_SERVER, /**< @brief Statistics response with the load of the server. */
+    PROTOCOL_S2C_STATS,        /**< @brief Statistics response with an aggregate of tasks. */
+    PROTOCOL_S2C_EXPORTED,     /**< @brief Completed tasks were written to a file. */
+    PROTOCOL_S2C_OUTPUT,       /**< @brief A task's output will be written to the client's pipe. */
 } protocol_s2c_msg_type;
 
 /** @brief The maximum length of protocol_send_program_task_message_t::command_line */
@@ -102,7 +114,7 @@ typedef struct __attribute__((packed)) {
  * @retval 1 Failure (check `errno`).
  *
  * | `errno`    | Cause                                                             |
- * | ---------- |  ---------------------------------------------------------------- |
+ * | ---------- | ----------------------------------------------------------------- |
  * | `EINVAL`   | @p out, @p out_size or @p command_line are `NULL`.                |
  * | `EMSGSIZE` | @p command_line is longer than ::PROTOCOL_MAXIMUM_COMMAND_LENGTH. |
  */
@@ -134,17 +146,36 @@ int protocol_send_program_task_message_check_length(size_t message_length, size_
  *     @brief Must be ::PROTOCOL_C2S_STATUS.
  * @var protocol_status_request_message_t::client_pid
  *     @brief PID of the client that sent this message.
+ * @var protocol_status_request_message_t::flags
+ *     @brief Bitwise OR of `PROTOCOL_STATUS_FLAG_*` values, with extra information to be sent.
+ * @var protocol_status_request_message_t::first_id
+ *     @brief Lowest identifier of the tasks to be reported.
+ * @var protocol_status_request_message_t::last_id
+ *     @brief Highest identifier of the tasks to be reported (`UINT32_MAX` for all tasks).
  */
 typedef struct __attribute__((packed)) {
     protocol_c2s_msg_type type : 8;
     pid_t                 client_pid;
+    uint8_t               flags;
+    uint32_t              first_id;
+    uint32_t              last_id;
 } protocol_status_request_message_t;
 
+/** @brief Flag in protocol_status_request_message_t::flags to also request memory pool counters. */
+#define PROTOCOL_STATUS_FLAG_POOLS 1
+
+/** @brief Flag in protocol_status_request_message_t::flags to also request stage statistics. */
+#define PROTOCOL_STATUS_FLAG_STAGES 2
+
+/** @brief Length of a ::protocol_task_done_message_t without any stages. */
+#define PROTOCOL_TASK_DONE_HEADER_LENGTH                                                           \
+    (sizeof(uint8_t) + sizeof(size_t) + sizeof(struct timespec) + 2 * sizeof(uint8_t))
+
 /**
  * @struct  protocol_task_done_message_t
  * @brief   Structure of a message that tells the server one of its children terminated.
- * @details A constructor and a message length checker isn't available for such a trivial message
- *          type.
+ * @details A constructor isn't available for such a trivial message type. Only as many stages as
+ *          the task has are sent (see ::PROTOCOL_TASK_DONE_HEADER_LENGTH).
  *
  * @var protocol_task_done_message_t::type
  *     @brief Must be ::PROTOCOL_C2S_TASK_DONE.
@@ -156,6 +187,8 @@ typedef struct __attribute__((packed)) {
  *     @brief If the scheduled task is a status task.
  * @var protocol_task_done_message_t::error
  *     @brief Whether running the task resulted in an error.
+ * @var protocol_task_done_message_t::stages
+ *     @brief Statistics of the first ::TAGGED_TASK_MAXIMUM_STAGES programs in the task.
  */
 typedef struct __attribute__((packed)) {
     protocol_c2s_msg_type type : 8;
@@ -163,8 +196,21 @@ typedef struct __attribute__((packed)) {
     struct timespec       time_ended;
     uint8_t               is_status;
     uint8_t               error;
+    tagged_task_stage_t   stages[TAGGED_TASK_MAXIMUM_STAGES];
 } protocol_task_done_message_t;
 
+/**
+ * @brief Checks if a received ::protocol_task_done_message_t can have a given length.
+ *
+ * @param message_length Length of the received message.
+ * @param stage_count    Where to write (on success) the number of elements in
+ *                       protocol_task_done_message_t::stages to. Mustn't be `NULL`.
+ *
+ * @retval 0 Invalid length or `NULL` @p stage_count (in this last case, `errno = EINVAL`).
+ * @retval 1 Valid length.
+ */
+int protocol_task_done_message_check_length(size_t message_length, size_t *stage_count);
+
 /** @brief The maximum length of protocol_error_message_t::error. */
 #define PROTOCOL_MAXIMUM_ERROR_LENGTH (IPC_MAXIMUM_MESSAGE_LENGTH - sizeof(uint8_t))
 
@@ -195,7 +241,7 @@ typedef struct __attribute__((packed)) {
  * @retval 1 Failure (check `errno`).
  *
  * | `errno`    | Cause                                                    |
- * | ---------- |  ------------------------------------------------------- |
+ * | ---------- | -------------------------------------------------------- |
  * | `EINVAL`   | @p out, @p out_size or @p error are `NULL`.              |
  * | `EMSGSIZE` | @p error is longer than ::PROTOCOL_MAXIMUM_ERROR_LENGTH. |
  */
@@ -291,7 +337,7 @@ typedef struct __attribute__((packed)) {
  * @retval 1 Failure (check `errno`).
  *
  * | `errno`    | Cause                                                    |
- * | ---------- |  ------------------------------------------------------- |
+ * | ---------- | -------------------------------------------------------- |
  * | `EINVAL`   | @p out, @p out_size or @p error are `NULL`.              |
  * | `EMSGSIZE` | @p error is longer than ::PROTOCOL_MAXIMUM_ERROR_LENGTH. |
  */
@@ -315,4 +361,334 @@ int protocol_status_response_message_new(
  */
 int protocol_status_response_message_check_length(size_t message_length, size_t *command_length);
 
+/**
+ * @struct  protocol_pool_status_message_t
+ * @brief   Structure of a message that tells the client the usage counters of a memory pool.
+ * @details A constructor and a message length checker isn't available for such a trivial message
+ *          type. See ::pool_statistics_t for the meaning of each field.
+ *
+ * @var protocol_pool_status_message_t::type
+ *     @brief Must be ::PROTOCOL_S2C_POOL_STATUS.
+ * @var protocol_pool_status_message_t::object_size
+ *     @brief Size of objects in the pool. `0` for objects too large to be pooled.
+ * @var protocol_pool_status_message_t::used
+ *     @brief Number of objects currently allocated.
+ * @var protocol_pool_status_message_t::free
+ *     @brief Number of objects that can be allocated without a system allocator call.
+ * @var protocol_pool_status_message_t::slabs
+ *     @brief Number of slabs currently allocated.
+ * @var protocol_pool_status_message_t::allocations
+ *     @brief Total number of objects allocated.
+ * @var protocol_pool_status_message_t::system_allocations
+ *     @brief Total number of calls to the system allocator.
+ */
+typedef struct __attribute__((packed)) {
+    protocol_s2c_msg_type type : 8;
+    uint64_t              object_size;
+    uint64_t              used, free, slabs;
+    uint64_t              allocations, system_allocations;
+} protocol_pool_status_message_t;
+
+/**
+ * @struct  protocol_stage_status_message_t
+ * @brief   Structure of a message that tells the client the statistics of the stages of a task.
+ * @details A constructor isn't available for such a trivial message type. Only as many stages as
+ *          the task has are sent.
+ *
+ * @var protocol_stage_status_message_t::type
+ *     @brief Must be ::PROTOCOL_S2C_STAGE_STATUS.
+ * @var protocol_stage_status_message_t::id
+ *     @brief Identifier of the task.
+ * @var protocol_stage_status_message_t::stages
+ *     @brief Statistics of each stage of the task.
+ */
+typedef struct __attribute__((packed)) {
+    protocol_s2c_msg_type type : 8;
+    uint32_t              id;
+    tagged_task_stage_t   stages[TAGGED_TASK_MAXIMUM_STAGES];
+} protocol_stage_status_message_t;
+
+/** @brief Length of a ::protocol_stage_status_message_t without any stages. */
+#define PROTOCOL_STAGE_STATUS_HEADER_LENGTH (sizeof(uint8_t) + sizeof(uint32_t))
+
+/**
+ * @brief Checks if a received ::protocol_stage_status_message_t can have a given length.
+ *
+ * @param message_length Length of the received message.
+ * @param stage_count    Where to write (on success) the number of elements in
+ *                       protocol_stage_status_message_t::stages to. Mustn't be `NULL`.
+ *
+ * @retval 0 Invalid length or `NULL` @p stage_count (in this last case, `errno = EINVAL`).
+ * @retval 1 Valid length.
+ */
+int protocol_stage_status_message_check_length(size_t message_length, size_t *stage_count);
+
+/**
+ * @struct  protocol_follow_request_message_t
+ * @brief   Structure of a message asking a server to stream the output of a running task.
+ * @details A constructor and a message length checker isn't available for such a trivial message
+ *          type. Before sending this message, the client must have opened the named pipes given by
+ *          ::ipc_get_follow_fifo_path for reading.
+ *
+ * @var protocol_follow_request_message_t::type
+ *     @brief Must be ::PROTOCOL_C2S_FOLLOW.
+ * @var protocol_follow_request_message_t::client_pid
+ *     @brief PID of the client that sent this message.
+ * @var protocol_follow_request_message_t::id
+ *     @brief Identifier of the task to be followed.
+ */
+typedef struct __attribute__((packed)) {
+    protocol_c2s_msg_type type : 8;
+    pid_t                 client_pid;
+    uint32_t              id;
+} protocol_follow_request_message_t;
+
+/**
+ * @struct  protocol_following_message_t
+ * @brief   Structure of a message that tells the client that its task's output will be streamed.
+ * @details A constructor and a message length checker isn't available for such a trivial message
+ *          type.
+ *
+ * @var protocol_following_message_t::type
+ *     @brief Must be ::PROTOCOL_S2C_FOLLOWING.
+ * @var protocol_following_message_t::runner_pid
+ *     @brief   PID of the process running the task.
+ *     @details The client can use it to know if the task terminated before its output streams were
+ *              opened.
+ */
+typedef struct __attribute__((packed)) {
+    protocol_s2c_msg_type type : 8;
+    pid_t                 runner_pid;
+} protocol_following_message_t;
+
+/**
+ * @struct  protocol_stats_request_message_t
+ * @brief   Structure of a message asking a server for the aggregates of completed tasks.
+ * @details A constructor and a message length checker isn't available for such a trivial message
+ *          type.
+ *
+ * @var protocol_stats_request_message_t::type
+ *     @brief Must be ::PROTOCOL_C2S_STATS.
+ * @var protocol_stats_request_message_t::client_pid
+ *     @brief PID of the client that sent this message.
+ */
+typedef struct __attribute__((packed)) {
+    protocol_c2s_msg_type type : 8;
+    pid_t                 client_pid;
+} protocol_stats_request_message_t;
+
+/**
+ * @struct  protocol_stats_server_message_t
+ * @brief   Structure of a message that tells the client the current load of the server.
+ * @details A constructor and a message length checker isn't available for such a trivial message
+ *          type. This message is sent before any ::protocol_stats_message_t.
+ *
+ * @var protocol_stats_server_message_t::type
+ *     @brief Must be ::PROTOCOL_S2C_STATS_SERVER.
+ * @var protocol_stats_server_message_t::policy
+ *     @brief The server's ::scheduler_policy_t.
+ * @var protocol_stats_server_message_t::slots
+ *     @brief Maximum number of concurrent tasks.
+ * @var protocol_stats_server_message_t::running
+ *     @brief Number of tasks running.
+ * @var protocol_stats_server_message_t::queued
+ *     @brief Number of tasks waiting to run (queue depth).
+ * @var protocol_stats_server_message_t::uptime
+ *     @brief Nanoseconds during which the aggregates were kept (see ::statistics_get_uptime).
+ */
+typedef struct __attribute__((packed)) {
+    protocol_s2c_msg_type type : 8;
+    uint8_t               policy;
+    uint64_t              slots, running, queued;
+    uint64_t              uptime;
+} protocol_stats_server_message_t;
+
+/**
+ * @struct protocol_stats_time_t
+ * @brief  Summary of a ::statistics_histogram_t. All times are in nanoseconds.
+ *
+ * @var protocol_stats_time_t::count
+ *     @brief See statistics_histogram_t::count.
+ * @var protocol_stats_time_t::mean
+ *     @brief Mean of all values.
+ * @var protocol_stats_time_t::min
+ *     @brief See statistics_histogram_t::min.
+ * @var protocol_stats_time_t::p50
+ *     @brief Median.
+ * @var protocol_stats_time_t::p90
+ *     @brief 90th percentile.
+ * @var protocol_stats_time_t::p99
+ *     @brief 99th percentile.
+ * @var protocol_stats_time_t::max
+ *     @brief See statistics_histogram_t::max.
+ */
+typedef struct __attribute__((packed)) {
+    uint64_t count, mean, min, p50, p90, p99, max;
+} protocol_stats_time_t;
+
+/**
+ * @struct  protocol_stats_message_t
+ * @brief   Structure of a message that tells the client an aggregate of completed tasks.
+ * @details A constructor and a message length checker isn't available for such a trivial message
+ *          type. One message is sent for every aggregate (see ::STATISTICS_AGGREGATE_COUNT), in
+ *          order.
+ *
+ * @var protocol_stats_message_t::type
+ *     @brief Must be ::PROTOCOL_S2C_STATS.
+ * @var protocol_stats_message_t::min_expected_time
+ *     @brief Lowest expected time (milliseconds) of the tasks in the aggregate.
+ * @var protocol_stats_message_t::max_expected_time
+ *     @brief Highest expected time (milliseconds) of the tasks in the aggregate.
+ * @var protocol_stats_message_t::task_count
+ *     @brief Number of completed tasks.
+ * @var protocol_stats_message_t::error_count
+ *     @brief Number of tasks that failed.
+ * @var protocol_stats_message_t::times
+ *     @brief Summary of each ::statistics_time_t.
+ */
+typedef struct __attribute__((packed)) {
+    protocol_s2c_msg_type type : 8;
+    uint32_t              min_expected_time, max_expected_time;
+    uint64_t              task_count, error_count;
+    protocol_stats_time_t times[STATISTICS_TIME_COUNT];
+} protocol_stats_message_t;
+
+/** @brief Format of the file written for a ::protocol_export_request_message_t. */
+typedef enum {
+    PROTOCOL_EXPORT_FORMAT_LOG, /**< @brief Log file, with records copied from the server log. */
+    PROTOCOL_EXPORT_FORMAT_CSV  /**< @brief Comma-separated values, as output by `logdump`. */
+} protocol_export_format_t;
+
+/** @brief The maximum length of protocol_export_request_message_t::path. */
+#define PROTOCOL_MAXIMUM_EXPORT_PATH_LENGTH                                                        \
+    (IPC_MAXIMUM_MESSAGE_LENGTH - 2 * sizeof(uint8_t) - sizeof(pid_t) - 2 * sizeof(uint32_t))
+
+/**
+ * @struct protocol_export_request_message_t
+ * @brief  Structure of a message asking the server to write completed tasks to a file.
+ *
+ * @var protocol_export_request_message_t::type
+ *     @brief Must be ::PROTOCOL_C2S_EXPORT.
+ * @var protocol_export_request_message_t::client_pid
+ *     @brief PID of the client that sent this message.
+ * @var protocol_export_request_message_t::format
+ *     @brief Format of the file (a ::protocol_export_format_t).
+ * @var protocol_export_request_message_t::first_id
+ *     @brief Lowest identifier of the tasks to be exported.
+ * @var protocol_export_request_message_t::last_id
+ *     @brief Highest identifier of the tasks to be exported.
+ * @var protocol_export_request_message_t::path
+ *     @brief   Absolute path of the file, that must already exist.
+ *     @details Like protocol_send_program_task_message_t::command_line, this string isn't
+ *              null-terminated.
+ */
+typedef struct __attribute__((packed)) {
+    protocol_c2s_msg_type type : 8;
+    pid_t                 client_pid;
+    uint8_t               format;
+    uint32_t              first_id, last_id;
+    char                  path[PROTOCOL_MAXIMUM_EXPORT_PATH_LENGTH];
+} protocol_export_request_message_t;
+
+/**
+ * @brief Creates a new message asking the server to write completed tasks to a file.
+ *
+ * @param out      Where to output the message to. Mustn't be `NULL`. Will only be modified when
+ *                 this function succeeds.
+ * @param out_size Where to output the number of bytes in the final message to. Mustn't be `NULL`.
+ *                 Will only be set when this function succeeds.
+ * @param format   Format of the file.
+ * @param first_id Lowest identifier of the tasks to be exported.
+ * @param last_id  Highest identifier of the tasks to be exported.
+ * @param path     Absolute path of the file. Mustn't be `NULL`.
+ *
+ * @retval 0 Success.
+ * @retval 1 Failure (check `errno`).
+ *
+ * | `errno`    | Cause                                                         |
+ * | ---------- | ------------------------------------------------------------- |
+ * | `EINVAL`   | @p out, @p out_size or @p path are `NULL`.                    |
+ * | `EMSGSIZE` | @p path is longer than ::PROTOCOL_MAXIMUM_EXPORT_PATH_LENGTH. |
+ */
+int protocol_export_request_message_new(protocol_export_request_message_t *out,
+                                        size_t                            *out_size,
+                                        protocol_export_format_t           format,
+                                        uint32_t                           first_id,
+                                        uint32_t                           last_id,
+                                        const char                        *path);
+
+/**
+ * @brief Checks if a received ::protocol_export_request_message_t can have a given length.
+ *
+ * @param message_length Length of the received message.
+ * @param path_length    Where to write (on success) the length of
+ *                       protocol_export_request_message_t::path to. Mustn't be `NULL`.
+ *
+ * @retval 0 Too long, too short or `NULL` @p path_length (in this last case, `errno = EINVAL`).
+ * @retval 1 Valid length.
+ */
+int protocol_export_request_message_check_length(size_t message_length, size_t *path_length);
+
+/**
+ * @struct  protocol_exported_message_t
+ * @brief   Structure of a message that tells the client that tasks were written to a file.
+ * @details A constructor and a message length checker isn't available for such a trivial message
+ *          type.
+ *
+ * @var protocol_exported_message_t::type
+ *     @brief Must be ::PROTOCOL_S2C_EXPORTED.
+ * @var protocol_exported_message_t::task_count
+ *     @brief Number of tasks written to the file.
+ * @var protocol_exported_message_t::size
+ *     @brief Size of the file, in bytes.
+ */
+typedef struct __attribute__((packed)) {
+    protocol_s2c_msg_type type : 8;
+    uint64_t              task_count, size;
+} protocol_exported_message_t;
+
+/**
+ * @struct  protocol_output_request_message_t
+ * @brief   Structure of a message asking a server for the stored output of a task.
+ * @details A constructor and a message length checker isn't available for such a trivial message
+ *          type. Before sending this message, the client must have opened the named pipe given by
+ *          ::ipc_get_follow_fifo_path for reading, for the stream it asked for.
+ *
+ * @var protocol_output_request_message_t::type
+ *     @brief Must be ::PROTOCOL_C2S_OUTPUT.
+ * @var protocol_output_request_message_t::client_pid
+ *     @brief PID of the client that sent this message.
+ * @var protocol_output_request_message_t::id
+ *     @brief Identifier of the task whose output is wanted.
+ * @var protocol_output_request_message_t::stream
+ *     @brief `STDOUT_FILENO` or `STDERR_FILENO`.
+ * @var protocol_output_request_message_t::first_byte
+ *     @brief Offset of the first byte of the output to be sent.
+ * @var protocol_output_request_message_t::last_byte
+ *     @brief Offset of the last byte of the output to be sent (`UINT64_MAX` for the whole output).
+ */
+typedef struct __attribute__((packed)) {
+    protocol_c2s_msg_type type : 8;
+    pid_t                 client_pid;
+    uint32_t              id;
+    uint8_t               stream;
+    uint64_t              first_byte, last_byte;
+} protocol_output_request_message_t;
+
+/**
+ * @struct  protocol_output_message_t
+ * @brief   Structure of a message that tells the client that a task's output will be sent.
+ * @details A constructor and a message length checker isn't available for such a trivial message
+ *          type. The output is written to the client's named pipe after this message is sent.
+ *
+ * @var protocol_output_message_t::type
+ *     @brief Must be ::PROTOCOL_S2C_OUTPUT.
+ * @var protocol_output_message_t::size
+ *     @brief Number of bytes that will be written to the client's named pipe.
+ */
+typedef struct __attribute__((packed)) {
+    protocol_s2c_msg_type type : 8;
+    uint64_t              size;
+} protocol_output_message_t;
+
 #endif
@@ -25,7 +25,12 @@
 #include <server/task.h>
 
 /**
- * @brief Parses a command line.
+ * @brief   Parses a command line.
+ * @details Parsing is done into buffers shared by every call, kept between calls to avoid
+ *          allocations. Thus, this function isn't reentrant nor thread-safe: it must only be called
+ *          by one thread of a process (in the orchestrator, the main thread). After a `fork()`,
+ *          each process has its own buffers.
+ *
  * @param command_line Command line to be parsed.
  *
  * @return On success, a task composed of either a single program or a pipeline. On failure, `NULL`
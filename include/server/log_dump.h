@@ -0,0 +1,115 @@
+/*
+ * Copyright 2024 Humberto Gomes, José Lopes, José Matos
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+/**
+ * @file    server/log_dump.h
+ * @brief   Conversion of log files to formats meant for offline analysis.
+ * @details Records are streamed from the log file (see ::log_file_read_records), so memory usage
+ *          doesn't depend on the size of the log. Timestamps are written as they're stored
+ *          (nanoseconds of `CLOCK_MONOTONIC`), along with the durations derived from them.
+ */
+
+#ifndef LOG_DUMP_H
+#define LOG_DUMP_H
+
+#include <inttypes.h>
+#include <stdio.h>
+
+#include "server/log_file.h"
+
+/** @brief Output format of a log dump. */
+typedef enum {
+    LOG_DUMP_FORMAT_CSV,       /**< @brief Comma-separated values, with a header line. */
+    LOG_DUMP_FORMAT_JSON_LINES /**< @brief One JSON object per line. */
+} log_dump_format_t;
+
+/**
+ * @struct log_dump_options_t
+ * @brief  Format and filters of a log dump.
+ *
+ * @var log_dump_options_t::format
+ *     @brief Output format.
+ * @var log_dump_options_t::first_id
+ *     @brief Lowest identifier of the tasks to be output.
+ * @var log_dump_options_t::last_id
+ *     @brief Highest identifier of the tasks to be output.
+ * @var log_dump_options_t::since
+ *     @brief   Tasks completed before this (nanoseconds since the Unix epoch) aren't output.
+ *     @details Compared to log_file_record_t::logged_at, that, unlike the other times of a task,
+ *              is still meaningful after a reboot. Tasks without it aren't output when
+ *              log_dump_options_t::since or log_dump_options_t::until are set.
+ * @var log_dump_options_t::until
+ *     @brief Tasks completed after this (nanoseconds since the Unix epoch) aren't output.
+ */
+typedef struct {
+    log_dump_format_t format;
+    uint32_t          first_id, last_id;
+    uint64_t          since, until;
+} log_dump_options_t;
+
+/**
+ * @brief Writes what must come before all records (the CSV header line).
+ *
+ * @param options Format of the dump. Mustn't be `NULL`.
+ * @param out     Where to write to. Mustn't be `NULL`.
+ *
+ * @retval 0 Success.
+ * @retval 1 Failure (check `errno`).
+ *
+ * | `errno`  | Cause                            |
+ * | -------- | -------------------------------- |
+ * | `EINVAL` | @p options or @p out are `NULL`. |
+ * | other    | See `man 3 fputs`.               |
+ */
+int log_dump_write_header(const log_dump_options_t *options, FILE *out);
+
+/**
+ * @brief Writes a record, if it passes the filters in @p options.
+ *
+ * @param record  Record to be written. Mustn't be `NULL`.
+ * @param options Format and filters of the dump. Mustn't be `NULL`.
+ * @param out     Where to write to. Mustn't be `NULL`.
+ *
+ * @retval 0 Success.
+ * @retval 1 Failure (check `errno`).
+ *
+ * | `errno`  | Cause                                       |
+ * | -------- | ------------------------------------------- |
+ * | `EINVAL` | @p record, @p options or @p out are `NULL`. |
+ * | other    | See `man 3 fputs`.                          |
+ */
+int log_dump_record(const log_file_record_t *record, const log_dump_options_t *options, FILE *out);
+
+/**
+ * @brief   Writes the records in a log file that pass the filters in @p options.
+ * @details Log files of all versions are supported, including segments of a log store.
+ *
+ * @param path    Path to the log file. Mustn't be `NULL`.
+ * @param options Format and filters of the dump. Mustn't be `NULL`.
+ * @param out     Where to write to. Mustn't be `NULL`.
+ *
+ * @retval 0 Success.
+ * @retval 1 Failure (check `errno`).
+ *
+ * | `errno`  | Cause                                                    |
+ * | -------- | -------------------------------------------------------- |
+ * | `EINVAL` | @p path, @p options or @p out are `NULL`.                |
+ * | `EILSEQ` | Invalid or truncated log file.                           |
+ * | other    | See ::log_file_new, ::log_file_read_records and `fputs`. |
+ */
+int log_dump_file(const char *path, const log_dump_options_t *options, FILE *out);
+
+#endif
@@ -22,6 +22,7 @@
 #ifndef LOG_FILE_H
 #define LOG_FILE_H
 
+#include "server/log_writer.h"
 #include "server/tagged_task.h"
 
 /** @brief A handle for an open log file. */
@@ -41,33 +42,107 @@ typedef struct log_file log_file_t;
  */
 typedef int (*log_file_task_callback_t)(const tagged_task_t *task, int error, void *state);
 
+/**
+ * @struct  log_file_record_t
+ * @brief   View of a task in a log file.
+ * @details Handed out by ::log_file_read_records without any allocation. It's only valid during the
+ *          callback it's passed to.
+ *
+ * @var log_file_record_t::id
+ *     @brief See tagged_task::id.
+ * @var log_file_record_t::expected_time
+ *     @brief See tagged_task::expected_time.
+ * @var log_file_record_t::error
+ *     @brief Whether an error occurred while running this task.
+ * @var log_file_record_t::times
+ *     @brief See tagged_task::times. Times that were never set are zero.
+ * @var log_file_record_t::logged_at
+ *     @brief   Wall-clock time (`CLOCK_REALTIME`) at which the task was logged, right after it
+ *              completed.
+ *     @details Unlike log_file_record_t::times, that come from `CLOCK_MONOTONIC`, this can be
+ *              compared across reboots. Zero for tasks logged by older versions of the server.
+ * @var log_file_record_t::stage_count
+ *     @brief Number of valid elements in log_file_record_t::stages.
+ * @var log_file_record_t::stages
+ *     @brief See tagged_task::stages.
+ * @var log_file_record_t::command_line
+ *     @brief   See tagged_task::command_line. **Not null-terminated.**
+ *     @details Points to memory owned by the log file.
+ * @var log_file_record_t::command_length
+ *     @brief Number of characters in log_file_record_t::command_line.
+ * @var log_file_record_t::offset
+ *     @brief   Offset of the record in the log file.
+ *     @details Can be passed to ::log_file_read_record_at, even if the record hasn't reached the
+ *              file yet.
+ */
+typedef struct {
+    uint32_t            id, expected_time;
+    int                 error;
+    struct timespec     times[TAGGED_TASK_TIME_COMPLETED + 1];
+    struct timespec     logged_at;
+    size_t              stage_count;
+    tagged_task_stage_t stages[TAGGED_TASK_MAXIMUM_STAGES];
+    const char         *command_line;
+    size_t              command_length;
+    size_t              offset;
+} log_file_record_t;
+
+/**
+ * @brief   Callback called for every record in a log file.
+ * @details See ::log_file_read_records.
+ *
+ * @param record Record read from file.
+ * @param state  Pointer passed to ::log_file_read_records so that this procedure can modify the
+ *               program's state.
+ *
+ * @retval 0 Success.
+ * @retval 1 Failure. Stop log file iteration.
+ */
+typedef int (*log_file_record_callback_t)(const log_file_record_t *record, void *state);
+
 /**
  * @brief   Opens a new log file for reading or for writing.
  * @details If the specified file already exists and @p writable is true, the file's contents will
- *          be deleted.
+ *          be deleted. New files are written with compact variable-length records, but files with
+ *          the older fixed-size records (and no header) can still be opened for reading.
+ *
+ *          Records are written asynchronously by a ::log_writer_t, so ::log_file_write_task doesn't
+ *          wait for the disk.
  *
- * @param path     Path to the file to be opened.
- * @param writable Whether the file can be written to. Reading will still be possible if this is
- *                 `1`.
+ * @param path       Path to the file to be opened.
+ * @param writable   Whether the file can be written to. Reading will still be possible if this is
+ *                   `1`.
+ * @param durability When to synchronize written records to the disk. Ignored if @p writable is `0`.
  *
  * @return A new handle for a log file on success, `NULL` on failure (check `errno`).
  *
- * | `errno`  | Cause                                     |
- * | -------- | ----------------------------------------- |
- * | `EINVAL` | @p path is `NULL`.                        |
- * | `ENOMEM` | Allocation failure (or see `man 2 open`). |
- * | other    | See `man 2 open`.                         |
+ * | `errno`  | Cause                                                                |
+ * | -------- | -------------------------------------------------------------------- |
+ * | `EINVAL` | @p path is `NULL`.                                                   |
+ * | `ENOMEM` | Allocation failure (or see `man 2 open`).                            |
+ * | `EILSEQ` | Unsupported log file version.                                        |
+ * | other    | See `man 2 open`, `read`, `write` and `fstat`, and ::log_writer_new. |
  */
-log_file_t *log_file_new(const char *path, int writable);
+log_file_t *log_file_new(const char *path, int writable, log_writer_durability_t durability);
 
 /**
- * @brief Frees the memory of a log file, closing its file descriptor.
- * @param log_file Log file to be freed.
+ * @brief   Frees the memory of a log file, closing its file descriptor.
+ * @details Waits for all tasks written to the file to reach it.
+ * @param   log_file Log file to be freed.
  */
 void log_file_free(log_file_t *log_file);
 
 /**
- * @brief Writes a task to a log file.
+ * @brief   Lets the tasks written to a log file reach it in the background, without waiting.
+ * @details Nothing else can be written to the file afterwards, but it can still be read, including
+ *          the tasks that haven't reached it yet. ::log_file_free must still be called.
+ * @param   log_file Log file to stop writing to. Can be `NULL`.
+ */
+void log_file_stop_writing(log_file_t *log_file);
+
+/**
+ * @brief   Writes a task to a log file.
+ * @details The task is queued for writing, and write errors are later printed to `stderr`.
  *
  * @param log_file Log file to write @p task to. Mustn't be `NULL` and must be writable.
  * @param task     Task to be written to @p log_file. Mustn't be `NULL`.
@@ -80,13 +155,71 @@ void log_file_free(log_file_t *log_file);
  * | ---------- | --------------------------------------------------------- |
  * | `EINVAL`   | @p log_file `NULL` or not writable, or @p task is `NULL`. |
  * | `EMSGSIZE` | tagged_task_t::command_line is too long.                  |
- * | other      | See `man 2 write`.                                        |
+ * | `EPIPE`    | ::log_file_stop_writing was called.                       |
  */
 int log_file_write_task(log_file_t *log_file, const tagged_task_t *task, int error);
 
+/**
+ * @brief   Gets the size of a log file.
+ * @details Tasks written to the file are included, even if they haven't reached the disk yet.
+ *
+ * @param log_file Log file to get the size of. Mustn't be `NULL`.
+ * @return The size of the file in bytes, or `0` on failure (`errno = EINVAL`).
+ */
+size_t log_file_get_size(const log_file_t *log_file);
+
+/**
+ * @brief   Reads all records from a log file, without allocating or parsing command lines.
+ * @details The file is mapped to memory, and records are decoded from there in order. Records that
+ *          were written but haven't reached the file yet are also read. Invalid records will be
+ *          reported to `stderr`.
+ *
+ * @param log_file  Log file to read from. Mustn't be `NULL`.
+ * @param record_cb Callback to be called for every record. Mustn't be `NULL`.
+ * @param state     Pointer passed to @p record_cb so that it can modify the program's state.
+ *
+ * @retval 0     Success.
+ * @retval 1     Failure.
+ * @retval other Value returned by @p record_cb on failure.
+ *
+ * | `errno`  | Cause                                   |
+ * | -------- | --------------------------------------- |
+ * | `EINVAL` | @p log_file or @p record_cb are `NULL`. |
+ * | `ENOMEM` | Allocation failure.                     |
+ * | `EILSEQ` | Invalid file contents.                  |
+ * | other    | See `man 2 fstat`, `man 2 mmap`.        |
+ */
+int log_file_read_records(log_file_t *log_file, log_file_record_callback_t record_cb, void *state);
+
+/**
+ * @brief   Reads a single record from a log file.
+ * @details Records that haven't reached the file yet are read from its writer.
+ *
+ * @param log_file  Log file to read from. Mustn't be `NULL`.
+ * @param offset    Offset of the record (see log_file_record_t::offset).
+ * @param record_cb Callback called with the record. Mustn't be `NULL`.
+ * @param state     Pointer passed to @p record_cb so that it can modify the program's state.
+ *
+ * @retval 0     Success.
+ * @retval 1     Failure (check `errno`).
+ * @retval other Value returned by @p record_cb on failure.
+ *
+ * | `errno`  | Cause                                   |
+ * | -------- | --------------------------------------- |
+ * | `EINVAL` | @p log_file or @p record_cb are `NULL`. |
+ * | `EILSEQ` | No valid record at @p offset.           |
+ * | other    | See `man 2 pread`.                      |
+ */
+int log_file_read_record_at(log_file_t                *log_file,
+                            size_t                     offset,
+                            log_file_record_callback_t record_cb,
+                            void                      *state);
+
 /**
  * @brief   Reads all tasks from a log file.
- * @details Deserialization errors will be written to `stderr`.
+ * @details Built on top of ::log_file_read_records, but every record is turned into a
+ *          ::tagged_task_t, which requires parsing its command line. Tasks that were written but
+ *          haven't reached the file yet are also read.
  *
  * @param log_file Log file to read from. Mustn't be `NULL`.
  * @param task_cb  Callback to be called for every task. Mustn't be `NULL`.
@@ -96,13 +229,52 @@ int log_file_write_task(log_file_t *log_file, const tagged_task_t *task, int err
  * @retval 1     Failure.
  * @retval other Value returned by @p task_cb on failure.
  *
- * | `errno`  | Cause                                           |
- * | -------- | ----------------------------------------------- |
- * | `EINVAL` | @p log_file or @p task_cb are `NULL`.           |
- * | `ENOMEM` | Allocation failure (or see man 2 open``).       |
- * | `EILSEQ` | Invalid file contents.                          |
- * | other    | See `man 2 lseek`, `man 2 open`, or @p task_cb. |
+ * | `errno`  | Cause                                       |
+ * | -------- | ------------------------------------------- |
+ * | `EINVAL` | @p log_file or @p task_cb are `NULL`.       |
+ * | `ENOMEM` | Allocation failure.                         |
+ * | `EILSEQ` | Invalid file contents.                      |
+ * | other    | See ::log_file_read_records, or @p task_cb. |
  */
 int log_file_read_tasks(log_file_t *log_file, log_file_task_callback_t task_cb, void *state);
 
+/**
+ * @brief   Writes the header of a new log file.
+ * @details Records copied after the header with ::log_file_copy_records form a valid log file.
+ *
+ * @param fd File to write to, at its current offset.
+ *
+ * @retval 0 Success.
+ * @retval 1 Failure (check `errno`, see `man 2 write`).
+ */
+int log_file_write_header(int fd);
+
+/**
+ * @brief   Copies the records with identifiers in a range from a log file to another file.
+ * @details Records are copied as they are, with `copy_file_range()` when possible, so this is only
+ *          supported for files in the current format. Records that haven't reached the file yet are
+ *          copied from its writer.
+ *
+ * @param log_file Log file to copy records from. Mustn't be `NULL`.
+ * @param first_id Lowest identifier of the records to be copied.
+ * @param last_id  Highest identifier of the records to be copied.
+ * @param out      File to copy records to, at its current offset.
+ * @param count    Where to write the number of records copied to. Mustn't be `NULL`.
+ *
+ * @retval 0 Success.
+ * @retval 1 Failure (check `errno`).
+ *
+ * | `errno`  | Cause                                                         |
+ * | -------- | ------------------------------------------------------------- |
+ * | `EINVAL` | @p log_file or @p count are `NULL`.                           |
+ * | `ENOMEM` | Allocation failure.                                           |
+ * | `EILSEQ` | Log file in an older format, or invalid file contents.        |
+ * | other    | See ::log_file_read_records, `man 2 pread` and `man 2 write`. |
+ */
+int log_file_copy_records(log_file_t *log_file,
+                          uint32_t    first_id,
+                          uint32_t    last_id,
+                          int         out,
+                          size_t     *count);
+
 #endif
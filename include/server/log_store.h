@@ -0,0 +1,298 @@
+/*
+ * Copyright 2024 Humberto Gomes, José Lopes, José Matos
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+/**
+ * @file    server/log_store.h
+ * @brief   Segmented log of completed tasks, that persists across server restarts.
+ * @details Tasks are logged to segment files (`log/<sequence>.log` in the server's directory), each
+ *          a ::log_file_t. The last segment is the only one written to, and a new one is started
+ *          when it grows too large or too old, or when the server restarts.
+ *
+ *          When the size of all older segments exceeds a limit, the oldest ones are compacted:
+ *          each is replaced by a ::log_store_summary_t, appended to `log/summaries.bin`. This reads
+ *          whole segments, so it's left for another process (see ::log_store_compact). Once the
+ *          summary file has ::LOG_STORE_MAXIMUM_SUMMARIES summaries, they're merged into one, so
+ *          the summary file is bounded too, but not accounted for in the limit.
+ *
+ *          The range of task identifiers in every segment is kept in memory, so that reads for a
+ *          range of identifiers only open the segments that may contain them. Every segment also
+ *          has an index of task identifiers, with the location of each task's record: it's kept in
+ *          memory for the segment being written to, and written to `log/<first_id>.idx` (`first_id`
+ *          being the lowest identifier in the segment) and mapped to memory for the others. Indexes
+ *          are deleted with their segments when these are compacted.
+ */
+
+#ifndef LOG_STORE_H
+#define LOG_STORE_H
+
+#include <stdint.h>
+#include <time.h>
+
+#include "server/log_file.h"
+
+/**
+ * @struct log_store_options_t
+ * @brief  Configuration of a ::log_store_t.
+ *
+ * @var log_store_options_t::durability
+ *     @brief When records written to segments are synchronized to the disk.
+ * @var log_store_options_t::segment_size
+ *     @brief Size in bytes after which a new segment is started.
+ * @var log_store_options_t::segment_age
+ *     @brief Age in seconds after which a new segment is started. `0` to disable.
+ * @var log_store_options_t::maximum_size
+ *     @brief   Maximum number of bytes in segments other than the one being written to.
+ *     @details Older segments are compacted when this is exceeded (see ::log_store_compact). `0`
+ *              for no limit.
+ */
+typedef struct {
+    log_writer_durability_t durability;
+    size_t                  segment_size;
+    time_t                  segment_age;
+    size_t                  maximum_size;
+} log_store_options_t;
+
+/** @brief Default value of log_store_options_t::segment_size. */
+#define LOG_STORE_DEFAULT_SEGMENT_SIZE (4 * 1024 * 1024)
+
+/** @brief Default value of log_store_options_t::maximum_size. */
+#define LOG_STORE_DEFAULT_MAXIMUM_SIZE (256 * 1024 * 1024)
+
+/** @brief Number of summaries in `log/summaries.bin` after which they're merged into one. */
+#define LOG_STORE_MAXIMUM_SUMMARIES 1024
+
+/**
+ * @struct log_store_summary_t
+ * @brief  What remains of a segment after it's compacted.
+ *
+ * @var log_store_summary_t::first_id
+ *     @brief Lowest identifier of a task in the segment.
+ * @var log_store_summary_t::last_id
+ *     @brief Highest identifier of a task in the segment.
+ * @var log_store_summary_t::task_count
+ *     @brief Number of tasks in the segment.
+ * @var log_store_summary_t::error_count
+ *     @brief Number of tasks in the segment that ended in error.
+ * @var log_store_summary_t::waiting_time
+ *     @brief Total time tasks in the segment waited to be executed, in nanoseconds.
+ * @var log_store_summary_t::executing_time
+ *     @brief Total time tasks in the segment were executing, in nanoseconds.
+ */
+typedef struct __attribute__((packed)) {
+    uint32_t first_id, last_id;
+    uint64_t task_count, error_count;
+    uint64_t waiting_time, executing_time;
+} log_store_summary_t;
+
+/**
+ * @brief   Callback called for every summary of a compacted segment.
+ * @details See ::log_store_read_summaries.
+ *
+ * @param summary Summary read from the store.
+ * @param state   Pointer passed to ::log_store_read_summaries so that this procedure can modify the
+ *                program's state.
+ *
+ * @retval 0 Success.
+ * @retval 1 Failure. Stop iteration.
+ */
+typedef int (*log_store_summary_callback_t)(const log_store_summary_t *summary, void *state);
+
+/** @brief A segmented log of completed tasks. */
+typedef struct log_store log_store_t;
+
+/**
+ * @brief   Opens the log store in a directory, starting a new segment to write to.
+ * @details Existing segments are read, to find the ranges of identifiers in them. A `log.bin` file
+ *          left by older versions of the server becomes the first segment. Invalid segments are
+ *          reported to `stderr`, and only the records before the first invalid one are considered.
+ *
+ * @param directory Directory of the server. Must already exist.
+ * @param options   Configuration of the store. Mustn't be `NULL`.
+ *
+ * @return A new log store on success, `NULL` on failure (check `errno`).
+ *
+ * | `errno`  | Cause                                                         |
+ * | -------- | ------------------------------------------------------------- |
+ * | `EINVAL` | @p directory or @p options are `NULL`, or invalid @p options. |
+ * | `ENOMEM` | Allocation failure.                                           |
+ * | other    | See `man 2 mkdir`, `man 3 opendir` and ::log_file_new.        |
+ */
+log_store_t *log_store_new(const char *directory, const log_store_options_t *options);
+
+/**
+ * @brief   Frees a log store, waiting for all written tasks to reach the segment being written to.
+ * @param   store Log store to be freed.
+ */
+void log_store_free(log_store_t *store);
+
+/**
+ * @brief   Gets an identifier greater than the identifiers of all tasks in a log store.
+ * @details Used to keep identifiers unique across restarts of the server.
+ *
+ * @param store Log store to get the identifier from. Mustn't be `NULL`.
+ * @return The identifier (`1` for empty stores), or `0` on failure (`errno = EINVAL`).
+ */
+uint32_t log_store_get_next_id(const log_store_t *store);
+
+/**
+ * @brief   Writes a task to a log store.
+ * @details A new segment may be started before writing the task, without waiting for the tasks in
+ *          the previous one to reach the disk. Failures to do so are printed to `stderr`, and don't
+ *          stop the task from being written to the current segment.
+ *
+ * @param store Log store to write @p task to. Mustn't be `NULL`.
+ * @param task  Task to be written to @p store. Mustn't be `NULL`.
+ * @param error Whether an error occurred while running the task.
+ *
+ * @retval 0 Success.
+ * @retval 1 Failure (check `errno`, see ::log_file_write_task).
+ */
+int log_store_write_task(log_store_t *store, const tagged_task_t *task, int error);
+
+/**
+ * @brief   Gets how many segments must be compacted for log_store_options_t::maximum_size to be
+ *          respected.
+ * @details Those are always the oldest segments. The segment being written to and the one before
+ *          it, whose tasks may still be reaching the disk, are never compacted.
+ *
+ * @param store Log store. Mustn't be `NULL`.
+ * @return The number of segments to compact, or `0` on failure (`errno = EINVAL`).
+ */
+size_t log_store_get_compactable(const log_store_t *store);
+
+/**
+ * @brief   Compacts the oldest segments of a log store, replacing each with its summary.
+ * @details Segments are read in full, so this is meant to be called in a child process, forked
+ *          before ::log_store_forget_segments is called in the parent. @p store itself isn't
+ *          modified. Compactions in different processes can run concurrently.
+ *
+ *          A crash before all segments are compacted leaves the rest on the disk, to be compacted
+ *          after the server restarts.
+ *
+ * @param store Log store. Mustn't be `NULL`.
+ * @param count Number of segments to compact (see ::log_store_get_compactable).
+ *
+ * @retval 0 Success.
+ * @retval 1 Failure (check `errno`).
+ *
+ * | `errno`  | Cause                                                              |
+ * | -------- | ------------------------------------------------------------------ |
+ * | `EINVAL` | @p store is `NULL` or @p count includes segments still open.       |
+ * | other    | See ::log_file_new, `man 2 open`, `man 2 fcntl` and `man 2 write`. |
+ */
+int log_store_compact(log_store_t *store, size_t count);
+
+/**
+ * @brief   Removes the oldest segments from a log store, without touching their files.
+ * @details To be called after starting a process that calls ::log_store_compact for the same
+ *          segments. Reads from the store stop seeing them, as if they were already compacted.
+ *
+ * @param store Log store. Does nothing if `NULL`.
+ * @param count Number of segments to remove. Does nothing if it includes segments still open.
+ */
+void log_store_forget_segments(log_store_t *store, size_t count);
+
+/**
+ * @brief   Reads the records of the tasks with identifiers in a range.
+ * @details Records are read in the order they were written. Segments compacted in the meantime are
+ *          silently skipped, and invalid ones are reported to `stderr` and skipped.
+ *
+ * @param store     Log store to read from. Mustn't be `NULL`.
+ * @param first_id  Lowest identifier of the records to read.
+ * @param last_id   Highest identifier of the records to read.
+ * @param record_cb Callback called for every record. Mustn't be `NULL`.
+ * @param state     Pointer passed to @p record_cb so that it can modify the program's state.
+ *
+ * @retval 0     Success.
+ * @retval 1     Failure (`errno = EINVAL`, @p store or @p record_cb are `NULL`).
+ * @retval other Value returned by @p record_cb on failure.
+ */
+int log_store_read_records(log_store_t               *store,
+                           uint32_t                   first_id,
+                           uint32_t                   last_id,
+                           log_file_record_callback_t record_cb,
+                           void                      *state);
+
+/**
+ * @brief   Reads the records of the tasks with identifiers in a range, through the task index.
+ * @details Unlike ::log_store_read_records, the segments aren't scanned: each record is found in
+ *          constant time from its identifier, so this is preferable for small ranges. Records are
+ *          read in identifier order, and tasks in compacted segments are silently skipped.
+ *
+ * @param store     Log store to read from. Mustn't be `NULL`.
+ * @param first_id  Lowest identifier of the records to read.
+ * @param last_id   Highest identifier of the records to read.
+ * @param record_cb Callback called for every record. Mustn't be `NULL`.
+ * @param state     Pointer passed to @p record_cb so that it can modify the program's state.
+ *
+ * @retval 0     Success.
+ * @retval 1     Failure (`errno = EINVAL`, @p store or @p record_cb are `NULL`).
+ * @retval other Value returned by @p record_cb on failure.
+ */
+int log_store_lookup_records(log_store_t               *store,
+                             uint32_t                   first_id,
+                             uint32_t                   last_id,
+                             log_file_record_callback_t record_cb,
+                             void                      *state);
+
+/**
+ * @brief   Writes a log file with the records of the tasks with identifiers in a range.
+ * @details Records are copied from the segments without being decoded (see
+ *          ::log_file_copy_records), in the order they were written. Segments compacted in the
+ *          meantime are silently skipped.
+ *
+ * @param store    Log store to read from. Mustn't be `NULL`.
+ * @param first_id Lowest identifier of the records to write.
+ * @param last_id  Highest identifier of the records to write.
+ * @param out      File to write to, at its current offset.
+ * @param count    Where to write the number of records written to. Mustn't be `NULL`.
+ *
+ * @retval 0 Success.
+ * @retval 1 Failure (check `errno`).
+ *
+ * | `errno`  | Cause                                                 |
+ * | -------- | ----------------------------------------------------- |
+ * | `EINVAL` | @p store or @p count are `NULL`.                      |
+ * | other    | See ::log_file_write_header, ::log_file_copy_records. |
+ */
+int log_store_export_records(log_store_t *store,
+                             uint32_t     first_id,
+                             uint32_t     last_id,
+                             int          out,
+                             size_t      *count);
+
+/**
+ * @brief Reads the summaries of all compacted segments, from the oldest to the newest.
+ *
+ * @param store      Log store to read from. Mustn't be `NULL`.
+ * @param summary_cb Callback called for every summary. Mustn't be `NULL`.
+ * @param state      Pointer passed to @p summary_cb so that it can modify the program's state.
+ *
+ * @retval 0     Success.
+ * @retval 1     Failure (check `errno`).
+ * @retval other Value returned by @p summary_cb on failure.
+ *
+ * | `errno`  | Cause                                 |
+ * | -------- | ------------------------------------- |
+ * | `EINVAL` | @p store or @p summary_cb are `NULL`. |
+ * | `EILSEQ` | Truncated summary file.               |
+ * | other    | See `man 2 open` and `man 2 read`.    |
+ */
+int log_store_read_summaries(log_store_t                 *store,
+                             log_store_summary_callback_t summary_cb,
+                             void                        *state);
+
+#endif
@@ -0,0 +1,159 @@
+/*
+ * Copyright 2024 Humberto Gomes, José Lopes, José Matos
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+/**
+ * @file    server/log_writer.h
+ * @brief   Asynchronous writer of records to a file, with group commit.
+ * @details Records are copied to a ring buffer and written to the file by a thread, that coalesces
+ *          all records available into a single `writev()` call. This way, a slow disk doesn't
+ *          delay the thread that appends records, unless the ring buffer fills up.
+ *
+ *          Records only reach the file once the thread writes them: those still in the ring buffer
+ *          are lost if the process dies, whatever the ::log_writer_durability_t. ::log_writer_free
+ *          writes them before returning, so programs should free their writers on termination
+ *          (e.g. on `SIGTERM`).
+ *
+ *          Processes forked while a writer exists can still call ::log_writer_get_pending, but not
+ *          any other function, as the thread isn't copied to the child process. The thread blocks
+ *          all signals, so that they're handled by the rest of the program.
+ */
+
+#ifndef LOG_WRITER_H
+#define LOG_WRITER_H
+
+#include <stddef.h>
+#include <stdint.h>
+
+/**
+ * @brief   When written data is synchronized to the disk with `fdatasync()`.
+ * @details This only covers records that have already left the ring buffer, i.e., that have been
+ *          written by the writer's thread. See ::log_writer_get_pending.
+ */
+typedef enum {
+    LOG_WRITER_DURABILITY_NONE,     /**< @brief Never. Left to the operating system. */
+    LOG_WRITER_DURABILITY_PERIODIC, /**< @brief At most every ::LOG_WRITER_SYNC_INTERVAL. */
+    LOG_WRITER_DURABILITY_BATCH,    /**< @brief After every `writev()`. */
+} log_writer_durability_t;
+
+/** @brief Time in seconds between synchronizations with ::LOG_WRITER_DURABILITY_PERIODIC. */
+#define LOG_WRITER_SYNC_INTERVAL 1
+
+/** @brief Number of bytes in the ring buffer of a writer. Records can't be larger than this. */
+#define LOG_WRITER_RING_SIZE (1024 * 1024)
+
+/** @brief An asynchronous writer of records to a file. */
+typedef struct log_writer log_writer_t;
+
+/**
+ * @brief Creates a new writer and starts its thread.
+ *
+ * @param fd         File descriptor to write records to. Should have been opened with `O_APPEND`,
+ *                   so that other users of the file don't need to care about its offset. Not
+ *                   closed by ::log_writer_free.
+ * @param durability When to synchronize written data to the disk.
+ *
+ * @return A new writer on success, `NULL` on failure (check `errno`).
+ *
+ * | `errno`  | Cause                       |
+ * | -------- | --------------------------- |
+ * | `EINVAL` | @p durability is invalid.   |
+ * | `ENOMEM` | Allocation failure.         |
+ * | other    | See `man 3 pthread_create`. |
+ */
+log_writer_t *log_writer_new(int fd, log_writer_durability_t durability);
+
+/**
+ * @brief   Asks the writer's thread to stop once all pending records are written, without waiting.
+ * @details Nothing else can be appended to the writer afterwards, but pending records can still be
+ *          read. ::log_writer_free must still be called, and waits for the thread to stop.
+ * @param   writer Writer to be stopped. Can be `NULL`.
+ */
+void log_writer_stop(log_writer_t *writer);
+
+/**
+ * @brief   Writes all pending records, stops the writer's thread and frees the writer.
+ * @details Errors are printed to `stderr`.
+ * @param   writer Writer to be freed. Can be `NULL`.
+ */
+void log_writer_free(log_writer_t *writer);
+
+/**
+ * @brief   Queues a record to be written.
+ * @details Blocks while the ring buffer doesn't have space for the record. Errors writing the
+ *          record to the file are printed to `stderr` by the writer's thread.
+ *
+ * @param writer Writer to append the record to. Mustn't be `NULL`.
+ * @param record Bytes of the record. Mustn't be `NULL`.
+ * @param length Number of bytes in @p record.
+ *
+ * @retval 0 Success.
+ * @retval 1 Failure (check `errno`).
+ *
+ * | `errno`    | Cause                                     |
+ * | ---------- | ----------------------------------------- |
+ * | `EINVAL`   | @p writer or @p record are `NULL`.        |
+ * | `EMSGSIZE` | @p length exceeds ::LOG_WRITER_RING_SIZE. |
+ * | `EPIPE`    | ::log_writer_stop was called.             |
+ */
+int log_writer_append(log_writer_t *writer, const void *record, size_t length);
+
+/**
+ * @brief Gets the records that haven't been written to the file yet.
+ *
+ * @param writer          Writer to get the records from. Mustn't be `NULL`.
+ * @param length          Where to write the number of bytes returned to. Mustn't be `NULL`.
+ * @param written_records Where to write the number of records already in the file to. Mustn't be
+ *                        `NULL`.
+ * @param pending_records Where to write the number of records returned to. Mustn't be `NULL`.
+ *
+ * @return A copy of the pending records, in the order they were appended, that must be `free()`d.
+ *         `NULL` is returned on failure (check `errno`), or when there are no pending records (in
+ *         which case @p length is `0`).
+ *
+ * | `errno`  | Cause                  |
+ * | -------- | ---------------------- |
+ * | `EINVAL` | An argument is `NULL`. |
+ * | `ENOMEM` | Allocation failure.    |
+ */
+uint8_t *log_writer_get_pending(log_writer_t *writer,
+                                size_t       *length,
+                                size_t       *written_records,
+                                size_t       *pending_records);
+
+/**
+ * @brief   Reads bytes of a record that may not have been written to the file yet.
+ * @details Bytes that were already written to the file aren't read, and must be read from the file
+ *          instead, as they're no longer in the ring buffer.
+ *
+ * @param writer   Writer to read from. Mustn't be `NULL`.
+ * @param position Position of the first byte to read, in the sequence of all bytes ever appended to
+ *                 @p writer.
+ * @param out      Where to copy the bytes to. Mustn't be `NULL`.
+ * @param length   Maximum number of bytes to read.
+ * @param copied   Where to write the number of bytes copied to @p out to. `0` if the byte at
+ *                 @p position was already written to the file, or if it was never appended.
+ *                 Mustn't be `NULL`.
+ *
+ * @retval 0 Success.
+ * @retval 1 Failure (`errno = EINVAL`, a pointer argument is `NULL`).
+ */
+int log_writer_read(log_writer_t *writer,
+                    size_t        position,
+                    void         *out,
+                    size_t        length,
+                    size_t       *copied);
+
+#endif
@@ -0,0 +1,53 @@
+/*
+ * Copyright 2024 Humberto Gomes, José Lopes, José Matos
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+/**
+ * @file    server/metrics_file.h
+ * @brief   Export of the server's metrics in the Prometheus text format.
+ * @details Metrics are written to a file meant for the textfile collector of the Prometheus node
+ *          exporter. The file is replaced atomically, so that it's never read half-written.
+ */
+
+#ifndef METRICS_FILE_H
+#define METRICS_FILE_H
+
+#include "server/scheduler.h"
+#include "server/statistics.h"
+
+/**
+ * @brief   Writes the server's metrics to a file, replacing it atomically.
+ * @details The file is first written to `path` followed by `.tmp`, and then renamed to @p path.
+ *          Counters are read from metrics.h, gauges from @p scheduler, and task counts and latency
+ *          histograms from @p statistics.
+ *
+ * @param path       Path of the file to be written. Mustn't be `NULL`.
+ * @param statistics Aggregates of completed tasks. Mustn't be `NULL`.
+ * @param scheduler  Scheduler whose load is to be exported. Mustn't be `NULL`.
+ *
+ * @retval 0 Success.
+ * @retval 1 Failure (check `errno`).
+ *
+ * | `errno`        | Cause                                                                  |
+ * | -------------- | ---------------------------------------------------------------------- |
+ * | `EINVAL`       | @p path, @p statistics or @p scheduler are `NULL`.                     |
+ * | `ENAMETOOLONG` | @p path is too long.                                                   |
+ * | other          | See `man 3 fopen`, `man 3 fprintf`, `man 3 fclose` and `man 2 rename`. |
+ */
+int metrics_file_write(const char         *path,
+                       const statistics_t *statistics,
+                       const scheduler_t  *scheduler);
+
+#endif
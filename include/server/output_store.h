@@ -0,0 +1,280 @@
+/*
+ * Copyright 2024 Humberto Gomes, José Lopes, José Matos
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+/**
+ * @file    server/output_store.h
+ * @brief   Where the `stdout` and `stderr` of tasks are stored.
+ * @details Two backends are available:
+ *
+ *          - ::OUTPUT_STORE_BACKEND_FILES: every task gets a `<id>.out` and a `<id>.err` file in
+ *            the output directory.
+ *          - ::OUTPUT_STORE_BACKEND_PACKED: output is appended to large segment files, in
+ *            directories sharded by task ID (`output/<id / 1000000>/<id / 1000 % 1000>/`). Each
+ *            shard has an `index.bin` file, with the location of the streams of every task in the
+ *            shard's segments. Empty streams take no space in segments.
+ *
+ *          With the packed backend, a task's output is kept in memory while the task runs, and
+ *          written to a segment when the task terminates, so that no files are created for a task
+ *          before that. Only streams larger than ::OUTPUT_STORE_MEMORY_LIMIT are moved to an
+ *          unlinked temporary file, to bound the memory used by task runners. Segment appends are
+ *          serialized between processes with a `fcntl()` lock on the shard's index.
+ */
+
+#ifndef OUTPUT_STORE_H
+#define OUTPUT_STORE_H
+
+#include <stdint.h>
+#include <sys/types.h>
+#include <time.h>
+
+/** @brief How task output is stored. */
+typedef enum {
+    OUTPUT_STORE_BACKEND_FILES, /**< @brief Two files per task. */
+    OUTPUT_STORE_BACKEND_PACKED /**< @brief Indexed segment files. */
+} output_store_backend_t;
+
+/** @brief Output stream of a task. */
+typedef enum {
+    OUTPUT_STORE_STREAM_OUTPUT, /**< @brief `stdout` of the task. */
+    OUTPUT_STORE_STREAM_ERROR   /**< @brief `stderr` of the task. */
+} output_store_stream_t;
+
+/** @brief Number of values in ::output_store_stream_t. */
+#define OUTPUT_STORE_STREAM_COUNT 2
+
+/**
+ * @brief Number of bytes of a stream of a task kept in memory by ::OUTPUT_STORE_BACKEND_PACKED,
+ *        before the stream is moved to a temporary file.
+ */
+#define OUTPUT_STORE_MEMORY_LIMIT (1024 * 1024)
+
+/**
+ * @brief Maximum number of milliseconds output is kept waiting to be written to a non-blocking file
+ *        descriptor that can't be written to (see ::output_store_read_range).
+ */
+#define OUTPUT_STORE_WRITE_TIMEOUT 10000
+
+/**
+ * @struct output_store_retention_t
+ * @brief  Limits on the output kept by an output store (see ::output_store_sweep).
+ *
+ * @var output_store_retention_t::maximum_age
+ *     @brief Age in seconds after which the output of a task is deleted. `0` to disable.
+ * @var output_store_retention_t::maximum_size
+ *     @brief Number of bytes of output after which the oldest tasks' output is deleted. `0` to
+ *            disable.
+ * @var output_store_retention_t::keep_last
+ *     @brief Number of most recent tasks whose output is kept, regardless of the other limits
+ *            (`0` to disable). The output of older tasks is deleted.
+ */
+typedef struct {
+    time_t   maximum_age;
+    uint64_t maximum_size;
+    uint32_t keep_last;
+} output_store_retention_t;
+
+/** @brief A place where the output of tasks is stored. */
+typedef struct output_store output_store_t;
+
+/** @brief The output of a task that is being written to an output store. */
+typedef struct output_store_writer output_store_writer_t;
+
+/**
+ * @brief Creates a handle for an output store.
+ *
+ * @param directory Directory where output is stored. Must already exist.
+ * @param backend   How output is stored.
+ *
+ * @return A new output store on success, `NULL` on failure (check `errno`).
+ *
+ * | `errno`  | Cause                                         |
+ * | -------- | --------------------------------------------- |
+ * | `EINVAL` | @p directory is `NULL` or invalid @p backend. |
+ * | `ENOMEM` | Allocation failure.                           |
+ */
+output_store_t *output_store_new(const char *directory, output_store_backend_t backend);
+
+/**
+ * @brief Frees the memory used by an output store.
+ * @param store Output store to be freed.
+ */
+void output_store_free(output_store_t *store);
+
+/**
+ * @brief   Starts storing the output of a task.
+ * @details Must be followed by ::output_store_end_task, after the task terminates. With
+ *          ::OUTPUT_STORE_BACKEND_PACKED, nothing is created on disk by this function.
+ *
+ * @param store Output store. Mustn't be `NULL`.
+ * @param id    Identifier of the task.
+ *
+ * @return A writer for the output of the task on success, `NULL` on failure (check `errno`).
+ *
+ * | `errno`  | Cause               |
+ * | -------- | ------------------- |
+ * | `EINVAL` | @p store is `NULL`. |
+ * | `ENOMEM` | Allocation failure. |
+ * | other    | See `man 2 open`.   |
+ */
+output_store_writer_t *output_store_begin_task(const output_store_t *store, uint32_t id);
+
+/**
+ * @brief Moves data out of a pipe into a stream of a task.
+ *
+ * @param writer Writer created by ::output_store_begin_task. Mustn't be `NULL`.
+ * @param stream Stream the data belongs to.
+ * @param pipe   File descriptor of the pipe to read from.
+ * @param length Maximum number of bytes to be moved.
+ *
+ * @return The number of bytes moved (`0` on end-of-file), or `-1` on failure (check `errno`).
+ *
+ * | `errno`  | Cause                                                                |
+ * | -------- | -------------------------------------------------------------------- |
+ * | `EINVAL` | @p writer is `NULL` or invalid @p stream.                            |
+ * | `ENOMEM` | Allocation failure.                                                  |
+ * | other    | See `man 2 splice`, `man 2 read`, `man 2 write` and `man 3 mkstemp`. |
+ */
+ssize_t output_store_write(output_store_writer_t *writer,
+                           output_store_stream_t  stream,
+                           int                    pipe,
+                           size_t                 length);
+
+/**
+ * @brief   Stores the output of a task that has terminated, and frees its writer.
+ * @details The writer is freed even on failure.
+ *
+ * @param writer Writer created by ::output_store_begin_task. Mustn't be `NULL`.
+ *
+ * @retval 0 Success.
+ * @retval 1 Failure (check `errno`).
+ *
+ * | `errno`  | Cause                                              |
+ * | -------- | -------------------------------------------------- |
+ * | `EINVAL` | @p writer is `NULL`.                               |
+ * | other    | See `man 2 open`, `man 2 write` and `man 2 fcntl`. |
+ */
+int output_store_end_task(output_store_writer_t *writer);
+
+/**
+ * @brief Gets the number of bytes a task wrote to one of its output streams.
+ *
+ * @param store  Output store. Mustn't be `NULL`.
+ * @param id     Identifier of the task.
+ * @param stream Stream to be measured.
+ * @param length Where to write the length of the stream to. Mustn't be `NULL`.
+ *
+ * @retval 0 Success.
+ * @retval 1 Failure (check `errno`).
+ *
+ * | `errno`  | Cause                                                  |
+ * | -------- | ------------------------------------------------------ |
+ * | `EINVAL` | @p store or @p length is `NULL`, or invalid @p stream. |
+ * | `ENOENT` | No output was stored for task @p id.                   |
+ * | `EIO`    | The store is corrupted.                                |
+ * | other    | See `man 2 open` and `man 2 read`.                     |
+ */
+int output_store_get_length(const output_store_t *store,
+                            uint32_t              id,
+                            output_store_stream_t stream,
+                            uint64_t             *length);
+
+/**
+ * @brief   Copies part of the output of a task to a file descriptor.
+ * @details `sendfile()` is used when possible, so that the output isn't copied to user space.
+ *          If @p fd is non-blocking and stops accepting data (e.g. a named pipe no one reads
+ *          anymore) for ::OUTPUT_STORE_WRITE_TIMEOUT milliseconds, copying is given up on.
+ *
+ * @param store      Output store. Mustn't be `NULL`.
+ * @param id         Identifier of the task.
+ * @param stream     Stream to be read.
+ * @param first_byte Offset of the first byte to be copied. Nothing is copied if it's past the end
+ *                   of the stream.
+ * @param length     Maximum number of bytes to be copied.
+ * @param fd         Where to write the output to.
+ *
+ * @retval 0 Success.
+ * @retval 1 Failure (check `errno`).
+ *
+ * | `errno`     | Cause                                                                       |
+ * | ----------- | --------------------------------------------------------------------------- |
+ * | `EINVAL`    | @p store is `NULL` or invalid @p stream.                                    |
+ * | `ENOENT`    | No output was stored for task @p id.                                        |
+ * | `EIO`       | The store is corrupted.                                                     |
+ * | `ETIMEDOUT` | @p fd couldn't be written to for ::OUTPUT_STORE_WRITE_TIMEOUT milliseconds. |
+ * | other       | See `man 2 open`, `man 2 sendfile` and `man 2 write`.                       |
+ */
+int output_store_read_range(const output_store_t *store,
+                            uint32_t              id,
+                            output_store_stream_t stream,
+                            uint64_t              first_byte,
+                            uint64_t              length,
+                            int                   fd);
+
+/**
+ * @brief Copies the output of a task to a file descriptor.
+ *
+ * @param store  Output store. Mustn't be `NULL`.
+ * @param id     Identifier of the task.
+ * @param stream Stream to be read.
+ * @param fd     Where to write the output to.
+ *
+ * @retval 0 Success.
+ * @retval 1 Failure (check `errno`).
+ *
+ * | `errno`  | Cause                                             |
+ * | -------- | ------------------------------------------------- |
+ * | `EINVAL` | @p store is `NULL` or invalid @p stream.          |
+ * | `ENOENT` | No output was stored for task @p id.              |
+ * | `EIO`    | The store is corrupted.                           |
+ * | other    | See `man 2 open`, `man 2 read` and `man 2 write`. |
+ */
+int output_store_read(const output_store_t *store,
+                      uint32_t              id,
+                      output_store_stream_t stream,
+                      int                   fd);
+
+/**
+ * @brief   Deletes stored output that exceeds the limits of a retention policy.
+ * @details The oldest output (by task identifier) is deleted first, in batches. With
+ *          ::OUTPUT_STORE_BACKEND_PACKED, whole shards (1000 tasks) are deleted, so a shard is only
+ *          deleted once all of its tasks must be.
+ *
+ *          Every batch is recorded in the `retention.log` file of the store's directory, with the
+ *          time of the deletion, the range of task identifiers, and the number of files and bytes
+ *          deleted.
+ *
+ * @param store        Output store. Mustn't be `NULL`.
+ * @param retention    Retention policy. Mustn't be `NULL`.
+ * @param first_active Identifier of the oldest task that may still be writing output. The output
+ *                     of this task and of newer ones is never deleted.
+ * @param next_id      Identifier that will be attributed to the next task, for
+ *                     output_store_retention_t::keep_last.
+ *
+ * @retval 0 Success.
+ * @retval 1 Failure (check `errno`).
+ *
+ * | `errno`  | Cause                                                               |
+ * | -------- | ------------------------------------------------------------------- |
+ * | `EINVAL` | @p store or @p retention is `NULL`.                                 |
+ * | `ENOMEM` | Allocation failure.                                                 |
+ * | other    | See `man 3 opendir`, `man 3 readdir`, `man 2 stat` and `man 2 open` |
+ */
+int output_store_sweep(const output_store_t           *store,
+                       const output_store_retention_t *retention,
+                       uint32_t                        first_active,
+                       uint32_t                        next_id);
+
+#endif
@@ -0,0 +1,62 @@
+/*
+ * Copyright 2024 Humberto Gomes, José Lopes, José Matos
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+/**
+ * @file    server/path_cache.h
+ * @brief   Cache of the locations of executables in `$PATH`.
+ * @details `execvp()` looks for a program by trying to `execve()` it in every `$PATH` directory,
+ *          until one of the attempts succeeds. Since the same few programs are run over and over
+ *          again, their locations are resolved once by the orchestrator and kept in this cache.
+ *          Programs that can't be found are also cached, so that they can be rejected quickly.
+ *
+ *          The cache is invalidated when `$PATH` changes or when the modification time of any of
+ *          its directories changes. This is checked at most once every
+ *          ::PATH_CACHE_RECHECK_INTERVAL seconds, so a newly installed program may take that long
+ *          to be found.
+ *
+ *          There is a single cache per process, and it isn't thread-safe: only one thread may look
+ *          programs up (in the orchestrator, the main thread, where tasks are submitted).
+ *          After a `fork()`, each process has its own copy of it.
+ */
+
+#ifndef PATH_CACHE_H
+#define PATH_CACHE_H
+
+/** @brief Minimum number of seconds between checks of the modification times of directories. */
+#define PATH_CACHE_RECHECK_INTERVAL 1
+
+/**
+ * @brief   Finds the executable file a program name refers to.
+ * @details Names containing a `/` aren't looked up in `$PATH` nor cached, just like in
+ *          `execvp()`. An empty `$PATH` entry refers to the current directory.
+ *
+ * @param name Name of the program (`argv[0]`).
+ *
+ * @return The path to the executable, that remains valid until the next call to a method in this
+ *         module, or `NULL` on failure (check `errno`).
+ *
+ * | `errno`  | Cause                                        |
+ * | -------- | -------------------------------------------- |
+ * | `EINVAL` | @p name is `NULL`.                           |
+ * | `ENOENT` | No executable called @p name could be found. |
+ * | `ENOMEM` | Allocation failure.                          |
+ */
+const char *path_cache_resolve(const char *name);
+
+/** @brief Frees all memory used by the cache. Later resolutions will start from an empty cache. */
+void path_cache_clear(void);
+
+#endif
@@ -0,0 +1,125 @@
+/*
+ * Copyright 2024 Humberto Gomes, José Lopes, José Matos
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+/**
+ * @file    server/pool.h
+ * @brief   Size-class slab allocator for small, frequently allocated objects.
+ * @details Tasks, programs and their argument arrays are allocated and freed on every submission
+ *          and completion. Instead of going through `malloc()` and `free()` every time, these
+ *          objects are placed in slabs of objects of the same size, that are recycled. Empty slabs
+ *          are returned to the system, except for one per size class, so that steady-state
+ *          operation performs no system allocator calls and memory usage goes down after a burst
+ *          of tasks.
+ *
+ *          The pools are global to the process and this allocator isn't thread-safe: it must only
+ *          be used by one thread (in the orchestrator, the main thread, as the log writer thread
+ *          never allocates tasks). After a `fork()`, each process has its own pools.
+ */
+
+#ifndef POOL_H
+#define POOL_H
+
+#include <stddef.h>
+
+/** @brief Number of size classes (powers of two from ::POOL_MINIMUM_OBJECT_SIZE). */
+#define POOL_SIZE_CLASS_COUNT 10
+
+/** @brief Size of objects in the smallest size class. */
+#define POOL_MINIMUM_OBJECT_SIZE 16
+
+/** @brief Objects larger than this are allocated with `malloc()`. */
+#define POOL_MAXIMUM_OBJECT_SIZE (POOL_MINIMUM_OBJECT_SIZE << (POOL_SIZE_CLASS_COUNT - 1))
+
+/**
+ * @struct pool_statistics_t
+ * @brief  Usage counters of a size class.
+ *
+ * @var pool_statistics_t::object_size
+ *     @brief Size of the objects in the size class. `0` for objects larger than
+ *            ::POOL_MAXIMUM_OBJECT_SIZE, that aren't pooled.
+ * @var pool_statistics_t::used
+ *     @brief Number of objects currently allocated.
+ * @var pool_statistics_t::free
+ *     @brief Number of objects in slabs that can be allocated without a system allocator call.
+ * @var pool_statistics_t::slabs
+ *     @brief Number of slabs currently allocated.
+ * @var pool_statistics_t::allocations
+ *     @brief Total number of objects allocated since the start of the program.
+ * @var pool_statistics_t::system_allocations
+ *     @brief Total number of calls to the system allocator since the start of the program.
+ */
+typedef struct {
+    size_t object_size;
+    size_t used, free, slabs;
+    size_t allocations, system_allocations;
+} pool_statistics_t;
+
+/**
+ * @brief  Allocates an object from the pool of its size class.
+ * @param  size Size of the object in bytes.
+ * @return A pointer to the object (aligned like `malloc()`), or `NULL` on allocation failure
+ *         (`errno = ENOMEM`).
+ */
+void *pool_allocate(size_t size);
+
+/**
+ * @brief Frees an object allocated by ::pool_allocate.
+ *
+ * @param object Object to be freed. Can be `NULL`.
+ * @param size   Size passed to ::pool_allocate when @p object was allocated.
+ */
+void pool_free(void *object, size_t size);
+
+/**
+ * @brief Changes the size of an object allocated by ::pool_allocate.
+ *
+ * @param object   Object to be resized. Can be `NULL`, in which case this behaves like
+ *                 ::pool_allocate.
+ * @param old_size Size passed to ::pool_allocate when @p object was allocated.
+ * @param new_size New size of the object.
+ *
+ * @return The resized object, or `NULL` on allocation failure (`errno = ENOMEM`), in which case
+ *         @p object won't be freed.
+ */
+void *pool_reallocate(void *object, size_t old_size, size_t new_size);
+
+/**
+ * @brief  Duplicates a string, allocating it from the pools.
+ * @param  string String to be duplicated. Mustn't be `NULL`.
+ * @return A copy of @p string, that must be freed with ::pool_free_string, or `NULL` on failure
+ *         (check `errno`).
+ *
+ * | `errno`  | Cause                |
+ * | -------- | -------------------- |
+ * | `EINVAL` | @p string is `NULL`. |
+ * | `ENOMEM` | Allocation failure.  |
+ */
+char *pool_duplicate_string(const char *string);
+
+/**
+ * @brief Frees a string created by ::pool_duplicate_string.
+ * @param string String to be freed. Can be `NULL`.
+ */
+void pool_free_string(char *string);
+
+/**
+ * @brief Gets the usage counters of all size classes.
+ * @param out Where to write the statistics to. The last element refers to objects too large to be
+ *            pooled. Mustn't be `NULL`.
+ */
+void pool_get_statistics(pool_statistics_t out[POOL_SIZE_CLASS_COUNT + 1]);
+
+#endif
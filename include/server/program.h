@@ -22,11 +22,43 @@
 #ifndef PROGRAM_H
 #define PROGRAM_H
 
+#include <stdint.h>
 #include <sys/types.h>
 
 /** @brief A single program that must be executed (may be part of a pipeline). */
 typedef struct program program_t;
 
+/** @brief Standard stream of a program that can be redirected to / from a file. */
+typedef enum {
+    PROGRAM_REDIRECTION_INPUT,  /**< @brief `stdin` read from a file (`< file`). */
+    PROGRAM_REDIRECTION_OUTPUT, /**< @brief `stdout` written to a file (`> file` / `>> file`). */
+    PROGRAM_REDIRECTION_ERROR,  /**< @brief `stderr` written to a file (`2> file` / `2>> file`). */
+} program_redirection_t;
+
+/** @brief Number of values in ::program_redirection_t. */
+#define PROGRAM_REDIRECTION_COUNT (PROGRAM_REDIRECTION_ERROR + 1)
+
+/** @brief Value of program_layout_t::redirections for streams that aren't redirected. */
+#define PROGRAM_NO_REDIRECTION SIZE_MAX
+
+/**
+ * @struct program_layout_t
+ * @brief  Description of a program whose strings are stored in an external buffer.
+ *
+ * @var program_layout_t::argument_count
+ *     @brief Number of arguments of the program (including the program's name).
+ * @var program_layout_t::redirections
+ *     @brief Offset of the path of each redirection in the strings buffer, or
+ *            ::PROGRAM_NO_REDIRECTION.
+ * @var program_layout_t::append
+ *     @brief Whether each output redirection appends to its file instead of truncating it.
+ */
+typedef struct {
+    size_t argument_count;
+    size_t redirections[PROGRAM_REDIRECTION_COUNT];
+    int    append[PROGRAM_REDIRECTION_COUNT];
+} program_layout_t;
+
 /**
  * @brief   Creates a empty program.
  * @details This program isn't valid, and needs to be populated with arguments (see
@@ -52,6 +84,33 @@ program_t *program_new_empty(void);
  */
 program_t *program_new_from_arguments(const char *const *arguments, ssize_t length);
 
+/**
+ * @brief  Gets the number of bytes needed by ::program_new_in_place.
+ * @param  argc Number of arguments of the program (including the program's name).
+ * @return The size of the program, excluding the strings of its arguments.
+ */
+size_t program_get_in_place_size(size_t argc);
+
+/**
+ * @brief   Creates a program in memory owned by the caller.
+ * @details The program owns neither its memory nor its argument strings. So, it can't be modified
+ *          with ::program_add_argument, and ::program_free won't release any memory. This is meant
+ *          for programs embedded in larger allocations (see ::task_new_from_string_table).
+ *
+ * @param memory  Where to place the program. Must be at least ::program_get_in_place_size bytes
+ *                long and aligned like `malloc()` memory. Mustn't be `NULL`.
+ * @param strings Buffer containing the null-terminated arguments and redirection paths of the
+ *                program. Must outlive the program. Mustn't be `NULL`.
+ * @param offsets Offset of each argument in @p strings. Mustn't be `NULL`.
+ * @param layout  Number of arguments and redirections of the program. Mustn't be `NULL`.
+ *
+ * @return A program placed in @p memory on success, or `NULL` on failure (`errno = EINVAL`).
+ */
+program_t *program_new_in_place(void                   *memory,
+                                char                   *strings,
+                                const size_t           *offsets,
+                                const program_layout_t *layout);
+
 /**
  * @brief Frees memory used by a program.
  * @param program Program to be deleted.
@@ -73,19 +132,57 @@ program_t *program_clone(const program_t *program);
 /**
  * @brief Appends an argument to a program's argument list.
  *
- * @param program  Program to be modified. Mustn't be `NULL`.
+ * @param program  Program to be modified. Mustn't be `NULL` or created with ::program_new_in_place.
  * @param argument Argument to be added to @p program. Mustn't be `NULL`.
  *
  * @retval 0 Success.
  * @retval 1 Invalid arguments or allocation failure (check `errno`).
  *
- * | `errno`  | Cause                                         |
- * | -------- | --------------------------------------------- |
- * | `EINVAL` | @p program or @p argument is `NULL` or empty. |
- * | `ENOMEM` | Allocation failure.                           |
+ * | `errno`  | Cause                                                                    |
+ * | -------- | ------------------------------------------------------------------------ |
+ * | `EINVAL` | @p program or @p argument is `NULL`, or @p program was created in place. |
+ * | `ENOMEM` | Allocation failure.                                                      |
  */
 int program_add_argument(program_t *program, const char *argument);
 
+/**
+ * @brief Sets (or removes) the redirection of one of the standard streams of a program.
+ *
+ * @param program     Program to be modified. Mustn't be `NULL` or created with
+ *                    ::program_new_in_place.
+ * @param redirection Stream to be redirected.
+ * @param path        Path of the file to redirect the stream to / from. Will be copied. Can be
+ *                    `NULL`, to remove the redirection.
+ * @param append      Whether to append to the file instead of truncating it. Ignored for
+ *                    ::PROGRAM_REDIRECTION_INPUT.
+ *
+ * @retval 0 Success.
+ * @retval 1 Failure (check `errno`).
+ *
+ * | `errno`  | Cause                                                                    |
+ * | -------- | ------------------------------------------------------------------------ |
+ * | `EINVAL` | @p program is `NULL` or was created in place, or invalid @p redirection. |
+ * | `ENOMEM` | Allocation failure.                                                      |
+ */
+int program_set_redirection(program_t            *program,
+                            program_redirection_t redirection,
+                            const char           *path,
+                            int                   append);
+
+/**
+ * @brief Gets the redirection of one of the standard streams of a program.
+ *
+ * @param program     Program to get the redirection from. Mustn't be `NULL`.
+ * @param redirection Stream whose redirection is requested.
+ * @param append      Where to write whether the file is to be appended to. Can be `NULL`.
+ *
+ * @return The path of the file the stream is redirected to / from, or `NULL` if the stream isn't
+ *         redirected. `NULL` is also returned on failure (`errno = EINVAL`).
+ */
+const char *program_get_redirection(const program_t      *program,
+                                    program_redirection_t redirection,
+                                    int                  *append);
+
 /**
  * @brief  Gets the list of arguments in a program.
  * @param  program Program to get arguments from. Mustn't be `NULL`.
@@ -22,6 +22,8 @@
 #ifndef SCHEDULER_H
 #define SCHEDULER_H
 
+#include "server/output_store.h"
+#include "server/priority_queue.h"
 #include "server/tagged_task.h"
 
 /** @brief Scheduling policy used in a ::scheduler_t. */
@@ -46,21 +48,44 @@ typedef struct scheduler scheduler_t;
  */
 typedef int (*scheduler_task_iterator_t)(const tagged_task_t *task, void *state);
 
+/**
+ * @brief   Callback that starts running a task dispatched by a scheduler.
+ * @details Used by ::scheduler_dispatch_with. The task stays owned by the scheduler until it's
+ *          marked as done.
+ *
+ * @param task  Dispatched task.
+ * @param slot  Slot where @p task was dispatched to, to be given to ::scheduler_mark_done.
+ * @param state Pointer argument so that this procedure can modify the program's state.
+ *
+ * @return The PID of the process running @p task (`0` if it isn't run by a process), `-1` on
+ *         failure (check `errno`).
+ */
+typedef pid_t (*scheduler_dispatcher_t)(tagged_task_t *task, size_t slot, void *state);
+
+/**
+ * @brief  Gets the function used to order the queue of tasks of a scheduling policy.
+ * @param  policy Scheduling policy.
+ * @return The comparison function, or `NULL` for an invalid @p policy (`errno = EINVAL`).
+ */
+priority_queue_compare_function_t scheduler_get_compare_function(scheduler_policy_t policy);
+
 /**
  * @brief Creates a new scheduler.
  *
- * @param policy    Scheduling policy.
- * @param ntasks    Maximum number of tasks scheduled concurrently. Can't be `0`.
- * @param outputdir Directory path where to write output and error files. Mustn't be `NULL`.
+ * @param policy Scheduling policy.
+ * @param ntasks Maximum number of tasks scheduled concurrently. Can't be `0`.
+ * @param store  Where to store the output of tasks. Not owned by the scheduler, and must outlive
+ *               it. Can only be `NULL` if all tasks will be procedures.
  *
  * @return A new scheduler on success, `NULL` on failure (check `errno`).
  *
- * | `errno`  | Cause                                             |
- * | -------- | ------------------------------------------------- |
- * | `EINVAL` | Invalid @p policy, @p ntasks or `NULL` directory. |
- * | `ENOMEM` | Allocation failure.                               |
+ * | `errno`  | Cause                           |
+ * | -------- | ------------------------------- |
+ * | `EINVAL` | Invalid @p policy or @p ntasks. |
+ * | `ENOMEM` | Allocation failure.             |
  */
-scheduler_t *scheduler_new(scheduler_policy_t policy, size_t ntasks, const char *directory);
+scheduler_t *
+    scheduler_new(scheduler_policy_t policy, size_t ntasks, const output_store_t *store);
 
 /**
  * @brief   Frees memory used by a scheduler.
@@ -112,10 +137,31 @@ int scheduler_can_schedule_now(scheduler_t *scheduler);
  */
 ssize_t scheduler_dispatch_possible(scheduler_t *scheduler);
 
+/**
+ * @brief   Like ::scheduler_dispatch_possible, but with another way of running tasks.
+ * @details Used for simulations, where tasks aren't run in processes (see server/simulator.h).
+ *
+ * @param scheduler  Scheduler to get tasks to dispatch from.
+ * @param dispatcher Procedure that starts running each dispatched task.
+ * @param state      Pointer passed to @p dispatcher, so that it can modify the program's state.
+ *
+ * @return The number of tasks scheduled, `-1` on failure (check `errno`).
+ *
+ * | `errno`  | Cause                                        |
+ * | -------- | -------------------------------------------- |
+ * | `EINVAL` | @p scheduler or @p dispatcher are `NULL`.    |
+ * | `ENOMEM` | Allocation failure during task reeinsertion. |
+ * | other    | Set by @p dispatcher.                        |
+ */
+ssize_t scheduler_dispatch_with(scheduler_t           *scheduler,
+                                scheduler_dispatcher_t dispatcher,
+                                void                  *state);
+
 /**
  * @brief   Marks a task currently running as complete.
  * @details The scheduler will `wait()` for the task, so make sure it has finished already. If this
- *          call to `waitpid()` fails, a message will be printed to `stderr`.
+ *          call to `waitpid()` fails, a message will be printed to `stderr`. Tasks dispatched
+ *          without a process (see ::scheduler_dispatcher_t) aren't waited for.
  *
  * @param scheduler  Scheduler that dispatched the task. Can't be `NULL`.
  * @param slot       Slot where the task was scheduled (provided to child).
@@ -123,15 +169,30 @@ ssize_t scheduler_dispatch_possible(scheduler_t *scheduler);
  *
  * @return The finished task, now owned by the caller. `NULL` is returned on error (check `errno`).
  *
- * | `errno`       | Cause                                                  |
- * | ------------- | -------------------------------------------------------|
- * | `EINVAL`      | @p scheduler or @p time_ended are `NULL`.              |
- * | `ERANGE`      | @p slot too large or still available.                  |
- * | other         | See `man 2 wait`.                                      |
+ * | `errno`  | Cause                                     |
+ * | -------- | ----------------------------------------- |
+ * | `EINVAL` | @p scheduler or @p time_ended are `NULL`. |
+ * | `ERANGE` | @p slot too large or still available.     |
+ * | other    | See `man 2 wait`.                         |
  */
 tagged_task_t *
     scheduler_mark_done(scheduler_t *scheduler, size_t slot, const struct timespec *time_ended);
 
+/**
+ * @brief Gets the PID of the process running a task.
+ *
+ * @param scheduler Scheduler that dispatched the task. Mustn't be `NULL`.
+ * @param id        Identifier of the task.
+ *
+ * @return The PID of the process running the task, or `-1` on failure (check `errno`).
+ *
+ * | `errno`  | Cause                                   |
+ * | -------- | --------------------------------------- |
+ * | `EINVAL` | @p scheduler is `NULL`.                 |
+ * | `ESRCH`  | The task isn't running in @p scheduler. |
+ */
+pid_t scheduler_get_runner_pid(scheduler_t *scheduler, uint32_t id);
+
 /**
  * @brief Iterates through the tasks currently running in a scheduler.
  *
@@ -162,4 +223,20 @@ int scheduler_get_scheduled_tasks(scheduler_t              *scheduler,
                                   scheduler_task_iterator_t callback,
                                   void                     *state);
 
+/**
+ * @brief Counts the tasks in a scheduler.
+ *
+ * @param scheduler Scheduler whose tasks are to be counted. Musn't be `NULL`.
+ * @param running   Where to output the number of running tasks to. Musn't be `NULL`.
+ * @param queued    Where to output the number of tasks waiting to run to. Musn't be `NULL`.
+ * @param slots     Where to output the maximum number of concurrent tasks to. Musn't be `NULL`.
+ *
+ * @retval 0 Success.
+ * @retval 1 Failure (`errno = EINVAL`).
+ */
+int scheduler_get_load(const scheduler_t *scheduler,
+                       size_t            *running,
+                       size_t            *queued,
+                       size_t            *slots);
+
 #endif
@@ -24,24 +24,40 @@
 #ifndef SERVER_REQUESTS_H
 #define SERVER_REQUESTS_H
 
+#include "server/log_store.h"
+#include "server/output_store.h"
 #include "server/scheduler.h"
 
 /**
  * @brief   Opens a listening connection and listens to incoming requests.
- * @details This procedure will output to `stderr` in case of error.
+ * @details This procedure will output to `stderr` in case of error. It installs handlers for
+ *          `SIGTERM` and `SIGINT`, that make it stop listening, free everything and return, so that
+ *          log records not yet written to the disk aren't lost.
  *
- * @param policy    Task scheduling policy.
- * @param ntasks    Maximum number of tasks scheduled concurrently. Can't be `0`.
- * @param directory Directory where the server will output logs and program outputs to.
+ * @param policy       Task scheduling policy.
+ * @param ntasks       Maximum number of tasks scheduled concurrently. Can't be `0`.
+ * @param directory    Directory where the server will output logs and program outputs to.
+ * @param backend      How program outputs are stored.
+ * @param log_options  Configuration of the log of completed tasks. Mustn't be `NULL`.
+ * @param retention    Limits on the output of tasks kept in @p directory. Mustn't be `NULL`.
+ * @param metrics_path Where to write metrics in the Prometheus text format to, every few seconds.
+ *                     `NULL` not to write them.
  *
- * @returns This function only exits on failure (`1`, check `errno`). It keeps running otherwise.
+ * @retval 0 Terminated by `SIGTERM` or `SIGINT`.
+ * @retval 1 Failure (check `errno`).
  *
- * | `errno`  | Cause                                                   |
- * | -------- | ------------------------------------------------------- |
- * | `EINVAL` | Invalid @p policy or @p ntasks, or `NULL` @p directory. |
- * | `ENOMEM` | Allocation failure.                                     |
- * | other    | `See man 2 open`.                                       |
+ * | `errno`  | Cause                                                                     |
+ * | -------- | ------------------------------------------------------------------------- |
+ * | `EINVAL` | Invalid @p policy, @p ntasks or @p backend, or a `NULL` pointer argument. |
+ * | `ENOMEM` | Allocation failure.                                                       |
+ * | other    | `See man 2 open`.                                                         |
  */
-int server_requests_listen(scheduler_policy_t policy, size_t ntasks, const char *directory);
+int server_requests_listen(scheduler_policy_t              policy,
+                           size_t                          ntasks,
+                           const char                     *directory,
+                           output_store_backend_t          backend,
+                           const log_store_options_t      *log_options,
+                           const output_store_retention_t *retention,
+                           const char                     *metrics_path);
 
 #endif
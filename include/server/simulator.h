@@ -0,0 +1,120 @@
+/*
+ * Copyright 2024 Humberto Gomes, José Lopes, José Matos
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+/**
+ * @file    server/simulator.h
+ * @brief   Discrete-event simulation of scheduling policies.
+ * @details A workload of tasks, with their arrival times, expected times and actual runtimes, is
+ *          run through the same scheduler (and priority queue) used by the server. Time is virtual:
+ *          no processes are created, and the clock jumps from one arrival or completion to the
+ *          next, so that large workloads can be simulated in seconds.
+ *
+ *          Workloads are text files, with a task per line: its arrival time, expected time and
+ *          runtime, all in milliseconds, separated by whitespace. Empty lines and lines starting
+ *          with `#` are ignored.
+ */
+
+#ifndef SIMULATOR_H
+#define SIMULATOR_H
+
+#include <inttypes.h>
+#include <stdio.h>
+
+#include "server/scheduler.h"
+
+/**
+ * @struct simulator_task_t
+ * @brief  A task in a simulated workload.
+ *
+ * @var simulator_task_t::arrival
+ *     @brief When the task arrives at the server, in nanoseconds.
+ * @var simulator_task_t::runtime
+ *     @brief For how long the task runs, in nanoseconds.
+ * @var simulator_task_t::expected_time
+ *     @brief Expected time of the task given by the client, in milliseconds.
+ * @var simulator_task_t::dispatched
+ *     @brief When the task was dispatched, in nanoseconds (output of ::simulator_run).
+ * @var simulator_task_t::ended
+ *     @brief When the task ended, in nanoseconds (output of ::simulator_run).
+ */
+typedef struct {
+    uint64_t arrival, runtime;
+    uint32_t expected_time;
+    uint64_t dispatched, ended;
+} simulator_task_t;
+
+/**
+ * @brief   Reads a workload from a file.
+ * @details Tasks are sorted by arrival time (keeping the order in the file for tasks arriving at
+ *          the same time), and identified by their position after sorting, starting at `0`.
+ *
+ * @param in     File to read the workload from. Mustn't be `NULL`.
+ * @param tasks  Where to output the array of tasks to, to be `free()`d by the caller. Mustn't be
+ *               `NULL`.
+ * @param ntasks Where to output the number of tasks in @p tasks to. When the workload is invalid,
+ *               the number of the invalid line is written here. Mustn't be `NULL`.
+ *
+ * @retval 0 Success.
+ * @retval 1 Failure (check `errno`).
+ *
+ * | `errno`  | Cause                                       |
+ * | -------- | ------------------------------------------- |
+ * | `EINVAL` | @p in, @p tasks or @p ntasks are `NULL`.    |
+ * | `EILSEQ` | Invalid line (number written to @p ntasks). |
+ * | `ENOMEM` | Allocation failure.                         |
+ * | other    | See `man 3 getline`.                        |
+ */
+int simulator_read_workload(FILE *in, simulator_task_t **tasks, size_t *ntasks);
+
+/**
+ * @brief Simulates running a workload on a server.
+ *
+ * @param policy Scheduling policy.
+ * @param slots  Maximum number of tasks running concurrently. Can't be `0`.
+ * @param tasks  Tasks to be simulated, sorted by arrival time. Their simulator_task_t::dispatched
+ *               and simulator_task_t::ended fields are written. Mustn't be `NULL`.
+ * @param ntasks Number of tasks in @p tasks.
+ *
+ * @retval 0 Success.
+ * @retval 1 Failure (check `errno`).
+ *
+ * | `errno`  | Cause                                                                     |
+ * | -------- | ------------------------------------------------------------------------- |
+ * | `EINVAL` | Invalid @p policy or @p slots, @p tasks is `NULL`, or tasks out of order. |
+ * | `ENOMEM` | Allocation failure.                                                       |
+ */
+int simulator_run(scheduler_policy_t policy, size_t slots, simulator_task_t *tasks, size_t ntasks);
+
+/**
+ * @brief   Prints the results of a simulation.
+ * @details Aggregates are printed after the tasks, with the distributions of waiting and
+ *          turnaround times. All times are printed in milliseconds.
+ *
+ * @param out         Where to print the results to. Mustn't be `NULL` (unchecked).
+ * @param policy      Scheduling policy used in the simulation.
+ * @param slots       Number of slots used in the simulation.
+ * @param tasks       Simulated tasks. Mustn't be `NULL` (unchecked).
+ * @param ntasks      Number of tasks in @p tasks.
+ * @param print_tasks Whether to print every task, and not only the aggregates.
+ */
+void simulator_print_results(FILE                   *out,
+                             scheduler_policy_t      policy,
+                             size_t                  slots,
+                             const simulator_task_t *tasks,
+                             size_t                  ntasks,
+                             int                     print_tasks);
+
+#endif
@@ -0,0 +1,188 @@
+/*
+ * Copyright 2024 Humberto Gomes, José Lopes, José Matos
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+/**
+ * @file    server/statistics.h
+ * @brief   Running aggregates of the times of completed tasks.
+ * @details Aggregates are updated as tasks complete, so that they can be reported in constant time,
+ *          without reading the log. Times are kept in log-linear histograms (like HDR histograms):
+ *          every power of two is split into ::STATISTICS_HISTOGRAM_SUB_BUCKETS linear buckets, so
+ *          that percentiles have a relative error under 4%, and histograms can be merged by adding
+ *          their buckets.
+ */
+
+#ifndef STATISTICS_H
+#define STATISTICS_H
+
+#include <inttypes.h>
+#include <time.h>
+
+#include "server/tagged_task.h"
+
+/** @brief Base-2 logarithm of ::STATISTICS_HISTOGRAM_SUB_BUCKETS. */
+#define STATISTICS_HISTOGRAM_SUB_BUCKET_BITS 4
+
+/** @brief Number of linear buckets each power of two is split into. */
+#define STATISTICS_HISTOGRAM_SUB_BUCKETS (1 << STATISTICS_HISTOGRAM_SUB_BUCKET_BITS)
+
+/** @brief Values (in nanoseconds) from `2 ^` this on are counted in the last bucket. */
+#define STATISTICS_HISTOGRAM_MAXIMUM_EXPONENT 44
+
+/** @brief Number of buckets in a ::statistics_histogram_t. */
+#define STATISTICS_HISTOGRAM_BUCKETS                                                               \
+    ((STATISTICS_HISTOGRAM_MAXIMUM_EXPONENT - STATISTICS_HISTOGRAM_SUB_BUCKET_BITS + 1)            \
+     << STATISTICS_HISTOGRAM_SUB_BUCKET_BITS)
+
+/**
+ * @struct statistics_histogram_t
+ * @brief  Log-linear histogram of times. Zero-initialize it before use.
+ *
+ * @var statistics_histogram_t::count
+ *     @brief Number of values added to the histogram.
+ * @var statistics_histogram_t::sum
+ *     @brief Sum of all values, in nanoseconds.
+ * @var statistics_histogram_t::min
+ *     @brief Smallest value, in nanoseconds (`0` if statistics_histogram_t::count is `0`).
+ * @var statistics_histogram_t::max
+ *     @brief Largest value, in nanoseconds.
+ * @var statistics_histogram_t::buckets
+ *     @brief Number of values in each bucket.
+ */
+typedef struct {
+    uint64_t count, sum, min, max;
+    uint64_t buckets[STATISTICS_HISTOGRAM_BUCKETS];
+} statistics_histogram_t;
+
+/** @brief Times of a task kept in a ::statistics_aggregate_t. */
+typedef enum {
+    STATISTICS_TIME_C2S,     /**< @brief From the client sending the task to the server. */
+    STATISTICS_TIME_WAIT,    /**< @brief Waiting in the queue. */
+    STATISTICS_TIME_EXECUTE, /**< @brief Executing. */
+    STATISTICS_TIME_S2S,     /**< @brief From the task runner to the server. */
+    STATISTICS_TIME_COUNT    /**< @brief Not a time, but the number of times. */
+} statistics_time_t;
+
+/**
+ * @struct statistics_aggregate_t
+ * @brief  Aggregates of a set of completed tasks.
+ *
+ * @var statistics_aggregate_t::task_count
+ *     @brief Number of completed tasks.
+ * @var statistics_aggregate_t::error_count
+ *     @brief Number of tasks that failed.
+ * @var statistics_aggregate_t::times
+ *     @brief Histogram of each ::statistics_time_t.
+ */
+typedef struct {
+    uint64_t               task_count, error_count;
+    statistics_histogram_t times[STATISTICS_TIME_COUNT];
+} statistics_aggregate_t;
+
+/**
+ * @brief   Number of aggregates in a ::statistics_t.
+ * @details The first one is of all tasks. The others group tasks by their expected time, in
+ *          powers of ten of milliseconds (see ::statistics_get_expected_time_range).
+ */
+#define STATISTICS_AGGREGATE_COUNT 7
+
+/** @brief Running aggregates of the times of completed tasks. */
+typedef struct statistics statistics_t;
+
+/**
+ * @brief Adds a value to a histogram.
+ * @param histogram Histogram to add @p value to. Mustn't be `NULL` (unchecked).
+ * @param value     Value to be added, in nanoseconds.
+ */
+void statistics_histogram_add(statistics_histogram_t *histogram, uint64_t value);
+
+/**
+ * @brief Adds all values in a histogram to another.
+ * @param dest Histogram to add values to. Mustn't be `NULL` (unchecked).
+ * @param src  Histogram to take values from. Mustn't be `NULL` (unchecked).
+ */
+void statistics_histogram_merge(statistics_histogram_t *dest, const statistics_histogram_t *src);
+
+/**
+ * @brief  Estimates a percentile of the values in a histogram.
+ * @param  histogram  Histogram to read from. Mustn't be `NULL` (unchecked).
+ * @param  percentile Percentile to be estimated, between `0` and `100`.
+ * @return The estimated value in nanoseconds, always between statistics_histogram_t::min and
+ *         statistics_histogram_t::max (`0` for an empty histogram).
+ */
+uint64_t statistics_histogram_get_percentile(const statistics_histogram_t *histogram,
+                                             double                        percentile);
+
+/**
+ * @brief   Counts the values in a histogram not larger than a value.
+ * @details Values in the same bucket as @p value are all counted, so the count is approximate, up
+ *          to the resolution of the histogram.
+ *
+ * @param histogram Histogram to read from. Mustn't be `NULL` (unchecked).
+ * @param value     Upper bound of the values to be counted, in nanoseconds.
+ *
+ * @return The number of values counted.
+ */
+uint64_t statistics_histogram_count_below(const statistics_histogram_t *histogram, uint64_t value);
+
+/**
+ * @brief Gets the range of expected times of the tasks in an aggregate.
+ *
+ * @param index Index of the aggregate, lower than ::STATISTICS_AGGREGATE_COUNT.
+ * @param min   Where to output the lowest expected time (milliseconds) to. Mustn't be `NULL`
+ *              (unchecked).
+ * @param max   Where to output the highest expected time (milliseconds) to. Mustn't be `NULL`
+ *              (unchecked).
+ */
+void statistics_get_expected_time_range(size_t index, uint32_t *min, uint32_t *max);
+
+/**
+ * @brief  Creates a new set of empty aggregates.
+ * @return The new aggregates, or `NULL` on failure (`errno = ENOMEM`).
+ */
+statistics_t *statistics_new(void);
+
+/**
+ * @brief Frees memory used by aggregates.
+ * @param statistics Aggregates to be freed. Can be `NULL`.
+ */
+void statistics_free(statistics_t *statistics);
+
+/**
+ * @brief Adds a completed task to all aggregates it belongs to.
+ *
+ * @param statistics Aggregates to be updated. Mustn't be `NULL` (unchecked).
+ * @param task       Completed task. Mustn't be `NULL` (unchecked). Missing times are skipped.
+ * @param error      Whether an error occurred while running the task.
+ */
+void statistics_add_task(statistics_t *statistics, const tagged_task_t *task, int error);
+
+/**
+ * @brief  Gets an aggregate.
+ * @param  statistics Aggregates to read from. Mustn't be `NULL` (unchecked).
+ * @param  index      Index of the aggregate, lower than ::STATISTICS_AGGREGATE_COUNT (unchecked).
+ * @return The aggregate, valid until the next call to ::statistics_add_task.
+ */
+const statistics_aggregate_t *statistics_get_aggregate(const statistics_t *statistics,
+                                                       size_t              index);
+
+/**
+ * @brief  Gets for how long aggregates have been kept.
+ * @param  statistics Aggregates. Mustn't be `NULL` (unchecked).
+ * @return Nanoseconds since ::statistics_new.
+ */
+uint64_t statistics_get_uptime(const statistics_t *statistics);
+
+#endif
@@ -23,27 +23,51 @@
 #define STATUS_H
 
 #include "ipc.h"
-#include "server/log_file.h"
+#include "protocol.h"
+#include "server/log_store.h"
+#include "server/output_store.h"
 #include "server/scheduler.h"
 
 /**
- * @struct status_state_t
- * @brief  Data the status program needs to operate.
+ * @struct status_request_t
+ * @brief  A client's request for the status of the server.
  *
- * @var status_state_t::ipc
- *     @brief ::IPC_ENDPOINT_SERVER connection, not yet open to the client.
- * @var status_state_t::client_pid
+ * @var status_request_t::client_pid
  *     @brief The PID of the client to send the status data to.
+ * @var status_request_t::flags
+ *     @brief protocol_status_request_message_t::flags sent by the client.
+ * @var status_request_t::first_id
+ *     @brief protocol_status_request_message_t::first_id sent by the client.
+ * @var status_request_t::last_id
+ *     @brief protocol_status_request_message_t::last_id sent by the client.
+ */
+typedef struct {
+    pid_t    client_pid;
+    uint8_t  flags;
+    uint32_t first_id;
+    uint32_t last_id;
+} status_request_t;
+
+/**
+ * @struct  status_state_t
+ * @brief   Data the status program needs to operate.
+ * @details Requests are answered together, so that the log is only read once for all clients
+ *          asking for all tasks: every record is sent to all of them as soon as it's read.
+ *
  * @var status_state_t::log
- *     @brief The server's log file, to get completed task information from.
+ *     @brief The server's log, to get completed task information from.
  * @var status_state_t::scheduler
  *     @brief Scheduler information about scheduled and currently running.
+ * @var status_state_t::requests
+ *     @brief Requests to be answered, in order.
+ * @var status_state_t::request_count
+ *     @brief Number of elements in status_state_t::requests.
  */
 typedef struct {
-    ipc_t       *ipc;
-    pid_t        client_pid;
-    log_file_t  *log;
-    scheduler_t *scheduler;
+    log_store_t            *log;
+    scheduler_t            *scheduler;
+    const status_request_t *requests;
+    size_t                  request_count;
 } status_state_t;
 
 /**
@@ -57,4 +81,148 @@ typedef struct {
  */
 int status_main(void *state_data, size_t slot);
 
+/**
+ * @struct status_export_state_t
+ * @brief  Data the export program needs to operate.
+ *
+ * @var status_export_state_t::ipc
+ *     @brief ::IPC_ENDPOINT_SERVER connection, not yet open to any client.
+ * @var status_export_state_t::log
+ *     @brief The server's log, to get completed tasks from.
+ * @var status_export_state_t::client_pid
+ *     @brief The PID of the client to reply to.
+ * @var status_export_state_t::format
+ *     @brief Format of the file to be written.
+ * @var status_export_state_t::first_id
+ *     @brief Lowest identifier of the tasks to be exported.
+ * @var status_export_state_t::last_id
+ *     @brief Highest identifier of the tasks to be exported.
+ * @var status_export_state_t::path
+ *     @brief Path of the file to be written, created empty beforehand by the client.
+ */
+typedef struct {
+    ipc_t                   *ipc;
+    log_store_t             *log;
+    pid_t                    client_pid;
+    protocol_export_format_t format;
+    uint32_t                 first_id, last_id;
+    char                     path[PROTOCOL_MAXIMUM_EXPORT_PATH_LENGTH + 1];
+} status_export_state_t;
+
+/**
+ * @brief   Entry point to the subprogram that writes completed tasks to a file for the client.
+ * @details Only a completion message (or an error) is sent to the client, so large exports don't
+ *          go through its FIFO. To keep clients from overwriting files that aren't theirs, the file
+ *          must already exist, be an empty regular file and be owned by the user that owns the
+ *          client's named pipe, and symbolic links aren't followed.
+ *
+ * @param state_data A pointer to a ::status_export_state_t. It's only a `void *` to match the
+ *                   signature of ::task_prcedure_t. Mustn't be `NULL`.
+ * @param slot       Slot where the task was scheduled.
+ *
+ * @return The exit code of the program. The value of `errno` is unspecified.
+ */
+int status_export_main(void *state_data, size_t slot);
+
+/**
+ * @struct status_output_state_t
+ * @brief  Data the program that sends the output of a task needs to operate.
+ *
+ * @var status_output_state_t::ipc
+ *     @brief ::IPC_ENDPOINT_SERVER connection, not yet open to any client.
+ * @var status_output_state_t::store
+ *     @brief Where the output of tasks is stored.
+ * @var status_output_state_t::client_pid
+ *     @brief The PID of the client to send the output to.
+ * @var status_output_state_t::id
+ *     @brief Identifier of the task whose output is sent.
+ * @var status_output_state_t::stream
+ *     @brief Output stream to be sent.
+ * @var status_output_state_t::first_byte
+ *     @brief Offset of the first byte of the output to be sent.
+ * @var status_output_state_t::last_byte
+ *     @brief Offset of the last byte of the output to be sent.
+ */
+typedef struct {
+    ipc_t                *ipc;
+    output_store_t       *store;
+    pid_t                 client_pid;
+    uint32_t              id;
+    output_store_stream_t stream;
+    uint64_t              first_byte, last_byte;
+} status_output_state_t;
+
+/**
+ * @brief   Entry point to the subprogram that sends the stored output of a task to the client.
+ * @details The output is written to the client's named pipe (see ::ipc_get_follow_fifo_path), after
+ *          a ::PROTOCOL_S2C_OUTPUT message with its length (or an error) is sent.
+ *
+ * @param state_data A pointer to a ::status_output_state_t. It's only a `void *` to match the
+ *                   signature of ::task_prcedure_t. Mustn't be `NULL`.
+ * @param slot       Slot where the task was scheduled.
+ *
+ * @return The exit code of the program. The value of `errno` is unspecified.
+ */
+int status_output_main(void *state_data, size_t slot);
+
+/**
+ * @struct status_sweep_state_t
+ * @brief  Data the program that enforces the output retention policy needs to operate.
+ *
+ * @var status_sweep_state_t::store
+ *     @brief Where the output of tasks is stored.
+ * @var status_sweep_state_t::retention
+ *     @brief Limits on the output kept in status_sweep_state_t::store.
+ * @var status_sweep_state_t::first_active
+ *     @brief Identifier of the oldest task that may still be writing output.
+ * @var status_sweep_state_t::next_id
+ *     @brief Identifier that will be attributed to the next task.
+ */
+typedef struct {
+    output_store_t          *store;
+    output_store_retention_t retention;
+    uint32_t                 first_active, next_id;
+} status_sweep_state_t;
+
+/**
+ * @brief   Entry point to the subprogram that deletes old task output (see ::output_store_sweep).
+ * @details This program runs with the lowest CPU priority, so that it doesn't slow down tasks.
+ *
+ * @param state_data A pointer to a ::status_sweep_state_t. It's only a `void *` to match the
+ *                   signature of ::task_prcedure_t. Mustn't be `NULL`.
+ * @param slot       Slot where the task was scheduled.
+ *
+ * @return The exit code of the program. The value of `errno` is unspecified.
+ */
+int status_sweep_main(void *state_data, size_t slot);
+
+/**
+ * @struct status_compact_state_t
+ * @brief  Data the program that compacts old segments of the log needs to operate.
+ *
+ * @var status_compact_state_t::log
+ *     @brief Log whose segments are compacted.
+ * @var status_compact_state_t::count
+ *     @brief Number of segments to compact (see ::log_store_get_compactable).
+ */
+typedef struct {
+    log_store_t *log;
+    size_t       count;
+} status_compact_state_t;
+
+/**
+ * @brief   Entry point to the subprogram that compacts old segments of the log (see
+ *          ::log_store_compact).
+ * @details This program runs with the lowest CPU priority, so that it doesn't slow down tasks.
+ *          Whether compaction failed is reported in protocol_task_done_message_t::error, as the
+ *          server must only forget the segments once they're compacted.
+ *
+ * @param state_data A pointer to a ::status_compact_state_t. It's only a `void *` to match the
+ *                   signature of ::task_prcedure_t. Mustn't be `NULL`.
+ * @param slot       Slot where the task was scheduled.
+ *
+ * @return The exit code of the program. The value of `errno` is unspecified.
+ */
+int status_compact_main(void *state_data, size_t slot);
+
 #endif
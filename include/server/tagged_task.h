@@ -44,6 +44,39 @@ typedef enum {
     TAGGED_TASK_TIME_COMPLETED
 } tagged_task_time_t;
 
+/**
+ * @brief   Maximum number of programs in a task whose statistics are kept.
+ * @details Limited so that all statistics fit in a single message (see ::PIPE_BUF).
+ */
+#define TAGGED_TASK_MAXIMUM_STAGES 32
+
+/**
+ * @struct tagged_task_stage_t
+ * @brief  Statistics about the execution of a program (pipeline stage) in a task.
+ *
+ * @var tagged_task_stage_t::started
+ *     @brief When the program was spawned (`CLOCK_MONOTONIC`).
+ * @var tagged_task_stage_t::ended
+ *     @brief When the program's termination was noticed (`CLOCK_MONOTONIC`).
+ * @var tagged_task_stage_t::user_time
+ *     @brief CPU time spent in user mode, in microseconds.
+ * @var tagged_task_stage_t::system_time
+ *     @brief CPU time spent in kernel mode, in microseconds.
+ * @var tagged_task_stage_t::maximum_resident_size
+ *     @brief Maximum resident set size, in kibibytes.
+ * @var tagged_task_stage_t::exit_status
+ *     @brief Exit code of the program, or the symmetric of the signal that terminated it.
+ * @var tagged_task_stage_t::executed
+ *     @brief Whether the program was run (it isn't after a failure followed by `&&`).
+ */
+typedef struct {
+    struct timespec started, ended;
+    uint64_t        user_time, system_time;
+    uint64_t        maximum_resident_size;
+    int32_t         exit_status;
+    uint8_t         executed;
+} tagged_task_stage_t;
+
 /** @brief A task (see ::task_t) with extra information needed for task management. */
 typedef struct tagged_task tagged_task_t;
 
@@ -94,9 +127,12 @@ tagged_task_t *tagged_task_new_from_procedure(task_procedure_t procedure,
 void tagged_task_free(tagged_task_t *task);
 
 /**
- * @brief  Creates a deep copy of a task.
- * @param  task Task to be cloned.
- * @return A copy of @p task on success, `NULL` on failure (check `errno`).
+ * @brief   Creates a copy of a task.
+ * @details The immutable part of the task (command line, ::task_t, identifier and expected time)
+ *          is reference-counted and shared with @p task, so only the timestamps are copied. This
+ *          makes moving a task between the queue, the scheduler's slots and the log cheap.
+ * @param   task Task to be cloned.
+ * @return  A copy of @p task on success, `NULL` on failure (check `errno`).
  *
  * | `errno`  | Cause               |
  * | -------- | ------------------- |
@@ -161,4 +197,33 @@ const struct timespec *tagged_task_get_time(const tagged_task_t *task, tagged_ta
  */
 int tagged_task_set_time(tagged_task_t *task, tagged_task_time_t id, const struct timespec *time);
 
+/**
+ * @brief Gets the statistics of the programs in a task that has been run.
+ *
+ * @param task  Task to get the statistics from. Mustn't be `NULL`.
+ * @param count Where to write the number of stages to. Mustn't be `NULL`. `0` is written if no
+ *              statistics have been set.
+ *
+ * @return The statistics of each program, in the same order as ::task_get_programs, or `NULL` on
+ *         failure (`errno = EINVAL`) or if no statistics have been set.
+ */
+const tagged_task_stage_t *tagged_task_get_stages(const tagged_task_t *task, size_t *count);
+
+/**
+ * @brief Sets the statistics of the programs in a task that has been run.
+ *
+ * @param task   Task to have its statistics set. Mustn't be `NULL`.
+ * @param stages Statistics of each program, to be copied to the task.
+ * @param count  Number of elements in @p stages. Can't be more than ::TAGGED_TASK_MAXIMUM_STAGES.
+ *
+ * @retval 0 Success.
+ * @retval 1 Failure (check `errno`).
+ *
+ * | `errno`  | Cause                                                            |
+ * | -------- | ---------------------------------------------------------------- |
+ * | `EINVAL` | @p task is `NULL`, @p stages is `NULL` or @p count is too large. |
+ * | `ENOMEM` | Allocation failure.                                              |
+ */
+int tagged_task_set_stages(tagged_task_t *task, const tagged_task_stage_t *stages, size_t count);
+
 #endif
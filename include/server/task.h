@@ -43,6 +43,28 @@ typedef struct task task_t;
  */
 typedef int (*task_procedure_t)(void *state, size_t slot);
 
+/** @brief How a program in a task is connected to the program that follows it. */
+typedef enum {
+    TASK_CONNECTOR_NONE,     /**< @brief Last program in the task. */
+    TASK_CONNECTOR_PIPE,     /**< @brief Output piped to the next program (`|`). */
+    TASK_CONNECTOR_AND,      /**< @brief Next pipeline only runs on success (`&&`). */
+    TASK_CONNECTOR_SEQUENCE, /**< @brief Next pipeline runs after this one (`;`). */
+} task_connector_t;
+
+/**
+ * @struct task_program_layout_t
+ * @brief  Description of a program in a task created with ::task_new_from_string_table.
+ *
+ * @var task_program_layout_t::program
+ *     @brief Arguments and redirections of the program.
+ * @var task_program_layout_t::connector
+ *     @brief How the program is connected to the next one. Ignored for the last program.
+ */
+typedef struct {
+    program_layout_t program;
+    task_connector_t connector;
+} task_program_layout_t;
+
 /**
  * @brief   Creates a empty task composed of programs.
  * @details This task isn't valid, and needs to be populated with programs (see
@@ -67,6 +89,32 @@ task_t *task_new_empty(void);
  */
 task_t *task_new_from_programs(const program_t *const *programs, size_t length);
 
+/**
+ * @brief   Creates a new task from a table of argument strings, in a single allocation.
+ * @details The task's programs can't be modified (see ::program_new_in_place), nor can programs be
+ *          added to the task.
+ *
+ * @param strings        Buffer of null-terminated arguments and redirection paths of all programs.
+ *                       Will be copied. Mustn't be `NULL`.
+ * @param strings_length Number of bytes in @p strings.
+ * @param offsets        Offset of every argument in @p strings, ordered by program. Mustn't be
+ *                       `NULL`.
+ * @param layouts        Description of each program. Mustn't be `NULL`.
+ * @param nprograms      Number of programs in @p layouts. Mustn't be `0`.
+ *
+ * @return A new task on success, or `NULL` on failure (check `errno`).
+ *
+ * | `errno`  | Cause                                               |
+ * | -------- | --------------------------------------------------- |
+ * | `EINVAL` | An array argument is `NULL` or @p nprograms is `0`. |
+ * | `ENOMEM` | Allocation failure.                                 |
+ */
+task_t *task_new_from_string_table(const char                  *strings,
+                                   size_t                       strings_length,
+                                   const size_t                *offsets,
+                                   const task_program_layout_t *layouts,
+                                   size_t                       nprograms);
+
 /**
  * @brief Creates a new task that will run a procedure.
  *
@@ -104,16 +152,17 @@ task_t *task_clone(const task_t *task);
 /**
  * @brief Appends a program to a task's program list.
  *
- * @param task    Task to be modified. Mustn't be `NULL` or a task composed of a procedure.
+ * @param task    Task to be modified. Mustn't be `NULL`, a task composed of a procedure, or a task
+ *                with connectors other than pipes (e.g.: created with ::task_new_from_string_table).
  * @param program Program to be added to @p task. Mustn't be `NULL`.
  *
  * @retval 0 Success.
  * @retval 1 Failure (check `errno`).
  *
- * | `errno`  | Cause                                                          |
- * | -------- | -------------------------------------------------------------- |
- * | `EINVAL` | @p program is `NULL` or @p task is `NULL` or a procedure task. |
- * | `ENOMEM` | Allocation failure.                                            |
+ * | `errno`  | Cause                                                                          |
+ * | -------- | ------------------------------------------------------------------------------ |
+ * | `EINVAL` | @p program is `NULL` or @p task is `NULL`, a procedure task or has connectors. |
+ * | `ENOMEM` | Allocation failure.                                                            |
  */
 int task_add_program(task_t *task, const program_t *program);
 
@@ -128,6 +177,16 @@ int task_add_program(task_t *task, const program_t *program);
  */
 const program_t *const *task_get_programs(const task_t *task, size_t *count);
 
+/**
+ * @brief Gets how a program in a task is connected to the next one.
+ *
+ * @param task  Task to get the connector from. Mustn't be `NULL` or a task composed of a procedure.
+ * @param index Index of the program in the list returned by ::task_get_programs.
+ *
+ * @return The connector after the program, or ::TASK_CONNECTOR_NONE on failure (`errno = EINVAL`).
+ */
+task_connector_t task_get_connector(const task_t *task, size_t index);
+
 /**
  * @brief Gets the procedure of a task composed by one.
  *
@@ -22,20 +22,56 @@
 #ifndef TASK_RUNNER_H
 #define TASK_RUNNER_H
 
+#include <signal.h>
+
+#include "server/output_store.h"
 #include "server/tagged_task.h"
 
 /**
- * @brief Entry point to the child that runs processes in tasks.
+ * @brief   Signal sent to a task runner for a client to start following the task's output.
+ * @details The PID of the client is sent as the signal's value (see `man 3 sigqueue`). This signal
+ *          must be blocked in the process that creates task runners, so that it's kept pending
+ *          until a runner is ready to handle it.
+ */
+#define TASK_RUNNER_FOLLOW_SIGNAL SIGUSR1
+
+/**
+ * @brief   Entry point to the child that runs processes in tasks.
+ * @details Unless @p store can't be written to, the output of the programs goes through pipes
+ *          drained by the runner into @p store (see ::output_store_write). Clients can then ask for
+ *          the output to be streamed to them with ::TASK_RUNNER_FOLLOW_SIGNAL, in which case it's
+ *          `tee()`d into their named pipes (see ::ipc_get_follow_fifo_path). Programs are spawned
+ *          and reaped by the runner itself, on `SIGCHLD`, in the loop that drains their output.
  *
  * @param task      Task to be run.
  * @param slot      Slot in the scheduler where this task was scheduled, used to identify this task
  *                  when compeleted.
- * @param directory Directory path where to write output and error files.
+ * @param store     Where to store the output of the task. Can only be `NULL` for procedures.
  *
  * @return 0 Success.
  * @return 1 Failure. The value of `errno` is unspecified, as the process `_exit()`s after calling
  *           this.
  */
-int task_runner_main(tagged_task_t *task, size_t slot, const char *directory);
+int task_runner_main(tagged_task_t *task, size_t slot, const output_store_t *store);
+
+/**
+ * @brief   Sets the size of the buffers of the pipes between the programs of a pipeline.
+ * @details Larger buffers let throughput-heavy pipelines run with fewer context switches. The
+ *          setting is inherited by task runners forked after this call.
+ *
+ * @param size Size of the buffers in bytes, or `0` for the system's default. Rounded up to a power
+ *             of two number of pages by the kernel.
+ *
+ * @retval 0 Success.
+ * @retval 1 Failure (check `errno`).
+ *
+ * | `errno`   | Cause                                                               |
+ * | --------- | ------------------------------------------------------------------- |
+ * | `EINVAL`  | @p size is too large.                                               |
+ * | `EPERM`   | @p size is above `/proc/sys/fs/pipe-max-size` for this user.        |
+ * | `ENOTSUP` | Pipe sizes can't be set on this system.                             |
+ * | other     | See `man 2 pipe`.                                                   |
+ */
+int task_runner_set_pipe_size(size_t size);
 
 #endif
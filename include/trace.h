@@ -0,0 +1,208 @@
+/*
+ * Copyright 2024 Humberto Gomes, José Lopes, José Matos
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+/**
+ * @file    trace.h
+ * @brief   Low-overhead tracing of the path of tasks through the server and its children.
+ * @details The server maps a file (::TRACE_PATH) with a ring buffer of timestamped events, before
+ *          any other process is forked, so that all of its children write to the same ring. Events
+ *          are only recorded while tracing is enabled, which clients can do at any time by writing
+ *          to the same file (see ::trace_set_enabled). The ring can then be exported as Chrome
+ *          trace-event JSON (see ::trace_dump), to be opened in Perfetto or `chrome://tracing`.
+ *
+ *          While tracing is disabled, recording an event costs a single memory load.
+ */
+
+#ifndef TRACE_H
+#define TRACE_H
+
+#include <stdint.h>
+#include <stdio.h>
+#include <sys/types.h>
+
+/** @brief Path of the file shared between the server, its children and clients. */
+#define TRACE_PATH "/tmp/orchestrator.trace"
+
+/** @brief Version of the layout of ::trace_region_t, checked by readers. */
+#define TRACE_VERSION 1
+
+/** @brief Number of events kept in the ring. Older events are overwritten. */
+#define TRACE_CAPACITY 65536
+
+/** @brief Value of trace_event_t::task_id for events not related to a task. */
+#define TRACE_NO_TASK UINT32_MAX
+
+/** @brief Points of the server (and of its children) where events are recorded. */
+typedef enum {
+    TRACE_EVENT_FRAME_READ, /**< @brief Frames were read from the server's FIFO (instant). */
+    TRACE_EVENT_MESSAGE,    /**< @brief A message was handled by the server (duration). */
+    TRACE_EVENT_ENQUEUE,    /**< @brief A task was added to the scheduler's queue (instant). */
+    TRACE_EVENT_DISPATCH,   /**< @brief A task was taken from the queue to be run (instant). */
+    TRACE_EVENT_FORK,       /**< @brief A task's runner started running (instant). */
+    TRACE_EVENT_EXEC,       /**< @brief A program of a task is about to be executed (instant). */
+    TRACE_EVENT_DONE_SENT,  /**< @brief A task's runner told the server it's done (instant). */
+    TRACE_EVENT_DONE,       /**< @brief The server handled the end of a task (instant). */
+    TRACE_EVENT_LOG_WRITE   /**< @brief A completed task was written to the log (duration). */
+} trace_event_type_t;
+
+/** @brief Number of values in ::trace_event_type_t. */
+#define TRACE_EVENT_TYPE_COUNT 9
+
+/**
+ * @struct trace_event_t
+ * @brief  An event in the ring of a ::trace_region_t.
+ *
+ * @var trace_event_t::sequence
+ *     @brief Position of the event in the ring plus one, or `0` while the event is being written.
+ * @var trace_event_t::timestamp
+ *     @brief When the event (or its duration) started, in nanoseconds (`CLOCK_MONOTONIC`).
+ * @var trace_event_t::duration
+ *     @brief Duration of the event in nanoseconds. `0` for instant events.
+ * @var trace_event_t::pid
+ *     @brief PID of the process where the event happened.
+ * @var trace_event_t::task_id
+ *     @brief Identifier of the task the event is about, or ::TRACE_NO_TASK.
+ * @var trace_event_t::type
+ *     @brief Type of the event (a ::trace_event_type_t).
+ * @var trace_event_t::arg
+ *     @brief   Extra information about the event.
+ *     @details Number of frames for ::TRACE_EVENT_FRAME_READ, message type for
+ *              ::TRACE_EVENT_MESSAGE, and slot for ::TRACE_EVENT_DISPATCH and ::TRACE_EVENT_FORK.
+ */
+typedef struct {
+    uint64_t sequence;
+    uint64_t timestamp, duration;
+    int32_t  pid;
+    uint32_t task_id;
+    uint32_t type, arg;
+} trace_event_t;
+
+/**
+ * @struct trace_region_t
+ * @brief  Contents of ::TRACE_PATH.
+ *
+ * @var trace_region_t::version
+ *     @brief ::TRACE_VERSION.
+ * @var trace_region_t::enabled
+ *     @brief Whether events are being recorded.
+ * @var trace_region_t::server_pid
+ *     @brief PID of the server that created the region.
+ * @var trace_region_t::next
+ *     @brief Number of events ever recorded. The next event is written to `next % capacity`.
+ * @var trace_region_t::events
+ *     @brief Ring of events.
+ */
+typedef struct {
+    uint32_t      version, enabled;
+    int64_t       server_pid;
+    uint64_t      next;
+    trace_event_t events[TRACE_CAPACITY];
+} trace_region_t;
+
+/**
+ * @brief   Creates the ring events are recorded to, with tracing disabled.
+ * @details Must be called by the server before forking any process. Later calls fail.
+ *
+ * @param server_pid PID of the server.
+ *
+ * @retval 0 Success.
+ * @retval 1 Failure (check `errno`).
+ *
+ * | `errno`  | Cause                                                 |
+ * | -------- | ----------------------------------------------------- |
+ * | `EEXIST` | The ring was already created by this process.         |
+ * | other    | See `man 2 open`, `man 2 ftruncate` and `man 2 mmap`. |
+ */
+int trace_init(pid_t server_pid);
+
+/** @brief Unmaps and deletes the ring created by ::trace_init, if it was created. */
+void trace_free(void);
+
+/**
+ * @brief   Sets the task that events in this process are about, when no task is given.
+ * @details Meant for task runners, so that events in their children are attributed to the task.
+ * @param   task_id Identifier of the task, or ::TRACE_NO_TASK.
+ */
+void trace_set_task(uint32_t task_id);
+
+/**
+ * @brief Records an instant event, if tracing is enabled.
+ *
+ * @param type    Type of the event.
+ * @param task_id Identifier of the task the event is about. ::TRACE_NO_TASK for the task given to
+ *                ::trace_set_task.
+ * @param arg     Extra information about the event (see trace_event_t::arg).
+ */
+void trace_event(trace_event_type_t type, uint32_t task_id, uint32_t arg);
+
+/**
+ * @brief  Starts measuring the duration of an event, if tracing is enabled.
+ * @return A value to be passed to ::trace_end (`0` if tracing is disabled).
+ */
+uint64_t trace_begin(void);
+
+/**
+ * @brief Records an event whose duration was being measured.
+ *
+ * @param type    Type of the event.
+ * @param task_id Identifier of the task the event is about. ::TRACE_NO_TASK for the task given to
+ *                ::trace_set_task.
+ * @param arg     Extra information about the event (see trace_event_t::arg).
+ * @param start   Value returned by ::trace_begin. Nothing is recorded if it's `0`.
+ */
+void trace_end(trace_event_type_t type, uint32_t task_id, uint32_t arg, uint64_t start);
+
+/**
+ * @brief Enables or disables tracing in a running server, from any process.
+ *
+ * @param enabled Whether events should be recorded.
+ *
+ * @retval 0 Success.
+ * @retval 1 Failure (check `errno`).
+ *
+ * | `errno`  | Cause                                                  |
+ * | -------- | ------------------------------------------------------ |
+ * | `ENOENT` | No server is running.                                  |
+ * | `ESRCH`  | The server that created the ring is no longer running. |
+ * | `EPROTO` | The server uses a different version of the layout.     |
+ * | other    | See `man 2 open` and `man 2 mmap`.                     |
+ */
+int trace_set_enabled(int enabled);
+
+/**
+ * @brief   Writes the events in the ring of a running server as Chrome trace-event JSON.
+ * @details Every process is shown as a thread of the server. Every task also gets an asynchronous
+ *          slice, from the moment it's queued until the server handles its end, so that its whole
+ *          path through the system can be seen in the same timeline.
+ *
+ * @param out         Where to write the JSON to. Mustn't be `NULL`.
+ * @param event_count Where to write the number of events written to. Can be `NULL`.
+ *
+ * @retval 0 Success.
+ * @retval 1 Failure (check `errno`).
+ *
+ * | `errno`  | Cause                                                  |
+ * | -------- | ------------------------------------------------------ |
+ * | `EINVAL` | @p out is `NULL`.                                      |
+ * | `ENOENT` | No server is running.                                  |
+ * | `ESRCH`  | The server that created the ring is no longer running. |
+ * | `EPROTO` | The server uses a different version of the layout.     |
+ * | `ENOMEM` | Allocation failure.                                    |
+ * | other    | See `man 2 open`, `man 2 mmap` and `man 3 fprintf`.    |
+ */
+int trace_dump(FILE *out, size_t *event_count);
+
+#endif
@@ -0,0 +1,96 @@
+/*
+ * Copyright 2024 Humberto Gomes, José Lopes, José Matos
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+/**
+ * @file  bench/bench.c
+ * @brief Implementation of methods in bench/bench.h
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "bench/bench.h"
+
+/** @brief Substring that benchmark names must contain to be run. `NULL` to run all benchmarks. */
+static const char *__bench_filter = NULL;
+
+int bench_is_selected(const char *name) {
+    return !__bench_filter || strstr(name, __bench_filter) || strstr(__bench_filter, name);
+}
+
+int bench_is_full(void) {
+    const char *full = getenv("BENCH_FULL");
+    return full && *full && strcmp(full, "0") != 0;
+}
+
+void bench_set_filter(const char *filter) {
+    __bench_filter = filter;
+}
+
+void bench_reset(bench_t *bench) {
+    bench->nsamples  = 0;
+    bench->warmed_up = 0;
+}
+
+int bench_keep_running(const bench_t *bench) {
+    return bench->nsamples < BENCH_REPETITIONS;
+}
+
+void bench_start(bench_t *bench) {
+    (void) clock_gettime(CLOCK_MONOTONIC, &bench->start);
+}
+
+void bench_stop(bench_t *bench, size_t operations) {
+    struct timespec end;
+    (void) clock_gettime(CLOCK_MONOTONIC, &end);
+
+    if (!bench->warmed_up) {
+        bench->warmed_up = 1; /* Discard warm-up (cold caches, page faults on first allocation) */
+        return;
+    }
+
+    double elapsed = (end.tv_sec - bench->start.tv_sec) * 1000000000.0 +
+                     (end.tv_nsec - bench->start.tv_nsec);
+    bench->samples[bench->nsamples++] = elapsed / operations;
+}
+
+/**
+ * @brief  Compares two `double`s for `qsort()`.
+ * @param  a Pointer to the first `double`.
+ * @param  b Pointer to the second `double`.
+ * @return Negative if `a < b`, positive if `a > b`, `0` otherwise.
+ */
+int __bench_compare_doubles(const void *a, const void *b) {
+    double da = *(const double *) a, db = *(const double *) b;
+    return (da > db) - (da < db);
+}
+
+void bench_report(const bench_t *bench, const char *name, const char *parameters) {
+    double sorted[BENCH_REPETITIONS];
+    memcpy(sorted, bench->samples, sizeof(double) * bench->nsamples);
+    qsort(sorted, bench->nsamples, sizeof(double), __bench_compare_doubles);
+
+    printf("{\"benchmark\": \"%s\", \"parameters\": %s, \"repetitions\": %zu, "
+           "\"ns_per_op_min\": %.3f, \"ns_per_op_median\": %.3f, \"ns_per_op_max\": %.3f}\n",
+           name,
+           parameters,
+           bench->nsamples,
+           sorted[0],
+           sorted[bench->nsamples / 2],
+           sorted[bench->nsamples - 1]);
+    fflush(stdout);
+}
@@ -0,0 +1,155 @@
+/*
+ * Copyright 2024 Humberto Gomes, José Lopes, José Matos
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+/**
+ * @file  bench/command_parser_bench.c
+ * @brief Benchmarks of ::command_parser_parse_task.
+ */
+
+#include <limits.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "bench/bench.h"
+#include "server/command_parser.h"
+#include "util.h"
+
+/** @brief Path to the corpus of command lines used by the parser's tests. */
+#define COMMAND_PARSER_BENCH_CORPUS "tests/parser.txt"
+
+/** @brief Maximum number of command lines in a corpus. */
+#define COMMAND_PARSER_BENCH_MAX_LINES 256
+
+/** @brief Minimum number of command lines parsed in each repetition of a benchmark. */
+#define COMMAND_PARSER_BENCH_OPERATIONS 100000
+
+/**
+ * @brief Benchmarks the parsing (and freeing) of a corpus of command lines.
+ *
+ * @param lines  Command lines to be parsed. Mustn't be `NULL`.
+ * @param nlines Number of command lines in @p lines. Mustn't be `0`.
+ * @param corpus Name of the corpus, for the report.
+ */
+void __command_parser_bench_run(char *const *lines, size_t nlines, const char *corpus) {
+    size_t bytes = 0;
+    for (size_t i = 0; i < nlines; ++i)
+        bytes += strlen(lines[i]);
+
+    size_t rounds = (COMMAND_PARSER_BENCH_OPERATIONS + nlines - 1) / nlines;
+    bench_t bench;
+    bench_reset(&bench);
+    while (bench_keep_running(&bench)) {
+        bench_start(&bench);
+        for (size_t round = 0; round < rounds; ++round)
+            for (size_t i = 0; i < nlines; ++i)
+                task_free(command_parser_parse_task(lines[i]));
+        bench_stop(&bench, rounds * nlines);
+    }
+
+    char parameters[LINE_MAX];
+    snprintf(parameters,
+             LINE_MAX,
+             "{\"corpus\": \"%s\", \"lines\": %zu, \"average_length\": %zu}",
+             corpus,
+             nlines,
+             bytes / nlines);
+    bench_report(&bench, "command_parser_parse_task", parameters);
+}
+
+/**
+ * @brief  Reads the command lines in the parser's test corpus (without the expected exit code).
+ * @param  lines Where to write the command lines to. Must have space for
+ *               ::COMMAND_PARSER_BENCH_MAX_LINES elements. Mustn't be `NULL`.
+ * @return The number of lines read (`0` on failure).
+ */
+size_t __command_parser_bench_read_corpus(char **lines) {
+    FILE *file = fopen(COMMAND_PARSER_BENCH_CORPUS, "r");
+    if (!file) {
+        util_perror("__command_parser_bench_read_corpus(): failed to open corpus (run from the "
+                    "project's root)");
+        return 0;
+    }
+
+    size_t nlines = 0;
+    char   line[LINE_MAX];
+    while (nlines < COMMAND_PARSER_BENCH_MAX_LINES && fgets(line, LINE_MAX, file)) {
+        line[strcspn(line, "\n")] = '\0';
+        if (!*line)
+            continue;
+
+        lines[nlines] = strdup(line + 1); /* Skip expected exit code */
+        if (!lines[nlines])
+            break;
+        nlines++;
+    }
+
+    fclose(file);
+    return nlines;
+}
+
+/**
+ * @brief  Generates a long command line by repeating a segment.
+ * @param  segment   Segment to be repeated.
+ * @param  separator String placed between segments.
+ * @param  count     Number of times @p segment is repeated.
+ * @return The generated command line, or `NULL` on allocation failure.
+ */
+char *__command_parser_bench_generate(const char *segment, const char *separator, size_t count) {
+    size_t segment_length = strlen(segment), separator_length = strlen(separator);
+    char  *ret            = malloc(count * (segment_length + separator_length) + 1);
+    if (!ret)
+        return NULL;
+
+    char *cursor = ret;
+    for (size_t i = 0; i < count; ++i) {
+        if (i != 0) {
+            memcpy(cursor, separator, separator_length);
+            cursor += separator_length;
+        }
+        memcpy(cursor, segment, segment_length);
+        cursor += segment_length;
+    }
+    *cursor = '\0';
+    return ret;
+}
+
+void bench_command_parser(void) {
+    if (!bench_is_selected("command_parser"))
+        return;
+
+    char  *corpus[COMMAND_PARSER_BENCH_MAX_LINES];
+    size_t ncorpus = __command_parser_bench_read_corpus(corpus);
+    if (ncorpus)
+        __command_parser_bench_run(corpus, ncorpus, "parser.txt");
+    for (size_t i = 0; i < ncorpus; ++i)
+        free(corpus[i]);
+
+    /* Long command lines, close to the maximum size of a message */
+    char *generated[] = {
+        __command_parser_bench_generate("grep -v \"some pattern\"", " | ", 128),
+        __command_parser_bench_generate("argument", " ", 256),
+        __command_parser_bench_generate("'quoted \\\\ argument' \"with \\\" escapes\"", " ", 64),
+        __command_parser_bench_generate("cat < in > out 2>> err", " && ", 96),
+    };
+    const char *names[] = {"long_pipeline", "many_arguments", "quoting", "redirections"};
+
+    for (size_t i = 0; i < sizeof(generated) / sizeof(*generated); ++i) {
+        if (generated[i])
+            __command_parser_bench_run(generated + i, 1, names[i]);
+        free(generated[i]);
+    }
+}
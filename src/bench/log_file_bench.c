@@ -0,0 +1,131 @@
+/*
+ * Copyright 2024 Humberto Gomes, José Lopes, José Matos
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+/**
+ * @file  bench/log_file_bench.c
+ * @brief Benchmarks of ::log_file_write_task, ::log_file_read_tasks and ::log_file_read_records.
+ */
+
+#include <limits.h>
+#include <stdio.h>
+#include <unistd.h>
+
+#include "bench/bench.h"
+#include "server/log_file.h"
+#include "util.h"
+
+/**
+ * @brief Callback for ::log_file_read_tasks that counts tasks.
+ *
+ * @param task        Task read from the log file. Ignored.
+ * @param error       Whether the task failed. Ignored.
+ * @param state_count A `size_t *` to be incremented.
+ *
+ * @retval 0 Always successful.
+ */
+int __log_file_bench_count_task(const tagged_task_t *task, int error, void *state_count) {
+    (void) task;
+    (void) error;
+    (*(size_t *) state_count)++;
+    return 0;
+}
+
+/**
+ * @brief Callback for ::log_file_read_records that counts records.
+ *
+ * @param record      Record read from the log file. Ignored.
+ * @param state_count A `size_t *` to be incremented.
+ *
+ * @retval 0 Always successful.
+ */
+int __log_file_bench_count_record(const log_file_record_t *record, void *state_count) {
+    (void) record;
+    (*(size_t *) state_count)++;
+    return 0;
+}
+
+/**
+ * @brief Benchmarks writing a number of tasks to a log file and reading them back.
+ * @param ntasks Number of tasks in the log file.
+ */
+void __log_file_bench_run(size_t ntasks) {
+    char path[PATH_MAX];
+    snprintf(path, PATH_MAX, "/tmp/bench_log_%ld.bin", (long) getpid());
+
+    tagged_task_t *task =
+        tagged_task_new_from_command_line("grep -v pattern input.txt | sort | uniq -c", 1, 100);
+    if (!task) {
+        util_perror("__log_file_bench_run(): failed to create task");
+        return;
+    }
+
+    struct timespec now;
+    (void) clock_gettime(CLOCK_MONOTONIC, &now);
+    for (tagged_task_time_t i = TAGGED_TASK_TIME_SENT; i <= TAGGED_TASK_TIME_COMPLETED; ++i)
+        tagged_task_set_time(task, i, &now);
+
+    bench_t write_bench, read_bench, records_bench;
+    bench_reset(&write_bench);
+    bench_reset(&read_bench);
+    bench_reset(&records_bench);
+    while (bench_keep_running(&write_bench)) {
+        log_file_t *log = log_file_new(path, 1, LOG_WRITER_DURABILITY_NONE);
+        if (!log) {
+            util_perror("__log_file_bench_run(): failed to create log file");
+            break;
+        }
+
+        bench_start(&write_bench);
+        for (size_t i = 0; i < ntasks; ++i)
+            (void) log_file_write_task(log, task, 0);
+        bench_stop(&write_bench, ntasks);
+
+        size_t count = 0;
+        bench_start(&read_bench);
+        (void) log_file_read_tasks(log, __log_file_bench_count_task, &count);
+        bench_stop(&read_bench, ntasks);
+
+        if (count != ntasks)
+            util_error("__log_file_bench_run(): read %zu tasks, expected %zu\n", count, ntasks);
+
+        count = 0;
+        bench_start(&records_bench);
+        (void) log_file_read_records(log, __log_file_bench_count_record, &count);
+        bench_stop(&records_bench, ntasks);
+
+        if (count != ntasks)
+            util_error("__log_file_bench_run(): read %zu records, expected %zu\n", count, ntasks);
+        log_file_free(log);
+    }
+
+    char parameters[LINE_MAX];
+    snprintf(parameters, LINE_MAX, "{\"size\": %zu}", ntasks);
+    bench_report(&write_bench, "log_file_write_task", parameters);
+    bench_report(&read_bench, "log_file_read_tasks", parameters);
+    bench_report(&records_bench, "log_file_read_records", parameters);
+
+    (void) unlink(path);
+    tagged_task_free(task);
+}
+
+void bench_log_file(void) {
+    if (!bench_is_selected("log_file"))
+        return;
+
+    size_t max_size = bench_is_full() ? 100000 : 10000;
+    for (size_t size = 1000; size <= max_size; size *= 10)
+        __log_file_bench_run(size);
+}
@@ -0,0 +1,45 @@
+/*
+ * Copyright 2024 Humberto Gomes, José Lopes, José Matos
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+/**
+ * @file  main.c
+ * @brief Contains the entry point to the microbenchmark program.
+ */
+
+#include <string.h>
+
+#include "bench/bench.h"
+#include "util.h"
+
+/**
+ * @brief  The entry point to the microbenchmark program.
+ * @retval 0 Success.
+ * @retval 1 Invalid command-line arguments.
+ */
+int main(int argc, char **argv) {
+    if (argc > 2 || (argc == 2 && strcmp(argv[1], "help") == 0)) {
+        util_error("Usage: %s [benchmark name filter]\n", argv[0]);
+        util_error("Set BENCH_FULL=1 to run the larger (slower) benchmarks.\n");
+        return 1;
+    }
+    bench_set_filter(argc == 2 ? argv[1] : NULL);
+
+    bench_priority_queue();
+    bench_command_parser();
+    bench_log_file();
+    bench_protocol();
+    return 0;
+}
@@ -0,0 +1,131 @@
+/*
+ * Copyright 2024 Humberto Gomes, José Lopes, José Matos
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+/**
+ * @file  bench/priority_queue_bench.c
+ * @brief Benchmarks of ::priority_queue_t, using the comparison functions of the scheduler.
+ */
+
+#include <limits.h>
+#include <stdio.h>
+#include <stdlib.h>
+
+#include "bench/bench.h"
+#include "server/priority_queue.h"
+#include "server/scheduler.h"
+#include "util.h"
+
+/** @brief Procedure of the tasks inserted in queues (never run). */
+int __priority_queue_bench_procedure(void *state, size_t slot) {
+    (void) state;
+    (void) slot;
+    return 0;
+}
+
+/**
+ * @brief  Creates the tasks to be inserted in a queue, with pseudo-random (but deterministic)
+ *         arrival and expected times.
+ * @param  ntasks Number of tasks to create.
+ * @return An array of tasks, or `NULL` on allocation failure.
+ */
+tagged_task_t **__priority_queue_bench_new_tasks(size_t ntasks) {
+    tagged_task_t **tasks = malloc(sizeof(tagged_task_t *) * ntasks);
+    if (!tasks)
+        return NULL;
+
+    uint32_t seed = 42;
+    for (size_t i = 0; i < ntasks; ++i) {
+        seed = seed * 1103515245 + 12345; /* Deterministic LCG, as rand() varies between libcs */
+
+        tasks[i] = tagged_task_new_from_procedure(__priority_queue_bench_procedure,
+                                                  NULL,
+                                                  i,
+                                                  (seed >> 8) % 100000);
+        if (!tasks[i]) {
+            for (size_t j = 0; j < i; ++j)
+                tagged_task_free(tasks[j]);
+            free(tasks);
+            return NULL;
+        }
+
+        struct timespec arrived = {.tv_sec = (seed >> 4) % 100000, .tv_nsec = seed % 1000000000};
+        tagged_task_set_time(tasks[i], TAGGED_TASK_TIME_ARRIVED, &arrived);
+    }
+    return tasks;
+}
+
+/**
+ * @brief Benchmarks insertions in a queue followed by the removal of all elements.
+ *
+ * @param policy      Scheduling policy whose comparison function is used.
+ * @param policy_name Name of @p policy, for the report.
+ * @param ntasks      Number of tasks in the queue.
+ */
+void __priority_queue_bench_run(scheduler_policy_t policy, const char *policy_name, size_t ntasks) {
+    tagged_task_t **tasks = __priority_queue_bench_new_tasks(ntasks);
+    if (!tasks) {
+        util_perror("__priority_queue_bench_run(): failed to create tasks");
+        return;
+    }
+
+    bench_t insert_bench, remove_bench;
+    bench_reset(&insert_bench);
+    bench_reset(&remove_bench);
+    while (bench_keep_running(&insert_bench)) {
+        priority_queue_t *queue = priority_queue_new(scheduler_get_compare_function(policy));
+        if (!queue) {
+            util_perror("__priority_queue_bench_run(): failed to create queue");
+            break;
+        }
+
+        bench_start(&insert_bench);
+        for (size_t i = 0; i < ntasks; ++i)
+            (void) priority_queue_insert(queue, tasks[i]);
+        bench_stop(&insert_bench, ntasks);
+
+        /* Freeing is included, as it's part of how the scheduler consumes the queue */
+        bench_start(&remove_bench);
+        for (size_t i = 0; i < ntasks; ++i)
+            tagged_task_free(priority_queue_remove_top(queue));
+        bench_stop(&remove_bench, ntasks);
+
+        priority_queue_free(queue);
+    }
+
+    char parameters[LINE_MAX];
+    snprintf(parameters,
+             LINE_MAX,
+             "{\"policy\": \"%s\", \"size\": %zu}",
+             policy_name,
+             ntasks);
+    bench_report(&insert_bench, "priority_queue_insert", parameters);
+    bench_report(&remove_bench, "priority_queue_remove_top", parameters);
+
+    for (size_t i = 0; i < ntasks; ++i)
+        tagged_task_free(tasks[i]);
+    free(tasks);
+}
+
+void bench_priority_queue(void) {
+    if (!bench_is_selected("priority_queue"))
+        return;
+
+    size_t max_size = bench_is_full() ? 10000000 : 1000000;
+    for (size_t size = 1000; size <= max_size; size *= 10) {
+        __priority_queue_bench_run(SCHEDULER_POLICY_FCFS, "fcfs", size);
+        __priority_queue_bench_run(SCHEDULER_POLICY_SJF, "sjf", size);
+    }
+}
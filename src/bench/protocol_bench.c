@@ -0,0 +1,104 @@
+/*
+ * Copyright 2024 Humberto Gomes, José Lopes, José Matos
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+/**
+ * @file  bench/protocol_bench.c
+ * @brief Benchmarks of message encoding and decoding in protocol.h.
+ */
+
+#include <string.h>
+
+#include "bench/bench.h"
+#include "protocol.h"
+
+/** @brief Number of messages encoded and decoded in each repetition of a benchmark. */
+#define PROTOCOL_BENCH_OPERATIONS 1000000
+
+/** @brief Command line in benchmarked messages. */
+#define PROTOCOL_BENCH_COMMAND_LINE "grep -v pattern input.txt | sort | uniq -c"
+
+/**
+ * @brief Benchmarks encoding and decoding (length check and command line extraction) of
+ *        ::protocol_send_program_task_message_t.
+ */
+void __protocol_bench_send_program_task(void) {
+    protocol_send_program_task_message_t message;
+    char                                 command_line[PROTOCOL_MAXIMUM_COMMAND_LENGTH + 1];
+    size_t                               message_length, command_length;
+    volatile size_t                      checksum = 0; /* Keeps decoding from being optimized out */
+
+    bench_t bench;
+    bench_reset(&bench);
+    while (bench_keep_running(&bench)) {
+        bench_start(&bench);
+        for (size_t i = 0; i < PROTOCOL_BENCH_OPERATIONS; ++i) {
+            (void) protocol_send_program_task_message_new(&message,
+                                                          &message_length,
+                                                          1,
+                                                          PROTOCOL_BENCH_COMMAND_LINE,
+                                                          i);
+            if (protocol_send_program_task_message_check_length(message_length, &command_length)) {
+                memcpy(command_line, message.command_line, command_length);
+                command_line[command_length] = '\0';
+                checksum += command_line[i % command_length];
+            }
+        }
+        bench_stop(&bench, PROTOCOL_BENCH_OPERATIONS);
+    }
+
+    bench_report(&bench, "protocol_send_program_task_message", "{}");
+}
+
+/**
+ * @brief Benchmarks encoding and decoding (length check) of ::protocol_status_response_message_t.
+ */
+void __protocol_bench_status_response(void) {
+    struct timespec        time  = {.tv_sec = 1, .tv_nsec = 500};
+    const struct timespec *times[TAGGED_TASK_TIME_COMPLETED + 1];
+    for (tagged_task_time_t i = TAGGED_TASK_TIME_SENT; i <= TAGGED_TASK_TIME_COMPLETED; ++i)
+        times[i] = &time;
+
+    protocol_status_response_message_t message;
+    size_t                             message_length, command_length;
+    volatile size_t                    checksum = 0; /* Keeps decoding from being optimized out */
+
+    bench_t bench;
+    bench_reset(&bench);
+    while (bench_keep_running(&bench)) {
+        bench_start(&bench);
+        for (size_t i = 0; i < PROTOCOL_BENCH_OPERATIONS; ++i) {
+            (void) protocol_status_response_message_new(&message,
+                                                        &message_length,
+                                                        PROTOCOL_BENCH_COMMAND_LINE,
+                                                        i,
+                                                        0,
+                                                        times);
+            if (protocol_status_response_message_check_length(message_length, &command_length))
+                checksum += command_length + (size_t) message.time_executing;
+        }
+        bench_stop(&bench, PROTOCOL_BENCH_OPERATIONS);
+    }
+
+    bench_report(&bench, "protocol_status_response_message", "{}");
+}
+
+void bench_protocol(void) {
+    if (!bench_is_selected("protocol"))
+        return;
+
+    __protocol_bench_send_program_task();
+    __protocol_bench_status_response();
+}
@@ -20,13 +20,21 @@
  */
 
 #include <errno.h>
+#include <fcntl.h>
 #include <math.h>
+#include <poll.h>
+#include <signal.h>
 #include <stdio.h>
+#include <stdlib.h>
 #include <string.h>
+#include <sys/stat.h>
 #include <unistd.h>
 
 #include "client/client_requests.h"
+#include "live_state.h"
 #include "protocol.h"
+#include "server/scheduler.h"
+#include "trace.h"
 #include "util.h"
 
 /**
@@ -104,19 +112,97 @@ void __client_request_on_status_message(uint8_t *message, size_t length) {
              fields->error ? " (FAILED)" : "");
 }
 
+/**
+ * @brief   Handles an incoming ::PROTOCOL_S2C_POOL_STATUS message.
+ * @details Returns nothing, as all errors are printed to `stderr`.
+ *
+ * @param message Bytes of the received message. Mustn't be `NULL` (unchecked).
+ * @param length  Number of bytes in @p message.
+ */
+void __client_request_on_pool_status_message(uint8_t *message, size_t length) {
+    if (length != sizeof(protocol_pool_status_message_t)) {
+        util_error("%s(): invalid message received!\n", __func__);
+        return;
+    }
+    protocol_pool_status_message_t *fields = (protocol_pool_status_message_t *) message;
+
+    char size_str[32];
+    if (fields->object_size)
+        sprintf(size_str, "%" PRIu64 "B", fields->object_size);
+    else
+        sprintf(size_str, "LARGE");
+
+    util_log("(POOL) %s: %" PRIu64 " %" PRIu64 " %" PRIu64 " %" PRIu64 " %" PRIu64 "\n",
+             size_str,
+             fields->used,
+             fields->free,
+             fields->slabs,
+             fields->allocations,
+             fields->system_allocations);
+}
+
+/**
+ * @brief   Handles an incoming ::PROTOCOL_S2C_STAGE_STATUS message.
+ * @details Returns nothing, as all errors are printed to `stderr`.
+ *
+ * @param message Bytes of the received message. Mustn't be `NULL` (unchecked).
+ * @param length  Number of bytes in @p message.
+ */
+void __client_request_on_stage_status_message(uint8_t *message, size_t length) {
+    size_t nstages;
+    if (!protocol_stage_status_message_check_length(length, &nstages)) {
+        util_error("%s(): invalid message received!\n", __func__);
+        return;
+    }
+    protocol_stage_status_message_t *fields = (protocol_stage_status_message_t *) message;
+
+    /* Copy the stages out of the packed message, for them to be aligned */
+    tagged_task_stage_t stages[TAGGED_TASK_MAXIMUM_STAGES];
+    memcpy(stages, message + PROTOCOL_STAGE_STATUS_HEADER_LENGTH, nstages * sizeof(*stages));
+
+    for (size_t i = 0; i < nstages; ++i) {
+        if (!stages[i].executed) {
+            util_log("(STAGE) %" PRIu32 ".%zu: SKIPPED\n", fields->id, i);
+            continue;
+        }
+
+        char start_str[32], duration_str[32], user_str[32], system_str[32];
+        __client_request_print_time_unit(
+            (stages[i].started.tv_sec - stages[0].started.tv_sec) * 1000000.0 +
+                (stages[i].started.tv_nsec - stages[0].started.tv_nsec) / 1000.0,
+            start_str);
+        __client_request_print_time_unit(
+            (stages[i].ended.tv_sec - stages[i].started.tv_sec) * 1000000.0 +
+                (stages[i].ended.tv_nsec - stages[i].started.tv_nsec) / 1000.0,
+            duration_str);
+        __client_request_print_time_unit((double) stages[i].user_time, user_str);
+        __client_request_print_time_unit((double) stages[i].system_time, system_str);
+
+        util_log("(STAGE) %" PRIu32 ".%zu: +%s %s %" PRId32 " %s %s %" PRIu64 "KiB\n",
+                 fields->id,
+                 i,
+                 start_str,
+                 duration_str,
+                 stages[i].exit_status,
+                 user_str,
+                 system_str,
+                 stages[i].maximum_resident_size);
+    }
+}
+
 /**
  * @brief Listens to new messages coming from the server.
  *
  * @param message Bytes of the received message. Mustn't be `NULL` (unchecked).
  * @param length  Number of bytes in @p message. Must be greater than `0` (unchecked).
- * @param state   Always `NULL`.
+ * @param state   Where to write the PID in a ::PROTOCOL_S2C_FOLLOWING message to (a `pid_t *`), or
+ *                the size in a ::PROTOCOL_S2C_OUTPUT message (a `uint64_t *`). `NULL` when no
+ *                such message is expected.
  *
  * @retval 0 Success.
  * @retval 1 Failure (error message from client).
  */
 int __client_requests_on_message(uint8_t *message, size_t length, void *state) {
-    (void) state;
-
     /* Zero-length messages are disallowed in ipc layer */
     protocol_s2c_msg_type type = message[0];
     switch (type) {
@@ -146,6 +232,48 @@ int __client_requests_on_message(uint8_t *message, size_t length, void *state) {
             __client_request_on_status_message(message, length);
             break;
 
+        case PROTOCOL_S2C_POOL_STATUS:
+            __client_request_on_pool_status_message(message, length);
+            break;
+
+        case PROTOCOL_S2C_STAGE_STATUS:
+            __client_request_on_stage_status_message(message, length);
+            break;
+
+        case PROTOCOL_S2C_FOLLOWING: {
+            if (length != sizeof(protocol_following_message_t) || !state) {
+                util_error("%s(): invalid S2C_FOLLOWING message received!\n", __func__);
+                return 0;
+            }
+
+            protocol_following_message_t *fields = (protocol_following_message_t *) message;
+            *(pid_t *) state                      = fields->runner_pid;
+        } break;
+
+        case PROTOCOL_S2C_OUTPUT: {
+            if (length != sizeof(protocol_output_message_t) || !state) {
+                util_error("%s(): invalid S2C_OUTPUT message received!\n", __func__);
+                return 0;
+            }
+
+            protocol_output_message_t fields; /* Aligned copy of the packed message */
+            memcpy(&fields, message, sizeof(fields));
+            *(uint64_t *) state = fields.size;
+        } break;
+
+        case PROTOCOL_S2C_EXPORTED: {
+            if (length != sizeof(protocol_exported_message_t)) {
+                util_error("%s(): invalid S2C_EXPORTED message received!\n", __func__);
+                return 0;
+            }
+
+            protocol_exported_message_t fields; /* Aligned copy of the packed message */
+            memcpy(&fields, message, sizeof(fields));
+            util_log("Exported %" PRIu64 " tasks (%" PRIu64 " bytes)\n",
+                     (uint64_t) fields.task_count,
+                     (uint64_t) fields.size);
+        } break;
+
         default:
             util_error("%s(): message with bad type received!\n", __func__);
             break;
@@ -221,7 +349,7 @@ int client_requests_send_task(const char *command_line, uint32_t expected_time)
     return __client_requests_send_program_task(command_line, expected_time, 1);
 }
 
-int client_request_ask_status(void) {
+int client_request_ask_status(uint8_t flags, uint32_t first_id, uint32_t last_id) {
     ipc_t *ipc = ipc_new(IPC_ENDPOINT_CLIENT);
     if (!ipc) {
         if (errno == ENOENT)
@@ -232,7 +360,10 @@ int client_request_ask_status(void) {
     }
 
     protocol_status_request_message_t message = {.type       = PROTOCOL_C2S_STATUS,
-                                                 .client_pid = getpid()};
+                                                 .client_pid = getpid(),
+                                                 .flags      = flags,
+                                                 .first_id   = first_id,
+                                                 .last_id    = last_id};
     if (ipc_send_retry(ipc,
                        &message,
                        sizeof(protocol_status_request_message_t),
@@ -241,10 +372,607 @@ int client_request_ask_status(void) {
         ipc_free(ipc);
         return 1;
     }
+    (void) ipc_client_close_sending(ipc); /* Let the server know no more requests are coming */
 
     util_log("(STATUS) ID: \"COMMAND LINE\" C2S WAIT EXECUTE S2S\n");
+    if (flags & PROTOCOL_STATUS_FLAG_STAGES)
+        util_log("(STAGE) ID.INDEX: START DURATION EXIT_STATUS USER SYSTEM MAX_RSS\n");
+    if (flags & PROTOCOL_STATUS_FLAG_POOLS)
+        util_log("(POOL) SIZE: USED FREE SLABS ALLOCATIONS SYSTEM_ALLOCATIONS\n");
     if (ipc_listen(ipc, __client_requests_on_message, __client_requests_before_block, NULL) == 1)
         util_perror("client_requests_ask_status(): error opening connection");
     ipc_free(ipc);
     return 0;
 }
+
+/**
+ * @brief Gets the absolute path of a file, relative to the current working directory.
+ *
+ * @param path Path to the file. Mustn't be `NULL` (unchecked).
+ * @param out  Where to write the absolute path to.
+ *
+ * @retval 0 Success.
+ * @retval 1 Failure (check `errno`, `ENAMETOOLONG` or see `man 3 getcwd`).
+ */
+int __client_requests_get_absolute_path(const char *path, char out[PATH_MAX]) {
+    if (*path == '/') {
+        if (strlen(path) >= PATH_MAX) {
+            errno = ENAMETOOLONG;
+            return 1;
+        }
+        strcpy(out, path);
+        return 0;
+    }
+
+    if (!getcwd(out, PATH_MAX))
+        return 1; /* Keep errno */
+
+    size_t cwd_length = strlen(out);
+    if (cwd_length + 1 + strlen(path) >= PATH_MAX) {
+        errno = ENAMETOOLONG;
+        return 1;
+    }
+    out[cwd_length] = '/';
+    strcpy(out + cwd_length + 1, path);
+    return 0;
+}
+
+int client_requests_export(protocol_export_format_t format,
+                           uint32_t                 first_id,
+                           uint32_t                 last_id,
+                           const char              *path) {
+    /* Created here, as the server only exports to empty files owned by the client's user */
+    int fd = open(path, O_WRONLY | O_CREAT | O_TRUNC, 0644);
+    if (fd < 0) {
+        util_error("Failed to create %s: %s\n", path, strerror(errno));
+        return 1;
+    }
+    (void) close(fd);
+
+    char                              absolute_path[PATH_MAX];
+    protocol_export_request_message_t message;
+    size_t                            message_size;
+    if (__client_requests_get_absolute_path(path, absolute_path) ||
+        protocol_export_request_message_new(&message,
+                                            &message_size,
+                                            format,
+                                            first_id,
+                                            last_id,
+                                            absolute_path)) {
+        util_perror("client_requests_export(): invalid path");
+        return 1;
+    }
+
+    ipc_t *ipc = ipc_new(IPC_ENDPOINT_CLIENT);
+    if (!ipc) {
+        if (errno == ENOENT)
+            util_error("Server's FIFO not found. Is the server running?\n");
+        else
+            util_perror("client_requests_export(): failed to open() server's FIFO");
+        return 1;
+    }
+
+    if (ipc_send_retry(ipc, &message, message_size, CLIENT_REQUESTS_MAX_RETRIES)) {
+        util_perror("client_requests_export(): failed to send message to server");
+        ipc_free(ipc);
+        return 1;
+    }
+    (void) ipc_client_close_sending(ipc);
+
+    int listen_res =
+        ipc_listen(ipc, __client_requests_on_message, __client_requests_before_block, NULL);
+    if (listen_res == 1)
+        util_perror("client_requests_export(): error opening connection");
+    ipc_free(ipc);
+    return listen_res != 0;
+}
+
+/**
+ * @brief Prints a task published by the server in shared memory, like in a status response.
+ *
+ * @param task     Task to be printed. Mustn't be `NULL` (unchecked).
+ * @param first_id Lowest identifier of the tasks to be printed.
+ * @param last_id  Highest identifier of the tasks to be printed.
+ */
+void __client_requests_print_live_task(const live_state_task_t *task,
+                                       uint32_t                 first_id,
+                                       uint32_t                 last_id) {
+    if (task->id < first_id || task->id > last_id)
+        return;
+
+    const struct timespec *times[TAGGED_TASK_TIME_COMPLETED + 1];
+    for (tagged_task_time_t i = 0; i <= TAGGED_TASK_TIME_COMPLETED; ++i)
+        times[i] = task->times[i].tv_sec || task->times[i].tv_nsec ? task->times + i : NULL;
+
+    protocol_status_response_message_t message;
+    size_t                             message_length;
+    if (!protocol_status_response_message_new(&message,
+                                              &message_length,
+                                              task->command_line,
+                                              task->id,
+                                              task->error,
+                                              times))
+        __client_request_on_status_message((uint8_t *) &message, message_length);
+}
+
+int client_requests_read_local_status(uint32_t first_id, uint32_t last_id) {
+    live_state_region_t *state = malloc(sizeof(live_state_region_t));
+    if (!state) {
+        util_perror("client_requests_read_local_status(): allocation failure");
+        return 1;
+    }
+
+    if (live_state_read(state)) {
+        if (errno == ENOENT || errno == ESRCH)
+            util_error("Server's shared state not found. Is the server running?\n");
+        else
+            util_perror("client_requests_read_local_status(): failed to read server's state");
+        free(state);
+        return 1;
+    }
+
+    util_log("(SERVER) POLICY SLOTS RUNNING QUEUED COMPLETED FAILED\n");
+    util_log("(STATUS) ID: \"COMMAND LINE\" C2S WAIT EXECUTE S2S\n");
+    util_log("(SERVER) %s %" PRIu32 " %" PRIu32 " %" PRIu32 " %" PRIu64 " %" PRIu64 "\n",
+             state->policy == SCHEDULER_POLICY_SJF ? "sjf" : "fcfs",
+             state->slots,
+             state->running,
+             state->queued,
+             state->completed,
+             state->failed);
+
+    /* Oldest completions first, as in the log */
+    uint64_t ncompletions = state->completed < LIVE_STATE_COMPLETIONS ? state->completed
+                                                                      : LIVE_STATE_COMPLETIONS;
+    for (uint64_t i = state->completed - ncompletions; i < state->completed; ++i)
+        __client_requests_print_live_task(state->completions + i % LIVE_STATE_COMPLETIONS,
+                                          first_id,
+                                          last_id);
+
+    uint32_t nrunning = state->running < LIVE_STATE_MAXIMUM_SLOTS ? state->running
+                                                                  : LIVE_STATE_MAXIMUM_SLOTS;
+    for (uint32_t i = 0; i < nrunning; ++i)
+        __client_requests_print_live_task(state->running_tasks + i, first_id, last_id);
+
+    free(state);
+    return 0;
+}
+
+/** @brief Time in milliseconds between checks for the termination of a followed task's runner. */
+#define CLIENT_REQUESTS_FOLLOW_CHECK_INTERVAL 1000
+
+/** @brief Maximum number of bytes moved from a followed task's named pipe at once. */
+#define CLIENT_REQUESTS_FOLLOW_CHUNK_SIZE (16 * PIPE_BUF)
+
+/**
+ * @brief   Copies the output of a followed task to `stdout` and `stderr` until it ends.
+ * @details Errors are printed to `stderr`.
+ *
+ * @param fifos      Named pipes the task's runner writes to, open for reading. Mustn't be `NULL`
+ *                   (unchecked).
+ * @param runner_pid PID of the task's runner.
+ *
+ * @retval 0 Success.
+ * @retval 1 The task terminated before its runner opened @p fifos.
+ */
+int __client_requests_stream(const int fifos[2], pid_t runner_pid) {
+    struct pollfd pfds[2]    = {{.fd = fifos[0], .events = POLLIN},
+                                {.fd = fifos[1], .events = POLLIN}};
+    const int     outputs[2] = {STDOUT_FILENO, STDERR_FILENO};
+    int           connected  = 0;
+
+    while (pfds[0].fd >= 0 || pfds[1].fd >= 0) {
+        int ready = poll(pfds, 2, CLIENT_REQUESTS_FOLLOW_CHECK_INTERVAL);
+        if (ready < 0 && errno == EINTR) {
+            continue;
+        } else if (ready < 0) {
+            util_perror("__client_requests_stream(): poll() failed");
+            return 1;
+        } else if (ready == 0) {
+            /* The runner may have terminated before handling our request */
+            if (!connected && kill(runner_pid, 0) && errno == ESRCH) {
+                util_error("Task terminated before its output could be followed!\n");
+                return 1;
+            }
+            continue;
+        }
+
+        for (size_t i = 0; i < 2; ++i) {
+            if (!pfds[i].revents)
+                continue;
+            connected = 1;
+
+            ssize_t moved = 0;
+            if (pfds[i].revents & POLLIN)
+                moved = ipc_splice(pfds[i].fd, outputs[i], CLIENT_REQUESTS_FOLLOW_CHUNK_SIZE);
+            if (moved < 0 && errno == EAGAIN)
+                continue;
+            if (moved <= 0) /* The runner closed this output */
+                pfds[i].fd = -1;
+        }
+    }
+    return 0;
+}
+
+int client_requests_follow(uint32_t id) {
+    int  fifos[2] = {-1, -1};
+    char paths[2][PATH_MAX];
+    int  ret = 1;
+    for (size_t i = 0; i < 2; ++i) {
+        (void) ipc_get_follow_fifo_path(getpid(), i ? STDERR_FILENO : STDOUT_FILENO, paths[i]);
+        (void) unlink(paths[i]); /* In case any previous client didn't terminate correctly */
+
+        /* Opened before contacting the server, so that the runner can open it without blocking */
+        if (mkfifo(paths[i], 0622) || (fifos[i] = open(paths[i], O_RDONLY | O_NONBLOCK)) < 0) {
+            util_perror("client_requests_follow(): failed to create named pipe");
+            break;
+        }
+    }
+
+    ipc_t *ipc = NULL;
+    if (fifos[0] >= 0 && fifos[1] >= 0) {
+        ipc = ipc_new(IPC_ENDPOINT_CLIENT);
+        if (!ipc) {
+            if (errno == ENOENT)
+                util_error("Server's FIFO not found. Is the server running?\n");
+            else
+                util_perror("client_requests_follow(): failed to open() server's FIFO");
+        }
+    }
+
+    if (ipc) {
+        protocol_follow_request_message_t message = {.type       = PROTOCOL_C2S_FOLLOW,
+                                                     .client_pid = getpid(),
+                                                     .id         = id};
+        pid_t runner_pid = -1;
+        if (ipc_send_retry(ipc, &message, sizeof(message), CLIENT_REQUESTS_MAX_RETRIES)) {
+            util_perror("client_requests_follow(): failed to send message to server");
+        } else {
+            int listen_res = ipc_listen(ipc,
+                                        __client_requests_on_message,
+                                        __client_requests_before_block,
+                                        &runner_pid);
+            if (listen_res == 1)
+                util_perror("client_requests_follow(): error opening connection");
+            else if (runner_pid >= 0)
+                ret = __client_requests_stream(fifos, runner_pid);
+        }
+        ipc_free(ipc);
+    }
+
+    for (size_t i = 0; i < 2; ++i) {
+        if (fifos[i] >= 0)
+            (void) close(fifos[i]);
+        (void) unlink(paths[i]);
+    }
+    return ret;
+}
+
+int client_requests_output(uint32_t id, int stream, uint64_t first_byte, uint64_t last_byte) {
+    char path[PATH_MAX];
+    if (ipc_get_follow_fifo_path(getpid(), stream, path)) {
+        util_perror("client_requests_output(): invalid stream");
+        return 1;
+    }
+    (void) unlink(path); /* In case any previous client didn't terminate correctly */
+
+    /* Opened before contacting the server, so that it can open the pipe without blocking */
+    int fifo = -1;
+    if (mkfifo(path, 0622) || (fifo = open(path, O_RDONLY | O_NONBLOCK)) < 0) {
+        util_perror("client_requests_output(): failed to create named pipe");
+        (void) unlink(path);
+        return 1;
+    }
+
+    int    ret = 1;
+    ipc_t *ipc = ipc_new(IPC_ENDPOINT_CLIENT);
+    if (!ipc) {
+        if (errno == ENOENT)
+            util_error("Server's FIFO not found. Is the server running?\n");
+        else
+            util_perror("client_requests_output(): failed to open() server's FIFO");
+    } else {
+        protocol_output_request_message_t message = {.type       = PROTOCOL_C2S_OUTPUT,
+                                                     .client_pid = getpid(),
+                                                     .id         = id,
+                                                     .stream     = stream,
+                                                     .first_byte = first_byte,
+                                                     .last_byte  = last_byte};
+        uint64_t size = UINT64_MAX;
+        if (ipc_send_retry(ipc, &message, sizeof(message), CLIENT_REQUESTS_MAX_RETRIES)) {
+            util_perror("client_requests_output(): failed to send message to server");
+        } else {
+            (void) ipc_client_close_sending(ipc);
+            int listen_res = ipc_listen(ipc,
+                                        __client_requests_on_message,
+                                        __client_requests_before_block,
+                                        &size);
+            if (listen_res == 1)
+                util_perror("client_requests_output(): error opening connection");
+        }
+        ipc_free(ipc);
+
+        /* The server opened the pipe before replying, so reads only end when it's done */
+        if (size != UINT64_MAX) {
+            (void) fcntl(fifo, F_SETFL, fcntl(fifo, F_GETFL) & ~O_NONBLOCK);
+
+            uint64_t received = 0;
+            ssize_t  moved;
+            while ((moved = ipc_splice(fifo, STDOUT_FILENO, CLIENT_REQUESTS_FOLLOW_CHUNK_SIZE)) > 0)
+                received += moved;
+
+            if (moved < 0)
+                util_perror("client_requests_output(): failed to copy output");
+            else if (received != size)
+                util_error("Output truncated: %" PRIu64 " of %" PRIu64 " bytes received\n",
+                           received,
+                           size);
+            else
+                ret = 0;
+        }
+    }
+
+    (void) close(fifo);
+    (void) unlink(path);
+    return ret;
+}
+
+/**
+ * @struct client_requests_stats_t
+ * @brief  State of the output of a ::client_requests_ask_stats call.
+ *
+ * @var client_requests_stats_t::json
+ *     @brief Whether to output JSON instead of text.
+ * @var client_requests_stats_t::uptime
+ *     @brief protocol_stats_server_message_t::uptime, to compute throughputs.
+ * @var client_requests_stats_t::aggregate_count
+ *     @brief Number of ::protocol_stats_message_t received.
+ */
+typedef struct {
+    int      json;
+    uint64_t uptime;
+    size_t   aggregate_count;
+} client_requests_stats_t;
+
+/** @brief Names of each ::statistics_time_t. */
+const char *const client_requests_stats_time_names[STATISTICS_TIME_COUNT] = {"C2S",
+                                                                             "WAIT",
+                                                                             "EXECUTE",
+                                                                             "S2S"};
+
+/**
+ * @brief Handles an incoming ::PROTOCOL_S2C_STATS_SERVER message.
+ * @param message Bytes of the received message. Mustn't be `NULL` (unchecked).
+ * @param length  Number of bytes in @p message.
+ * @param stats   Output state. Mustn't be `NULL` (unchecked).
+ */
+void __client_requests_on_stats_server_message(uint8_t                 *message,
+                                               size_t                   length,
+                                               client_requests_stats_t *stats) {
+    if (length != sizeof(protocol_stats_server_message_t)) {
+        util_error("%s(): invalid message received!\n", __func__);
+        return;
+    }
+    protocol_stats_server_message_t *fields = (protocol_stats_server_message_t *) message;
+
+    const char *policy      = fields->policy == SCHEDULER_POLICY_SJF ? "sjf" : "fcfs";
+    double      utilization = fields->slots ? (double) fields->running / fields->slots : 0.0;
+    stats->uptime           = fields->uptime;
+
+    if (stats->json) {
+        util_log("{\"policy\": \"%s\", \"slots\": %" PRIu64 ", \"running\": %" PRIu64
+                 ", \"queued\": %" PRIu64 ", \"utilization\": %.4f, \"uptime_ns\": %" PRIu64
+                 ", \"aggregates\": [",
+                 policy,
+                 (uint64_t) fields->slots,
+                 (uint64_t) fields->running,
+                 (uint64_t) fields->queued,
+                 utilization,
+                 (uint64_t) fields->uptime);
+    } else {
+        char uptime_str[32];
+        __client_request_print_time_unit(fields->uptime / 1000.0, uptime_str);
+        util_log("(SERVER) %s %" PRIu64 " %" PRIu64 " %" PRIu64 " %.1f%% %s\n",
+                 policy,
+                 (uint64_t) fields->slots,
+                 (uint64_t) fields->running,
+                 (uint64_t) fields->queued,
+                 utilization * 100.0,
+                 uptime_str);
+    }
+}
+
+/**
+ * @brief Handles an incoming ::PROTOCOL_S2C_STATS message.
+ * @param message Bytes of the received message. Mustn't be `NULL` (unchecked).
+ * @param length  Number of bytes in @p message.
+ * @param stats   Output state. Mustn't be `NULL` (unchecked).
+ */
+void __client_requests_on_stats_message(uint8_t                 *message,
+                                        size_t                   length,
+                                        client_requests_stats_t *stats) {
+    if (length != sizeof(protocol_stats_message_t)) {
+        util_error("%s(): invalid message received!\n", __func__);
+        return;
+    }
+
+    /* Copy the message, for its fields to be aligned */
+    protocol_stats_message_t fields;
+    memcpy(&fields, message, sizeof(fields));
+    protocol_stats_time_t times[STATISTICS_TIME_COUNT];
+    memcpy(times, message + offsetof(protocol_stats_message_t, times), sizeof(times));
+
+    double throughput = stats->uptime ? fields.task_count * 1e9 / stats->uptime : 0.0;
+    int    is_overall = fields.min_expected_time == 0 && fields.max_expected_time == UINT32_MAX;
+
+    char range_str[32];
+    if (is_overall)
+        sprintf(range_str, "all");
+    else if (fields.max_expected_time == UINT32_MAX)
+        sprintf(range_str, "%" PRIu32 "ms+", (uint32_t) fields.min_expected_time);
+    else
+        sprintf(range_str,
+                "%" PRIu32 "-%" PRIu32 "ms",
+                (uint32_t) fields.min_expected_time,
+                (uint32_t) fields.max_expected_time);
+
+    if (stats->json) {
+        util_log("%s{\"expected_time\": \"%s\", \"tasks\": %" PRIu64 ", \"errors\": %" PRIu64
+                 ", \"throughput\": %.4f, \"times\": {",
+                 stats->aggregate_count ? ", " : "",
+                 range_str,
+                 (uint64_t) fields.task_count,
+                 (uint64_t) fields.error_count,
+                 throughput);
+        for (statistics_time_t i = 0; i < STATISTICS_TIME_COUNT; ++i)
+            util_log("%s\"%s\": {\"count\": %" PRIu64 ", \"mean_ns\": %" PRIu64
+                     ", \"min_ns\": %" PRIu64 ", \"p50_ns\": %" PRIu64 ", \"p90_ns\": %" PRIu64
+                     ", \"p99_ns\": %" PRIu64 ", \"max_ns\": %" PRIu64 "}",
+                     i ? ", " : "",
+                     client_requests_stats_time_names[i],
+                     times[i].count,
+                     times[i].mean,
+                     times[i].min,
+                     times[i].p50,
+                     times[i].p90,
+                     times[i].p99,
+                     times[i].max);
+        util_log("}}");
+    } else if (is_overall || fields.task_count) {
+        util_log("(TASKS) %s: %" PRIu64 " %" PRIu64 " %.3f/s\n",
+                 range_str,
+                 (uint64_t) fields.task_count,
+                 (uint64_t) fields.error_count,
+                 throughput);
+
+        for (statistics_time_t i = 0; fields.task_count && i < STATISTICS_TIME_COUNT; ++i) {
+            const uint64_t values[6] = {times[i].mean,
+                                        times[i].min,
+                                        times[i].p50,
+                                        times[i].p90,
+                                        times[i].p99,
+                                        times[i].max};
+            char           value_strs[6][32];
+            for (size_t j = 0; j < 6; ++j)
+                __client_request_print_time_unit(values[j] / 1000.0, value_strs[j]);
+
+            util_log("(TIME) %s.%s: %s %s %s %s %s %s\n",
+                     range_str,
+                     client_requests_stats_time_names[i],
+                     value_strs[0],
+                     value_strs[1],
+                     value_strs[2],
+                     value_strs[3],
+                     value_strs[4],
+                     value_strs[5]);
+        }
+    }
+    stats->aggregate_count++;
+}
+
+/**
+ * @brief   Listens to new messages coming from the server, after asking for its statistics.
+ * @details Messages other than statistics are handled by ::__client_requests_on_message.
+ *
+ * @param message    Bytes of the received message. Mustn't be `NULL` (unchecked).
+ * @param length     Number of bytes in @p message. Must be greater than `0` (unchecked).
+ * @param stats_data A ::client_requests_stats_t. Mustn't be `NULL` (unchecked).
+ *
+ * @retval 0 Success.
+ * @retval 1 Failure (error message from client).
+ */
+int __client_requests_on_stats_response(uint8_t *message, size_t length, void *stats_data) {
+    switch ((protocol_s2c_msg_type) message[0]) {
+        case PROTOCOL_S2C_STATS_SERVER:
+            __client_requests_on_stats_server_message(message, length, stats_data);
+            return 0;
+        case PROTOCOL_S2C_STATS:
+            __client_requests_on_stats_message(message, length, stats_data);
+            return 0;
+        default:
+            return __client_requests_on_message(message, length, NULL);
+    }
+}
+
+int client_requests_ask_stats(int json) {
+    ipc_t *ipc = ipc_new(IPC_ENDPOINT_CLIENT);
+    if (!ipc) {
+        if (errno == ENOENT)
+            util_error("Server's FIFO not found. Is the server running?\n");
+        else
+            util_perror("client_requests_ask_stats(): failed to open() server's FIFO");
+        return 1;
+    }
+
+    protocol_stats_request_message_t message = {.type = PROTOCOL_C2S_STATS, .client_pid = getpid()};
+    if (ipc_send_retry(ipc,
+                       &message,
+                       sizeof(protocol_stats_request_message_t),
+                       CLIENT_REQUESTS_MAX_RETRIES)) {
+        util_perror("client_requests_ask_stats(): failed to send message to server");
+        ipc_free(ipc);
+        return 1;
+    }
+
+    if (!json) {
+        util_log("(SERVER) POLICY SLOTS RUNNING QUEUED UTILIZATION UPTIME\n");
+        util_log("(TASKS) EXPECTED_TIME: COUNT ERRORS THROUGHPUT\n");
+        util_log("(TIME) EXPECTED_TIME.TIME: MEAN MIN P50 P90 P99 MAX\n");
+    }
+
+    client_requests_stats_t stats      = {.json = json, .uptime = 0, .aggregate_count = 0};
+    int                     listen_res = ipc_listen(ipc,
+                                        __client_requests_on_stats_response,
+                                        __client_requests_before_block,
+                                        &stats);
+    if (listen_res == 1)
+        util_perror("client_requests_ask_stats(): error opening connection");
+    ipc_free(ipc);
+
+    if (json && stats.uptime)
+        util_log("]}\n");
+    return listen_res != 0;
+}
+
+/**
+ * @brief Prints an error when the server's trace ring can't be accessed.
+ * @param function Name of the function that failed.
+ */
+void __client_requests_trace_error(const char *function) {
+    if (errno == ENOENT || errno == ESRCH)
+        util_error("Server's trace ring not found. Is the server running?\n");
+    else if (errno == EPROTO)
+        util_error("The server's trace ring has an unknown layout!\n");
+    else
+        util_perror(function);
+}
+
+int client_requests_set_tracing(int enabled) {
+    if (trace_set_enabled(enabled)) {
+        __client_requests_trace_error("client_requests_set_tracing(): failed to access trace ring");
+        return 1;
+    }
+    return 0;
+}
+
+int client_requests_dump_trace(const char *path) {
+    FILE *out = path ? fopen(path, "w") : stdout;
+    if (!out) {
+        util_perror("client_requests_dump_trace(): failed to open output file");
+        return 1;
+    }
+
+    size_t event_count;
+    int    ret = trace_dump(out, &event_count);
+    if (ret)
+        __client_requests_trace_error("client_requests_dump_trace(): failed to write trace");
+
+    if (path && fclose(out) && !ret) {
+        util_perror("client_requests_dump_trace(): failed to write trace");
+        ret = 1;
+    }
+
+    if (!ret && path)
+        util_log("Wrote %zu events to %s\n", event_count, path);
+    return ret;
+}
@@ -19,10 +19,15 @@
  * @brief Contains the entry point to the client program.
  */
 
+#include <ctype.h>
+#include <errno.h>
+#include <limits.h>
 #include <stdlib.h>
 #include <string.h>
+#include <unistd.h>
 
 #include "client/client_requests.h"
+#include "protocol.h"
 #include "util.h"
 
 /**
@@ -33,20 +38,154 @@
 int __main_help_message(const char *program_name) {
     util_error("Usage:\n");
     util_error("  See this message:    %s help\n", program_name);
-    util_error("  Query server status: %s status\n", program_name);
+    util_error("  Query server status: %s status [--pools] [--stages] [(id) | (id)-(id)]\n",
+               program_name);
+    util_error("  Read live state:     %s status --local [(id) | (id)-(id)]\n", program_name);
+    util_error("  Export to file:      %s status --export (path) [--csv] [(id) | (id)-(id)]\n",
+               program_name);
     util_error("  Run single program:  %s execute (time) -u (command line)\n", program_name);
     util_error("  Run pipeline:        %s execute (time) -p (command line)\n", program_name);
+    util_error("  Follow task output:  %s follow (task id)\n", program_name);
+    util_error("  Read task output:    %s output (task id) [--stderr] [(byte) | (byte)-(byte)]\n",
+               program_name);
+    util_error("  Task statistics:     %s stats [--json]\n", program_name);
+    util_error("  Toggle tracing:      %s trace (on | off)\n", program_name);
+    util_error("  Export trace:        %s trace dump [(path)]\n", program_name);
     return 1;
 }
 
+/**
+ * @brief Parses a number (`n`) or an inclusive range of numbers (`from-to`).
+ *
+ * @param str     String to be parsed. Mustn't be `NULL` (unchecked).
+ * @param maximum Highest value allowed in the range.
+ * @param first   Where to output the lowest number. Mustn't be `NULL` (unchecked).
+ * @param last    Where to output the highest number. Mustn't be `NULL` (unchecked).
+ *
+ * @retval 0 Success.
+ * @retval 1 Invalid number or range.
+ */
+int __main_parse_range(const char *str, uint64_t maximum, uint64_t *first, uint64_t *last) {
+    errno = 0; /* strtoull() only sets it on overflow */
+    char              *integer_end;
+    unsigned long long first_value = strtoull(str, &integer_end, 10);
+    if (!isdigit(*str) || first_value > maximum || (first_value == ULLONG_MAX && errno == ERANGE))
+        return 1;
+
+    unsigned long long last_value = first_value;
+    if (*integer_end == '-') {
+        const char *last_str = integer_end + 1;
+        errno                = 0;
+        last_value           = strtoull(last_str, &integer_end, 10);
+        if (!isdigit(*last_str) || last_value > maximum || last_value < first_value ||
+            (last_value == ULLONG_MAX && errno == ERANGE))
+            return 1;
+    }
+
+    if (*integer_end)
+        return 1;
+
+    *first = first_value;
+    *last  = last_value;
+    return 0;
+}
+
+/**
+ * @brief Parses a task identifier (`id`) or an inclusive range of identifiers (`from-to`).
+ *
+ * @param str      String to be parsed. Mustn't be `NULL` (unchecked).
+ * @param first_id Where to output the lowest identifier. Mustn't be `NULL` (unchecked).
+ * @param last_id  Where to output the highest identifier. Mustn't be `NULL` (unchecked).
+ *
+ * @retval 0 Success.
+ * @retval 1 Invalid identifier or range.
+ */
+int __main_parse_id_range(const char *str, uint32_t *first_id, uint32_t *last_id) {
+    uint64_t first, last;
+    if (__main_parse_range(str, UINT32_MAX, &first, &last))
+        return 1;
+
+    *first_id = first;
+    *last_id  = last;
+    return 0;
+}
+
 /**
  * @brief  The entry point to the client program.
  * @retval 0 Success.
  * @retval 1 Insuccess.
  */
 int main(int argc, char **argv) {
-    if (argc == 2 && strcmp(argv[1], "status") == 0) {
-        return client_request_ask_status();
+    if (argc >= 2 && strcmp(argv[1], "status") == 0) {
+        uint8_t                  flags       = 0;
+        uint32_t                 first_id    = 0, last_id = UINT32_MAX;
+        int                      has_ids     = 0, local = 0;
+        const char              *export_path = NULL;
+        protocol_export_format_t format      = PROTOCOL_EXPORT_FORMAT_LOG;
+        for (int i = 2; i < argc; ++i) {
+            if (strcmp(argv[i], "--local") == 0)
+                local = 1;
+            else if (strcmp(argv[i], "--export") == 0 && i + 1 < argc && !export_path)
+                export_path = argv[++i];
+            else if (strcmp(argv[i], "--csv") == 0)
+                format = PROTOCOL_EXPORT_FORMAT_CSV;
+            else if (strcmp(argv[i], "--pools") == 0)
+                flags |= PROTOCOL_STATUS_FLAG_POOLS;
+            else if (strcmp(argv[i], "--stages") == 0)
+                flags |= PROTOCOL_STATUS_FLAG_STAGES;
+            else if (!has_ids && !__main_parse_id_range(argv[i], &first_id, &last_id))
+                has_ids = 1;
+            else
+                return __main_help_message(argv[0]);
+        }
+
+        if ((local && (flags || export_path)) || (export_path && flags) ||
+            (format == PROTOCOL_EXPORT_FORMAT_CSV && !export_path))
+            return __main_help_message(argv[0]);
+        else if (local)
+            return client_requests_read_local_status(first_id, last_id);
+        else if (export_path)
+            return client_requests_export(format, first_id, last_id, export_path);
+        return client_request_ask_status(flags, first_id, last_id);
+    } else if (argc == 3 && strcmp(argv[1], "follow") == 0) {
+        char         *integer_end;
+        unsigned long id = strtoul(argv[2], &integer_end, 10);
+        if (!*(argv[2]) || *integer_end || id > UINT32_MAX)
+            return __main_help_message(argv[0]);
+        return client_requests_follow(id);
+    } else if (argc >= 3 && argc <= 5 && strcmp(argv[1], "output") == 0) {
+        uint32_t id, last_id;
+        uint64_t first_byte = 0, last_byte = UINT64_MAX;
+        int      stream = STDOUT_FILENO, has_range = 0;
+        if (__main_parse_id_range(argv[2], &id, &last_id) || id != last_id)
+            return __main_help_message(argv[0]);
+
+        for (int i = 3; i < argc; ++i) {
+            if (strcmp(argv[i], "--stderr") == 0 && stream == STDOUT_FILENO)
+                stream = STDERR_FILENO;
+            else if (!has_range &&
+                     !__main_parse_range(argv[i], UINT64_MAX, &first_byte, &last_byte))
+                has_range = 1;
+            else
+                return __main_help_message(argv[0]);
+
+            if (has_range == 1 && !strchr(argv[i], '-')) { /* A single offset reads until the end */
+                last_byte = UINT64_MAX;
+                has_range = 2;
+            }
+        }
+        return client_requests_output(id, stream, first_byte, last_byte);
+    } else if (argc >= 2 && argc <= 3 && strcmp(argv[1], "stats") == 0) {
+        if (argc == 3 && strcmp(argv[2], "--json") != 0)
+            return __main_help_message(argv[0]);
+        return client_requests_ask_stats(argc == 3);
+    } else if (argc >= 3 && argc <= 4 && strcmp(argv[1], "trace") == 0) {
+        if (strcmp(argv[2], "dump") == 0)
+            return client_requests_dump_trace(argc == 4 ? argv[3] : NULL);
+        else if (argc == 3 && (strcmp(argv[2], "on") == 0 || strcmp(argv[2], "off") == 0))
+            return client_requests_set_tracing(strcmp(argv[2], "on") == 0);
+        else
+            return __main_help_message(argv[0]);
     } else if (argc == 2 && strcmp(argv[1], "help") == 0) {
         (void) __main_help_message(argv[0]);
         return 0;
@@ -19,6 +19,9 @@
  * @brief Implementation of methods in ipc.h
  */
 
+/* Needed for splice() */
+#define _GNU_SOURCE
+
 #include <errno.h>
 #include <fcntl.h>
 #include <signal.h>
@@ -26,9 +29,12 @@
 #include <stdlib.h>
 #include <string.h>
 #include <sys/stat.h>
+#include <time.h>
 #include <unistd.h>
 
 #include "ipc.h"
+#include "metrics.h"
+#include "trace.h"
 #include "util.h"
 
 /* Ignore __attribute__((packed)) if it's unavailable. */
@@ -52,6 +58,19 @@
  */
 #define IPC_CLIENT_FIFO_PATH "/tmp/client%ld.fifo"
 
+/**
+ * @brief   File path of a FIFO that a client following a task reads from.
+ * @details Format string, where `%ld` is replaced by the client's PID (casted to a `long`), and
+ *          `%d` by the file descriptor number of the stream being followed.
+ */
+#define IPC_FOLLOW_FIFO_PATH "/tmp/client%ld.%d.fifo"
+
+/**
+ * @brief Maximum time, in milliseconds, a connection created by ::ipc_server_connect waits for its
+ *        client to reopen its named pipe, when it's closed while sending a message.
+ */
+#define IPC_CONNECTION_REOPEN_TIMEOUT 100
+
 /**
  * @struct ipc
  * @brief  An inter-process connection using named pipes.
@@ -68,11 +87,14 @@
  * @var ipc::send_fd_pid
  *     @brief   PID of the process the server is communicating with (only for ::IPC_ENDPOINT_SERVER)
  *     @details Will be `-1` for new connection.
+ * @var ipc::is_connection
+ *     @brief Whether this was created by ::ipc_server_connect, and doesn't own a named pipe.
  */
 struct ipc {
     ipc_endpoint_t this_endpoint;
     int            send_fd, receive_fd;
     pid_t          send_fd_pid;
+    int            is_connection;
 };
 
 /**
@@ -111,6 +133,68 @@ int __ipc_get_owned_fifo_path(ipc_endpoint_t this_endpoint, char path[PATH_MAX])
     return 0;
 }
 
+/**
+ * @brief   Opens the named pipe of a client for writing, without blocking.
+ * @details The returned file descriptor is in blocking mode.
+ *
+ * @param client_pid PID of the client.
+ *
+ * @return A file descriptor on success, `-1` on failure (check `errno`).
+ *
+ * | `errno`  | Cause                                                 |
+ * | -------- | ----------------------------------------------------- |
+ * | `EAGAIN` | The client is running but isn't reading its pipe yet. |
+ * | `EPIPE`  | The client is gone.                                   |
+ * | other    | See `man 2 open` and `man 2 fcntl`.                   |
+ */
+int __ipc_open_client_fifo(pid_t client_pid) {
+    char client_fifo_path[PATH_MAX];
+    snprintf(client_fifo_path, PATH_MAX, IPC_CLIENT_FIFO_PATH, (long) client_pid);
+
+    int fd = open(client_fifo_path, O_WRONLY | O_NONBLOCK);
+    if (fd < 0) {
+        if (errno == ENXIO) /* No reader */
+            errno = kill(client_pid, 0) && errno == ESRCH ? EPIPE : EAGAIN;
+        return -1;
+    }
+
+    int flags = fcntl(fd, F_GETFL);
+    if (flags < 0 || fcntl(fd, F_SETFL, flags & ~O_NONBLOCK) < 0) {
+        int errno2 = errno;
+        (void) close(fd);
+        errno = errno2;
+        return -1;
+    }
+    return fd;
+}
+
+/**
+ * @brief Opens the named pipe of a client for writing, waiting for a limited time for the client
+ *        to start reading it.
+ *
+ * @param client_pid PID of the client.
+ * @param timeout    Maximum time to wait for, in milliseconds.
+ *
+ * @return A file descriptor on success, `-1` on failure (check `errno`).
+ *
+ * | `errno`     | Cause                            |
+ * | ----------- | -------------------------------- |
+ * | `ETIMEDOUT` | The client didn't read its pipe. |
+ * | other       | See ::__ipc_open_client_fifo.    |
+ */
+int __ipc_wait_client_fifo(pid_t client_pid, unsigned int timeout) {
+    const struct timespec interval = {.tv_sec = 0, .tv_nsec = 1000000};
+    for (unsigned int i = 0; i <= timeout; ++i) {
+        int fd = __ipc_open_client_fifo(client_pid);
+        if (fd >= 0 || errno != EAGAIN)
+            return fd; /* Keep errno */
+        (void) nanosleep(&interval, NULL);
+    }
+
+    errno = ETIMEDOUT;
+    return -1;
+}
+
 ipc_t *ipc_new(ipc_endpoint_t this_endpoint) {
     char fifo_path[PATH_MAX];
     if (__ipc_get_owned_fifo_path(this_endpoint, fifo_path))
@@ -152,7 +236,8 @@ ipc_t *ipc_new(ipc_endpoint_t this_endpoint) {
         /* Don't open the FIFO now, as that would block before before starting to listen. */
         ret->receive_fd = ret->send_fd = -1;
     }
-    ret->send_fd_pid = -1;
+    ret->send_fd_pid   = -1;
+    ret->is_connection = 0;
 
     return ret;
 }
@@ -163,6 +248,10 @@ void ipc_free(ipc_t *ipc) {
 
     if (ipc->send_fd > 0)
         (void) close(ipc->send_fd);
+    if (ipc->is_connection) {
+        free(ipc);
+        return;
+    }
 
     char fifo_path[PATH_MAX];
     __ipc_get_owned_fifo_path(ipc->this_endpoint, fifo_path);
@@ -211,10 +300,12 @@ int ipc_send_retry(ipc_t *ipc, const void *message, size_t length, unsigned int
     unsigned int recovered = 0;
     for (unsigned int i = 0; i < max_tries; ++i) {
         if (write(ipc->send_fd, &frame, PIPE_BUF) == PIPE_BUF) {
-            if (recovered)
+            if (recovered) {
+                metrics_add(METRICS_COUNTER_IPC_RECOVERED, 1);
                 util_error("%s(): IPC synchronization error recovered from (%u attempts)\n",
                            __func__,
                            recovered);
+            }
             return 0;
         }
 
@@ -225,9 +316,16 @@ int ipc_send_retry(ipc_t *ipc, const void *message, size_t length, unsigned int
             else
                 strcpy(fifo_path, IPC_SERVER_FIFO_PATH);
 
-            if (((ipc->send_fd = open(fifo_path, O_WRONLY))) < 0)
+            if (ipc->is_connection) {
+                /* Don't block on clients that are gone */
+                if ((ipc->send_fd = __ipc_wait_client_fifo(ipc->send_fd_pid,
+                                                           IPC_CONNECTION_REOPEN_TIMEOUT)) < 0)
+                    return 1; /* Keep errno */
+            } else if (((ipc->send_fd = open(fifo_path, O_WRONLY))) < 0) {
                 return 1; /* Keep errno. Also this shouldn't fail */
+            }
 
+            metrics_add(METRICS_COUNTER_IPC_RETRIES, 1);
             recovered++;
         } else {
             return 1; /* Keep errno */
@@ -252,6 +350,39 @@ int ipc_server_open_sending(ipc_t *ipc, pid_t client_pid) {
     return 0;
 }
 
+int ipc_server_get_client_uid(const ipc_t *ipc, uid_t *uid) {
+    if (!ipc || !uid || ipc->this_endpoint != IPC_ENDPOINT_SERVER || ipc->send_fd < 0) {
+        errno = EINVAL;
+        return 1;
+    }
+
+    struct stat statbuf;
+    if (fstat(ipc->send_fd, &statbuf))
+        return 1; /* Keep errno */
+
+    *uid = statbuf.st_uid;
+    return 0;
+}
+
+ipc_t *ipc_server_connect(pid_t client_pid) {
+    ipc_t *ret = malloc(sizeof(ipc_t));
+    if (!ret)
+        return NULL; /* errno = ENOMEM guaranteed */
+
+    if ((ret->send_fd = __ipc_open_client_fifo(client_pid)) < 0) {
+        int errno2 = errno;
+        free(ret);
+        errno = errno2;
+        return NULL;
+    }
+
+    ret->this_endpoint = IPC_ENDPOINT_SERVER;
+    ret->receive_fd    = -1;
+    ret->send_fd_pid   = client_pid;
+    ret->is_connection = 1;
+    return ret;
+}
+
 int ipc_server_close_sending(ipc_t *ipc) {
     if (!ipc || ipc->this_endpoint != IPC_ENDPOINT_SERVER || ipc->send_fd < 0) {
         errno = EINVAL;
@@ -264,6 +395,17 @@ int ipc_server_close_sending(ipc_t *ipc) {
     return 0; /* Don't care about closing success */
 }
 
+int ipc_client_close_sending(ipc_t *ipc) {
+    if (!ipc || ipc->this_endpoint != IPC_ENDPOINT_CLIENT || ipc->send_fd < 0) {
+        errno = EINVAL;
+        return 1;
+    }
+
+    (void) close(ipc->send_fd);
+    ipc->send_fd = -1;
+    return 0; /* Don't care about closing success */
+}
+
 /**
  * @brief   Size of buffer when reading from an IPC.
  * @details Must be at least as large as `PIPE_BUF`.
@@ -309,16 +451,19 @@ int ipc_listen(ipc_t                         *ipc,
             size_t messages_read = bytes_read / PIPE_BUF;
             if (bytes_read % PIPE_BUF != 0) {
                 util_error("%s(): dropping all frames! Not enough data!\n", __func__);
+                metrics_add(METRICS_COUNTER_DROPPED_FRAMES, messages_read + 1);
                 __ipc_flush_and_close(ipc);
                 break;
             }
 
+            trace_event(TRACE_EVENT_FRAME_READ, TRACE_NO_TASK, messages_read);
             for (size_t i = 0; i < messages_read; ++i) {
                 ipc_frame_t *frame = (ipc_frame_t *) buf + i;
 
                 if (frame->payload_length == 0 ||
                     frame->payload_length > IPC_MAXIMUM_MESSAGE_LENGTH) {
                     util_error("%s(): dropping single frame! Invalid frame!\n", __func__);
+                    metrics_add(METRICS_COUNTER_DROPPED_FRAMES, 1);
                     continue;
                 }
 
@@ -331,7 +476,7 @@ int ipc_listen(ipc_t                         *ipc,
             }
         }
 
-        if (bytes_read < 0)
+        if (bytes_read < 0 && errno != EINTR) /* Signals are left for block_cb to handle */
             util_perror("ipc_listen(): Recovering from read() error");
         (void) close(ipc->receive_fd);
         ipc->receive_fd = -1;
@@ -341,3 +486,42 @@ int ipc_listen(ipc_t                         *ipc,
             return bcb_ret;
     }
 }
+
+int ipc_get_follow_fifo_path(pid_t client_pid, int stream, char path[PATH_MAX]) {
+    if (!path || (stream != STDOUT_FILENO && stream != STDERR_FILENO)) {
+        errno = EINVAL;
+        return 1;
+    }
+
+    snprintf(path, PATH_MAX, IPC_FOLLOW_FIFO_PATH, (long) client_pid, stream);
+    return 0;
+}
+
+/** @brief Size of the buffer used by ::ipc_splice when `splice()` isn't supported. */
+#define IPC_SPLICE_BUFFER_SIZE (16 * PIPE_BUF)
+
+ssize_t ipc_splice(int in, int out, size_t length) {
+    ssize_t moved;
+    do {
+        moved = splice(in, NULL, out, NULL, length, SPLICE_F_MOVE);
+    } while (moved < 0 && errno == EINTR);
+
+    if (moved >= 0 || errno != EINVAL)
+        return moved; /* Keep errno */
+
+    /* Splicing to out isn't supported (e.g.: a terminal). */
+    uint8_t buf[IPC_SPLICE_BUFFER_SIZE];
+    ssize_t bytes_read;
+    do {
+        bytes_read = read(in, buf, length < sizeof(buf) ? length : sizeof(buf));
+    } while (bytes_read < 0 && errno == EINTR);
+
+    for (ssize_t written = 0; written < bytes_read;) {
+        ssize_t w = write(out, buf + written, bytes_read - written);
+        if (w < 0 && errno != EINTR)
+            return -1; /* Keep errno */
+        else if (w > 0)
+            written += w;
+    }
+    return bytes_read; /* Keep errno */
+}
@@ -0,0 +1,177 @@
+/*
+ * Copyright 2024 Humberto Gomes, José Lopes, José Matos
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+/**
+ * @file  live_state.c
+ * @brief Implementation of methods in live_state.h
+ */
+
+#include <errno.h>
+#include <fcntl.h>
+#include <signal.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+#include "live_state.h"
+
+/** @brief Maximum number of times a reader tries to get a consistent copy of a region. */
+#define LIVE_STATE_MAX_RETRIES 65536
+
+/**
+ * @struct live_state
+ * @brief  A shared memory region written to by the server.
+ *
+ * @var live_state::region
+ *     @brief Contents of the region, mapped from ::LIVE_STATE_PATH.
+ */
+struct live_state {
+    live_state_region_t *region;
+};
+
+live_state_t *live_state_new(pid_t server_pid, uint32_t policy) {
+    live_state_t *ret = malloc(sizeof(live_state_t));
+    if (!ret)
+        return NULL; /* errno = ENOMEM guaranteed */
+
+    /*
+     * Server can read and write, everyone else can read. A file left at the fixed path (or a
+     * symbolic link planted there) is replaced, never opened and truncated.
+     */
+    (void) unlink(LIVE_STATE_PATH);
+    int fd = open(LIVE_STATE_PATH, O_RDWR | O_CREAT | O_EXCL | O_NOFOLLOW, 0644);
+    if (fd < 0) {
+        free(ret);
+        return NULL;
+    }
+
+    if (ftruncate(fd, sizeof(live_state_region_t))) {
+        int errno2 = errno;
+        (void) close(fd);
+        (void) unlink(LIVE_STATE_PATH);
+        free(ret);
+        errno = errno2;
+        return NULL;
+    }
+
+    void *map = mmap(NULL, sizeof(live_state_region_t), PROT_READ | PROT_WRITE, MAP_SHARED, fd, 0);
+    (void) close(fd); /* The mapping keeps the file open */
+    if (map == MAP_FAILED) {
+        int errno2 = errno;
+        (void) unlink(LIVE_STATE_PATH);
+        free(ret);
+        errno = errno2;
+        return NULL;
+    }
+
+    /* The file starts zeroed, so readers see an empty server until the first update */
+    ret->region             = map;
+    ret->region->version    = LIVE_STATE_VERSION;
+    ret->region->server_pid = server_pid;
+    ret->region->policy     = policy;
+    return ret;
+}
+
+void live_state_free(live_state_t *live_state) {
+    if (!live_state)
+        return; /* Don't set errno, as that's not typical free behavior. */
+
+    (void) munmap(live_state->region, sizeof(live_state_region_t));
+    (void) unlink(LIVE_STATE_PATH);
+    free(live_state);
+}
+
+live_state_region_t *live_state_begin_update(live_state_t *live_state) {
+    uint32_t sequence = __atomic_load_n(&live_state->region->sequence, __ATOMIC_RELAXED);
+    __atomic_store_n(&live_state->region->sequence, sequence + 1, __ATOMIC_RELAXED);
+    __atomic_thread_fence(__ATOMIC_RELEASE); /* Odd sequence visible before any other change */
+    return live_state->region;
+}
+
+void live_state_end_update(live_state_t *live_state) {
+    uint32_t sequence = __atomic_load_n(&live_state->region->sequence, __ATOMIC_RELAXED);
+    __atomic_store_n(&live_state->region->sequence, sequence + 1, __ATOMIC_RELEASE);
+}
+
+/**
+ * @brief Copies a region while it isn't being updated.
+ *
+ * @param region Region mapped from ::LIVE_STATE_PATH. Mustn't be `NULL` (unchecked).
+ * @param out    Where to write the copy to. Mustn't be `NULL` (unchecked).
+ *
+ * @retval 0 Success.
+ * @retval 1 The region kept being updated (`errno = EAGAIN`).
+ */
+int __live_state_copy(const live_state_region_t *region, live_state_region_t *out) {
+    for (int i = 0; i < LIVE_STATE_MAX_RETRIES; ++i) {
+        uint32_t before = __atomic_load_n(&region->sequence, __ATOMIC_ACQUIRE);
+        if (before & 1)
+            continue;
+
+        memcpy(out, region, sizeof(live_state_region_t));
+        __atomic_thread_fence(__ATOMIC_ACQUIRE); /* Copy done before reading the sequence again */
+        if (__atomic_load_n(&region->sequence, __ATOMIC_RELAXED) == before)
+            return 0;
+    }
+
+    errno = EAGAIN;
+    return 1;
+}
+
+int live_state_read(live_state_region_t *out) {
+    if (!out) {
+        errno = EINVAL;
+        return 1;
+    }
+
+    int fd = open(LIVE_STATE_PATH, O_RDONLY);
+    if (fd < 0)
+        return 1;
+
+    struct stat statbuf;
+    if (fstat(fd, &statbuf)) {
+        int errno2 = errno;
+        (void) close(fd);
+        errno = errno2;
+        return 1;
+    }
+    if (statbuf.st_size != sizeof(live_state_region_t)) {
+        (void) close(fd);
+        errno = EPROTO;
+        return 1;
+    }
+
+    live_state_region_t *region =
+        mmap(NULL, sizeof(live_state_region_t), PROT_READ, MAP_SHARED, fd, 0);
+    (void) close(fd);
+    if (region == MAP_FAILED)
+        return 1;
+
+    int ret = __live_state_copy(region, out);
+    (void) munmap(region, sizeof(live_state_region_t));
+    if (ret)
+        return 1;
+
+    if (out->version != LIVE_STATE_VERSION) {
+        errno = EPROTO;
+        return 1;
+    } else if (kill(out->server_pid, 0) && errno == ESRCH) {
+        return 1;
+    }
+    return 0;
+}
@@ -0,0 +1,162 @@
+/*
+ * Copyright 2024 Humberto Gomes, José Lopes, José Matos
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+/**
+ * @file  main.c
+ * @brief Contains the entry point to the log dumping program.
+ */
+
+#include <ctype.h>
+#include <errno.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "server/log_dump.h"
+#include "util.h"
+
+/** @brief Size of the buffer of `stdout`, large to reduce the number of `write()` calls. */
+#define MAIN_OUTPUT_BUFFER_SIZE (256 * 1024)
+
+/**
+ * @brief  Prints the usage of the log dumping program to `stderr`.
+ * @param  program_name `argv[0]`.
+ * @return Always `1`.
+ */
+int __main_help_message(const char *program_name) {
+    util_error("Usage:\n");
+    util_error("  See this message: %s help\n", program_name);
+    util_error("  Dump log files:   %s [options] (log file)...\n", program_name);
+    util_error("    where options = --csv | --jsonl (default: --csv)\n");
+    util_error("                    --ids (id) | (id)-(id)\n");
+    util_error("                    --since (completion time, ns since the Unix epoch)\n");
+    util_error("                    --until (completion time, ns since the Unix epoch)\n");
+    util_error("Log files are log.bin or the segments in the log folder (log/*.log), in order.\n");
+    return 1;
+}
+
+/**
+ * @brief  Parses a non-negative 64-bit integer command-line argument.
+ * @param  str Argument to be parsed. Mustn't be `NULL` (unchecked).
+ * @param  out Where to write the parsed value to. Mustn't be `NULL` (unchecked).
+ * @retval 0 Success.
+ * @retval 1 Invalid integer.
+ */
+int __main_parse_uint64(const char *str, uint64_t *out) {
+    char *integer_end;
+    errno                    = 0;
+    unsigned long long value = strtoull(str, &integer_end, 10);
+    if (!isdigit(*str) || *integer_end || errno == ERANGE)
+        return 1;
+
+    *out = value;
+    return 0;
+}
+
+/**
+ * @brief Parses a task identifier (`id`) or an inclusive range of identifiers (`from-to`).
+ *
+ * @param str      String to be parsed. Mustn't be `NULL` (unchecked).
+ * @param first_id Where to output the lowest identifier. Mustn't be `NULL` (unchecked).
+ * @param last_id  Where to output the highest identifier. Mustn't be `NULL` (unchecked).
+ *
+ * @retval 0 Success.
+ * @retval 1 Invalid identifier or range.
+ */
+int __main_parse_id_range(const char *str, uint32_t *first_id, uint32_t *last_id) {
+    char         *integer_end;
+    unsigned long first = strtoul(str, &integer_end, 10);
+    if (!isdigit(*str) || first > UINT32_MAX)
+        return 1;
+
+    unsigned long last = first;
+    if (*integer_end == '-') {
+        const char *last_str = integer_end + 1;
+        last                 = strtoul(last_str, &integer_end, 10);
+        if (!isdigit(*last_str) || last > UINT32_MAX || last < first)
+            return 1;
+    }
+
+    if (*integer_end)
+        return 1;
+
+    *first_id = first;
+    *last_id  = last;
+    return 0;
+}
+
+/**
+ * @brief  The entry point to the log dumping program.
+ * @retval 0 Success.
+ * @retval 1 Invalid arguments, or failure to read a log file or to write the output.
+ */
+int main(int argc, char **argv) {
+    if (argc < 2 || strcmp(argv[1], "help") == 0)
+        return __main_help_message(argv[0]);
+
+    log_dump_options_t options = {.format   = LOG_DUMP_FORMAT_CSV,
+                                  .first_id = 0,
+                                  .last_id  = UINT32_MAX,
+                                  .since    = 0,
+                                  .until    = UINT64_MAX};
+
+    int i = 1;
+    for (; i < argc && strncmp(argv[i], "--", 2) == 0; ++i) {
+        if (strcmp(argv[i], "--csv") == 0) {
+            options.format = LOG_DUMP_FORMAT_CSV;
+        } else if (strcmp(argv[i], "--jsonl") == 0) {
+            options.format = LOG_DUMP_FORMAT_JSON_LINES;
+        } else if (strcmp(argv[i], "--ids") == 0 && i + 1 < argc) {
+            if (__main_parse_id_range(argv[++i], &options.first_id, &options.last_id))
+                return __main_help_message(argv[0]);
+        } else if (strcmp(argv[i], "--since") == 0 && i + 1 < argc) {
+            if (__main_parse_uint64(argv[++i], &options.since))
+                return __main_help_message(argv[0]);
+        } else if (strcmp(argv[i], "--until") == 0 && i + 1 < argc) {
+            if (__main_parse_uint64(argv[++i], &options.until))
+                return __main_help_message(argv[0]);
+        } else {
+            return __main_help_message(argv[0]);
+        }
+    }
+    if (i == argc)
+        return __main_help_message(argv[0]);
+
+    (void) setvbuf(stdout, NULL, _IOFBF, MAIN_OUTPUT_BUFFER_SIZE);
+    if (log_dump_write_header(&options, stdout)) {
+        util_perror("logdump: failed to write output");
+        return 1;
+    }
+
+    int ret = 0;
+    for (; i < argc; ++i) {
+        if (log_dump_file(argv[i], &options, stdout)) {
+            if (ferror(stdout)) {
+                util_perror("logdump: failed to write output");
+                return 1;
+            }
+
+            /* Keep dumping other files */
+            util_error("logdump: failed to read %s: %s\n", argv[i], strerror(errno));
+            ret = 1;
+        }
+    }
+
+    if (fflush(stdout)) {
+        util_perror("logdump: failed to write output");
+        return 1;
+    }
+    return ret;
+}
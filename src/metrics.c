@@ -0,0 +1,70 @@
+/*
+ * Copyright 2024 Humberto Gomes, José Lopes, José Matos
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+/**
+ * @file  metrics.c
+ * @brief Implementation of methods in metrics.h
+ */
+
+#include <errno.h>
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <unistd.h>
+
+#include "metrics.h"
+
+/** @brief Counters mapped by ::metrics_init, inherited by all children of the server. */
+static uint64_t *__metrics_counters = NULL;
+
+/** @brief Size of the mapping of ::__metrics_counters. */
+#define METRICS_MAPPING_SIZE (METRICS_COUNTER_COUNT * sizeof(uint64_t))
+
+int metrics_init(void) {
+    if (__metrics_counters) {
+        errno = EEXIST;
+        return 1;
+    }
+
+    /* Shared anonymous memory, portable without MAP_ANONYMOUS */
+    int fd = open("/dev/zero", O_RDWR);
+    if (fd < 0)
+        return 1;
+
+    void *map = mmap(NULL, METRICS_MAPPING_SIZE, PROT_READ | PROT_WRITE, MAP_SHARED, fd, 0);
+    (void) close(fd);
+    if (map == MAP_FAILED)
+        return 1;
+
+    __metrics_counters = map;
+    return 0;
+}
+
+void metrics_free(void) {
+    if (!__metrics_counters)
+        return; /* Don't set errno, as that's not typical free behavior. */
+
+    (void) munmap(__metrics_counters, METRICS_MAPPING_SIZE);
+    __metrics_counters = NULL;
+}
+
+void metrics_add(metrics_counter_t counter, uint64_t value) {
+    if (__metrics_counters)
+        (void) __atomic_fetch_add(__metrics_counters + counter, value, __ATOMIC_RELAXED);
+}
+
+uint64_t metrics_get(metrics_counter_t counter) {
+    return __metrics_counters ? __atomic_load_n(__metrics_counters + counter, __ATOMIC_RELAXED) : 0;
+}
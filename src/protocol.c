@@ -174,3 +174,89 @@ int protocol_status_response_message_check_length(size_t message_length, size_t
     *command_length = message_length - 3 * sizeof(uint8_t) - sizeof(uint32_t) - 4 * sizeof(double);
     return 1;
 }
+
+/**
+ * @brief Checks if a received message, made up of a header and stages, can have a given length.
+ *
+ * @param message_length Length of the received message.
+ * @param header_length  Length of the message without any stages.
+ * @param stage_count    Where to write (on success) the number of stages in the message to.
+ *                       Mustn't be `NULL`.
+ *
+ * @retval 0 Invalid length or `NULL` @p stage_count (in this last case, `errno = EINVAL`).
+ * @retval 1 Valid length.
+ */
+int __protocol_stages_message_check_length(size_t  message_length,
+                                           size_t  header_length,
+                                           size_t *stage_count) {
+    if (message_length < header_length || message_length > IPC_MAXIMUM_MESSAGE_LENGTH ||
+        (message_length - header_length) % sizeof(tagged_task_stage_t) != 0 ||
+        (message_length - header_length) / sizeof(tagged_task_stage_t) >
+            TAGGED_TASK_MAXIMUM_STAGES)
+        return 0;
+
+    if (!stage_count) {
+        errno = EINVAL;
+        return 0;
+    }
+
+    *stage_count = (message_length - header_length) / sizeof(tagged_task_stage_t);
+    return 1;
+}
+
+int protocol_task_done_message_check_length(size_t message_length, size_t *stage_count) {
+    return __protocol_stages_message_check_length(message_length,
+                                                  PROTOCOL_TASK_DONE_HEADER_LENGTH,
+                                                  stage_count);
+}
+
+int protocol_stage_status_message_check_length(size_t message_length, size_t *stage_count) {
+    return __protocol_stages_message_check_length(message_length,
+                                                  PROTOCOL_STAGE_STATUS_HEADER_LENGTH,
+                                                  stage_count);
+}
+
+/** @brief Length of a ::protocol_export_request_message_t, without its path. */
+#define PROTOCOL_EXPORT_HEADER_LENGTH                                                              \
+    (2 * sizeof(uint8_t) + sizeof(pid_t) + 2 * sizeof(uint32_t))
+
+int protocol_export_request_message_new(protocol_export_request_message_t *out,
+                                        size_t                            *out_size,
+                                        protocol_export_format_t           format,
+                                        uint32_t                           first_id,
+                                        uint32_t                           last_id,
+                                        const char                        *path) {
+    if (!out || !out_size || !path) {
+        errno = EINVAL;
+        return 1;
+    }
+
+    size_t len = strlen(path);
+    if (len == 0 || len > PROTOCOL_MAXIMUM_EXPORT_PATH_LENGTH) {
+        errno = EMSGSIZE;
+        return 1;
+    }
+
+    *out_size       = PROTOCOL_EXPORT_HEADER_LENGTH + len;
+    out->type       = PROTOCOL_C2S_EXPORT;
+    out->client_pid = getpid();
+    out->format     = format;
+    out->first_id   = first_id;
+    out->last_id    = last_id;
+    memcpy(out->path, path, len); /* Purposely don't copy null terminator */
+    return 0;
+}
+
+int protocol_export_request_message_check_length(size_t message_length, size_t *path_length) {
+    if (message_length <= PROTOCOL_EXPORT_HEADER_LENGTH ||
+        message_length > IPC_MAXIMUM_MESSAGE_LENGTH)
+        return 0;
+
+    if (!path_length) {
+        errno = EINVAL;
+        return 0;
+    }
+
+    *path_length = message_length - PROTOCOL_EXPORT_HEADER_LENGTH;
+    return 1;
+}
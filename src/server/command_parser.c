@@ -14,6 +14,7 @@
  * limitations under the License.
  */
 
+
 /**
  * @file  server/command_parser.c
  * @brief Implementation of methods in server/command_parser.h
@@ -21,156 +22,194 @@
 
 #include <errno.h>
 #include <stdlib.h>
+#include <string.h>
 
 #include "server/command_parser.h"
 
-/** @brief Initial value of command_parser_token_t::capacity.  */
-#define COMMAND_PARSER_TOKEN_INITIAL_CAPACITY 32
-
 /**
- * @struct command_parser_token_t
- * @brief  Token in a command line.
+ * @struct  command_parser_scratch_t
+ * @brief   Buffers where a command line is parsed to, before a task is created from them.
+ * @details These are reused between parses, so that no memory allocation is needed to parse
+ *          command lines no longer than the longest one parsed so far.
  *
- * @var command_parser_token_t::string
- *     @brief Contents of the token. It's owned by this `struct`.
- * @var command_parser_token_t::length
- *     @brief Number of characters in command_parser_token_t::string.
- * @var command_parser_token_t::capacity
- *     @brief Maximum number of characters (including terminator) that
- *            command_parser_token_t::string supports.
- * @var command_parser_token_t::is_pipe
- *     @brief Whether the token is a pipe, as a string comparison to `"|"` has no information about
- *            whether a token is a pipe or just part of a program's arguments.
+ * @var command_parser_scratch_t::strings
+ *     @brief Unescaped and null-terminated arguments of all programs.
+ * @var command_parser_scratch_t::offsets
+ *     @brief Offset of each argument in command_parser_scratch_t::strings.
+ * @var command_parser_scratch_t::layouts
+ *     @brief Number of arguments, redirections and connector of each program.
+ * @var command_parser_scratch_t::capacity
+ *     @brief Number of elements each one of the buffers can hold.
  */
 typedef struct {
-    char  *string;
-    size_t length, capacity;
-    int    is_pipe;
-} command_parser_token_t;
+    char                  *strings;
+    size_t                *offsets;
+    task_program_layout_t *layouts;
+    size_t                 capacity;
+} command_parser_scratch_t;
+
+/** @brief Buffers shared by all calls to ::command_parser_parse_task. */
+static command_parser_scratch_t __command_parser_scratch = {0};
 
 /**
- * @brief   Creates a new empty token.
- * @returns A new token on success, `NULL` on allocation error (`errno = ENOMEM`).
+ * @brief   Makes sure ::__command_parser_scratch can hold the parse of a command line.
+ * @details Parsing never outputs more bytes than those in the command line (plus a null
+ *          terminator), and every argument, redirection or program needs at least one character of
+ *          the command line. Thus, a capacity of `strlen(command_line) + 1` is enough for every
+ *          buffer.
+ *
+ * @param capacity Minimum capacity of every buffer.
+ *
+ * @retval 0 Success.
+ * @retval 1 Allocation failure (`errno = ENOMEM`).
  */
-command_parser_token_t *__command_parser_token_new_empty(void) {
-    command_parser_token_t *ret = malloc(sizeof(command_parser_token_t));
-    if (!ret)
-        return NULL; /* errno = ENOMEM guaranteed */
-
-    ret->is_pipe  = 0;
-    ret->length   = 0;
-    ret->capacity = COMMAND_PARSER_TOKEN_INITIAL_CAPACITY;
-    ret->string   = malloc(sizeof(char) * ret->capacity);
-    if (!ret->string) {
-        free(ret);
-        return NULL; /* errno = ENOMEM guaranteed */
-    }
-    ret->string[0] = '\0';
-
-    return ret;
+int __command_parser_scratch_reserve(size_t capacity) {
+    command_parser_scratch_t *scratch = &__command_parser_scratch;
+    if (capacity <= scratch->capacity)
+        return 0;
+
+    char *new_strings = realloc(scratch->strings, sizeof(char) * capacity);
+    if (!new_strings)
+        return 1; /* errno = ENOMEM guaranteed */
+    scratch->strings = new_strings;
+
+    size_t *new_offsets = realloc(scratch->offsets, sizeof(size_t) * capacity);
+    if (!new_offsets)
+        return 1; /* errno = ENOMEM guaranteed */
+    scratch->offsets = new_offsets;
+
+    task_program_layout_t *new_layouts =
+        realloc(scratch->layouts, sizeof(task_program_layout_t) * capacity);
+    if (!new_layouts)
+        return 1; /* errno = ENOMEM guaranteed */
+    scratch->layouts = new_layouts;
+
+    scratch->capacity = capacity;
+    return 0;
 }
 
 /**
- * @brief Frees memory used by a ::command_parser_token_t.
- * @param token Token to have its memory released. Mustn't be `NULL`.
+ * @brief Resets the layout of a program before it starts being parsed.
+ * @param layout Layout to be reset. Mustn't be `NULL` (unchecked).
  */
-void __command_parser_token_free(command_parser_token_t *token) {
-    if (!token)
-        return; /* Don't set errno, as that's normal free behavior */
-    free(token->string);
-    free(token);
+void __command_parser_layout_reset(task_program_layout_t *layout) {
+    layout->program.argument_count = 0;
+    for (size_t i = 0; i < PROGRAM_REDIRECTION_COUNT; ++i) {
+        layout->program.redirections[i] = PROGRAM_NO_REDIRECTION;
+        layout->program.append[i]       = 0;
+    }
+    layout->connector = TASK_CONNECTOR_NONE;
 }
 
-/**
- * @brief Appends a character to a token.
- *
- * @param token Token to have a character appended to it. Mustn't be `NULL`.
- * @param c     Character to be added to @p token.
- *
- * @retval 0 Success.
- * @retval 1 Failure (check `errno`).
- *
- * | `errno`  | Cause               |
- * | -------- | ------------------- |
- * | `EINVAL` | @p token is `NULL`. |
- * | `ENOMEM` | Allocation failure. |
- */
-int __command_parser_token_append(command_parser_token_t *token, char c) {
-    if (!token) {
+task_t *command_parser_parse_task(const char *command_line) {
+    if (!command_line) {
         errno = EINVAL;
-        return 1;
+        return NULL;
     }
 
-    if (token->length >= token->capacity - 2) {
-        size_t new_capacity = token->capacity * 2;
-        char  *new_string   = realloc(token->string, sizeof(char) * new_capacity);
-        if (!new_string)
-            return 1; /* errno = ENOMEM guaranteed */
+    size_t length = strlen(command_line);
+    if (__command_parser_scratch_reserve(length + 1))
+        return NULL; /* errno = ENOMEM guaranteed */
 
-        token->capacity = new_capacity;
-        token->string   = new_string;
-    }
+    char                  *strings = __command_parser_scratch.strings;
+    size_t                *offsets = __command_parser_scratch.offsets;
+    task_program_layout_t *layouts = __command_parser_scratch.layouts;
 
-    token->string[token->length]     = c;
-    token->string[token->length + 1] = '\0';
-    token->length++;
-    return 0;
-}
+    size_t strings_length = 0, noffsets = 0, nprograms = 0, token_start = 0;
+    int    in_double_quotes = 0, in_single_quotes = 0, in_token = 0, token_quoted = 0;
+    int    redirection = -1, append = 0; /* Redirection waiting for its path */
+    __command_parser_layout_reset(&layouts[0]);
+
+/** @brief Terminates the token being parsed in ::command_parser_parse_task. */
+#define END_TOKEN()                                                                                \
+    do {                                                                                           \
+        strings[strings_length++] = '\0';                                                          \
+        if (redirection >= 0) {                                                                    \
+            layouts[nprograms].program.redirections[redirection] = token_start;                    \
+            layouts[nprograms].program.append[redirection]       = append;                         \
+            redirection                                          = -1;                             \
+        } else {                                                                                   \
+            offsets[noffsets++] = token_start;                                                     \
+            layouts[nprograms].program.argument_count++;                                           \
+        }                                                                                          \
+        token_start  = strings_length;                                                             \
+        in_token     = 0;                                                                          \
+        token_quoted = 0;                                                                          \
+    } while (0)
 
 /**
- * @brief  Wrapper for ::__command_parser_token_append for use in ::__command_parser_token_next,
- *         that automatically frees @p token and returns `NULL` on failure.
- * @param  token See ::__command_parser_token_append.
- * @param  c     See ::__command_parser_token_append.
+ * @brief Terminates the program being parsed in ::command_parser_parse_task, that is followed by
+ *        @p connector_value.
  */
-#define APPEND_ERROR_CHECK(token, c)                                                               \
+#define END_PROGRAM(connector_value)                                                               \
     do {                                                                                           \
-        if (__command_parser_token_append(token, c)) {                                             \
-            __command_parser_token_free(token);                                                    \
+        if (in_token)                                                                              \
+            END_TOKEN();                                                                           \
+        if (redirection >= 0 || layouts[nprograms].program.argument_count == 0) {                  \
+            errno = EILSEQ; /* Parsing error (empty command or redirection without path) */        \
             return NULL;                                                                           \
         }                                                                                          \
+        layouts[nprograms++].connector = (connector_value);                                        \
+        __command_parser_layout_reset(&layouts[nprograms]);                                        \
     } while (0)
 
-/**
- * @brief  Gets the next token from a command line.
- * @param  remaining Pointer to part of command line still left to tokenize. On success, this will
- *                   be updated to have the position after the token read.
- * @return A new token, or `NULL` on failure (check `errno`).
- *
- * | `errno`  | Cause                                                |
- * | -------- | ---------------------------------------------------- |
- * | `EINVAL` | @p remaining is `NULL` or points to a `NULL` string. |
- * | `EILSEQ` | Parsing failure.                                     |
- * | `ENOMEM` | Allocation failure.                                  |
- */
-command_parser_token_t *__command_parser_token_next(const char **remaining) {
-    if (!remaining || !*remaining) {
-        errno = EINVAL;
-        return NULL;
-    }
+    for (const char *cursor = command_line; *cursor; cursor++) {
+        if (in_double_quotes || in_single_quotes) {
+            /* Operators and whitespace have no special meaning inside quotes */
+        } else if (*cursor == '|') {
+            END_PROGRAM(TASK_CONNECTOR_PIPE);
+            continue;
+        } else if (*cursor == ';') {
+            END_PROGRAM(TASK_CONNECTOR_SEQUENCE);
+            continue;
+        } else if (*cursor == '&' && cursor[1] == '&') {
+            END_PROGRAM(TASK_CONNECTOR_AND);
+            cursor++;
+            continue;
+        } else if (*cursor == '<' || *cursor == '>') {
+            int stream = *cursor == '<' ? PROGRAM_REDIRECTION_INPUT : PROGRAM_REDIRECTION_OUTPUT;
+            if (*cursor == '>' && in_token && !token_quoted && strings_length - token_start == 1 &&
+                strings[token_start] == '2') {
+
+                /* Discard "2" token in "2>" */
+                strings_length = token_start;
+                in_token       = 0;
+                stream         = PROGRAM_REDIRECTION_ERROR;
+            } else if (in_token) {
+                END_TOKEN();
+            }
 
-    int                     in_double_quotes = 0, in_single_quotes = 0, have_been_quotes = 0;
-    command_parser_token_t *token = __command_parser_token_new_empty();
-    if (!token)
-        return NULL; /* errno = ENOMEM guaranteed */
+            if (redirection >= 0) {
+                errno = EILSEQ; /* Redirection without path */
+                return NULL;
+            }
+
+            redirection = stream;
+            append      = 0;
+            if (*cursor == '>' && cursor[1] == '>') {
+                append = 1;
+                cursor++;
+            }
+            continue;
+        }
 
-    const char *cursor;
-    for (cursor = *remaining; *cursor; cursor++) {
         switch (*cursor) {
             case '"':
-                have_been_quotes = 1;
                 if (in_single_quotes)
-                    APPEND_ERROR_CHECK(token, '\"');
+                    strings[strings_length++] = '\"';
                 else
                     in_double_quotes = !in_double_quotes;
+                in_token     = 1;
+                token_quoted = 1;
                 break;
 
             case '\'':
-                have_been_quotes = 1;
                 if (in_double_quotes)
-                    APPEND_ERROR_CHECK(token, '\'');
+                    strings[strings_length++] = '\'';
                 else
                     in_single_quotes = !in_single_quotes;
+                in_token     = 1;
+                token_quoted = 1;
                 break;
 
             case '\\':
@@ -178,128 +217,48 @@ command_parser_token_t *__command_parser_token_next(const char **remaining) {
                     cursor++;
                     if (*cursor == '\\' || *cursor == '\"' ||
                         (!in_double_quotes && *cursor == ' ')) {
-                        APPEND_ERROR_CHECK(token, *cursor);
+                        strings[strings_length++] = *cursor;
                     } else if (*cursor) {
-                        APPEND_ERROR_CHECK(token, '\\');
-                        APPEND_ERROR_CHECK(token, *cursor);
+                        strings[strings_length++] = '\\';
+                        strings[strings_length++] = *cursor;
                     } else {
                         errno = EILSEQ; /* Unterminated escape sequence */
-                        __command_parser_token_free(token);
                         return NULL;
                     }
                 } else {
-                    APPEND_ERROR_CHECK(token, '\\');
+                    strings[strings_length++] = '\\';
                 }
+                in_token     = 1;
+                token_quoted = 1;
                 break;
 
             case '\t':
             case ' ':
-                if (in_double_quotes || in_single_quotes) {
-                    APPEND_ERROR_CHECK(token, *cursor);
-                } else if (*token->string || have_been_quotes) {
-                    *remaining = cursor + 1;
-                    return token;
-                }
-                break;
-
-            case '|':
-                if (in_double_quotes || in_single_quotes) {
-                    APPEND_ERROR_CHECK(token, '|');
-                } else if (*token->string || have_been_quotes) {
-                    *remaining = cursor;
-                    return token;
-                } else {
-                    APPEND_ERROR_CHECK(token, '|');
-                    *remaining     = cursor + 1;
-                    token->is_pipe = 1;
-                    return token;
-                }
+                if (in_double_quotes || in_single_quotes)
+                    strings[strings_length++] = *cursor;
+                else if (in_token)
+                    END_TOKEN();
                 break;
 
             default:
-                APPEND_ERROR_CHECK(token, *cursor);
+                strings[strings_length++] = *cursor;
+                in_token                  = 1;
                 break;
         }
     }
 
     if (in_double_quotes || in_single_quotes) {
-        /* Parsing error: unclosed quotation marks */
-        errno = EILSEQ;
-        __command_parser_token_free(token);
+        errno = EILSEQ; /* Parsing error: unclosed quotation marks */
         return NULL;
     }
 
-    if (*token->string || have_been_quotes) {
-        *remaining = cursor;
-        return token;
-    } else {
-        __command_parser_token_free(token);
-        return NULL; /* End of string */
-    }
-}
-
-task_t *command_parser_parse_task(const char *command_line) {
-    if (!command_line) {
-        errno = EINVAL;
-        return NULL;
-    }
-
-    task_t                 *ret             = NULL;
-    program_t              *current_program = NULL;
-    command_parser_token_t *token           = NULL;
-
-    ret = task_new_empty();
-    if (!ret)
-        goto FAILURE; /* ENOMEM */
-
-    current_program = program_new_empty();
-    if (!current_program)
-        goto FAILURE; /* ENOMEM */
-
-    errno                 = 0;
-    const char *remaining = command_line;
-    while ((token = __command_parser_token_next(&remaining))) {
-        if (token->is_pipe) {
-            if (program_get_argument_count(current_program) == 0) {
-                errno = EILSEQ; /* Parsing error (empty command) */
-                goto FAILURE;
-            }
-
-            if (task_add_program(ret, current_program))
-                goto FAILURE; /* ENOMEM */
-
-            program_free(current_program);
-            current_program = program_new_empty();
-            if (!current_program)
-                goto FAILURE; /* ENOMEM */
-
-        } else if (program_add_argument(current_program, token->string)) {
-            goto FAILURE; /* ENOMEM */
-        }
-
-        __command_parser_token_free(token);
-    }
-
-    if (errno != 0)
-        goto FAILURE; /* Keep errno from tokenizer */
-
-    if (program_get_argument_count(current_program) == 0) {
-        errno = EILSEQ; /* Parsing error (empty command) */
-        goto FAILURE;
-    }
-
-    if (task_add_program(ret, current_program))
-        goto FAILURE; /* ENOMEM */
+    /* Allow a trailing ";", like a shell (the last connector is ignored) */
+    if (in_token || redirection >= 0 || layouts[nprograms].program.argument_count != 0 ||
+        nprograms == 0 || layouts[nprograms - 1].connector != TASK_CONNECTOR_SEQUENCE)
+        END_PROGRAM(TASK_CONNECTOR_NONE);
 
-    program_free(current_program);
-    return ret;
+#undef END_TOKEN
+#undef END_PROGRAM
 
-FAILURE:
-    if (token)
-        __command_parser_token_free(token);
-    if (current_program)
-        program_free(current_program);
-    if (ret)
-        task_free(ret);
-    return NULL;
+    return task_new_from_string_table(strings, strings_length, offsets, layouts, nprograms);
 }
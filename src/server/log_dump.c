@@ -0,0 +1,284 @@
+/*
+ * Copyright 2024 Humberto Gomes, José Lopes, José Matos
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+/**
+ * @file  server/log_dump.c
+ * @brief Implementation of methods in server/log_dump.h
+ */
+
+#include <errno.h>
+
+#include "server/log_dump.h"
+#include "server/log_file.h"
+
+/** @brief Names of the columns output for every task in ::LOG_DUMP_FORMAT_CSV. */
+#define LOG_DUMP_CSV_HEADER                                                                        \
+    "id,expected_time_ms,error,sent_ns,arrived_ns,dispatched_ns,ended_ns,completed_ns,c2s_ns,"     \
+    "wait_ns,execute_ns,s2s_ns,turnaround_ns,logged_at_ns,stage_count,command_line\n"
+
+/** @brief Names of each ::tagged_task_time_t, as output. */
+const char *const log_dump_time_names[TAGGED_TASK_TIME_COMPLETED + 1] = {"sent_ns",
+                                                                         "arrived_ns",
+                                                                         "dispatched_ns",
+                                                                         "ended_ns",
+                                                                         "completed_ns"};
+
+/**
+ * @brief   Names of the durations between consecutive ::tagged_task_time_t, as output.
+ * @details The last one is the time between ::TAGGED_TASK_TIME_SENT and
+ *          ::TAGGED_TASK_TIME_COMPLETED.
+ */
+const char *const log_dump_duration_names[TAGGED_TASK_TIME_COMPLETED + 1] = {"c2s_ns",
+                                                                             "wait_ns",
+                                                                             "execute_ns",
+                                                                             "s2s_ns",
+                                                                             "turnaround_ns"};
+
+/**
+ * @struct log_dump_state_t
+ * @brief  State of ::log_dump_file, passed to ::__log_dump_record.
+ *
+ * @var log_dump_state_t::options
+ *     @brief Format and filters of the dump.
+ * @var log_dump_state_t::out
+ *     @brief Where to write to.
+ */
+typedef struct {
+    const log_dump_options_t *options;
+    FILE                     *out;
+} log_dump_state_t;
+
+/**
+ * @brief  Converts a timestamp to nanoseconds.
+ * @param  time Timestamp to be converted. Mustn't be `NULL` (unchecked).
+ * @return The number of nanoseconds, `0` for timestamps that were never set.
+ */
+int64_t __log_dump_get_ns(const struct timespec *time) {
+    return (int64_t) time->tv_sec * 1000000000 + time->tv_nsec;
+}
+
+/**
+ * @brief Writes a string as a quoted CSV field.
+ * @param str    String to be written. Mustn't be `NULL` (unchecked).
+ * @param length Number of characters in @p str.
+ * @param out    Where to write to. Mustn't be `NULL` (unchecked).
+ */
+void __log_dump_write_csv_string(const char *str, size_t length, FILE *out) {
+    (void) putc('"', out);
+    for (size_t i = 0; i < length; ++i) {
+        if (str[i] == '"')
+            (void) putc('"', out);
+        (void) putc(str[i], out);
+    }
+    (void) putc('"', out);
+}
+
+/**
+ * @brief Writes a string as a JSON string.
+ * @param str    String to be written. Mustn't be `NULL` (unchecked).
+ * @param length Number of characters in @p str.
+ * @param out    Where to write to. Mustn't be `NULL` (unchecked).
+ */
+void __log_dump_write_json_string(const char *str, size_t length, FILE *out) {
+    (void) putc('"', out);
+    for (size_t i = 0; i < length; ++i) {
+        unsigned char c = str[i];
+        if (c == '"' || c == '\\')
+            (void) fprintf(out, "\\%c", c);
+        else if (c < 0x20)
+            (void) fprintf(out, "\\u%04x", c);
+        else
+            (void) putc(c, out);
+    }
+    (void) putc('"', out);
+}
+
+/**
+ * @brief Writes a record as a CSV line.
+ * @param record    Record to be written. Mustn't be `NULL` (unchecked).
+ * @param times     Timestamps of @p record in nanoseconds. Mustn't be `NULL` (unchecked).
+ * @param logged_at log_file_record_t::logged_at in nanoseconds.
+ * @param out       Where to write to. Mustn't be `NULL` (unchecked).
+ */
+void __log_dump_write_csv(const log_file_record_t *record,
+                          const int64_t            times[TAGGED_TASK_TIME_COMPLETED + 1],
+                          int64_t                  logged_at,
+                          FILE                    *out) {
+    (void) fprintf(out,
+                   "%" PRIu32 ",%" PRIu32 ",%d",
+                   record->id,
+                   record->expected_time,
+                   record->error ? 1 : 0);
+
+    /* Unset timestamps and durations depending on them are empty fields */
+    for (tagged_task_time_t i = 0; i <= TAGGED_TASK_TIME_COMPLETED; ++i) {
+        if (times[i])
+            (void) fprintf(out, ",%" PRId64, times[i]);
+        else
+            (void) putc(',', out);
+    }
+    for (tagged_task_time_t i = 0; i <= TAGGED_TASK_TIME_COMPLETED; ++i) {
+        tagged_task_time_t start = i == TAGGED_TASK_TIME_COMPLETED ? TAGGED_TASK_TIME_SENT : i;
+        tagged_task_time_t end   = i == TAGGED_TASK_TIME_COMPLETED ? i : i + 1;
+        if (times[start] && times[end])
+            (void) fprintf(out, ",%" PRId64, times[end] - times[start]);
+        else
+            (void) putc(',', out);
+    }
+
+    if (logged_at)
+        (void) fprintf(out, ",%" PRId64, logged_at);
+    else
+        (void) putc(',', out);
+
+    (void) fprintf(out, ",%zu,", record->stage_count);
+    __log_dump_write_csv_string(record->command_line, record->command_length, out);
+    (void) putc('\n', out);
+}
+
+/**
+ * @brief Writes a record as a JSON object in its own line.
+ * @param record    Record to be written. Mustn't be `NULL` (unchecked).
+ * @param times     Timestamps of @p record in nanoseconds. Mustn't be `NULL` (unchecked).
+ * @param logged_at log_file_record_t::logged_at in nanoseconds.
+ * @param out       Where to write to. Mustn't be `NULL` (unchecked).
+ */
+void __log_dump_write_json(const log_file_record_t *record,
+                           const int64_t            times[TAGGED_TASK_TIME_COMPLETED + 1],
+                           int64_t                  logged_at,
+                           FILE                    *out) {
+    (void) fprintf(out,
+                   "{\"id\": %" PRIu32 ", \"expected_time_ms\": %" PRIu32 ", \"error\": %s",
+                   record->id,
+                   record->expected_time,
+                   record->error ? "true" : "false");
+
+    /* Unset timestamps and durations depending on them are null */
+    for (tagged_task_time_t i = 0; i <= TAGGED_TASK_TIME_COMPLETED; ++i) {
+        if (times[i])
+            (void) fprintf(out, ", \"%s\": %" PRId64, log_dump_time_names[i], times[i]);
+        else
+            (void) fprintf(out, ", \"%s\": null", log_dump_time_names[i]);
+    }
+    for (tagged_task_time_t i = 0; i <= TAGGED_TASK_TIME_COMPLETED; ++i) {
+        tagged_task_time_t start = i == TAGGED_TASK_TIME_COMPLETED ? TAGGED_TASK_TIME_SENT : i;
+        tagged_task_time_t end   = i == TAGGED_TASK_TIME_COMPLETED ? i : i + 1;
+        if (times[start] && times[end])
+            (void) fprintf(out,
+                           ", \"%s\": %" PRId64,
+                           log_dump_duration_names[i],
+                           times[end] - times[start]);
+        else
+            (void) fprintf(out, ", \"%s\": null", log_dump_duration_names[i]);
+    }
+
+    if (logged_at)
+        (void) fprintf(out, ", \"logged_at_ns\": %" PRId64, logged_at);
+    else
+        (void) fputs(", \"logged_at_ns\": null", out);
+
+    (void) fputs(", \"stages\": [", out);
+    for (size_t i = 0; i < record->stage_count; ++i) {
+        const tagged_task_stage_t *stage = record->stages + i;
+        (void) fprintf(out,
+                       "%s{\"started_ns\": %" PRId64 ", \"ended_ns\": %" PRId64
+                       ", \"user_us\": %" PRIu64 ", \"system_us\": %" PRIu64
+                       ", \"max_rss_kib\": %" PRIu64 ", \"exit_status\": %" PRId32
+                       ", \"executed\": %s}",
+                       i ? ", " : "",
+                       __log_dump_get_ns(&stage->started),
+                       __log_dump_get_ns(&stage->ended),
+                       stage->user_time,
+                       stage->system_time,
+                       stage->maximum_resident_size,
+                       stage->exit_status,
+                       stage->executed ? "true" : "false");
+    }
+
+    (void) fputs("], \"command_line\": ", out);
+    __log_dump_write_json_string(record->command_line, record->command_length, out);
+    (void) fputs("}\n", out);
+}
+
+int log_dump_record(const log_file_record_t *record, const log_dump_options_t *options, FILE *out) {
+    if (!record || !options || !out) {
+        errno = EINVAL;
+        return 1;
+    } else if (record->id < options->first_id || record->id > options->last_id) {
+        return 0;
+    }
+
+    int64_t times[TAGGED_TASK_TIME_COMPLETED + 1];
+    for (tagged_task_time_t i = 0; i <= TAGGED_TASK_TIME_COMPLETED; ++i)
+        times[i] = __log_dump_get_ns(record->times + i);
+
+    /* Tasks logged by older servers, without a wall-clock time, are only output without a window */
+    int64_t logged_at  = __log_dump_get_ns(&record->logged_at);
+    int     has_window = options->since || options->until != UINT64_MAX;
+    if ((has_window && !logged_at) || (uint64_t) logged_at < options->since ||
+        (uint64_t) logged_at > options->until)
+        return 0;
+
+    if (options->format == LOG_DUMP_FORMAT_CSV)
+        __log_dump_write_csv(record, times, logged_at, out);
+    else
+        __log_dump_write_json(record, times, logged_at, out);
+    return ferror(out) ? 1 : 0;
+}
+
+/**
+ * @brief Callback for ::log_file_read_records that writes a record, if it passes the filters.
+ *
+ * @param record     Record in the log file. Mustn't be `NULL` (unchecked).
+ * @param state_data A ::log_dump_state_t. Mustn't be `NULL` (unchecked).
+ *
+ * @retval 0 Success.
+ * @retval 1 Output failure (check `errno`).
+ */
+int __log_dump_record(const log_file_record_t *record, void *state_data) {
+    log_dump_state_t *state = state_data;
+    return log_dump_record(record, state->options, state->out);
+}
+
+int log_dump_write_header(const log_dump_options_t *options, FILE *out) {
+    if (!options || !out) {
+        errno = EINVAL;
+        return 1;
+    }
+
+    if (options->format == LOG_DUMP_FORMAT_CSV && fputs(LOG_DUMP_CSV_HEADER, out) == EOF)
+        return 1; /* Keep errno */
+    return 0;
+}
+
+int log_dump_file(const char *path, const log_dump_options_t *options, FILE *out) {
+    if (!path || !options || !out) {
+        errno = EINVAL;
+        return 1;
+    }
+
+    log_file_t *log_file = log_file_new(path, 0, LOG_WRITER_DURABILITY_NONE);
+    if (!log_file)
+        return 1; /* Keep errno */
+
+    log_dump_state_t state = {.options = options, .out = out};
+    int              ret   = log_file_read_records(log_file, __log_dump_record, &state);
+
+    int errno2 = errno;
+    log_file_free(log_file);
+    errno = errno2;
+    return ret != 0;
+}
@@ -19,10 +19,17 @@
  * @brief Implementation of methods in server/log_file.h
  */
 
+/* Needed for copy_file_range() */
+#define _GNU_SOURCE
+
 #include <errno.h>
 #include <fcntl.h>
 #include <stdlib.h>
 #include <string.h>
+#include <sys/mman.h>
+#include <sys/sendfile.h>
+#include <sys/stat.h>
+#include <time.h>
 #include <unistd.h>
 
 #include "protocol.h"
@@ -35,22 +42,61 @@
  *
  * @var log_file::fd
  *     @brief   File descriptor of the open log file.
- *     @details Its offset must always be kept at the end of the file.
- * @var log_file::writable
- *     @brief Whether it's possible to `write()` to log_file::fd.
- * @var log_file::task_count
- *     @brief   The number of tasks written to a file.
- *     @details For synchronization purposes, as children that read the server's status mustn't read
- *              more from the file that what was there when `fork()` was called.
+ *     @details Opened with `O_APPEND` when writable, and only read from with `pread()`, so that
+ *              readers and log_file::writer never disturb each other's offsets.
+ * @var log_file::writer
+ *     @brief   Asynchronous writer of records to log_file::fd.
+ *     @details `NULL` if the file isn't writable. Children that read the server's status mustn't
+ *              read more from the file than what was there when `fork()` was called, so the number
+ *              of records in the file is taken from the writer, and the rest from its ring buffer.
+ * @var log_file::version
+ *     @brief Format of the records in the file (`LOG_FILE_VERSION_*`).
+ * @var log_file::size
+ *     @brief Size of the file, including records that haven't reached it yet.
  */
 struct log_file {
-    int    fd, writable;
-    size_t task_count;
+    int           fd;
+    log_writer_t *writer;
+    uint32_t      version;
+    size_t        size;
 };
 
+/** @brief Magic number at the start of a log file (`"SOLG"` in little-endian). */
+#define LOG_FILE_MAGIC 0x474c4f53
+
+/** @brief Version of log files with no header, made of ::log_file_serialized_task_t records. */
+#define LOG_FILE_VERSION_LEGACY 1
+
+/** @brief Version of log files with variable-length records. */
+#define LOG_FILE_VERSION_VARIABLE 2
+
+/**
+ * @brief   Version of log files with variable-length records that may store when tasks were logged
+ *          (see log_file_record_t::logged_at), written by this implementation.
+ * @details Records are decoded in the same way as in ::LOG_FILE_VERSION_VARIABLE files, where
+ *          ::LOG_FILE_RECORD_FLAG_LOGGED_AT is never set, so both can be mixed when copying
+ *          records.
+ */
+#define LOG_FILE_VERSION_LOGGED_AT 3
+
+/**
+ * @struct log_file_header_t
+ * @brief  Header at the start of every log file, except for ::LOG_FILE_VERSION_LEGACY files.
+ *
+ * @var log_file_header_t::magic
+ *     @brief Must be ::LOG_FILE_MAGIC.
+ * @var log_file_header_t::version
+ *     @brief Version of the format of the records that follow the header.
+ */
+typedef struct __attribute__((packed)) {
+    uint32_t magic, version;
+} log_file_header_t;
+
 /**
- * @struct log_file_serialized_task_t
- * @brief  Information about a ::tagged_task_t in a serializable form.
+ * @struct  log_file_serialized_task_t
+ * @brief   Information about a ::tagged_task_t in a serializable form.
+ * @details This is how records are stored in ::LOG_FILE_VERSION_LEGACY files. In newer versions,
+ *          this is only an intermediate form, encoded by ::__log_file_encode_task.
  *
  * @var log_file_serialized_task_t::id
  *     @brief See tagged_task::id.
@@ -62,14 +108,20 @@ struct log_file {
  *     @brief Whether an error occurred while running this task.
  * @var log_file_serialized_task_t::times
  *     @brief See tagged_task::times.
+ * @var log_file_serialized_task_t::stage_count
+ *     @brief Number of valid elements in log_file_serialized_task_t::stages.
+ * @var log_file_serialized_task_t::stages
+ *     @brief See tagged_task::stages.
  * @var log_file_serialized_task_t::command_line
  *     @brief See tagged_task::command_line. **Not null-terminated.**
  */
 typedef struct __attribute__((packed)) {
-    uint32_t        id, command_length, expected_time;
-    uint8_t         error;
-    struct timespec times[TAGGED_TASK_TIME_COMPLETED + 1];
-    char            command_line[PROTOCOL_MAXIMUM_COMMAND_LENGTH];
+    uint32_t            id, command_length, expected_time;
+    uint8_t             error;
+    struct timespec     times[TAGGED_TASK_TIME_COMPLETED + 1];
+    uint8_t             stage_count;
+    tagged_task_stage_t stages[TAGGED_TASK_MAXIMUM_STAGES];
+    char                command_line[PROTOCOL_MAXIMUM_COMMAND_LENGTH];
 } log_file_serialized_task_t;
 
 /**
@@ -115,50 +167,346 @@ int __log_file_serialize_task(const tagged_task_t        *task,
         else
             out->times[i].tv_sec = out->times[i].tv_nsec = 0;
     }
+
+    size_t                     stage_count;
+    const tagged_task_stage_t *stages = tagged_task_get_stages(task, &stage_count);
+    out->stage_count                  = stage_count;
+    memset(out->stages, 0, sizeof(out->stages));
+    if (stage_count)
+        memcpy(out->stages, stages, stage_count * sizeof(tagged_task_stage_t));
     return 0;
 }
 
 /**
- * @brief Deserializes a task in a log file.
- * @param task Serialized task to deserialize.
+ * @brief Creates a view of a task stored in a ::LOG_FILE_VERSION_LEGACY file.
  *
- * @return A task owned by the caller on success, `NULL` on failure (check `errno`).
+ * @param task Serialized task, inside the memory the view will point to. Mustn't be `NULL`
+ *             (unchecked).
+ * @param out  Where to write the view to. Mustn't be `NULL` (unchecked).
  *
- * | `errno`    | Cause                                                |
- * | ---------- | ---------------------------------------------------- |
- * | `EINVAL`   | @p in is `NULL`.                                     |
- * | `EMSGSIZE` | Invalid serialized task with very long command line. |
- * | `ENOMEM`   | Allocation failure.                                  |
+ * @retval 0 Success.
+ * @retval 1 Invalid serialized task (`errno = EILSEQ`).
  */
-tagged_task_t *__log_file_deserialize_task(const log_file_serialized_task_t *task) {
-    if (!task) {
-        errno = EINVAL;
-        return NULL;
+int __log_file_view_serialized_task(const log_file_serialized_task_t *task,
+                                    log_file_record_t                *out) {
+    if (task->command_length > PROTOCOL_MAXIMUM_COMMAND_LENGTH ||
+        task->stage_count > TAGGED_TASK_MAXIMUM_STAGES) {
+        errno = EILSEQ;
+        return 1;
     }
 
+    out->id             = task->id;
+    out->expected_time  = task->expected_time;
+    out->error          = task->error;
+    out->stage_count    = task->stage_count;
+    out->command_line   = task->command_line;
+    out->command_length = task->command_length;
+    out->logged_at      = (struct timespec){0};
+    memcpy(out->times, task->times, sizeof(out->times));
+    memcpy(out->stages, task->stages, out->stage_count * sizeof(tagged_task_stage_t));
+    return 0;
+}
+
+/**
+ * @brief Creates a task from a record in a log file.
+ * @param record Record to create the task from. Mustn't be `NULL` (unchecked).
+ *
+ * @return A task owned by the caller on success, `NULL` on failure (`errno = ENOMEM`).
+ */
+tagged_task_t *__log_file_record_to_task(const log_file_record_t *record) {
     char command_line[PROTOCOL_MAXIMUM_COMMAND_LENGTH + 1];
-    if (task->command_length <= PROTOCOL_MAXIMUM_COMMAND_LENGTH) {
-        memcpy(command_line, task->command_line, task->command_length);
-        command_line[task->command_length] = '\0';
-    } else {
-        errno = EMSGSIZE;
-        return NULL;
-    }
+    memcpy(command_line, record->command_line, record->command_length);
+    command_line[record->command_length] = '\0';
 
     tagged_task_t *ret =
-        tagged_task_new_from_command_line(command_line, task->id, task->expected_time);
-    if (!task)
+        tagged_task_new_from_command_line(command_line, record->id, record->expected_time);
+    if (!ret)
         return NULL; /* Keep ENOMEM */
 
-    for (tagged_task_time_t i = TAGGED_TASK_TIME_SENT; i <= TAGGED_TASK_TIME_COMPLETED; ++i) {
-        struct timespec aligned_copy = task->times[i];
-        tagged_task_set_time(ret, i, &aligned_copy);
+    for (tagged_task_time_t i = TAGGED_TASK_TIME_SENT; i <= TAGGED_TASK_TIME_COMPLETED; ++i)
+        tagged_task_set_time(ret, i, record->times + i);
+
+    if (record->stage_count &&
+        tagged_task_set_stages(ret, record->stages, record->stage_count)) {
+        tagged_task_free(ret);
+        return NULL; /* errno = ENOMEM guaranteed */
     }
+    return ret;
+}
 
+/**
+ * @brief   Maximum length of a record in a ::LOG_FILE_VERSION_VARIABLE file (with its length).
+ * @details Very loose bound, as encoded records are never larger than a
+ *          ::log_file_serialized_task_t.
+ */
+#define LOG_FILE_MAXIMUM_RECORD_LENGTH (2 * sizeof(log_file_serialized_task_t))
+
+/** @brief Maximum number of bytes in a variable-length integer (see ::__log_file_put_varint). */
+#define LOG_FILE_MAXIMUM_VARINT_LENGTH 10
+
+/** @brief Flag in the flags of an encoded record, set when the task ended in error. */
+#define LOG_FILE_RECORD_FLAG_ERROR 1
+
+/** @brief Flag in the flags of an encoded record, set when log_file_record_t::logged_at follows. */
+#define LOG_FILE_RECORD_FLAG_LOGGED_AT 2
+
+/**
+ * @brief   Writes a variable-length integer (LEB128) to a buffer.
+ * @details Every byte stores 7 bits of the integer, with the most significant bit set if more
+ *          bytes follow.
+ *
+ * @param out   Where to write the integer to. Must have space for ::LOG_FILE_MAXIMUM_VARINT_LENGTH
+ *              bytes (unchecked).
+ * @param value Integer to be written.
+ *
+ * @return The number of bytes written.
+ */
+size_t __log_file_put_varint(uint8_t *out, uint64_t value) {
+    size_t length = 0;
+    while (value >= 0x80) {
+        out[length++] = (uint8_t) (value | 0x80);
+        value >>= 7;
+    }
+    out[length++] = (uint8_t) value;
+    return length;
+}
+
+/**
+ * @brief Reads a variable-length integer written by ::__log_file_put_varint.
+ *
+ * @param in    Pointer to the start of the integer, advanced past it on success. Mustn't be `NULL`
+ *              (unchecked).
+ * @param end   End of the buffer @p in points to.
+ * @param value Where to write the integer to. Mustn't be `NULL` (unchecked).
+ *
+ * @retval 0 Success.
+ * @retval 1 Integer truncated or too long.
+ */
+int __log_file_get_varint(const uint8_t **in, const uint8_t *end, uint64_t *value) {
+    *value = 0;
+    for (size_t i = 0; i < LOG_FILE_MAXIMUM_VARINT_LENGTH && *in + i < end; ++i) {
+        *value |= (uint64_t) ((*in)[i] & 0x7f) << (7 * i);
+        if (!((*in)[i] & 0x80)) {
+            *in += i + 1;
+            return 0;
+        }
+    }
+    return 1;
+}
+
+/** @brief Maps signed integers to unsigned ones, so that small magnitudes have short varints. */
+uint64_t __log_file_zigzag(int64_t value) {
+    return ((uint64_t) value << 1) ^ (uint64_t) (value >> 63);
+}
+
+/** @brief Inverse of ::__log_file_zigzag. */
+int64_t __log_file_unzigzag(uint64_t value) {
+    return (int64_t) (value >> 1) ^ -(int64_t) (value & 1);
+}
+
+/** @brief Converts a `struct timespec` to nanoseconds. */
+int64_t __log_file_timespec_to_ns(const struct timespec *time) {
+    return (int64_t) time->tv_sec * 1000000000 + time->tv_nsec;
+}
+
+/** @brief Converts nanoseconds to a `struct timespec`. */
+struct timespec __log_file_ns_to_timespec(int64_t ns) {
+    struct timespec ret = {.tv_sec = ns / 1000000000, .tv_nsec = ns % 1000000000};
+    if (ret.tv_nsec < 0) {
+        ret.tv_sec--;
+        ret.tv_nsec += 1000000000;
+    }
     return ret;
 }
 
-log_file_t *log_file_new(const char *path, int writable) {
+/**
+ * @brief   Encodes a task in a ::LOG_FILE_VERSION_LOGGED_AT record.
+ * @details Integers are stored as varints. Unset times (zero) are marked in a bit mask and
+ *          omitted. The first time is stored in full, and every other time as the difference
+ *          (zigzag encoded) to the time before it. Stages are stored relative to the first time of
+ *          the task. The time the task was logged at is stored in nanoseconds, after the flags.
+ *
+ * @param task      Task to be encoded. Mustn't be `NULL` (unchecked).
+ * @param logged_at See log_file_record_t::logged_at. Mustn't be `NULL` (unchecked).
+ * @param out       Where to write the record, length prefix included, to. Must have space for
+ *                  ::LOG_FILE_MAXIMUM_RECORD_LENGTH bytes (unchecked).
+ *
+ * @return The length of the record.
+ */
+size_t __log_file_encode_task(const log_file_serialized_task_t *task,
+                              const struct timespec            *logged_at,
+                              uint8_t                          *out) {
+    uint8_t body[LOG_FILE_MAXIMUM_RECORD_LENGTH];
+    size_t  length = 0;
+
+    length += __log_file_put_varint(body + length, task->id);
+    length += __log_file_put_varint(body + length, task->expected_time);
+    body[length++] = task->error ? LOG_FILE_RECORD_FLAG_ERROR | LOG_FILE_RECORD_FLAG_LOGGED_AT
+                                 : LOG_FILE_RECORD_FLAG_LOGGED_AT;
+    length += __log_file_put_varint(body + length, __log_file_timespec_to_ns(logged_at));
+
+    struct timespec times[TAGGED_TASK_TIME_COMPLETED + 1];
+    memcpy(times, task->times, sizeof(times));
+
+    uint8_t mask = 0;
+    for (tagged_task_time_t i = TAGGED_TASK_TIME_SENT; i <= TAGGED_TASK_TIME_COMPLETED; ++i)
+        if (times[i].tv_sec || times[i].tv_nsec)
+            mask |= 1 << i;
+    body[length++] = mask;
+
+    int64_t base  = 0, previous = 0;
+    int     first = 1;
+    for (tagged_task_time_t i = TAGGED_TASK_TIME_SENT; i <= TAGGED_TASK_TIME_COMPLETED; ++i) {
+        if (!(mask & (1 << i)))
+            continue;
+
+        int64_t time = __log_file_timespec_to_ns(times + i);
+        if (first) {
+            length += __log_file_put_varint(body + length, times[i].tv_sec);
+            length += __log_file_put_varint(body + length, times[i].tv_nsec);
+            base  = time;
+            first = 0;
+        } else {
+            length += __log_file_put_varint(body + length, __log_file_zigzag(time - previous));
+        }
+        previous = time;
+    }
+
+    tagged_task_stage_t stages[TAGGED_TASK_MAXIMUM_STAGES];
+    memcpy(stages, task->stages, task->stage_count * sizeof(tagged_task_stage_t));
+    body[length++] = task->stage_count;
+    for (size_t i = 0; i < task->stage_count; ++i) {
+        body[length++] = stages[i].executed;
+        if (!stages[i].executed)
+            continue;
+
+        int64_t started = __log_file_timespec_to_ns(&stages[i].started);
+        int64_t ended   = __log_file_timespec_to_ns(&stages[i].ended);
+        length += __log_file_put_varint(body + length, __log_file_zigzag(started - base));
+        length += __log_file_put_varint(body + length, __log_file_zigzag(ended - started));
+        length += __log_file_put_varint(body + length, stages[i].user_time);
+        length += __log_file_put_varint(body + length, stages[i].system_time);
+        length += __log_file_put_varint(body + length, stages[i].maximum_resident_size);
+        length += __log_file_put_varint(body + length, __log_file_zigzag(stages[i].exit_status));
+    }
+
+    length += __log_file_put_varint(body + length, task->command_length);
+    memcpy(body + length, task->command_line, task->command_length);
+    length += task->command_length;
+
+    size_t prefix_length = __log_file_put_varint(out, length);
+    memcpy(out + prefix_length, body, length);
+    return prefix_length + length;
+}
+
+/**
+ * @brief   Decodes the body of a record written by ::__log_file_encode_task.
+ * @details The command line isn't copied, but pointed to.
+ *
+ * @param in     Record body, without the length prefix. Mustn't be `NULL` (unchecked).
+ * @param length Number of bytes in @p in.
+ * @param out    Where to write the view of the record to. Mustn't be `NULL` (unchecked).
+ *
+ * @retval 0 Success.
+ * @retval 1 Invalid record (`errno = EILSEQ`).
+ */
+int __log_file_decode_task(const uint8_t *in, size_t length, log_file_record_t *out) {
+    const uint8_t *end = in + length;
+    uint64_t       id, expected_time, command_length;
+    if (__log_file_get_varint(&in, end, &id) || __log_file_get_varint(&in, end, &expected_time) ||
+        end - in < 2 || id > UINT32_MAX || expected_time > UINT32_MAX) {
+        errno = EILSEQ;
+        return 1;
+    }
+    out->id            = id;
+    out->expected_time = expected_time;
+    out->error         = *in & LOG_FILE_RECORD_FLAG_ERROR;
+    out->logged_at     = (struct timespec){0};
+
+    uint64_t logged_at;
+    if (*(in++) & LOG_FILE_RECORD_FLAG_LOGGED_AT) {
+        if (__log_file_get_varint(&in, end, &logged_at) || logged_at > INT64_MAX || in == end) {
+            errno = EILSEQ;
+            return 1;
+        }
+        out->logged_at = __log_file_ns_to_timespec(logged_at);
+    }
+
+    uint8_t mask = *(in++);
+    int64_t base  = 0, previous = 0;
+    int     first = 1;
+    for (tagged_task_time_t i = TAGGED_TASK_TIME_SENT; i <= TAGGED_TASK_TIME_COMPLETED; ++i) {
+        if (!(mask & (1 << i))) {
+            out->times[i] = (struct timespec){0};
+            continue;
+        }
+
+        uint64_t value, nsec = 0;
+        if (__log_file_get_varint(&in, end, &value) ||
+            (first && (__log_file_get_varint(&in, end, &nsec) || nsec >= 1000000000))) {
+            errno = EILSEQ;
+            return 1;
+        }
+
+        if (first) {
+            out->times[i] = (struct timespec){.tv_sec = value, .tv_nsec = nsec};
+            base          = __log_file_timespec_to_ns(out->times + i);
+            first         = 0;
+        } else {
+            out->times[i] = __log_file_ns_to_timespec(previous + __log_file_unzigzag(value));
+        }
+        previous = __log_file_timespec_to_ns(out->times + i);
+    }
+
+    if (in == end || *in > TAGGED_TASK_MAXIMUM_STAGES) {
+        errno = EILSEQ;
+        return 1;
+    }
+    out->stage_count = *(in++);
+
+    for (size_t i = 0; i < out->stage_count; ++i) {
+        tagged_task_stage_t *stage = out->stages + i;
+        if (in == end) {
+            errno = EILSEQ;
+            return 1;
+        }
+
+        uint8_t executed = *(in++);
+        if (!executed) {
+            *stage = (tagged_task_stage_t){0};
+            continue;
+        }
+
+        uint64_t started, duration, exit_status;
+        if (__log_file_get_varint(&in, end, &started) ||
+            __log_file_get_varint(&in, end, &duration) ||
+            __log_file_get_varint(&in, end, &stage->user_time) ||
+            __log_file_get_varint(&in, end, &stage->system_time) ||
+            __log_file_get_varint(&in, end, &stage->maximum_resident_size) ||
+            __log_file_get_varint(&in, end, &exit_status)) {
+            errno = EILSEQ;
+            return 1;
+        }
+
+        int64_t started_ns = base + __log_file_unzigzag(started);
+        stage->executed    = executed;
+        stage->started     = __log_file_ns_to_timespec(started_ns);
+        stage->ended       = __log_file_ns_to_timespec(started_ns + __log_file_unzigzag(duration));
+        stage->exit_status = __log_file_unzigzag(exit_status);
+    }
+
+    if (__log_file_get_varint(&in, end, &command_length) ||
+        command_length != (uint64_t) (end - in) ||
+        command_length > PROTOCOL_MAXIMUM_COMMAND_LENGTH) {
+        errno = EILSEQ;
+        return 1;
+    }
+    out->command_line   = (const char *) in;
+    out->command_length = command_length;
+    return 0;
+}
+
+log_file_t *log_file_new(const char *path, int writable, log_writer_durability_t durability) {
     if (!path) {
         errno = EINVAL;
         return NULL;
@@ -170,10 +518,11 @@ log_file_t *log_file_new(const char *path, int writable) {
         return NULL;
     }
 
-    log_file->writable   = writable;
-    log_file->task_count = 0;
+    log_file->writer  = NULL;
+    log_file->version = LOG_FILE_VERSION_LOGGED_AT;
+    log_file->size    = 0;
     if (writable)
-        log_file->fd = open(path, O_RDWR | O_CREAT | O_TRUNC, 0640);
+        log_file->fd = open(path, O_RDWR | O_CREAT | O_TRUNC | O_APPEND, 0640);
     else
         log_file->fd = open(path, O_RDONLY);
 
@@ -181,6 +530,45 @@ log_file_t *log_file_new(const char *path, int writable) {
         free(log_file);
         return NULL; /* Keep errno */
     }
+
+    log_file_header_t header = {.magic = LOG_FILE_MAGIC, .version = LOG_FILE_VERSION_LOGGED_AT};
+    if (writable) {
+        if (write(log_file->fd, &header, sizeof(header)) != sizeof(header)) {
+            log_file_free(log_file);
+            return NULL; /* Keep errno */
+        }
+        log_file->size = sizeof(header);
+
+        log_file->writer = log_writer_new(log_file->fd, durability);
+        if (!log_file->writer) {
+            log_file_free(log_file);
+            return NULL; /* Keep errno */
+        }
+    } else {
+        /* Files without a header are legacy files. Empty files have nothing to read */
+        ssize_t header_read = read(log_file->fd, &header, sizeof(header));
+        if (header_read < 0) {
+            log_file_free(log_file);
+            return NULL; /* Keep errno */
+        } else if (header_read == sizeof(header) && header.magic == LOG_FILE_MAGIC) {
+            if (header.version != LOG_FILE_VERSION_VARIABLE &&
+                header.version != LOG_FILE_VERSION_LOGGED_AT) {
+                log_file_free(log_file);
+                errno = EILSEQ;
+                return NULL;
+            }
+            log_file->version = header.version;
+        } else if (header_read != 0) {
+            log_file->version = LOG_FILE_VERSION_LEGACY;
+        }
+
+        struct stat statbuf;
+        if (fstat(log_file->fd, &statbuf)) {
+            log_file_free(log_file);
+            return NULL; /* Keep errno */
+        }
+        log_file->size = statbuf.st_size;
+    }
     return log_file;
 }
 
@@ -188,12 +576,18 @@ void log_file_free(log_file_t *log_file) {
     if (!log_file)
         return; /* Don't set errno, as that's not typical free() behavior */
 
+    log_writer_free(log_file->writer);
     (void) close(log_file->fd);
     free(log_file);
 }
 
+void log_file_stop_writing(log_file_t *log_file) {
+    if (log_file)
+        log_writer_stop(log_file->writer);
+}
+
 int log_file_write_task(log_file_t *log_file, const tagged_task_t *task, int error) {
-    if (!task || !log_file || !log_file->writable) {
+    if (!task || !log_file || !log_file->writer) {
         errno = EINVAL;
         return 1;
     }
@@ -202,67 +596,454 @@ int log_file_write_task(log_file_t *log_file, const tagged_task_t *task, int err
     if (__log_file_serialize_task(task, &serialized, error))
         return 1; /* Keep errno */
 
-    if (write(log_file->fd, &serialized, sizeof(log_file_serialized_task_t)) !=
-        sizeof(log_file_serialized_task_t)) /* No partial write risk */
-        return 1;                           /* Keep errno */
-    log_file->task_count++;
+    struct timespec logged_at = {0};
+    (void) clock_gettime(CLOCK_REALTIME, &logged_at);
+
+    uint8_t record[LOG_FILE_MAXIMUM_RECORD_LENGTH];
+    size_t  length = __log_file_encode_task(&serialized, &logged_at, record);
+    if (log_writer_append(log_file->writer, record, length))
+        return 1; /* Keep errno */
+
+    log_file->size += length;
     return 0;
 }
 
-/** @brief Number of bytes read in ::log_file_read_tasks. */
-#define LOG_FILE_READ_BUFFER_SIZE (4 * sizeof(log_file_serialized_task_t))
+size_t log_file_get_size(const log_file_t *log_file) {
+    if (!log_file) {
+        errno = EINVAL;
+        return 0;
+    }
+    return log_file->size;
+}
 
-int log_file_read_tasks(log_file_t *log_file, log_file_task_callback_t task_cb, void *state) {
-    if (!log_file || !task_cb) {
+/**
+ * @brief Calls a callback for every record in a ::LOG_FILE_VERSION_LEGACY file.
+ *
+ * @param records   Start of the records. Mustn't be `NULL` (unchecked).
+ * @param length    Number of bytes in @p records.
+ * @param record_cb Callback to be called for every record. Mustn't be `NULL` (unchecked).
+ * @param state     Pointer passed to @p record_cb.
+ *
+ * @return See ::log_file_read_records.
+ */
+int __log_file_read_legacy_records(const uint8_t             *records,
+                                   size_t                     length,
+                                   log_file_record_callback_t record_cb,
+                                   void                      *state) {
+    if (length % sizeof(log_file_serialized_task_t) != 0) {
+        util_error("%s(): log file with truncated record\n", __func__);
+        errno = EILSEQ;
+        return 1;
+    }
+
+    log_file_record_t record;
+    for (size_t i = 0; i < length / sizeof(log_file_serialized_task_t); ++i) {
+        const log_file_serialized_task_t *serialized =
+            (const log_file_serialized_task_t *) records + i;
+        if (__log_file_view_serialized_task(serialized, &record)) {
+            util_error("%s(): invalid record in log file\n", __func__);
+            return 1;
+        }
+        record.offset = i * sizeof(log_file_serialized_task_t);
+
+        int cb_ret = record_cb(&record, state);
+        if (cb_ret)
+            return cb_ret;
+    }
+    return 0;
+}
+
+/**
+ * @brief Calls a callback for the first ::LOG_FILE_VERSION_VARIABLE records in a buffer.
+ *
+ * @param records   Start of the buffer, advanced past the outputted records. Mustn't be `NULL`
+ *                  (unchecked).
+ * @param end       End of the buffer.
+ * @param offset    Offset in the log file of the record at the start of the buffer.
+ * @param count     Maximum number of records to output. `SIZE_MAX` to output until @p end.
+ * @param record_cb Callback to be called for every record. Mustn't be `NULL` (unchecked).
+ * @param state     Pointer passed to @p record_cb.
+ *
+ * @retval 0     Success.
+ * @retval 1     Invalid or truncated record, or less than @p count records (`errno = EILSEQ`).
+ * @retval other Value returned by @p record_cb.
+ */
+int __log_file_read_variable_records(const uint8_t            **records,
+                                     const uint8_t             *end,
+                                     size_t                     offset,
+                                     size_t                     count,
+                                     log_file_record_callback_t record_cb,
+                                     void                      *state) {
+    const uint8_t    *start = *records;
+    log_file_record_t record;
+    for (size_t i = 0; i < count && (count != SIZE_MAX || *records != end); ++i) {
+        const uint8_t *body = *records;
+        uint64_t       length;
+        if (__log_file_get_varint(&body, end, &length) || length > (uint64_t) (end - body) ||
+            __log_file_decode_task(body, length, &record)) {
+            util_error("%s(): invalid or truncated record in log file\n", __func__);
+            errno = EILSEQ;
+            return 1;
+        }
+
+        record.offset = offset + (*records - start);
+        *records      = body + length;
+        int cb_ret    = record_cb(&record, state);
+        if (cb_ret)
+            return cb_ret;
+    }
+    return 0;
+}
+
+/**
+ * @brief   Maps the records in a log file to memory.
+ * @details The file is mapped as a whole, as `mmap()` offsets must be page-aligned.
+ *
+ * @param log_file Log file to be mapped. Mustn't be `NULL` (unchecked).
+ * @param length   Where to write the size of the mapping to (`0` for empty files, that aren't
+ *                 mapped). Mustn't be `NULL` (unchecked).
+ *
+ * @return The start of the mapping on success, `MAP_FAILED` on failure (check `errno`, see
+ *         `man 2 fstat` and `man 2 mmap`).
+ */
+uint8_t *__log_file_map(log_file_t *log_file, size_t *length) {
+    struct stat statbuf;
+    if (fstat(log_file->fd, &statbuf))
+        return MAP_FAILED;
+
+    *length = statbuf.st_size;
+    if (!*length)
+        return NULL;
+
+    uint8_t *map = mmap(NULL, *length, PROT_READ, MAP_PRIVATE, log_file->fd, 0);
+    if (map != MAP_FAILED)
+        (void) posix_madvise(map, *length, POSIX_MADV_SEQUENTIAL);
+    return map;
+}
+
+int log_file_read_records(log_file_t *log_file, log_file_record_callback_t record_cb, void *state) {
+    if (!log_file || !record_cb) {
         errno = EINVAL;
         return 1;
     }
 
-    if (lseek(log_file->fd, 0, SEEK_SET) == (off_t) -1)
+    /* The file is mapped after the snapshot, so that it contains at least written_records */
+    uint8_t *pending        = NULL;
+    size_t   pending_length = 0, written_records = SIZE_MAX, pending_records = 0;
+    if (log_file->writer) {
+        pending = log_writer_get_pending(log_file->writer,
+                                         &pending_length,
+                                         &written_records,
+                                         &pending_records);
+        if (!pending && pending_length)
+            return 1; /* errno = ENOMEM guaranteed */
+    }
+
+    size_t   map_length;
+    uint8_t *map = __log_file_map(log_file, &map_length);
+    if (map == MAP_FAILED) {
+        free(pending);
+        return 1; /* Keep errno */
+    }
+
+    int ret;
+    if (log_file->version == LOG_FILE_VERSION_LEGACY) {
+        ret = __log_file_read_legacy_records(map, map_length, record_cb, state);
+    } else {
+        const uint8_t *records = map + sizeof(log_file_header_t), *end = map + map_length;
+        if (map_length < sizeof(log_file_header_t))
+            records = end; /* Header not written due to a failure */
+
+        ret = __log_file_read_variable_records(&records,
+                                               end,
+                                               sizeof(log_file_header_t),
+                                               written_records,
+                                               record_cb,
+                                               state);
+        if (!ret && pending_records) {
+            records = pending;
+            ret     = __log_file_read_variable_records(&records,
+                                                       pending + pending_length,
+                                                       log_file->size - pending_length,
+                                                       pending_records,
+                                                       record_cb,
+                                                       state);
+        }
+    }
+
+    int errno2 = errno;
+    if (map)
+        (void) munmap(map, map_length);
+    free(pending);
+    errno = errno2;
+    return ret;
+}
+
+int log_file_read_record_at(log_file_t                *log_file,
+                            size_t                     offset,
+                            log_file_record_callback_t record_cb,
+                            void                      *state) {
+    if (!log_file || !record_cb) {
+        errno = EINVAL;
         return 1;
+    }
 
-    uint8_t buf[LOG_FILE_READ_BUFFER_SIZE];
-    ssize_t bytes_read      = 0;
-    size_t  outputted_tasks = 0;
-    while ((bytes_read = read(log_file->fd, buf, LOG_FILE_READ_BUFFER_SIZE))) {
-        size_t tasks_read = bytes_read / sizeof(log_file_serialized_task_t);
-        if (bytes_read % sizeof(log_file_serialized_task_t) != 0) {
-            util_error("%s(): read too many / few bytes for task in log file\n", __func__);
-            (void) lseek(log_file->fd, 0, SEEK_END);
+    /* Bytes still in the writer's ring buffer aren't in the file */
+    uint8_t buf[LOG_FILE_MAXIMUM_RECORD_LENGTH];
+    size_t  available = 0;
+    if (log_file->writer && offset >= sizeof(log_file_header_t) &&
+        log_writer_read(log_file->writer,
+                        offset - sizeof(log_file_header_t),
+                        buf,
+                        LOG_FILE_MAXIMUM_RECORD_LENGTH,
+                        &available))
+        return 1; /* Keep errno */
+
+    if (!available) {
+        ssize_t bytes_read = pread(log_file->fd, buf, LOG_FILE_MAXIMUM_RECORD_LENGTH, offset);
+        if (bytes_read < 0)
+            return 1; /* Keep errno */
+        available = bytes_read;
+    }
+
+    log_file_record_t record;
+    if (log_file->version == LOG_FILE_VERSION_LEGACY) {
+        if (available < sizeof(log_file_serialized_task_t) ||
+            __log_file_view_serialized_task((log_file_serialized_task_t *) buf, &record)) {
+            errno = EILSEQ;
+            return 1;
+        }
+    } else {
+        const uint8_t *body = buf;
+        uint64_t       length;
+        if (__log_file_get_varint(&body, buf + available, &length) ||
+            length > (uint64_t) (buf + available - body) ||
+            __log_file_decode_task(body, length, &record)) {
             errno = EILSEQ;
             return 1;
         }
+    }
 
-        for (size_t i = 0; i < tasks_read; ++i) {
-            log_file_serialized_task_t *serialized = (log_file_serialized_task_t *) buf + i;
-            tagged_task_t              *task       = __log_file_deserialize_task(serialized);
-            if (!task) {
-                int errno2 = errno;
-                util_error("%s(): task deserialization failure!\n", __func__);
-                (void) lseek(log_file->fd, 0, SEEK_END);
-
-                if (errno2 == ENOMEM)
-                    errno = ENOMEM;
-                else
-                    errno = EILSEQ;
-                return 1;
-            }
+    record.offset = offset;
+    return record_cb(&record, state);
+}
+
+/**
+ * @struct log_file_task_adapter_t
+ * @brief  State of ::__log_file_record_to_task_cb, used by ::log_file_read_tasks.
+ *
+ * @var log_file_task_adapter_t::task_cb
+ *     @brief Callback passed to ::log_file_read_tasks.
+ * @var log_file_task_adapter_t::state
+ *     @brief State passed to ::log_file_read_tasks.
+ */
+typedef struct {
+    log_file_task_callback_t task_cb;
+    void                    *state;
+} log_file_task_adapter_t;
+
+/**
+ * @brief Creates a task from a record and calls the callback of ::log_file_read_tasks with it.
+ *
+ * @param record     Record read from the log file. Mustn't be `NULL` (unchecked).
+ * @param state_data A ::log_file_task_adapter_t. Mustn't be `NULL` (unchecked).
+ *
+ * @retval 0     Success.
+ * @retval 1     Allocation failure (`errno = ENOMEM`).
+ * @retval other Value returned by log_file_task_adapter_t::task_cb.
+ */
+int __log_file_record_to_task_cb(const log_file_record_t *record, void *state_data) {
+    log_file_task_adapter_t *adapter = state_data;
+
+    tagged_task_t *task = __log_file_record_to_task(record);
+    if (!task) {
+        util_error("%s(): task deserialization failure!\n", __func__);
+        return 1; /* errno = ENOMEM guaranteed */
+    }
+
+    int cb_ret = adapter->task_cb(task, record->error, adapter->state);
+    tagged_task_free(task);
+    return cb_ret;
+}
+
+int log_file_read_tasks(log_file_t *log_file, log_file_task_callback_t task_cb, void *state) {
+    if (!log_file || !task_cb) {
+        errno = EINVAL;
+        return 1;
+    }
+
+    log_file_task_adapter_t adapter = {.task_cb = task_cb, .state = state};
+    return log_file_read_records(log_file, __log_file_record_to_task_cb, &adapter);
+}
+
+int log_file_write_header(int fd) {
+    log_file_header_t header = {.magic = LOG_FILE_MAGIC, .version = LOG_FILE_VERSION_LOGGED_AT};
+    ssize_t           written = write(fd, &header, sizeof(header));
+    if (written != sizeof(header)) {
+        if (written >= 0)
+            errno = EIO; /* Short write */
+        return 1;
+    }
+    return 0;
+}
+
+/**
+ * @struct log_file_span_t
+ * @brief  State of ::__log_file_find_span, used by ::log_file_copy_records.
+ *
+ * @var log_file_span_t::first_id
+ *     @brief Lowest identifier of the records in the span.
+ * @var log_file_span_t::last_id
+ *     @brief Highest identifier of the records in the span.
+ * @var log_file_span_t::start
+ *     @brief Offset of the first record in the span.
+ * @var log_file_span_t::end
+ *     @brief Offset of the first record after the span, `SIZE_MAX` if it ends with the file.
+ * @var log_file_span_t::count
+ *     @brief Number of records in the span.
+ */
+typedef struct {
+    uint32_t first_id, last_id;
+    size_t   start, end, count;
+} log_file_span_t;
+
+/**
+ * @brief   Callback for ::log_file_read_records that finds the records in a range of identifiers.
+ * @details Records in a log file are sorted by identifier, so those in the range are contiguous.
+ *
+ * @param record    Record in the log file. Mustn't be `NULL` (unchecked).
+ * @param span_data A ::log_file_span_t. Mustn't be `NULL` (unchecked).
+ *
+ * @retval 0 Keep iterating.
+ * @retval 2 Past the end of the range. Stop iterating.
+ */
+int __log_file_find_span(const log_file_record_t *record, void *span_data) {
+    log_file_span_t *span = span_data;
+    if (record->id < span->first_id) {
+        return 0;
+    } else if (record->id > span->last_id) {
+        span->end = record->offset;
+        return 2;
+    }
 
-            int cb_ret = task_cb(task, serialized->error, state);
-            if (cb_ret) {
-                tagged_task_free(task);
-                (void) lseek(log_file->fd, 0, SEEK_END);
-                return cb_ret;
+    if (!span->count++)
+        span->start = record->offset;
+    return 0;
+}
+
+/**
+ * @brief   Copies bytes between two files.
+ * @details `copy_file_range()` is used so that data doesn't need to be copied to user space, with
+ *          `sendfile()` and then `pread()` as fallbacks when it isn't supported.
+ *
+ * @param in     File to copy from.
+ * @param offset Offset of the first byte to copy in @p in.
+ * @param length Number of bytes to copy.
+ * @param out    File to copy to, at its current offset.
+ *
+ * @retval 0 Success.
+ * @retval 1 Failure (check `errno`, see `man 2 pread` and `man 2 write`).
+ */
+int __log_file_copy_bytes(int in, off_t offset, size_t length, int out) {
+    int use_copy_file_range = 1, use_sendfile = 1;
+    while (length) {
+        ssize_t moved = -1;
+        if (use_copy_file_range) {
+            moved = copy_file_range(in, &offset, out, NULL, length, 0);
+            if (moved < 0 && errno != EINTR)
+                use_copy_file_range = 0; /* Unsupported file systems (EXDEV, EINVAL, ...) */
+        } else if (use_sendfile) {
+            moved = sendfile(out, in, &offset, length);
+            if (moved < 0 && errno != EINTR)
+                use_sendfile = 0;
+        } else {
+            uint8_t buf[LOG_FILE_MAXIMUM_RECORD_LENGTH];
+            moved = pread(in, buf, length < sizeof(buf) ? length : sizeof(buf), offset);
+            if (moved < 0 && errno != EINTR)
+                return 1; /* Keep errno */
+
+            for (ssize_t written = 0; written < moved;) {
+                ssize_t w = write(out, buf + written, moved - written);
+                if (w < 0 && errno != EINTR)
+                    return 1; /* Keep errno */
+                else if (w > 0)
+                    written += w;
             }
+            offset += moved > 0 ? moved : 0;
+        }
+
+        if (moved == 0) {
+            errno = EILSEQ; /* File shorter than expected */
+            return 1;
+        } else if (moved > 0) {
+            length -= moved;
+        }
+    }
+    return 0;
+}
 
-            tagged_task_free(task);
+int log_file_copy_records(log_file_t *log_file,
+                          uint32_t    first_id,
+                          uint32_t    last_id,
+                          int         out,
+                          size_t     *count) {
+    if (!log_file || !count) {
+        errno = EINVAL;
+        return 1;
+    } else if (log_file->version == LOG_FILE_VERSION_LEGACY) {
+        errno = EILSEQ;
+        return 1;
+    }
 
-            outputted_tasks++;
-            if (outputted_tasks == log_file->task_count)
+    log_file_span_t span = {.first_id = first_id,
+                            .last_id  = last_id,
+                            .start    = 0,
+                            .end      = SIZE_MAX,
+                            .count    = 0};
+    if (log_file_read_records(log_file, __log_file_find_span, &span) == 1)
+        return 1; /* Keep errno */
+
+    *count = span.count;
+    if (!span.count)
+        return 0;
+    if (span.end == SIZE_MAX)
+        span.end = log_file->size;
+
+    /* Records still in the writer's ring buffer aren't in the file */
+    uint8_t *pending        = NULL;
+    size_t   pending_length = 0, written_records, pending_records;
+    if (log_file->writer) {
+        pending = log_writer_get_pending(log_file->writer,
+                                         &pending_length,
+                                         &written_records,
+                                         &pending_records);
+        if (!pending && pending_length)
+            return 1; /* errno = ENOMEM guaranteed */
+    }
+
+    size_t file_end = log_file->size - pending_length;
+    int    ret      = 0;
+    if (span.start < file_end) {
+        size_t length = (span.end < file_end ? span.end : file_end) - span.start;
+        ret           = __log_file_copy_bytes(log_file->fd, span.start, length, out);
+    }
+
+    if (!ret && span.end > file_end) {
+        size_t         start = span.start > file_end ? span.start : file_end;
+        const uint8_t *bytes = pending + (start - file_end);
+        for (size_t written = 0; written < span.end - start;) {
+            ssize_t w = write(out, bytes + written, span.end - start - written);
+            if (w < 0 && errno != EINTR) {
+                ret = 1;
                 break;
+            } else if (w > 0) {
+                written += w;
+            }
         }
     }
 
-    (void) lseek(log_file->fd, 0, SEEK_END);
-    return bytes_read != 0;
+    int errno2 = errno;
+    free(pending);
+    errno = errno2;
+    return ret;
 }
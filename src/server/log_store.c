@@ -0,0 +1,1242 @@
+/*
+ * Copyright 2024 Humberto Gomes, José Lopes, José Matos
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+/**
+ * @file  server/log_store.c
+ * @brief Implementation of methods in server/log_store.h
+ */
+
+#include <dirent.h>
+#include <errno.h>
+#include <fcntl.h>
+#include <inttypes.h>
+#include <limits.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+#include "server/log_store.h"
+#include "util.h"
+
+/** @brief Initial number of elements in log_store::segments. */
+#define LOG_STORE_INITIAL_CAPACITY 16
+
+/** @brief Number of summaries read at once from the summary file. */
+#define LOG_STORE_SUMMARY_BUFFER_COUNT 64
+
+/** @brief Number of identifiers whose records are located at once by ::log_store_lookup_records. */
+#define LOG_STORE_LOOKUP_CHUNK 256
+
+/**
+ * @struct log_store_segment_t
+ * @brief  Information kept in memory about a segment.
+ *
+ * @var log_store_segment_t::sequence
+ *     @brief Number of the segment, that determines its file name. Grows with every new segment.
+ * @var log_store_segment_t::first_id
+ *     @brief Lowest identifier of a task in the segment (`UINT32_MAX` for empty segments).
+ * @var log_store_segment_t::last_id
+ *     @brief Highest identifier of a task in the segment (`0` for empty segments).
+ * @var log_store_segment_t::size
+ *     @brief Size of the segment's file in bytes.
+ * @var log_store_segment_t::index
+ *     @brief   Index of task identifiers of the segment, mapped from its file.
+ *     @details `NULL` for log_store::active (see log_store::index), empty segments and segments
+ *              whose index couldn't be written.
+ */
+typedef struct {
+    uint64_t  sequence;
+    uint32_t  first_id, last_id;
+    size_t    size;
+    uint64_t *index;
+} log_store_segment_t;
+
+/**
+ * @struct log_store
+ * @brief  A segmented log of completed tasks.
+ *
+ * @var log_store::directory
+ *     @brief Directory where segments are stored (`log` in the server's directory).
+ * @var log_store::options
+ *     @brief Configuration of the store.
+ * @var log_store::segments
+ *     @brief Segments that weren't compacted, from the oldest to the newest (log_store::active).
+ * @var log_store::segment_count
+ *     @brief Number of elements in log_store::segments.
+ * @var log_store::segment_capacity
+ *     @brief Number of elements log_store::segments can hold before being reallocated.
+ * @var log_store::active
+ *     @brief Log file of the last segment in log_store::segments, the one written to.
+ * @var log_store::previous
+ *     @brief   Log file of the segment before log_store::active, if this store wrote to it.
+ *     @details Kept open while its tasks reach the disk in the background (see
+ *              ::log_file_stop_writing), and used to read from that segment in the meantime.
+ * @var log_store::active_created
+ *     @brief When log_store::active was created.
+ * @var log_store::next_id
+ *     @brief See ::log_store_get_next_id.
+ * @var log_store::old_size
+ *     @brief Total size of all segments except log_store::active.
+ * @var log_store::index
+ *     @brief   Index of task identifiers of log_store::active.
+ *     @details The index of a segment is a dense array, where the element at position `i` is the
+ *              log_file_record_t::offset `+ 1` of the task with identifier
+ *              log_store_segment_t::first_id `+ i`, or `0` for identifiers not in the segment (the
+ *              first record of a segment may be at offset `0`). Once a segment stops being written
+ *              to, its index is written to `log/<first_id>.idx` (see ::__log_store_write_index).
+ * @var log_store::index_capacity
+ *     @brief Number of elements log_store::index can hold before being reallocated.
+ */
+struct log_store {
+    char               *directory;
+    log_store_options_t options;
+
+    log_store_segment_t *segments;
+    size_t               segment_count, segment_capacity;
+
+    log_file_t *active, *previous;
+    time_t      active_created;
+    uint32_t    next_id;
+    size_t      old_size;
+
+    uint64_t *index;
+    size_t    index_capacity;
+};
+
+/**
+ * @brief  Gets the path of a segment.
+ * @param  store    Log store. Mustn't be `NULL` (unchecked).
+ * @param  sequence See log_store_segment_t::sequence.
+ * @param  out      Where to write the path to. Mustn't be `NULL` (unchecked).
+ * @retval 0 Success.
+ * @retval 1 Path too long (`errno = ENAMETOOLONG`).
+ */
+int __log_store_get_segment_path(const log_store_t *store, uint64_t sequence, char out[PATH_MAX]) {
+    if (snprintf(out, PATH_MAX, "%s/%016" PRIu64 ".log", store->directory, sequence) >= PATH_MAX) {
+        errno = ENAMETOOLONG;
+        return 1;
+    }
+    return 0;
+}
+
+/**
+ * @brief  Gets the path of the file with the summaries of compacted segments.
+ * @param  store Log store. Mustn't be `NULL` (unchecked).
+ * @param  out   Where to write the path to. Mustn't be `NULL` (unchecked).
+ * @retval 0 Success.
+ * @retval 1 Path too long (`errno = ENAMETOOLONG`).
+ */
+int __log_store_get_summaries_path(const log_store_t *store, char out[PATH_MAX]) {
+    if (snprintf(out, PATH_MAX, "%s/summaries.bin", store->directory) >= PATH_MAX) {
+        errno = ENAMETOOLONG;
+        return 1;
+    }
+    return 0;
+}
+
+/**
+ * @brief  Gets the path of the index of task identifiers of a segment.
+ * @param  store   Log store. Mustn't be `NULL` (unchecked).
+ * @param  segment Segment, that mustn't be empty. Mustn't be `NULL` (unchecked).
+ * @param  out     Where to write the path to. Mustn't be `NULL` (unchecked).
+ * @retval 0 Success.
+ * @retval 1 Path too long (`errno = ENAMETOOLONG`).
+ */
+int __log_store_get_index_path(const log_store_t         *store,
+                               const log_store_segment_t *segment,
+                               char                       out[PATH_MAX]) {
+    if (snprintf(out, PATH_MAX, "%s/%010" PRIu32 ".idx", store->directory, segment->first_id) >=
+        PATH_MAX) {
+        errno = ENAMETOOLONG;
+        return 1;
+    }
+    return 0;
+}
+
+/**
+ * @brief  Gets the number of elements in the index of task identifiers of a segment.
+ * @param  segment Segment. Mustn't be `NULL` (unchecked).
+ * @return The length of the range of identifiers in @p segment, `0` if it's empty.
+ */
+size_t __log_store_get_index_length(const log_store_segment_t *segment) {
+    if (segment->first_id > segment->last_id)
+        return 0;
+    return (size_t) segment->last_id - segment->first_id + 1;
+}
+
+/**
+ * @brief  Grows log_store::index, if needed, for a task to be added to a segment.
+ * @param  store   Log store. Mustn't be `NULL` (unchecked).
+ * @param  segment Segment whose index is log_store::index. Mustn't be `NULL` (unchecked).
+ * @param  id      Identifier of the task.
+ * @retval 0 Success.
+ * @retval 1 Allocation failure (`errno = ENOMEM`).
+ */
+int __log_store_reserve_index(log_store_t *store, const log_store_segment_t *segment, uint32_t id) {
+    uint32_t first_id = id < segment->first_id ? id : segment->first_id;
+    uint32_t last_id  = id > segment->last_id ? id : segment->last_id;
+    size_t   length   = (size_t) last_id - first_id + 1;
+    if (length <= store->index_capacity)
+        return 0;
+
+    size_t new_capacity = store->index_capacity * 2;
+    if (new_capacity < length)
+        new_capacity = length;
+
+    uint64_t *new_index = realloc(store->index, new_capacity * sizeof(uint64_t));
+    if (!new_index)
+        return 1; /* errno = ENOMEM guaranteed */
+
+    store->index          = new_index;
+    store->index_capacity = new_capacity;
+    return 0;
+}
+
+/**
+ * @brief   Adds a record to log_store::index, before @p segment's range of identifiers is updated.
+ * @details log_store::index grows at either end, as tasks aren't logged in identifier order. Space
+ *          must have been reserved with ::__log_store_reserve_index.
+ *
+ * @param store   Log store. Mustn't be `NULL` (unchecked).
+ * @param segment Segment the record is in, whose index is log_store::index. Mustn't be `NULL`
+ *                (unchecked).
+ * @param record  Record to be indexed. Mustn't be `NULL` (unchecked).
+ */
+void __log_store_index_record(log_store_t               *store,
+                              const log_store_segment_t *segment,
+                              const log_file_record_t   *record) {
+    size_t   old_length = __log_store_get_index_length(segment);
+    uint32_t first_id   = record->id < segment->first_id ? record->id : segment->first_id;
+    uint32_t last_id    = record->id > segment->last_id ? record->id : segment->last_id;
+    size_t   length     = (size_t) last_id - first_id + 1;
+    size_t   shift      = old_length ? segment->first_id - first_id : 0;
+
+    memmove(store->index + shift, store->index, old_length * sizeof(uint64_t));
+    memset(store->index, 0, shift * sizeof(uint64_t));
+    memset(store->index + shift + old_length,
+           0,
+           (length - shift - old_length) * sizeof(uint64_t));
+    store->index[record->id - first_id] = record->offset + 1;
+}
+
+/**
+ * @brief   Writes log_store::index to the index file of a segment, and maps that file to memory.
+ * @details The file isn't synchronized to the disk, so it may be lost or stale after a crash. As
+ *          indexes are rebuilt when the server restarts, that doesn't outlive the crash. Empty
+ *          segments have no index. log_store::index can be reused afterwards.
+ *
+ * @param store   Log store. Mustn't be `NULL` (unchecked).
+ * @param segment Segment whose index is log_store::index. Mustn't be `NULL` (unchecked).
+ *
+ * @retval 0 Success.
+ * @retval 1 Failure (check `errno`, see `man 2 open`, `man 2 write` and `man 2 mmap`).
+ */
+int __log_store_write_index(log_store_t *store, log_store_segment_t *segment) {
+    size_t length = __log_store_get_index_length(segment) * sizeof(uint64_t);
+    if (!length)
+        return 0;
+
+    char path[PATH_MAX];
+    if (__log_store_get_index_path(store, segment, path))
+        return 1; /* errno = ENAMETOOLONG guaranteed */
+
+    int fd = open(path, O_RDWR | O_CREAT | O_TRUNC, 0640);
+    if (fd < 0)
+        return 1; /* Keep errno */
+
+    ssize_t written = write(fd, store->index, length);
+    if (written == (ssize_t) length) {
+        void *index = mmap(NULL, length, PROT_READ, MAP_SHARED, fd, 0);
+        if (index != MAP_FAILED)
+            segment->index = index;
+    } else if (written >= 0) {
+        errno = EIO; /* No space left, but errno wasn't set */
+    }
+
+    int errno2 = errno;
+    (void) close(fd); /* The mapping stays valid */
+    if (!segment->index) {
+        (void) unlink(path);
+        errno = errno2;
+        return 1;
+    }
+    return 0;
+}
+
+/**
+ * @brief Unmaps the index of task identifiers of a segment, if it was mapped.
+ * @param segment Segment. Mustn't be `NULL` (unchecked).
+ */
+void __log_store_unmap_index(log_store_segment_t *segment) {
+    if (segment->index)
+        (void) munmap(segment->index, __log_store_get_index_length(segment) * sizeof(uint64_t));
+    segment->index = NULL;
+}
+
+/**
+ * @brief  Adds a new empty segment to the end of log_store::segments.
+ * @param  store    Log store. Mustn't be `NULL` (unchecked).
+ * @param  sequence See log_store_segment_t::sequence.
+ * @return The new segment on success, `NULL` on failure (`errno = ENOMEM`).
+ */
+log_store_segment_t *__log_store_add_segment(log_store_t *store, uint64_t sequence) {
+    if (store->segment_count == store->segment_capacity) {
+        size_t               new_capacity = store->segment_capacity * 2;
+        log_store_segment_t *new_segments =
+            realloc(store->segments, new_capacity * sizeof(log_store_segment_t));
+        if (!new_segments)
+            return NULL; /* errno = ENOMEM guaranteed */
+
+        store->segments         = new_segments;
+        store->segment_capacity = new_capacity;
+    }
+
+    log_store_segment_t *segment = store->segments + store->segment_count++;
+    segment->sequence            = sequence;
+    segment->first_id            = UINT32_MAX;
+    segment->last_id             = 0;
+    segment->size                = 0;
+    segment->index               = NULL;
+    return segment;
+}
+
+/**
+ * @brief Updates the range of identifiers of a segment to include a task.
+ * @param segment Segment the task is in. Mustn't be `NULL` (unchecked).
+ * @param id      Identifier of the task.
+ */
+void __log_store_segment_add_id(log_store_segment_t *segment, uint32_t id) {
+    if (id < segment->first_id)
+        segment->first_id = id;
+    if (id > segment->last_id)
+        segment->last_id = id;
+}
+
+/**
+ * @struct log_store_scan_t
+ * @brief  State of ::__log_store_scan_record.
+ *
+ * @var log_store_scan_t::store
+ *     @brief Log store the segment belongs to.
+ * @var log_store_scan_t::segment
+ *     @brief Segment being read.
+ */
+typedef struct {
+    log_store_t         *store;
+    log_store_segment_t *segment;
+} log_store_scan_t;
+
+/**
+ * @brief   Callback for ::log_file_read_records that finds the range of identifiers in a segment.
+ * @details Records are also added to log_store::index, to rebuild the index of the segment.
+ *
+ * @param record    Record in the segment. Mustn't be `NULL` (unchecked).
+ * @param scan_data A ::log_store_scan_t. Mustn't be `NULL` (unchecked).
+ *
+ * @retval 0 Success.
+ * @retval 1 Allocation failure (`errno = ENOMEM`).
+ */
+int __log_store_scan_record(const log_file_record_t *record, void *scan_data) {
+    log_store_scan_t *scan = scan_data;
+    if (__log_store_reserve_index(scan->store, scan->segment, record->id))
+        return 1; /* errno = ENOMEM guaranteed */
+
+    __log_store_index_record(scan->store, scan->segment, record);
+    __log_store_segment_add_id(scan->segment, record->id);
+    return 0;
+}
+
+/**
+ * @brief   Reads a segment that already exists, to fill in its information and rebuild its index.
+ * @details Errors are printed to `stderr`, and the segment is considered to be empty or to end
+ *          at the first invalid record. Segments without an index can still be read, but not
+ *          through ::log_store_lookup_records.
+ *
+ * @param store   Log store. Mustn't be `NULL` (unchecked).
+ * @param segment Segment to be read. Mustn't be `NULL` (unchecked).
+ */
+void __log_store_scan_segment(log_store_t *store, log_store_segment_t *segment) {
+    char path[PATH_MAX];
+    if (__log_store_get_segment_path(store, segment->sequence, path))
+        return;
+
+    log_file_t *log_file = log_file_new(path, 0, LOG_WRITER_DURABILITY_NONE);
+    if (!log_file) {
+        util_error("%s(): failed to open %s: %s\n", __func__, path, strerror(errno));
+        return;
+    }
+
+    log_store_scan_t scan = {.store = store, .segment = segment};
+    segment->size         = log_file_get_size(log_file);
+    if (log_file_read_records(log_file, __log_store_scan_record, &scan))
+        util_error("%s(): failed to read %s: %s\n", __func__, path, strerror(errno));
+    log_file_free(log_file);
+
+    if (__log_store_write_index(store, segment))
+        util_error("%s(): failed to index %s: %s\n", __func__, path, strerror(errno));
+}
+
+/**
+ * @brief Compares the sequence numbers of two ::log_store_segment_t, for `qsort()`.
+ *
+ * @param a First segment.
+ * @param b Second segment.
+ *
+ * @return A negative number, `0` or a positive number, if @p a comes before, in the same place or
+ *         after @p b.
+ */
+int __log_store_compare_segments(const void *a, const void *b) {
+    uint64_t sequence_a = ((const log_store_segment_t *) a)->sequence;
+    uint64_t sequence_b = ((const log_store_segment_t *) b)->sequence;
+    return (sequence_a > sequence_b) - (sequence_a < sequence_b);
+}
+
+/**
+ * @brief   Finds the segments in the store's directory and sorts them.
+ * @details Other files in the directory are ignored.
+ *
+ * @param store Log store. Mustn't be `NULL` (unchecked).
+ *
+ * @retval 0 Success.
+ * @retval 1 Failure (check `errno`, see `man 3 opendir` and `man 3 readdir`).
+ */
+int __log_store_find_segments(log_store_t *store) {
+    DIR *dir = opendir(store->directory);
+    if (!dir)
+        return 1; /* Keep errno */
+
+    struct dirent *entry;
+    errno = 0;
+    while ((entry = readdir(dir))) {
+        char    *end;
+        uint64_t sequence = strtoull(entry->d_name, &end, 10);
+        if (end - entry->d_name != 16 || strcmp(end, ".log") != 0)
+            continue;
+
+        if (!__log_store_add_segment(store, sequence)) {
+            (void) closedir(dir);
+            return 1; /* errno = ENOMEM guaranteed */
+        }
+    }
+
+    int errno2 = errno;
+    (void) closedir(dir);
+    if (errno2) {
+        errno = errno2;
+        return 1;
+    }
+
+    qsort(store->segments,
+          store->segment_count,
+          sizeof(log_store_segment_t),
+          __log_store_compare_segments);
+    return 0;
+}
+
+/**
+ * @brief   Turns the `log.bin` file of older versions of the server into the first segment.
+ * @details Only done when there are no other segments. Errors are printed to `stderr`.
+ *
+ * @param store     Log store. Mustn't be `NULL` (unchecked).
+ * @param directory Directory of the server. Mustn't be `NULL` (unchecked).
+ */
+void __log_store_adopt_legacy_log(log_store_t *store, const char *directory) {
+    char legacy_path[PATH_MAX], segment_path[PATH_MAX];
+    if (store->segment_count ||
+        snprintf(legacy_path, PATH_MAX, "%s/log.bin", directory) >= PATH_MAX ||
+        __log_store_get_segment_path(store, 0, segment_path))
+        return;
+
+    if (rename(legacy_path, segment_path)) {
+        if (errno != ENOENT)
+            util_perror("__log_store_adopt_legacy_log(): failed to move log.bin");
+        return;
+    }
+
+    if (!__log_store_add_segment(store, 0))
+        util_perror("__log_store_adopt_legacy_log(): failed to add segment");
+}
+
+/**
+ * @brief Callback for ::log_store_read_summaries that finds the highest identifier in summaries.
+ *
+ * @param summary    Summary of a compacted segment. Mustn't be `NULL` (unchecked).
+ * @param store_data The ::log_store_t whose log_store::next_id is updated. Mustn't be `NULL`
+ *                   (unchecked).
+ *
+ * @retval 0 Always successful.
+ */
+int __log_store_scan_summary(const log_store_summary_t *summary, void *store_data) {
+    log_store_t *store = store_data;
+    if (summary->last_id >= store->next_id)
+        store->next_id = summary->last_id + 1;
+    return 0;
+}
+
+/**
+ * @brief   Starts a new segment, that becomes the one written to.
+ * @details The previous log_store::active becomes log_store::previous, and its tasks reach the disk
+ *          in the background. The old log_store::previous is closed, which only waits if its tasks
+ *          still haven't reached the disk (unlikely, as a whole segment was written since). The
+ *          index of the previous segment is written to its file (see ::__log_store_write_index).
+ *
+ * @param store Log store. Mustn't be `NULL` (unchecked).
+ *
+ * @retval 0 Success.
+ * @retval 1 Failure (check `errno`, see ::log_file_new).
+ */
+int __log_store_start_segment(log_store_t *store) {
+    uint64_t sequence =
+        store->segment_count ? store->segments[store->segment_count - 1].sequence + 1 : 0;
+
+    char path[PATH_MAX];
+    if (__log_store_get_segment_path(store, sequence, path))
+        return 1; /* errno = ENAMETOOLONG guaranteed */
+
+    log_file_t *log_file = log_file_new(path, 1, store->options.durability);
+    if (!log_file)
+        return 1; /* Keep errno */
+
+    log_store_segment_t *segment = __log_store_add_segment(store, sequence);
+    if (!segment) {
+        log_file_free(log_file);
+        (void) unlink(path);
+        errno = ENOMEM;
+        return 1;
+    }
+    segment->size = log_file_get_size(log_file);
+
+    if (store->active) {
+        if (__log_store_write_index(store, segment - 1))
+            util_perror("__log_store_start_segment(): failed to write index");
+
+        store->old_size += log_file_get_size(store->active);
+        log_file_free(store->previous);
+        store->previous = store->active;
+        log_file_stop_writing(store->previous);
+    }
+    store->active         = log_file;
+    store->active_created = time(NULL);
+    return 0;
+}
+
+/**
+ * @brief  Calculates the time between two instants of a task, in nanoseconds.
+ * @param  start Start of the interval. Mustn't be `NULL` (unchecked).
+ * @param  end   End of the interval. Mustn't be `NULL` (unchecked).
+ * @return The length of the interval, or `0` if any of the instants wasn't set.
+ */
+uint64_t __log_store_time_difference(const struct timespec *start, const struct timespec *end) {
+    if ((!start->tv_sec && !start->tv_nsec) || (!end->tv_sec && !end->tv_nsec))
+        return 0;
+    return (end->tv_sec - start->tv_sec) * 1000000000 + (end->tv_nsec - start->tv_nsec);
+}
+
+/**
+ * @brief Callback for ::log_file_read_records that adds a task to the summary of a segment.
+ *
+ * @param record       Record in the segment. Mustn't be `NULL` (unchecked).
+ * @param summary_data The ::log_store_summary_t being computed. Mustn't be `NULL` (unchecked).
+ *
+ * @retval 0 Always successful.
+ */
+int __log_store_summarize_record(const log_file_record_t *record, void *summary_data) {
+    log_store_summary_t   *summary = summary_data;
+    const struct timespec *times   = record->times;
+
+    summary->task_count++;
+    summary->error_count += record->error != 0;
+    summary->waiting_time += __log_store_time_difference(times + TAGGED_TASK_TIME_ARRIVED,
+                                                         times + TAGGED_TASK_TIME_DISPATCHED);
+    summary->executing_time += __log_store_time_difference(times + TAGGED_TASK_TIME_DISPATCHED,
+                                                           times + TAGGED_TASK_TIME_ENDED);
+    return 0;
+}
+
+/**
+ * @brief Callback for ::log_store_read_summaries that merges summaries into one.
+ *
+ * @param summary     Summary of a compacted segment. Mustn't be `NULL` (unchecked).
+ * @param merged_data The ::log_store_summary_t the summary is merged into. Mustn't be `NULL`
+ *                    (unchecked).
+ *
+ * @retval 0 Always successful.
+ */
+int __log_store_merge_summary(const log_store_summary_t *summary, void *merged_data) {
+    log_store_summary_t *merged = merged_data;
+    if (summary->first_id < merged->first_id)
+        merged->first_id = summary->first_id;
+    if (summary->last_id > merged->last_id)
+        merged->last_id = summary->last_id;
+    merged->task_count += summary->task_count;
+    merged->error_count += summary->error_count;
+    merged->waiting_time += summary->waiting_time;
+    merged->executing_time += summary->executing_time;
+    return 0;
+}
+
+/**
+ * @brief   Opens and locks the summary file, for a summary to be added to it.
+ * @details The lock keeps concurrent compactions from losing each other's summaries. As merging
+ *          summaries replaces the file, the file is opened again if it was replaced while waiting
+ *          for the lock.
+ *
+ * @param path Path of the summary file. Mustn't be `NULL` (unchecked).
+ *
+ * @return A file descriptor of the locked file, or `-1` on failure (check `errno`, see
+ *         `man 2 open`, `man 2 fcntl` and `man 2 stat`).
+ */
+int __log_store_lock_summaries(const char *path) {
+    while (1) {
+        int fd = open(path, O_WRONLY | O_CREAT | O_APPEND, 0640);
+        if (fd < 0)
+            return -1; /* Keep errno */
+
+        struct flock lock = {.l_type = F_WRLCK, .l_whence = SEEK_SET, .l_start = 0, .l_len = 0};
+        struct stat  fd_stat, path_stat;
+        if (fcntl(fd, F_SETLKW, &lock) || fstat(fd, &fd_stat)) {
+            int errno2 = errno;
+            (void) close(fd);
+            errno = errno2;
+            return -1;
+        }
+
+        if (!stat(path, &path_stat) && path_stat.st_dev == fd_stat.st_dev &&
+            path_stat.st_ino == fd_stat.st_ino)
+            return fd;
+        (void) close(fd); /* Replaced while waiting */
+    }
+}
+
+/**
+ * @brief   Replaces the summary file with a single summary, merging all summaries in it.
+ * @details The summary file must be locked (see ::__log_store_lock_summaries).
+ *
+ * @param store   Log store. Mustn't be `NULL` (unchecked).
+ * @param path    Path of the summary file. Mustn't be `NULL` (unchecked).
+ * @param summary Summary to be merged with the ones in the file. Mustn't be `NULL` (unchecked).
+ *
+ * @retval 0 Success.
+ * @retval 1 Failure (check `errno`).
+ */
+int __log_store_replace_summaries(log_store_t               *store,
+                                  const char                *path,
+                                  const log_store_summary_t *summary) {
+    char temporary_path[PATH_MAX];
+    if (snprintf(temporary_path, PATH_MAX, "%s.tmp", path) >= PATH_MAX) {
+        errno = ENAMETOOLONG;
+        return 1;
+    }
+
+    log_store_summary_t merged = *summary;
+    if (log_store_read_summaries(store, __log_store_merge_summary, &merged))
+        return 1; /* Keep errno */
+
+    int fd = open(temporary_path, O_WRONLY | O_CREAT | O_TRUNC, 0640);
+    if (fd < 0)
+        return 1; /* Keep errno */
+
+    ssize_t written = write(fd, &merged, sizeof(merged));
+    int     errno2  = errno;
+    (void) close(fd);
+    if (written != sizeof(merged) || rename(temporary_path, path)) {
+        if (written == sizeof(merged))
+            errno2 = errno;
+        else if (written >= 0)
+            errno2 = EIO;
+
+        (void) unlink(temporary_path);
+        errno = errno2;
+        return 1;
+    }
+    return 0;
+}
+
+/**
+ * @brief   Adds the summary of a compacted segment to the summary file.
+ * @details Once the file has ::LOG_STORE_MAXIMUM_SUMMARIES summaries, they're all merged with the
+ *          new one, so that the file doesn't grow forever.
+ *
+ * @param store   Log store. Mustn't be `NULL` (unchecked).
+ * @param summary Summary to be added. Mustn't be `NULL` (unchecked).
+ *
+ * @retval 0 Success.
+ * @retval 1 Failure (check `errno`).
+ */
+int __log_store_add_summary(log_store_t *store, const log_store_summary_t *summary) {
+    char path[PATH_MAX];
+    if (__log_store_get_summaries_path(store, path))
+        return 1; /* errno = ENAMETOOLONG guaranteed */
+
+    int fd = __log_store_lock_summaries(path);
+    if (fd < 0)
+        return 1; /* Keep errno */
+
+    int         ret;
+    struct stat statbuf;
+    if (fstat(fd, &statbuf)) {
+        ret = 1; /* Keep errno */
+    } else if ((size_t) statbuf.st_size >=
+               LOG_STORE_MAXIMUM_SUMMARIES * sizeof(log_store_summary_t)) {
+        ret = __log_store_replace_summaries(store, path, summary);
+    } else {
+        ssize_t written = write(fd, summary, sizeof(log_store_summary_t));
+        ret             = written != sizeof(log_store_summary_t);
+        if (ret && written >= 0)
+            errno = EIO;
+    }
+
+    int errno2 = errno;
+    (void) close(fd); /* Releases the lock */
+    errno = errno2;
+    return ret;
+}
+
+/**
+ * @brief   Compacts a segment, replacing it with its summary, and deletes its index.
+ * @details The segment is left in log_store::segments.
+ *
+ * @param store   Log store. Mustn't be `NULL` (unchecked).
+ * @param segment Segment to be compacted. Mustn't be `NULL` (unchecked).
+ *
+ * @retval 0 Success.
+ * @retval 1 Failure (check `errno`).
+ */
+int __log_store_compact_segment(log_store_t *store, const log_store_segment_t *segment) {
+    log_store_summary_t summary = {.first_id = segment->first_id, .last_id = segment->last_id};
+
+    char segment_path[PATH_MAX];
+    if (__log_store_get_segment_path(store, segment->sequence, segment_path))
+        return 1; /* errno = ENAMETOOLONG guaranteed */
+
+    log_file_t *log_file = log_file_new(segment_path, 0, LOG_WRITER_DURABILITY_NONE);
+    if (log_file) {
+        if (log_file_read_records(log_file, __log_store_summarize_record, &summary))
+            util_perror("__log_store_compact_segment(): segment partially summarized");
+        log_file_free(log_file);
+    } else if (errno != ENOENT) {
+        return 1; /* Keep errno */
+    }
+
+    if (summary.task_count && __log_store_add_summary(store, &summary))
+        return 1; /* Keep errno */
+
+    /* Without the segment, an index would never be deleted. The opposite is rebuilt on restart */
+    char index_path[PATH_MAX];
+    if (__log_store_get_index_length(segment) &&
+        (__log_store_get_index_path(store, segment, index_path) ||
+         (unlink(index_path) && errno != ENOENT)))
+        return 1; /* Keep errno */
+
+    if (unlink(segment_path) && errno != ENOENT)
+        return 1; /* Keep errno */
+    return 0;
+}
+
+log_store_t *log_store_new(const char *directory, const log_store_options_t *options) {
+    if (!directory || !options || !options->segment_size || options->segment_age < 0) {
+        errno = EINVAL;
+        return NULL;
+    }
+
+    log_store_t *store = malloc(sizeof(log_store_t));
+    if (!store)
+        return NULL; /* errno = ENOMEM guaranteed */
+
+    char path[PATH_MAX];
+    if (snprintf(path, PATH_MAX, "%s/log", directory) >= PATH_MAX) {
+        free(store);
+        errno = ENAMETOOLONG;
+        return NULL;
+    }
+
+    store->options          = *options;
+    store->directory        = strdup(path);
+    store->segments         = malloc(LOG_STORE_INITIAL_CAPACITY * sizeof(log_store_segment_t));
+    store->segment_count    = 0;
+    store->segment_capacity = LOG_STORE_INITIAL_CAPACITY;
+    store->active           = NULL;
+    store->previous         = NULL;
+    store->next_id          = 1;
+    store->old_size         = 0;
+    store->index            = NULL;
+    store->index_capacity   = 0;
+    if (!store->directory || !store->segments) {
+        log_store_free(store);
+        errno = ENOMEM;
+        return NULL;
+    }
+
+    if ((mkdir(store->directory, 0700) && errno != EEXIST) || __log_store_find_segments(store)) {
+        log_store_free(store);
+        return NULL; /* Keep errno */
+    }
+    __log_store_adopt_legacy_log(store, directory);
+
+    for (size_t i = 0; i < store->segment_count; ++i) {
+        log_store_segment_t *segment = store->segments + i;
+        __log_store_scan_segment(store, segment);
+        store->old_size += segment->size;
+        if (segment->first_id <= segment->last_id && segment->last_id >= store->next_id)
+            store->next_id = segment->last_id + 1;
+    }
+    (void) log_store_read_summaries(store, __log_store_scan_summary, store);
+
+    if (__log_store_start_segment(store)) {
+        log_store_free(store);
+        return NULL; /* Keep errno */
+    }
+    return store;
+}
+
+void log_store_free(log_store_t *store) {
+    if (!store)
+        return; /* Don't set errno, as that's not typical free() behavior */
+
+    log_file_free(store->active);
+    log_file_free(store->previous);
+    for (size_t i = 0; i < store->segment_count; ++i)
+        __log_store_unmap_index(store->segments + i);
+    free(store->segments);
+    free(store->index);
+    free(store->directory);
+    free(store);
+}
+
+uint32_t log_store_get_next_id(const log_store_t *store) {
+    if (!store) {
+        errno = EINVAL;
+        return 0;
+    }
+    return store->next_id;
+}
+
+/**
+ * @brief  Checks if a new segment should be started before writing a task.
+ * @param  store Log store. Mustn't be `NULL` (unchecked).
+ * @retval 0 Keep writing to log_store::active.
+ * @retval 1 Start a new segment.
+ */
+int __log_store_should_roll_over(const log_store_t *store) {
+    const log_store_segment_t *active = store->segments + store->segment_count - 1;
+    if (active->first_id > active->last_id)
+        return 0; /* Empty segment */
+
+    return active->size >= store->options.segment_size ||
+           (store->options.segment_age &&
+            time(NULL) - store->active_created >= store->options.segment_age);
+}
+
+int log_store_write_task(log_store_t *store, const tagged_task_t *task, int error) {
+    if (!store || !task) {
+        errno = EINVAL;
+        return 1;
+    }
+
+    if (__log_store_should_roll_over(store) && __log_store_start_segment(store))
+        util_perror("log_store_write_task(): failed to start new segment");
+
+    log_store_segment_t *segment = store->segments + store->segment_count - 1;
+    log_file_record_t    record  = {.id = tagged_task_get_id(task), .offset = segment->size};
+    if (__log_store_reserve_index(store, segment, record.id) ||
+        log_file_write_task(store->active, task, error))
+        return 1; /* Keep errno */
+
+    __log_store_index_record(store, segment, &record);
+    uint32_t id   = record.id;
+    segment->size = log_file_get_size(store->active);
+    __log_store_segment_add_id(segment, id);
+    if (id >= store->next_id)
+        store->next_id = id + 1;
+    return 0;
+}
+
+/**
+ * @brief  Gets the number of segments, from the oldest, that may be compacted.
+ * @param  store Log store. Mustn't be `NULL` (unchecked).
+ * @return All segments except log_store::active and log_store::previous.
+ */
+size_t __log_store_get_closed_segment_count(const log_store_t *store) {
+    size_t open_count = 1 + (store->previous != NULL);
+    return store->segment_count > open_count ? store->segment_count - open_count : 0;
+}
+
+size_t log_store_get_compactable(const log_store_t *store) {
+    if (!store) {
+        errno = EINVAL;
+        return 0;
+    }
+
+    size_t size = store->old_size, count = 0, closed = __log_store_get_closed_segment_count(store);
+    while (store->options.maximum_size && size > store->options.maximum_size && count < closed)
+        size -= store->segments[count++].size;
+    return count;
+}
+
+int log_store_compact(log_store_t *store, size_t count) {
+    if (!store || count > __log_store_get_closed_segment_count(store)) {
+        errno = EINVAL;
+        return 1;
+    }
+
+    for (size_t i = 0; i < count; ++i)
+        if (__log_store_compact_segment(store, store->segments + i))
+            return 1; /* Keep errno */
+    return 0;
+}
+
+void log_store_forget_segments(log_store_t *store, size_t count) {
+    if (!store || count > __log_store_get_closed_segment_count(store))
+        return;
+
+    for (size_t i = 0; i < count; ++i) {
+        store->old_size -= store->segments[i].size;
+        __log_store_unmap_index(store->segments + i);
+    }
+    store->segment_count -= count;
+    memmove(store->segments,
+            store->segments + count,
+            store->segment_count * sizeof(log_store_segment_t));
+}
+
+/**
+ * @struct log_store_filter_t
+ * @brief  State of ::__log_store_filter_record, used by ::log_store_read_records.
+ *
+ * @var log_store_filter_t::first_id
+ *     @brief Lowest identifier of the records to output.
+ * @var log_store_filter_t::last_id
+ *     @brief Highest identifier of the records to output.
+ * @var log_store_filter_t::record_cb
+ *     @brief Callback passed to ::log_store_read_records.
+ * @var log_store_filter_t::state
+ *     @brief State passed to ::log_store_read_records.
+ * @var log_store_filter_t::cb_ret
+ *     @brief Value returned by log_store_filter_t::record_cb, when it fails.
+ */
+typedef struct {
+    uint32_t                   first_id, last_id;
+    log_file_record_callback_t record_cb;
+    void                      *state;
+    int                        cb_ret;
+} log_store_filter_t;
+
+/**
+ * @brief  Gets the log file of a segment, if the store keeps it open.
+ * @param  store Log store. Mustn't be `NULL` (unchecked).
+ * @param  i     Index of the segment in log_store::segments.
+ * @return log_store::active, log_store::previous, or `NULL` for segments that must be opened.
+ */
+log_file_t *__log_store_get_open_segment(const log_store_t *store, size_t i) {
+    if (i == store->segment_count - 1)
+        return store->active;
+    else if (i == store->segment_count - 2)
+        return store->previous;
+    return NULL;
+}
+
+/**
+ * @brief  Opens a segment for reading.
+ * @param  store    Log store. Mustn't be `NULL` (unchecked).
+ * @param  sequence See log_store_segment_t::sequence.
+ * @return The log file on success, `NULL` on failure (check `errno`, see ::log_file_new).
+ */
+log_file_t *__log_store_open_segment(const log_store_t *store, uint64_t sequence) {
+    char path[PATH_MAX];
+    if (__log_store_get_segment_path(store, sequence, path))
+        return NULL; /* errno = ENAMETOOLONG guaranteed */
+    return log_file_new(path, 0, LOG_WRITER_DURABILITY_NONE);
+}
+
+/**
+ * @brief Callback for ::log_file_read_records that only outputs records in a range of identifiers.
+ *
+ * @param record      Record in a segment. Mustn't be `NULL` (unchecked).
+ * @param filter_data The ::log_store_filter_t. Mustn't be `NULL` (unchecked).
+ *
+ * @retval 0     Success.
+ * @retval other Value returned by log_store_filter_t::record_cb.
+ */
+int __log_store_filter_record(const log_file_record_t *record, void *filter_data) {
+    log_store_filter_t *filter = filter_data;
+    if (record->id < filter->first_id || record->id > filter->last_id)
+        return 0;
+
+    filter->cb_ret = filter->record_cb(record, filter->state);
+    return filter->cb_ret;
+}
+
+int log_store_read_records(log_store_t               *store,
+                           uint32_t                   first_id,
+                           uint32_t                   last_id,
+                           log_file_record_callback_t record_cb,
+                           void                      *state) {
+    if (!store || !record_cb) {
+        errno = EINVAL;
+        return 1;
+    }
+
+    log_store_filter_t filter = {.first_id  = first_id,
+                                 .last_id   = last_id,
+                                 .record_cb = record_cb,
+                                 .state     = state,
+                                 .cb_ret    = 0};
+
+    for (size_t i = 0; i < store->segment_count; ++i) {
+        const log_store_segment_t *segment = store->segments + i;
+        if (segment->first_id > last_id || segment->last_id < first_id)
+            continue;
+
+        log_file_t *opened   = NULL;
+        log_file_t *log_file = __log_store_get_open_segment(store, i);
+        if (!log_file)
+            log_file = opened = __log_store_open_segment(store, segment->sequence);
+        if (!log_file) {
+            if (errno != ENOENT) /* Compacted after the caller's fork() */
+                util_perror("log_store_read_records(): failed to open segment");
+            continue;
+        }
+
+        int ret = log_file_read_records(log_file, __log_store_filter_record, &filter);
+        log_file_free(opened);
+
+        if (filter.cb_ret)
+            return filter.cb_ret;
+        else if (ret)
+            util_perror("log_store_read_records(): failed to read segment");
+    }
+    return 0;
+}
+
+int log_store_export_records(log_store_t *store,
+                             uint32_t     first_id,
+                             uint32_t     last_id,
+                             int          out,
+                             size_t      *count) {
+    if (!store || !count) {
+        errno = EINVAL;
+        return 1;
+    }
+
+    *count = 0;
+    if (log_file_write_header(out))
+        return 1; /* Keep errno */
+
+    for (size_t i = 0; i < store->segment_count; ++i) {
+        const log_store_segment_t *segment = store->segments + i;
+        if (segment->first_id > last_id || segment->last_id < first_id)
+            continue;
+
+        log_file_t *opened   = NULL;
+        log_file_t *log_file = __log_store_get_open_segment(store, i);
+        if (!log_file)
+            log_file = opened = __log_store_open_segment(store, segment->sequence);
+        if (!log_file) {
+            if (errno == ENOENT) /* Compacted after the caller's fork() */
+                continue;
+            return 1; /* Keep errno */
+        }
+
+        size_t segment_count;
+        int    ret    = log_file_copy_records(log_file, first_id, last_id, out, &segment_count);
+        int    errno2 = errno;
+        log_file_free(opened);
+        errno = errno2;
+
+        if (ret)
+            return 1; /* Keep errno */
+        *count += segment_count;
+    }
+    return 0;
+}
+
+/**
+ * @brief   Locates the records of the tasks with identifiers in a range, through the segments'
+ *          indexes.
+ * @details Each segment is visited once, instead of once per identifier. As tasks aren't logged in
+ *          identifier order, the ranges of identifiers of segments overlap, so all of them must be
+ *          checked.
+ *
+ * @param store    Log store. Mustn't be `NULL` (unchecked).
+ * @param first_id Lowest identifier in the range.
+ * @param length   Number of identifiers in the range. Mustn't exceed ::LOG_STORE_LOOKUP_CHUNK.
+ * @param offsets  Where to write the log_file_record_t::offset `+ 1` of each task to, `0` for tasks
+ *                 not found (compacted, or in segments without an index). Mustn't be `NULL`
+ *                 (unchecked).
+ * @param segments Where to write the index in log_store::segments of the segment of each task to.
+ *                 Mustn't be `NULL` (unchecked).
+ */
+void __log_store_locate_records(const log_store_t *store,
+                                uint32_t           first_id,
+                                size_t             length,
+                                uint64_t          *offsets,
+                                size_t            *segments) {
+    memset(offsets, 0, length * sizeof(*offsets));
+    uint64_t last_id = (uint64_t) first_id + length - 1;
+
+    for (size_t i = 0; i < store->segment_count; ++i) {
+        const log_store_segment_t *segment = store->segments + i;
+        const uint64_t *index = i == store->segment_count - 1 ? store->index : segment->index;
+        if (!index || segment->first_id > last_id || segment->last_id < first_id)
+            continue;
+
+        uint32_t start = segment->first_id > first_id ? segment->first_id : first_id;
+        uint64_t end   = segment->last_id < last_id ? segment->last_id : last_id;
+        for (uint64_t id = start; id <= end; ++id) {
+            uint64_t offset = index[id - segment->first_id];
+            if (offset) {
+                offsets[id - first_id]  = offset;
+                segments[id - first_id] = i;
+            }
+        }
+    }
+}
+
+/**
+ * @struct log_store_lookup_t
+ * @brief  State of a ::log_store_lookup_records call.
+ *
+ * @var log_store_lookup_t::filter
+ *     @brief Filter with the identifier of the record being read and the caller's callback.
+ * @var log_store_lookup_t::log_file
+ *     @brief Last segment opened that the store doesn't keep open, kept open for the next records.
+ * @var log_store_lookup_t::sequence
+ *     @brief log_store_segment_t::sequence of log_store_lookup_t::log_file.
+ */
+typedef struct {
+    log_store_filter_t filter;
+    log_file_t        *log_file;
+    uint64_t           sequence;
+} log_store_lookup_t;
+
+/**
+ * @brief   Reads the record of a task, given its location.
+ * @details Segments compacted after the caller's `fork()` are silently skipped, as are stale index
+ *          entries (records lost in a crash). Other errors are printed to `stderr`.
+ *
+ * @param store  Log store. Mustn't be `NULL` (unchecked).
+ * @param i      Index of the segment with the record in log_store::segments.
+ * @param offset See log_file_record_t::offset.
+ * @param lookup State of the lookup. Mustn't be `NULL` (unchecked).
+ *
+ * @retval 0     Success (or ignored failure).
+ * @retval other Value returned by the caller's callback.
+ */
+int __log_store_lookup_record(log_store_t        *store,
+                              size_t              i,
+                              uint64_t            offset,
+                              log_store_lookup_t *lookup) {
+    log_file_t *log_file = __log_store_get_open_segment(store, i);
+    if (!log_file) {
+        uint64_t sequence = store->segments[i].sequence;
+        if (!lookup->log_file || lookup->sequence != sequence) {
+            log_file_free(lookup->log_file);
+            lookup->sequence = sequence;
+            lookup->log_file = __log_store_open_segment(store, sequence);
+            if (!lookup->log_file) {
+                if (errno != ENOENT) /* Compacted after the caller's fork() */
+                    util_perror("__log_store_lookup_record(): failed to open segment");
+                return 0;
+            }
+        }
+        log_file = lookup->log_file;
+    }
+
+    log_store_filter_t *filter = &lookup->filter;
+    if (log_file_read_record_at(log_file, offset, __log_store_filter_record, filter) &&
+        !filter->cb_ret && errno != EILSEQ)
+        util_perror("__log_store_lookup_record(): failed to read record");
+    return filter->cb_ret;
+}
+
+int log_store_lookup_records(log_store_t               *store,
+                             uint32_t                   first_id,
+                             uint32_t                   last_id,
+                             log_file_record_callback_t record_cb,
+                             void                      *state) {
+    if (!store || !record_cb) {
+        errno = EINVAL;
+        return 1;
+    }
+
+    if (last_id >= store->next_id)
+        last_id = store->next_id - 1;
+
+    log_store_lookup_t lookup = {.filter   = {.record_cb = record_cb, .state = state, .cb_ret = 0},
+                                 .log_file = NULL,
+                                 .sequence = 0};
+
+    uint64_t offsets[LOG_STORE_LOOKUP_CHUNK];
+    size_t   segments[LOG_STORE_LOOKUP_CHUNK];
+    int      ret = 0;
+    for (uint64_t chunk = first_id; !ret && chunk <= last_id; chunk += LOG_STORE_LOOKUP_CHUNK) {
+        size_t length = last_id - chunk + 1;
+        if (length > LOG_STORE_LOOKUP_CHUNK)
+            length = LOG_STORE_LOOKUP_CHUNK;
+        __log_store_locate_records(store, chunk, length, offsets, segments);
+
+        for (size_t i = 0; !ret && i < length; ++i) {
+            if (!offsets[i])
+                continue;
+            lookup.filter.first_id = lookup.filter.last_id = chunk + i;
+            ret = __log_store_lookup_record(store, segments[i], offsets[i] - 1, &lookup);
+        }
+    }
+
+    log_file_free(lookup.log_file);
+    return ret;
+}
+
+int log_store_read_summaries(log_store_t                 *store,
+                             log_store_summary_callback_t summary_cb,
+                             void                        *state) {
+    if (!store || !summary_cb) {
+        errno = EINVAL;
+        return 1;
+    }
+
+    char path[PATH_MAX];
+    if (__log_store_get_summaries_path(store, path))
+        return 1; /* errno = ENAMETOOLONG guaranteed */
+
+    int fd = open(path, O_RDONLY);
+    if (fd < 0)
+        return errno != ENOENT; /* No segment was compacted yet */
+
+    log_store_summary_t summaries[LOG_STORE_SUMMARY_BUFFER_COUNT];
+    ssize_t             bytes_read;
+    int                 ret = 0;
+    while (!ret && (bytes_read = read(fd, summaries, sizeof(summaries))) > 0) {
+        if (bytes_read % sizeof(log_store_summary_t)) {
+            errno = EILSEQ;
+            ret   = 1;
+            break;
+        }
+
+        for (size_t i = 0; !ret && i < bytes_read / sizeof(log_store_summary_t); ++i)
+            ret = summary_cb(summaries + i, state);
+    }
+    if (!ret && bytes_read < 0)
+        ret = 1;
+
+    int errno2 = errno;
+    (void) close(fd);
+    errno = errno2;
+    return ret;
+}
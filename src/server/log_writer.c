@@ -0,0 +1,384 @@
+/*
+ * Copyright 2024 Humberto Gomes, José Lopes, José Matos
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+/**
+ * @file  server/log_writer.c
+ * @brief Implementation of methods in server/log_writer.h
+ */
+
+#include <errno.h>
+#include <pthread.h>
+#include <signal.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/uio.h>
+#include <time.h>
+#include <unistd.h>
+
+#include "server/log_writer.h"
+#include "util.h"
+
+/**
+ * @struct log_writer
+ * @brief  An asynchronous writer of records to a file.
+ *
+ * @var log_writer::fd
+ *     @brief File descriptor records are written to.
+ * @var log_writer::durability
+ *     @brief When written data is synchronized to the disk.
+ * @var log_writer::ring
+ *     @brief Ring buffer with ::LOG_WRITER_RING_SIZE bytes.
+ * @var log_writer::head
+ *     @brief   Total number of bytes ever appended to log_writer::ring.
+ *     @details Never wraps around, as it's only reduced modulo ::LOG_WRITER_RING_SIZE for indexing.
+ * @var log_writer::tail
+ *     @brief Total number of bytes ever written to the file (or dropped on write errors).
+ * @var log_writer::pending_records
+ *     @brief Number of records between log_writer::tail and log_writer::head.
+ * @var log_writer::written_records
+ *     @brief Number of records already in the file.
+ * @var log_writer::stopping
+ *     @brief Whether the thread should terminate once there are no pending records.
+ * @var log_writer::thread
+ *     @brief Thread that writes records to the file.
+ * @var log_writer::has_data
+ *     @brief Signaled when records are appended or log_writer::stopping is set.
+ * @var log_writer::has_space
+ *     @brief Signaled when records are removed from the ring buffer.
+ */
+struct log_writer {
+    int                     fd;
+    log_writer_durability_t durability;
+
+    uint8_t *ring;
+    size_t   head, tail, pending_records, written_records;
+    int      stopping;
+
+    pthread_t      thread;
+    pthread_cond_t has_data, has_space;
+};
+
+/**
+ * @brief   Mutex protecting the state of all writers.
+ * @details A single mutex is shared between all writers, so that it can be held across `fork()`
+ *          (see ::__log_writer_register_atfork) without keeping a list of writers.
+ */
+pthread_mutex_t __log_writer_mutex = PTHREAD_MUTEX_INITIALIZER;
+
+/** @brief Guarantees ::__log_writer_register_atfork is only called once. */
+pthread_once_t __log_writer_atfork_once = PTHREAD_ONCE_INIT;
+
+/** @brief Locks ::__log_writer_mutex. */
+void __log_writer_lock(void) {
+    (void) pthread_mutex_lock(&__log_writer_mutex);
+}
+
+/** @brief Unlocks ::__log_writer_mutex. */
+void __log_writer_unlock(void) {
+    (void) pthread_mutex_unlock(&__log_writer_mutex);
+}
+
+/**
+ * @brief   Makes `fork()` wait for writers to be in a consistent state.
+ * @details ::__log_writer_mutex is locked before `fork()` and unlocked in both processes after it.
+ *          This way, the child never copies a ring buffer that is being modified, and
+ *          ::log_writer_get_pending can be called in it.
+ */
+void __log_writer_register_atfork(void) {
+    if (pthread_atfork(__log_writer_lock, __log_writer_unlock, __log_writer_unlock))
+        util_error("%s(): pthread_atfork() failed\n", __func__);
+}
+
+/**
+ * @brief Writes bytes from the ring buffer of a writer to its file.
+ *
+ * @param writer Writer to write bytes from. Mustn't be `NULL` (unchecked).
+ * @param from   Value of log_writer::tail to start writing from.
+ * @param to     Value of log_writer::head to stop writing at.
+ *
+ * @retval 0 Success.
+ * @retval 1 Failure (check `errno`, see `man 2 writev`).
+ */
+int __log_writer_write(log_writer_t *writer, size_t from, size_t to) {
+    while (from != to) {
+        /* Write both sides of a wrap-around at once */
+        size_t start = from % LOG_WRITER_RING_SIZE;
+        size_t first = to - from;
+        if (first > LOG_WRITER_RING_SIZE - start)
+            first = LOG_WRITER_RING_SIZE - start;
+
+        struct iovec iov[2] = {
+            {.iov_base = writer->ring + start, .iov_len = first            },
+            {.iov_base = writer->ring,         .iov_len = to - from - first},
+        };
+
+        ssize_t written = writev(writer->fd, iov, iov[1].iov_len ? 2 : 1);
+        if (written < 0) {
+            if (errno == EINTR)
+                continue;
+            return 1;
+        }
+        from += written;
+    }
+    return 0;
+}
+
+/**
+ * @brief Waits for records to be appended to a writer, synchronizing the file if it's time to.
+ *
+ * @param writer Writer to wait on, whose mutex must be locked. Mustn't be `NULL` (unchecked).
+ * @param dirty  Whether data was written since the last synchronization. Mustn't be `NULL`
+ *               (unchecked).
+ * @param synced When the last synchronization took place. Mustn't be `NULL` (unchecked).
+ */
+void __log_writer_wait(log_writer_t *writer, int *dirty, struct timespec *synced) {
+    while (writer->head == writer->tail && !writer->stopping) {
+        if (!*dirty) {
+            (void) pthread_cond_wait(&writer->has_data, &__log_writer_mutex);
+            continue;
+        }
+
+        /* Wait for the next periodic synchronization */
+        struct timespec deadline = {.tv_sec  = synced->tv_sec + LOG_WRITER_SYNC_INTERVAL,
+                                    .tv_nsec = synced->tv_nsec};
+        if (pthread_cond_timedwait(&writer->has_data, &__log_writer_mutex, &deadline) ==
+            ETIMEDOUT) {
+            __log_writer_unlock();
+            if (fdatasync(writer->fd))
+                util_perror("log_writer: fdatasync()");
+            __log_writer_lock();
+
+            *dirty = 0;
+            (void) clock_gettime(CLOCK_REALTIME, synced);
+        }
+    }
+}
+
+/**
+ * @brief   Main function of the thread of a writer.
+ * @details Every iteration writes all records available in the ring buffer with a single
+ *          `writev()` call (unless it's interrupted), so that records appended while the disk is
+ *          busy are written together.
+ *
+ * @param arg The writer (::log_writer_t *).
+ * @return Always `NULL`.
+ */
+void *__log_writer_main(void *arg) {
+    log_writer_t   *writer = arg;
+    int             dirty  = 0;
+    struct timespec synced;
+    (void) clock_gettime(CLOCK_REALTIME, &synced);
+
+    __log_writer_lock();
+    while (1) {
+        __log_writer_wait(writer, &dirty, &synced);
+        if (writer->head == writer->tail)
+            break; /* Stopping */
+
+        size_t from = writer->tail, to = writer->head, records = writer->pending_records;
+        __log_writer_unlock();
+
+        if (__log_writer_write(writer, from, to))
+            util_perror("log_writer: writev()");
+
+        if (writer->durability == LOG_WRITER_DURABILITY_BATCH) {
+            if (fdatasync(writer->fd))
+                util_perror("log_writer: fdatasync()");
+        } else if (writer->durability == LOG_WRITER_DURABILITY_PERIODIC) {
+            struct timespec now;
+            (void) clock_gettime(CLOCK_REALTIME, &now);
+            dirty = 1;
+            if (now.tv_sec - synced.tv_sec >= LOG_WRITER_SYNC_INTERVAL) {
+                if (fdatasync(writer->fd))
+                    util_perror("log_writer: fdatasync()");
+                dirty  = 0;
+                synced = now;
+            }
+        }
+
+        __log_writer_lock();
+        writer->tail = to;
+        writer->pending_records -= records;
+        writer->written_records += records;
+        (void) pthread_cond_broadcast(&writer->has_space);
+    }
+    __log_writer_unlock();
+
+    if (dirty && fdatasync(writer->fd))
+        util_perror("log_writer: fdatasync()");
+    return NULL;
+}
+
+log_writer_t *log_writer_new(int fd, log_writer_durability_t durability) {
+    if (durability != LOG_WRITER_DURABILITY_NONE && durability != LOG_WRITER_DURABILITY_PERIODIC &&
+        durability != LOG_WRITER_DURABILITY_BATCH) {
+        errno = EINVAL;
+        return NULL;
+    }
+
+    (void) pthread_once(&__log_writer_atfork_once, __log_writer_register_atfork);
+
+    log_writer_t *writer = malloc(sizeof(log_writer_t));
+    if (!writer) {
+        errno = ENOMEM;
+        return NULL;
+    }
+
+    writer->ring = malloc(LOG_WRITER_RING_SIZE);
+    if (!writer->ring) {
+        free(writer);
+        errno = ENOMEM;
+        return NULL;
+    }
+
+    writer->fd              = fd;
+    writer->durability      = durability;
+    writer->head            = 0;
+    writer->tail            = 0;
+    writer->pending_records = 0;
+    writer->written_records = 0;
+    writer->stopping        = 0;
+    (void) pthread_cond_init(&writer->has_data, NULL);
+    (void) pthread_cond_init(&writer->has_space, NULL);
+
+    /* Signals (e.g. SIGTERM) are left for the thread that appends records */
+    sigset_t all_signals, old_signals;
+    (void) sigfillset(&all_signals);
+    (void) pthread_sigmask(SIG_BLOCK, &all_signals, &old_signals);
+    int error = pthread_create(&writer->thread, NULL, __log_writer_main, writer);
+    (void) pthread_sigmask(SIG_SETMASK, &old_signals, NULL);
+    if (error) {
+        (void) pthread_cond_destroy(&writer->has_data);
+        (void) pthread_cond_destroy(&writer->has_space);
+        free(writer->ring);
+        free(writer);
+        errno = error;
+        return NULL;
+    }
+    return writer;
+}
+
+void log_writer_stop(log_writer_t *writer) {
+    if (!writer)
+        return;
+
+    __log_writer_lock();
+    writer->stopping = 1;
+    (void) pthread_cond_signal(&writer->has_data);
+    __log_writer_unlock();
+}
+
+void log_writer_free(log_writer_t *writer) {
+    if (!writer)
+        return; /* Don't set errno, as that's not typical free() behavior */
+
+    log_writer_stop(writer);
+    (void) pthread_join(writer->thread, NULL);
+
+    (void) pthread_cond_destroy(&writer->has_data);
+    (void) pthread_cond_destroy(&writer->has_space);
+    free(writer->ring);
+    free(writer);
+}
+
+int log_writer_append(log_writer_t *writer, const void *record, size_t length) {
+    if (!writer || !record) {
+        errno = EINVAL;
+        return 1;
+    }
+    if (length > LOG_WRITER_RING_SIZE) {
+        errno = EMSGSIZE;
+        return 1;
+    }
+
+    __log_writer_lock();
+    if (writer->stopping) {
+        __log_writer_unlock();
+        errno = EPIPE;
+        return 1;
+    }
+
+    while (LOG_WRITER_RING_SIZE - (writer->head - writer->tail) < length)
+        (void) pthread_cond_wait(&writer->has_space, &__log_writer_mutex);
+
+    size_t start = writer->head % LOG_WRITER_RING_SIZE;
+    size_t first = length < LOG_WRITER_RING_SIZE - start ? length : LOG_WRITER_RING_SIZE - start;
+    memcpy(writer->ring + start, record, first);
+    memcpy(writer->ring, (const uint8_t *) record + first, length - first);
+
+    writer->head += length;
+    writer->pending_records++;
+    (void) pthread_cond_signal(&writer->has_data);
+    __log_writer_unlock();
+    return 0;
+}
+
+int log_writer_read(log_writer_t *writer,
+                    size_t        position,
+                    void         *out,
+                    size_t        length,
+                    size_t       *copied) {
+    if (!writer || !out || !copied) {
+        errno = EINVAL;
+        return 1;
+    }
+
+    __log_writer_lock();
+    *copied = 0;
+    if (position >= writer->tail && position < writer->head) {
+        *copied = writer->head - position < length ? writer->head - position : length;
+
+        size_t start = position % LOG_WRITER_RING_SIZE;
+        size_t first = *copied < LOG_WRITER_RING_SIZE - start ? *copied
+                                                              : LOG_WRITER_RING_SIZE - start;
+        memcpy(out, writer->ring + start, first);
+        memcpy((uint8_t *) out + first, writer->ring, *copied - first);
+    }
+    __log_writer_unlock();
+    return 0;
+}
+
+uint8_t *log_writer_get_pending(log_writer_t *writer,
+                                size_t       *length,
+                                size_t       *written_records,
+                                size_t       *pending_records) {
+    if (!writer || !length || !written_records || !pending_records) {
+        errno = EINVAL;
+        return NULL;
+    }
+
+    __log_writer_lock();
+    *length          = writer->head - writer->tail;
+    *written_records = writer->written_records;
+    *pending_records = writer->pending_records;
+
+    uint8_t *ret = NULL;
+    if (*length) {
+        ret = malloc(*length);
+        if (ret) {
+            size_t start = writer->tail % LOG_WRITER_RING_SIZE;
+            size_t first = *length < LOG_WRITER_RING_SIZE - start ? *length
+                                                                  : LOG_WRITER_RING_SIZE - start;
+            memcpy(ret, writer->ring + start, first);
+            memcpy(ret + first, writer->ring, *length - first);
+        }
+    }
+    __log_writer_unlock();
+
+    if (*length && !ret)
+        errno = ENOMEM;
+    return ret;
+}
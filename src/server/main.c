@@ -20,11 +20,15 @@
  */
 
 #include <errno.h>
+#include <stdio.h>
 #include <stdlib.h>
 #include <string.h>
 #include <sys/stat.h>
+#include <unistd.h>
 
 #include "server/server_requests.h"
+#include "server/simulator.h"
+#include "server/task_runner.h"
 #include "util.h"
 
 /**
@@ -35,11 +39,188 @@
 int __main_help_message(const char *program_name) {
     util_error("Usage:\n");
     util_error("  See this message: %s help\n", program_name);
-    util_error("  Run server:       %s (output folder) (number of tasks) (policy)\n", program_name);
-    util_error("    where policy = fcfs | sjf\n");
+    util_error("  Run server:       %s (output folder) (number of tasks) (policy) [backend] "
+               "[options]\n",
+               program_name);
+    util_error("  Read task output: %s read-output (output folder) (task id) (out | err) "
+               "[backend]\n",
+               program_name);
+    util_error("  Simulate policy:  %s simulate (workload | -) (number of tasks) (policy) "
+               "[--summary]\n",
+               program_name);
+    util_error("    where policy     = fcfs | sjf\n");
+    util_error("          backend    = files | packed (default: files)\n");
+    util_error("          options    = --pipe-size (bytes)\n");
+    util_error("                       --durability (durability)\n");
+    util_error("                       --log-segment-size (bytes) (default: %d)\n",
+               LOG_STORE_DEFAULT_SEGMENT_SIZE);
+    util_error("                       --log-segment-age (seconds) (default: 0, never)\n");
+    util_error("                       --log-max-size (bytes) (default: %d, 0 for no limit)\n",
+               LOG_STORE_DEFAULT_MAXIMUM_SIZE);
+    util_error("                       --output-max-age (seconds) (default: 0, never)\n");
+    util_error("                       --output-max-size (bytes) (default: 0, no limit)\n");
+    util_error("                       --output-keep-last (tasks) (default: 0, no limit)\n");
+    util_error("                       --metrics-file (path) (default: none)\n");
+    util_error("          durability = none | periodic | batch (default: none)\n");
     return 1;
 }
 
+/**
+ * @brief  Parses the name of an output store backend.
+ * @param  name Name of the backend. `NULL` for the default backend.
+ * @param  out  Where to write the parsed backend to. Mustn't be `NULL` (unchecked).
+ * @retval 0 Success.
+ * @retval 1 Invalid backend name.
+ */
+int __main_parse_backend(const char *name, output_store_backend_t *out) {
+    if (!name || strcmp(name, "files") == 0)
+        *out = OUTPUT_STORE_BACKEND_FILES;
+    else if (strcmp(name, "packed") == 0)
+        *out = OUTPUT_STORE_BACKEND_PACKED;
+    else
+        return 1;
+    return 0;
+}
+
+/**
+ * @brief  Parses a non-negative integer command-line argument.
+ * @param  str     Argument to be parsed. Mustn't be `NULL` (unchecked).
+ * @param  minimum Minimum accepted value.
+ * @param  out     Where to write the parsed value to. Mustn't be `NULL` (unchecked).
+ * @retval 0 Success.
+ * @retval 1 Invalid integer.
+ */
+int __main_parse_size(const char *str, size_t minimum, size_t *out) {
+    char         *integer_end;
+    unsigned long value = strtoul(str, &integer_end, 10);
+    if (!*str || *integer_end || *str == '-' || value < minimum)
+        return 1;
+
+    *out = value;
+    return 0;
+}
+
+/**
+ * @brief  Parses the name of a scheduling policy.
+ * @param  name Name of the policy. Mustn't be `NULL` (unchecked).
+ * @param  out  Where to write the parsed policy to. Mustn't be `NULL` (unchecked).
+ * @retval 0 Success.
+ * @retval 1 Invalid policy name.
+ */
+int __main_parse_policy(const char *name, scheduler_policy_t *out) {
+    if (strcmp(name, "fcfs") == 0)
+        *out = SCHEDULER_POLICY_FCFS;
+    else if (strcmp(name, "sjf") == 0)
+        *out = SCHEDULER_POLICY_SJF;
+    else
+        return 1;
+    return 0;
+}
+
+/**
+ * @brief  Parses the name of a log durability policy.
+ * @param  name Name of the policy. Mustn't be `NULL` (unchecked).
+ * @param  out  Where to write the parsed policy to. Mustn't be `NULL` (unchecked).
+ * @retval 0 Success.
+ * @retval 1 Invalid policy name.
+ */
+int __main_parse_durability(const char *name, log_writer_durability_t *out) {
+    if (strcmp(name, "none") == 0)
+        *out = LOG_WRITER_DURABILITY_NONE;
+    else if (strcmp(name, "periodic") == 0)
+        *out = LOG_WRITER_DURABILITY_PERIODIC;
+    else if (strcmp(name, "batch") == 0)
+        *out = LOG_WRITER_DURABILITY_BATCH;
+    else
+        return 1;
+    return 0;
+}
+
+/**
+ * @brief  Copies the output of a task in an output folder to `stdout`.
+ * @param  argc Number of command-line arguments. Must be `5` or `6` (unchecked).
+ * @param  argv Command-line arguments. Mustn't be `NULL` (unchecked).
+ * @return The exit code of the program.
+ */
+int __main_read_output(int argc, char **argv) {
+    char         *integer_end;
+    unsigned long id = strtoul(argv[3], &integer_end, 10);
+    if (!*(argv[3]) || *integer_end || id > UINT32_MAX)
+        return __main_help_message(argv[0]);
+
+    output_store_stream_t stream;
+    if (strcmp(argv[4], "out") == 0)
+        stream = OUTPUT_STORE_STREAM_OUTPUT;
+    else if (strcmp(argv[4], "err") == 0)
+        stream = OUTPUT_STORE_STREAM_ERROR;
+    else
+        return __main_help_message(argv[0]);
+
+    output_store_backend_t backend;
+    if (__main_parse_backend(argc == 6 ? argv[5] : NULL, &backend))
+        return __main_help_message(argv[0]);
+
+    output_store_t *store = output_store_new(argv[2], backend);
+    if (!store) {
+        util_perror("main(): failed to open output store");
+        return 1;
+    }
+
+    int ret = output_store_read(store, id, stream, STDOUT_FILENO);
+    if (ret) {
+        if (errno == ENOENT)
+            util_error("No output stored for task %lu\n", id);
+        else
+            util_perror("main(): failed to read task output");
+    }
+
+    output_store_free(store);
+    return ret;
+}
+
+/**
+ * @brief  Simulates running a workload with a scheduling policy, and prints the results.
+ * @param  argc Number of command-line arguments. Must be `5` or `6` (unchecked).
+ * @param  argv Command-line arguments. Mustn't be `NULL` (unchecked).
+ * @return The exit code of the program.
+ */
+int __main_simulate(int argc, char **argv) {
+    size_t             slots;
+    scheduler_policy_t policy;
+    if (__main_parse_size(argv[3], 1, &slots) || __main_parse_policy(argv[4], &policy) ||
+        (argc == 6 && strcmp(argv[5], "--summary") != 0))
+        return __main_help_message(argv[0]);
+
+    FILE *in = strcmp(argv[2], "-") == 0 ? stdin : fopen(argv[2], "r");
+    if (!in) {
+        util_perror("main(): failed to open workload");
+        return 1;
+    }
+
+    simulator_task_t *tasks;
+    size_t            ntasks;
+    int               failed = simulator_read_workload(in, &tasks, &ntasks);
+    if (in != stdin)
+        (void) fclose(in);
+    if (failed) {
+        if (errno == EILSEQ)
+            util_error("Invalid workload (line %zu)!\n", ntasks);
+        else
+            util_perror("main(): failed to read workload");
+        return 1;
+    }
+
+    if (simulator_run(policy, slots, tasks, ntasks)) {
+        util_perror("main(): simulation failed");
+        free(tasks);
+        return 1;
+    }
+
+    simulator_print_results(stdout, policy, slots, tasks, ntasks, argc == 5);
+    free(tasks);
+    return fflush(stdout) != 0;
+}
+
 /**
  * @brief  The entry point to the program.
  * @retval 0 Success
@@ -49,7 +230,11 @@ int main(int argc, char **argv) {
     if (argc == 2 && strcmp(argv[1], "help") == 0) {
         (void) __main_help_message(argv[0]);
         return 0;
-    } else if (argc == 4) {
+    } else if ((argc == 5 || argc == 6) && strcmp(argv[1], "read-output") == 0) {
+        return __main_read_output(argc, argv);
+    } else if ((argc == 5 || argc == 6) && strcmp(argv[1], "simulate") == 0) {
+        return __main_simulate(argc, argv);
+    } else if (argc >= 4) {
         if (mkdir(argv[1], 0700)) {
             if (errno == EEXIST) {
                 struct stat statbuf;
@@ -74,14 +259,73 @@ int main(int argc, char **argv) {
             return __main_help_message(argv[0]);
 
         scheduler_policy_t policy;
-        if (strcmp(argv[3], "fcfs") == 0)
-            policy = SCHEDULER_POLICY_FCFS;
-        else if (strcmp(argv[3], "sjf") == 0)
-            policy = SCHEDULER_POLICY_SJF;
-        else
+        if (__main_parse_policy(argv[3], &policy))
             return __main_help_message(argv[0]);
 
-        return server_requests_listen(policy, ntasks, argv[1]);
+        output_store_backend_t   backend      = OUTPUT_STORE_BACKEND_FILES;
+        log_store_options_t      log_options  = {.durability   = LOG_WRITER_DURABILITY_NONE,
+                                                 .segment_size = LOG_STORE_DEFAULT_SEGMENT_SIZE,
+                                                 .segment_age  = 0,
+                                                 .maximum_size = LOG_STORE_DEFAULT_MAXIMUM_SIZE};
+        output_store_retention_t retention    = {0};
+        const char              *metrics_path = NULL;
+        int                      backend_set  = 0;
+        for (int i = 4; i < argc; ++i) {
+            if (strcmp(argv[i], "--pipe-size") == 0 && i + 1 < argc) {
+                i++;
+                unsigned long pipe_size = strtoul(argv[i], &integer_end, 10);
+                if (!*(argv[i]) || *integer_end)
+                    return __main_help_message(argv[0]);
+
+                if (task_runner_set_pipe_size(pipe_size)) {
+                    util_perror("main(): invalid pipe size");
+                    return 1;
+                }
+            } else if (strcmp(argv[i], "--durability") == 0 && i + 1 < argc) {
+                if (__main_parse_durability(argv[++i], &log_options.durability))
+                    return __main_help_message(argv[0]);
+            } else if (strcmp(argv[i], "--log-segment-size") == 0 && i + 1 < argc) {
+                if (__main_parse_size(argv[++i], 1, &log_options.segment_size))
+                    return __main_help_message(argv[0]);
+            } else if (strcmp(argv[i], "--log-segment-age") == 0 && i + 1 < argc) {
+                size_t age;
+                if (__main_parse_size(argv[++i], 0, &age))
+                    return __main_help_message(argv[0]);
+                log_options.segment_age = age;
+            } else if (strcmp(argv[i], "--log-max-size") == 0 && i + 1 < argc) {
+                if (__main_parse_size(argv[++i], 0, &log_options.maximum_size))
+                    return __main_help_message(argv[0]);
+            } else if (strcmp(argv[i], "--output-max-age") == 0 && i + 1 < argc) {
+                size_t age;
+                if (__main_parse_size(argv[++i], 0, &age))
+                    return __main_help_message(argv[0]);
+                retention.maximum_age = age;
+            } else if (strcmp(argv[i], "--output-max-size") == 0 && i + 1 < argc) {
+                size_t size;
+                if (__main_parse_size(argv[++i], 0, &size))
+                    return __main_help_message(argv[0]);
+                retention.maximum_size = size;
+            } else if (strcmp(argv[i], "--output-keep-last") == 0 && i + 1 < argc) {
+                size_t count;
+                if (__main_parse_size(argv[++i], 0, &count) || count > UINT32_MAX)
+                    return __main_help_message(argv[0]);
+                retention.keep_last = count;
+            } else if (strcmp(argv[i], "--metrics-file") == 0 && i + 1 < argc && !metrics_path) {
+                metrics_path = argv[++i];
+            } else if (!backend_set && !__main_parse_backend(argv[i], &backend)) {
+                backend_set = 1;
+            } else {
+                return __main_help_message(argv[0]);
+            }
+        }
+
+        return server_requests_listen(policy,
+                                      ntasks,
+                                      argv[1],
+                                      backend,
+                                      &log_options,
+                                      &retention,
+                                      metrics_path);
     } else {
         return __main_help_message(argv[0]);
     }
@@ -0,0 +1,227 @@
+/*
+ * Copyright 2024 Humberto Gomes, José Lopes, José Matos
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+/**
+ * @file  server/metrics_file.c
+ * @brief Implementation of methods in server/metrics_file.h
+ */
+
+#include <errno.h>
+#include <inttypes.h>
+#include <limits.h>
+#include <stdio.h>
+#include <string.h>
+
+#include "metrics.h"
+#include "server/metrics_file.h"
+
+/** @brief Prefix of the names of all metrics. */
+#define METRICS_FILE_PREFIX "orchestrator_"
+
+/** @brief Names of the metrics of each ::metrics_counter_t, without ::METRICS_FILE_PREFIX. */
+static const char *const __metrics_file_counter_names[METRICS_COUNTER_COUNT] = {
+    "tasks_submitted_total",
+    "tasks_dispatched_total",
+    "ipc_retries_total",
+    "ipc_recovered_total",
+    "ipc_dropped_frames_total",
+    "fork_failures_total"};
+
+/** @brief Descriptions of the metrics of each ::metrics_counter_t. */
+static const char *const __metrics_file_counter_descriptions[METRICS_COUNTER_COUNT] = {
+    "Tasks accepted by the server.",
+    "Tasks taken from the queue to be run.",
+    "Messages sent again after a failed write.",
+    "IPC synchronization errors recovered from.",
+    "Frames discarded by the server for being invalid.",
+    "Failed forks of task runners and programs."};
+
+/** @brief Values of the `phase` label of each ::statistics_time_t. */
+static const char *const __metrics_file_phases[STATISTICS_TIME_COUNT] =
+    {"c2s", "wait", "execute", "s2s"};
+
+/** @brief Upper bounds of the buckets of latency histograms, in nanoseconds. */
+static const uint64_t __metrics_file_buckets[] = {100000,
+                                                  1000000,
+                                                  10000000,
+                                                  100000000,
+                                                  500000000,
+                                                  1000000000,
+                                                  2500000000,
+                                                  5000000000,
+                                                  10000000000,
+                                                  30000000000,
+                                                  60000000000,
+                                                  300000000000};
+
+/**
+ * @brief Writes a time in seconds, with nanosecond precision.
+ * @param out         Where to write the time to. Mustn't be `NULL` (unchecked).
+ * @param nanoseconds Time in nanoseconds.
+ */
+void __metrics_file_print_seconds(FILE *out, uint64_t nanoseconds) {
+    fprintf(out, "%" PRIu64 ".%09" PRIu64, nanoseconds / 1000000000, nanoseconds % 1000000000);
+}
+
+/**
+ * @brief Writes the header of a metric.
+ *
+ * @param out         Where to write the header to. Mustn't be `NULL` (unchecked).
+ * @param name        Name of the metric, without ::METRICS_FILE_PREFIX. Mustn't be `NULL`
+ *                    (unchecked).
+ * @param type        Type of the metric (`counter`, `gauge` or `histogram`). Mustn't be `NULL`
+ *                    (unchecked).
+ * @param description Description of the metric. Mustn't be `NULL` (unchecked).
+ */
+void __metrics_file_print_header(FILE       *out,
+                                 const char *name,
+                                 const char *type,
+                                 const char *description) {
+    fprintf(out,
+            "# HELP " METRICS_FILE_PREFIX "%s %s\n# TYPE " METRICS_FILE_PREFIX "%s %s\n",
+            name,
+            description,
+            name,
+            type);
+}
+
+/**
+ * @brief Writes a metric with a single value.
+ *
+ * @param out         Where to write the metric to. Mustn't be `NULL` (unchecked).
+ * @param name        Name of the metric, without ::METRICS_FILE_PREFIX. Mustn't be `NULL`
+ *                    (unchecked).
+ * @param type        Type of the metric (`counter` or `gauge`). Mustn't be `NULL` (unchecked).
+ * @param description Description of the metric. Mustn't be `NULL` (unchecked).
+ * @param value       Value of the metric.
+ */
+void __metrics_file_print_value(FILE       *out,
+                                const char *name,
+                                const char *type,
+                                const char *description,
+                                uint64_t    value) {
+    __metrics_file_print_header(out, name, type, description);
+    fprintf(out, METRICS_FILE_PREFIX "%s %" PRIu64 "\n", name, value);
+}
+
+/**
+ * @brief Writes the latency histograms of completed tasks, one per ::statistics_time_t.
+ * @param out       Where to write the histograms to. Mustn't be `NULL` (unchecked).
+ * @param aggregate Aggregate of all completed tasks. Mustn't be `NULL` (unchecked).
+ */
+void __metrics_file_print_histograms(FILE *out, const statistics_aggregate_t *aggregate) {
+    __metrics_file_print_header(out,
+                                "task_latency_seconds",
+                                "histogram",
+                                "Time completed tasks spent in each phase.");
+
+    for (size_t i = 0; i < STATISTICS_TIME_COUNT; ++i) {
+        const statistics_histogram_t *histogram = aggregate->times + i;
+        const char                   *phase     = __metrics_file_phases[i];
+
+        for (size_t j = 0; j < sizeof(__metrics_file_buckets) / sizeof(uint64_t); ++j) {
+            fprintf(out,
+                    METRICS_FILE_PREFIX "task_latency_seconds_bucket{phase=\"%s\",le=\"",
+                    phase);
+            __metrics_file_print_seconds(out, __metrics_file_buckets[j]);
+            fprintf(out,
+                    "\"} %" PRIu64 "\n",
+                    statistics_histogram_count_below(histogram, __metrics_file_buckets[j]));
+        }
+
+        fprintf(out,
+                METRICS_FILE_PREFIX "task_latency_seconds_bucket{phase=\"%s\",le=\"+Inf\"} "
+                                    "%" PRIu64 "\n",
+                phase,
+                histogram->count);
+        fprintf(out, METRICS_FILE_PREFIX "task_latency_seconds_sum{phase=\"%s\"} ", phase);
+        __metrics_file_print_seconds(out, histogram->sum);
+        fprintf(out,
+                "\n" METRICS_FILE_PREFIX "task_latency_seconds_count{phase=\"%s\"} %" PRIu64 "\n",
+                phase,
+                histogram->count);
+    }
+}
+
+/**
+ * @brief Writes all metrics.
+ *
+ * @param out        Where to write the metrics to. Mustn't be `NULL` (unchecked).
+ * @param statistics Aggregates of completed tasks. Mustn't be `NULL` (unchecked).
+ * @param scheduler  Scheduler whose load is to be exported. Mustn't be `NULL` (unchecked).
+ */
+void __metrics_file_print(FILE *out, const statistics_t *statistics, const scheduler_t *scheduler) {
+    const statistics_aggregate_t *aggregate = statistics_get_aggregate(statistics, 0);
+
+    for (metrics_counter_t i = 0; i < METRICS_COUNTER_COUNT; ++i)
+        __metrics_file_print_value(out,
+                                   __metrics_file_counter_names[i],
+                                   "counter",
+                                   __metrics_file_counter_descriptions[i],
+                                   metrics_get(i));
+    __metrics_file_print_value(out,
+                               "tasks_completed_total",
+                               "counter",
+                               "Tasks that finished running, successfully or not.",
+                               aggregate->task_count);
+    __metrics_file_print_value(out,
+                               "tasks_failed_total",
+                               "counter",
+                               "Tasks whose programs failed to run.",
+                               aggregate->error_count);
+
+    size_t running, queued, slots;
+    (void) scheduler_get_load(scheduler, &running, &queued, &slots);
+    __metrics_file_print_value(out, "queue_depth", "gauge", "Tasks waiting to be run.", queued);
+    __metrics_file_print_value(out, "busy_slots", "gauge", "Slots running a task.", running);
+    __metrics_file_print_value(out, "slots", "gauge", "Tasks that can run in parallel.", slots);
+
+    __metrics_file_print_header(out, "uptime_seconds", "gauge", "Time since the server started.");
+    fprintf(out, METRICS_FILE_PREFIX "uptime_seconds ");
+    __metrics_file_print_seconds(out, statistics_get_uptime(statistics));
+    fprintf(out, "\n");
+
+    __metrics_file_print_histograms(out, aggregate);
+}
+
+int metrics_file_write(const char         *path,
+                       const statistics_t *statistics,
+                       const scheduler_t  *scheduler) {
+    if (!path || !statistics || !scheduler) {
+        errno = EINVAL;
+        return 1;
+    }
+
+    char temporary_path[PATH_MAX];
+    if (snprintf(temporary_path, PATH_MAX, "%s.tmp", path) >= PATH_MAX) {
+        errno = ENAMETOOLONG;
+        return 1;
+    }
+
+    FILE *out = fopen(temporary_path, "w");
+    if (!out)
+        return 1;
+
+    __metrics_file_print(out, statistics, scheduler);
+    int failed = ferror(out);
+    if (fclose(out) || failed || rename(temporary_path, path)) {
+        int errno2 = failed && !errno ? EIO : errno;
+        (void) remove(temporary_path);
+        errno = errno2;
+        return 1;
+    }
+    return 0;
+}
@@ -0,0 +1,1241 @@
+/*
+ * Copyright 2024 Humberto Gomes, José Lopes, José Matos
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+/**
+ * @file  server/output_store.c
+ * @brief Implementation of methods in server/output_store.h
+ */
+
+#include <dirent.h>
+#include <errno.h>
+#include <fcntl.h>
+#include <inttypes.h>
+#include <limits.h>
+#include <poll.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/sendfile.h>
+#include <sys/stat.h>
+#include <time.h>
+#include <unistd.h>
+
+#include "ipc.h"
+#include "server/output_store.h"
+
+/** @brief Number of tasks in each leaf directory of the packed store. */
+#define OUTPUT_STORE_SHARD_SIZE 1000
+
+/** @brief Size after which a new segment is started in a shard. */
+#define OUTPUT_STORE_SEGMENT_SIZE (64 * 1024 * 1024)
+
+/** @brief Magic number at the start of every index file (`"SOIX"`). */
+#define OUTPUT_STORE_INDEX_MAGIC 0x58494f53
+
+/** @brief Size of the buffer used to copy data between files. */
+#define OUTPUT_STORE_COPY_BUFFER_SIZE (64 * 1024)
+
+/** @brief Maximum number of files deleted by ::output_store_sweep before pausing. */
+#define OUTPUT_STORE_SWEEP_BATCH_SIZE 256
+
+/** @brief Time (in nanoseconds) ::output_store_sweep pauses for between batches of deletions. */
+#define OUTPUT_STORE_SWEEP_PAUSE 10000000
+
+/**
+ * @struct output_store
+ * @brief  A place where the output of tasks is stored.
+ *
+ * @var output_store::backend
+ *     @brief How output is stored.
+ * @var output_store::directory
+ *     @brief Directory where output is stored.
+ */
+struct output_store {
+    output_store_backend_t backend;
+    char                  *directory;
+};
+
+/**
+ * @struct output_store_writer
+ * @brief  The output of a task that is being written to an output store.
+ *
+ * @var output_store_writer::store
+ *     @brief Output store the output is written to.
+ * @var output_store_writer::id
+ *     @brief Identifier of the task.
+ * @var output_store_writer::fds
+ *     @brief Files where each stream is written to. With ::OUTPUT_STORE_BACKEND_PACKED, these are
+ *            temporary files, only created (and `-1` until then) for streams larger than
+ *            ::OUTPUT_STORE_MEMORY_LIMIT.
+ * @var output_store_writer::buffers
+ *     @brief Contents of each stream not written to output_store_writer::fds.
+ * @var output_store_writer::capacities
+ *     @brief Number of bytes allocated for each of output_store_writer::buffers.
+ * @var output_store_writer::lengths
+ *     @brief Number of bytes written to each stream.
+ */
+struct output_store_writer {
+    const output_store_t *store;
+    uint32_t              id;
+    int                   fds[OUTPUT_STORE_STREAM_COUNT];
+    char                 *buffers[OUTPUT_STORE_STREAM_COUNT];
+    size_t                capacities[OUTPUT_STORE_STREAM_COUNT];
+    uint64_t              lengths[OUTPUT_STORE_STREAM_COUNT];
+};
+
+/**
+ * @struct output_store_index_header_t
+ * @brief  Header at the start of every index file of the packed store.
+ *
+ * @var output_store_index_header_t::magic
+ *     @brief ::OUTPUT_STORE_INDEX_MAGIC.
+ * @var output_store_index_header_t::segment
+ *     @brief Number of the segment output is currently appended to.
+ */
+typedef struct {
+    uint32_t magic;
+    uint32_t segment;
+} output_store_index_header_t;
+
+/**
+ * @struct output_store_index_entry_t
+ * @brief  Location of the output of a task in the packed store.
+ *
+ * @var output_store_index_entry_t::id
+ *     @brief Identifier of the task. `0` for tasks whose output wasn't stored.
+ * @var output_store_index_entry_t::segment
+ *     @brief Segment where all streams of the task are.
+ * @var output_store_index_entry_t::offsets
+ *     @brief Offsets of each stream (::output_store_stream_t) in the segment.
+ * @var output_store_index_entry_t::lengths
+ *     @brief Lengths of each stream (::output_store_stream_t).
+ */
+typedef struct {
+    uint32_t id;
+    uint32_t segment;
+    uint64_t offsets[OUTPUT_STORE_STREAM_COUNT];
+    uint64_t lengths[OUTPUT_STORE_STREAM_COUNT];
+} output_store_index_entry_t;
+
+output_store_t *output_store_new(const char *directory, output_store_backend_t backend) {
+    if (!directory ||
+        (backend != OUTPUT_STORE_BACKEND_FILES && backend != OUTPUT_STORE_BACKEND_PACKED)) {
+        errno = EINVAL;
+        return NULL;
+    }
+
+    output_store_t *ret = malloc(sizeof(output_store_t));
+    if (!ret)
+        return NULL; /* errno = ENOMEM guaranteed */
+
+    ret->backend   = backend;
+    ret->directory = strdup(directory);
+    if (!ret->directory) {
+        free(ret);
+        return NULL; /* errno = ENOMEM guaranteed */
+    }
+
+    return ret;
+}
+
+void output_store_free(output_store_t *store) {
+    if (!store)
+        return; /* Don't set errno, as that's not typical free behavior */
+
+    free(store->directory);
+    free(store);
+}
+
+/**
+ * @brief Closes all file descriptors of a task, keeping `errno`.
+ * @param fds File descriptors of the task. `-1` ones are ignored. Mustn't be `NULL` (unchecked).
+ */
+void __output_store_close_fds(int fds[OUTPUT_STORE_STREAM_COUNT]) {
+    int errno_copy = errno;
+    for (size_t i = 0; i < OUTPUT_STORE_STREAM_COUNT; ++i) {
+        if (fds[i] >= 0)
+            (void) close(fds[i]);
+        fds[i] = -1;
+    }
+    errno = errno_copy;
+}
+
+/**
+ * @brief  Waits for a non-blocking file descriptor that couldn't be written to to accept data.
+ * @param  out File descriptor to wait for.
+ * @retval 0 @p out can be written to (or is in error, which the next write will report).
+ * @retval 1 Timeout (`errno = ETIMEDOUT`) or failure (check `errno`, see `man 2 poll`).
+ */
+int __output_store_wait_writable(int out) {
+    struct pollfd pfd = {.fd = out, .events = POLLOUT, .revents = 0};
+    int           ready;
+    while ((ready = poll(&pfd, 1, OUTPUT_STORE_WRITE_TIMEOUT)) < 0 && errno == EINTR)
+        ;
+
+    if (ready == 0)
+        errno = ETIMEDOUT;
+    return ready <= 0;
+}
+
+/**
+ * @brief   Copies data between files.
+ * @details If @p out is non-blocking, this waits for it to accept data with
+ *          ::__output_store_wait_writable.
+ *
+ * @param in         File descriptor to read from.
+ * @param in_offset  Where to start reading from in @p in.
+ * @param out        File descriptor to write to.
+ * @param out_offset Where to start writing to in @p out, or `-1` to write at the current offset.
+ * @param length     Number of bytes to be copied.
+ *
+ * @retval 0 Success.
+ * @retval 1 Failure (check `errno`). `EIO` is set if @p in ends before @p length bytes are read.
+ */
+int __output_store_copy(int in, off_t in_offset, int out, off_t out_offset, uint64_t length) {
+    char buffer[OUTPUT_STORE_COPY_BUFFER_SIZE];
+    while (length > 0) {
+        size_t  to_read = length < sizeof(buffer) ? (size_t) length : sizeof(buffer);
+        ssize_t nread   = pread(in, buffer, to_read, in_offset);
+        if (nread < 0) {
+            return 1;
+        } else if (nread == 0) {
+            errno = EIO;
+            return 1;
+        }
+
+        for (ssize_t written = 0; written < nread;) {
+            ssize_t w = out_offset < 0
+                            ? write(out, buffer + written, nread - written)
+                            : pwrite(out, buffer + written, nread - written, out_offset + written);
+            if (w < 0 && errno == EAGAIN) {
+                if (__output_store_wait_writable(out))
+                    return 1; /* Keep errno */
+                continue;
+            } else if (w < 0 && errno != EINTR) {
+                return 1;
+            } else if (w > 0) {
+                written += w;
+            }
+        }
+
+        in_offset += nread;
+        if (out_offset >= 0)
+            out_offset += nread;
+        length -= nread;
+    }
+    return 0;
+}
+
+/**
+ * @brief Gets the path of a file of the flat files backend.
+ *
+ * @param store  Output store. Mustn't be `NULL` (unchecked).
+ * @param id     Identifier of the task.
+ * @param stream Stream stored in the file. Must be valid (unchecked).
+ * @param out    Where to write the path to. Mustn't be `NULL` (unchecked).
+ */
+void __output_store_get_file_path(const output_store_t *store,
+                                  uint32_t              id,
+                                  output_store_stream_t stream,
+                                  char                  out[PATH_MAX]) {
+    snprintf(out,
+             PATH_MAX,
+             "%s/%" PRIu32 ".%s",
+             store->directory,
+             id,
+             stream == OUTPUT_STORE_STREAM_OUTPUT ? "out" : "err");
+}
+
+/**
+ * @brief  Gets the path of the shard of the packed store where a task is stored.
+ *
+ * @param store  Output store. Mustn't be `NULL` (unchecked).
+ * @param id     Identifier of the task.
+ * @param create Whether to create the shard's directories if they don't exist.
+ * @param out    Where to write the path to. Mustn't be `NULL` (unchecked).
+ *
+ * @retval 0 Success.
+ * @retval 1 Failure to create a directory (check `errno`).
+ */
+int __output_store_get_shard_path(const output_store_t *store,
+                                  uint32_t              id,
+                                  int                   create,
+                                  char                  out[PATH_MAX]) {
+    uint32_t shard = id / OUTPUT_STORE_SHARD_SIZE;
+    int      lengths[3];
+    lengths[0] = snprintf(out, PATH_MAX, "%s/output", store->directory);
+    lengths[1] = snprintf(out, PATH_MAX, "%s/output/%" PRIu32, store->directory, shard / 1000);
+    lengths[2] = snprintf(out,
+                          PATH_MAX,
+                          "%s/output/%" PRIu32 "/%" PRIu32,
+                          store->directory,
+                          shard / 1000,
+                          shard % 1000);
+
+    if (create) {
+        for (size_t i = 0; i < 3; ++i) {
+            char c          = out[lengths[i]];
+            out[lengths[i]] = '\0';
+            int failed      = mkdir(out, 0700) && errno != EEXIST;
+            out[lengths[i]] = c;
+            if (failed)
+                return 1;
+        }
+    }
+    return 0;
+}
+
+/**
+ * @brief  Gets the path of the index of a shard of the packed store.
+ * @param  shard_path Path to the shard. Mustn't be `NULL` (unchecked).
+ * @param  out        Where to write the path to. Mustn't be `NULL` (unchecked).
+ * @retval 0 Success.
+ * @retval 1 Path too long (`errno = ENAMETOOLONG`).
+ */
+int __output_store_get_index_path(const char *shard_path, char out[PATH_MAX]) {
+    if (snprintf(out, PATH_MAX, "%s/index.bin", shard_path) >= PATH_MAX) {
+        errno = ENAMETOOLONG;
+        return 1;
+    }
+    return 0;
+}
+
+/**
+ * @brief  Gets the path of a segment of a shard of the packed store.
+ * @param  shard_path Path to the shard. Mustn't be `NULL` (unchecked).
+ * @param  segment    Number of the segment.
+ * @param  out        Where to write the path to. Mustn't be `NULL` (unchecked).
+ * @retval 0 Success.
+ * @retval 1 Path too long (`errno = ENAMETOOLONG`).
+ */
+int __output_store_get_segment_path(const char *shard_path, uint32_t segment, char out[PATH_MAX]) {
+    if (snprintf(out, PATH_MAX, "%s/segment-%" PRIu32 ".bin", shard_path, segment) >= PATH_MAX) {
+        errno = ENAMETOOLONG;
+        return 1;
+    }
+    return 0;
+}
+
+/**
+ * @brief  Writes a whole buffer to a file.
+ *
+ * @param fd     File descriptor to write to.
+ * @param buffer Data to be written. Mustn't be `NULL` (unchecked).
+ * @param length Number of bytes in @p buffer.
+ * @param offset Where to start writing to in @p fd, or `-1` to write at the current offset.
+ *
+ * @retval 0 Success.
+ * @retval 1 Failure (check `errno`).
+ */
+int __output_store_write_all(int fd, const char *buffer, size_t length, off_t offset) {
+    for (size_t written = 0; written < length;) {
+        ssize_t w = offset < 0 ? write(fd, buffer + written, length - written)
+                               : pwrite(fd, buffer + written, length - written, offset + written);
+        if (w < 0 && errno == EINTR)
+            continue;
+        else if (w < 0)
+            return 1;
+        written += w;
+    }
+    return 0;
+}
+
+/**
+ * @brief   Moves a stream of a task in the packed store from memory to a temporary file.
+ * @details The file is unlinked as soon as it's created, and closed on `exec()`, so that the
+ *          programs of the task don't inherit it.
+ *
+ * @param writer Output of the task. Mustn't be `NULL` (unchecked).
+ * @param stream Stream to be moved. Must be valid (unchecked).
+ *
+ * @retval 0 Success.
+ * @retval 1 Failure (check `errno`).
+ */
+int __output_store_packed_spill(output_store_writer_t *writer, output_store_stream_t stream) {
+    char path[PATH_MAX];
+    snprintf(path, PATH_MAX, "%s/output", writer->store->directory);
+    if (mkdir(path, 0700) && errno != EEXIST)
+        return 1;
+
+    snprintf(path, PATH_MAX, "%s/output/tmp-XXXXXX", writer->store->directory);
+    int fd = mkstemp(path);
+    if (fd < 0)
+        return 1;
+    (void) unlink(path);
+    (void) fcntl(fd, F_SETFD, FD_CLOEXEC);
+
+    if (__output_store_write_all(fd, writer->buffers[stream], writer->lengths[stream], -1)) {
+        int errno_copy = errno;
+        (void) close(fd);
+        errno = errno_copy;
+        return 1;
+    }
+
+    free(writer->buffers[stream]);
+    writer->buffers[stream]    = NULL;
+    writer->capacities[stream] = 0;
+    writer->fds[stream]        = fd;
+    return 0;
+}
+
+/**
+ * @brief  Moves data out of a pipe into the memory of a stream of a task in the packed store.
+ *
+ * @param writer Output of the task. Mustn't be `NULL` (unchecked).
+ * @param stream Stream the data belongs to. Must be valid (unchecked).
+ * @param pipe   File descriptor of the pipe to read from.
+ * @param length Maximum number of bytes to be moved.
+ *
+ * @return The number of bytes moved (`0` on end-of-file), or `-1` on failure (check `errno`).
+ */
+ssize_t __output_store_packed_buffer(output_store_writer_t *writer,
+                                     output_store_stream_t  stream,
+                                     int                    pipe,
+                                     size_t                 length) {
+    size_t used = writer->lengths[stream];
+    if (used + length > writer->capacities[stream]) {
+        size_t capacity = writer->capacities[stream] ? writer->capacities[stream] : length;
+        while (capacity < used + length)
+            capacity *= 2;
+
+        char *buffer = realloc(writer->buffers[stream], capacity);
+        if (!buffer)
+            return -1; /* errno = ENOMEM guaranteed */
+        writer->buffers[stream]    = buffer;
+        writer->capacities[stream] = capacity;
+    }
+
+    ssize_t nread;
+    do {
+        nread = read(pipe, writer->buffers[stream] + used, length);
+    } while (nread < 0 && errno == EINTR);
+    return nread;
+}
+
+/**
+ * @brief  Opens the segment of a shard where the next task's output should be appended to.
+ *
+ * @param shard_path Path to the shard. Mustn't be `NULL` (unchecked).
+ * @param header     Header of the shard's index, whose segment number is updated when a new segment
+ *                   is started. Mustn't be `NULL` (unchecked).
+ * @param length     Number of bytes that will be appended.
+ * @param offset     Where to write the current size of the segment to. Mustn't be `NULL`
+ *                   (unchecked).
+ *
+ * @return The file descriptor of the segment, or `-1` on failure (check `errno`).
+ */
+int __output_store_open_segment(const char                  *shard_path,
+                                output_store_index_header_t *header,
+                                uint64_t                     length,
+                                off_t                       *offset) {
+    while (1) {
+        char path[PATH_MAX];
+        if (__output_store_get_segment_path(shard_path, header->segment, path))
+            return -1;
+
+        int segment = open(path, O_RDWR | O_CREAT, 0640);
+        if (segment < 0)
+            return -1;
+
+        struct stat statbuf;
+        if (fstat(segment, &statbuf)) {
+            int errno_copy = errno;
+            (void) close(segment);
+            errno = errno_copy;
+            return -1;
+        }
+
+        *offset = statbuf.st_size;
+        if (*offset == 0 || *offset + length <= OUTPUT_STORE_SEGMENT_SIZE)
+            return segment;
+
+        (void) close(segment); /* Segment is full */
+        header->segment++;
+    }
+}
+
+/**
+ * @brief  Appends the output of a task to a shard, whose index is already locked.
+ *
+ * @param index      File descriptor of the shard's index.
+ * @param shard_path Path to the shard. Mustn't be `NULL` (unchecked).
+ * @param writer     Output of the task. Mustn't be `NULL` (unchecked).
+ *
+ * @retval 0 Success.
+ * @retval 1 Failure (check `errno`).
+ */
+int __output_store_packed_append(int                          index,
+                                 const char                  *shard_path,
+                                 const output_store_writer_t *writer) {
+    output_store_index_header_t header = {0};
+    ssize_t                     nread  = pread(index, &header, sizeof(header), 0);
+    if (nread != sizeof(header) || header.magic != OUTPUT_STORE_INDEX_MAGIC)
+        header = (output_store_index_header_t) {.magic = OUTPUT_STORE_INDEX_MAGIC, .segment = 0};
+
+    output_store_index_entry_t entry = {.id = writer->id};
+    uint64_t                   total = 0;
+    for (size_t i = 0; i < OUTPUT_STORE_STREAM_COUNT; ++i) {
+        entry.lengths[i] = writer->lengths[i];
+        total += writer->lengths[i];
+    }
+
+    if (total) { /* Tasks without output don't touch segments */
+        off_t offset;
+        int   segment = __output_store_open_segment(shard_path, &header, total, &offset);
+        if (segment < 0)
+            return 1;
+
+        entry.segment = header.segment;
+        for (size_t i = 0; i < OUTPUT_STORE_STREAM_COUNT; ++i) {
+            uint64_t length  = writer->lengths[i];
+            entry.offsets[i] = offset;
+
+            int failed;
+            if (writer->fds[i] >= 0)
+                failed = __output_store_copy(writer->fds[i], 0, segment, offset, length);
+            else
+                failed = __output_store_write_all(segment, writer->buffers[i], length, offset);
+
+            if (failed) {
+                int errno_copy = errno;
+                (void) close(segment);
+                errno = errno_copy;
+                return 1;
+            }
+            offset += length;
+        }
+        (void) close(segment);
+    } else {
+        entry.segment = header.segment;
+    }
+
+    /* Only index the task after its output is in the segment, for concurrent readers */
+    off_t entry_offset = sizeof(header) + (entry.id % OUTPUT_STORE_SHARD_SIZE) * sizeof(entry);
+    if (pwrite(index, &entry, sizeof(entry), entry_offset) != sizeof(entry) ||
+        pwrite(index, &header, sizeof(header), 0) != sizeof(header))
+        return 1;
+    return 0;
+}
+
+/**
+ * @brief  Appends the output of a task that has terminated to the packed store.
+ *
+ * @param  writer Output of the task. Mustn't be `NULL` (unchecked).
+ *
+ * @retval 0 Success.
+ * @retval 1 Failure (check `errno`).
+ */
+int __output_store_packed_end_task(const output_store_writer_t *writer) {
+    char shard_path[PATH_MAX], path[PATH_MAX];
+    if (__output_store_get_shard_path(writer->store, writer->id, 1, shard_path))
+        return 1;
+
+    if (__output_store_get_index_path(shard_path, path))
+        return 1;
+
+    int index = open(path, O_RDWR | O_CREAT, 0640);
+    if (index < 0)
+        return 1;
+
+    /* Serialize appends to this shard. The lock is released when the index is closed. */
+    struct flock lock = {.l_type = F_WRLCK, .l_whence = SEEK_SET, .l_start = 0, .l_len = 0};
+    int          ret  = fcntl(index, F_SETLKW, &lock) ||
+               __output_store_packed_append(index, shard_path, writer);
+
+    int errno_copy = errno;
+    (void) close(index);
+    errno = errno_copy;
+    return ret;
+}
+
+/**
+ * @brief  Opens the file where a stream of a task in the packed store is, and finds the stream.
+ *
+ * @param store  Output store. Mustn't be `NULL` (unchecked).
+ * @param id     Identifier of the task.
+ * @param stream Stream to be found. Must be valid (unchecked).
+ * @param offset Where to write the offset of the stream in the returned file to. Mustn't be `NULL`
+ *               (unchecked).
+ * @param length Where to write the length of the stream to. Mustn't be `NULL` (unchecked).
+ *
+ * @return A file descriptor open for reading (`-1` with `errno = 0` for empty streams), or `-1`
+ *         on failure (check `errno`).
+ */
+int __output_store_packed_open(const output_store_t *store,
+                               uint32_t              id,
+                               output_store_stream_t stream,
+                               uint64_t             *offset,
+                               uint64_t             *length) {
+    char shard_path[PATH_MAX], path[PATH_MAX];
+    (void) __output_store_get_shard_path(store, id, 0, shard_path);
+
+    if (__output_store_get_index_path(shard_path, path))
+        return -1;
+
+    int index = open(path, O_RDONLY);
+    if (index < 0)
+        return -1; /* errno = ENOENT for tasks in shards that don't exist */
+
+    output_store_index_entry_t entry        = {0};
+    off_t                      entry_offset = sizeof(output_store_index_header_t) +
+                         (id % OUTPUT_STORE_SHARD_SIZE) * sizeof(entry);
+    ssize_t nread = pread(index, &entry, sizeof(entry), entry_offset);
+    (void) close(index);
+    if (nread != sizeof(entry) || entry.id != id) {
+        errno = ENOENT;
+        return -1;
+    }
+
+    *offset = entry.offsets[stream];
+    *length = entry.lengths[stream];
+    if (entry.lengths[stream] == 0) {
+        errno = 0;
+        return -1;
+    }
+
+    if (__output_store_get_segment_path(shard_path, entry.segment, path))
+        return -1;
+
+    int segment = open(path, O_RDONLY);
+    if (segment < 0)
+        errno = EIO;
+    return segment;
+}
+
+/**
+ * @brief  Opens the file where a stream of a task is, and finds the stream in it.
+ *
+ * @param store  Output store. Mustn't be `NULL` (unchecked).
+ * @param id     Identifier of the task.
+ * @param stream Stream to be found. Must be valid (unchecked).
+ * @param offset Where to write the offset of the stream in the returned file to. Mustn't be `NULL`
+ *               (unchecked).
+ * @param length Where to write the length of the stream to. Mustn't be `NULL` (unchecked).
+ *
+ * @return A file descriptor open for reading (`-1` with `errno = 0` for empty streams), or `-1`
+ *         on failure (check `errno`).
+ */
+int __output_store_open(const output_store_t *store,
+                        uint32_t              id,
+                        output_store_stream_t stream,
+                        uint64_t             *offset,
+                        uint64_t             *length) {
+    if (store->backend == OUTPUT_STORE_BACKEND_PACKED)
+        return __output_store_packed_open(store, id, stream, offset, length);
+
+    char path[PATH_MAX];
+    __output_store_get_file_path(store, id, stream, path);
+    int in = open(path, O_RDONLY);
+    if (in < 0)
+        return -1; /* errno = ENOENT for unknown tasks */
+
+    struct stat statbuf;
+    if (fstat(in, &statbuf)) {
+        int errno_copy = errno;
+        (void) close(in);
+        errno = errno_copy;
+        return -1;
+    }
+
+    *offset = 0;
+    *length = statbuf.st_size;
+    return in;
+}
+
+/**
+ * @brief   Copies part of a file to a file descriptor.
+ * @details `sendfile()` is used so that data doesn't need to be copied to user space. If the kernel
+ *          can't send data to @p out, it's copied with ::__output_store_copy.
+ *
+ * @param in     File descriptor to read from.
+ * @param offset Where to start reading from in @p in.
+ * @param out    File descriptor to write to, at its current offset.
+ * @param length Number of bytes to be copied.
+ *
+ * @retval 0 Success.
+ * @retval 1 Failure (check `errno`). `EIO` is set if @p in ends before @p length bytes are read.
+ */
+int __output_store_send(int in, off_t offset, int out, uint64_t length) {
+    while (length > 0) {
+        size_t  to_send = length < SSIZE_MAX ? (size_t) length : SSIZE_MAX;
+        ssize_t sent    = sendfile(out, in, &offset, to_send);
+        if (sent < 0 && errno == EINTR) {
+            continue;
+        } else if (sent < 0 && errno == EAGAIN) {
+            if (__output_store_wait_writable(out))
+                return 1; /* Keep errno */
+        } else if (sent < 0 && (errno == EINVAL || errno == ENOSYS)) {
+            return __output_store_copy(in, offset, out, -1, length);
+        } else if (sent < 0) {
+            return 1;
+        } else if (sent == 0) {
+            errno = EIO;
+            return 1;
+        } else {
+            length -= sent; /* offset is updated by sendfile() */
+        }
+    }
+    return 0;
+}
+
+output_store_writer_t *output_store_begin_task(const output_store_t *store, uint32_t id) {
+    if (!store) {
+        errno = EINVAL;
+        return NULL;
+    }
+
+    output_store_writer_t *writer = calloc(1, sizeof(output_store_writer_t));
+    if (!writer)
+        return NULL; /* errno = ENOMEM guaranteed */
+
+    writer->store = store;
+    writer->id    = id;
+    for (size_t i = 0; i < OUTPUT_STORE_STREAM_COUNT; ++i)
+        writer->fds[i] = -1;
+
+    if (store->backend == OUTPUT_STORE_BACKEND_PACKED)
+        return writer; /* Created when the task terminates */
+
+    for (output_store_stream_t i = 0; i < OUTPUT_STORE_STREAM_COUNT; ++i) {
+        char path[PATH_MAX];
+        __output_store_get_file_path(store, id, i, path);
+        writer->fds[i] = open(path, O_CREAT | O_WRONLY | O_TRUNC | O_CLOEXEC, 0640);
+        if (writer->fds[i] < 0) {
+            __output_store_close_fds(writer->fds);
+            free(writer);
+            return NULL;
+        }
+    }
+    return writer;
+}
+
+ssize_t output_store_write(output_store_writer_t *writer,
+                           output_store_stream_t  stream,
+                           int                    pipe,
+                           size_t                 length) {
+    if (!writer || stream >= OUTPUT_STORE_STREAM_COUNT) {
+        errno = EINVAL;
+        return -1;
+    }
+
+    if (writer->fds[stream] < 0 && writer->lengths[stream] + length > OUTPUT_STORE_MEMORY_LIMIT &&
+        __output_store_packed_spill(writer, stream))
+        return -1;
+
+    ssize_t moved = writer->fds[stream] >= 0
+                        ? ipc_splice(pipe, writer->fds[stream], length)
+                        : __output_store_packed_buffer(writer, stream, pipe, length);
+    if (moved > 0)
+        writer->lengths[stream] += moved;
+    return moved;
+}
+
+int output_store_end_task(output_store_writer_t *writer) {
+    if (!writer) {
+        errno = EINVAL;
+        return 1;
+    }
+
+    int ret = 0;
+    if (writer->store->backend == OUTPUT_STORE_BACKEND_PACKED)
+        ret = __output_store_packed_end_task(writer);
+
+    __output_store_close_fds(writer->fds); /* Keeps errno */
+    for (size_t i = 0; i < OUTPUT_STORE_STREAM_COUNT; ++i)
+        free(writer->buffers[i]);
+    free(writer);
+    return ret;
+}
+
+int output_store_get_length(const output_store_t *store,
+                            uint32_t              id,
+                            output_store_stream_t stream,
+                            uint64_t             *length) {
+    if (!store || !length ||
+        (stream != OUTPUT_STORE_STREAM_OUTPUT && stream != OUTPUT_STORE_STREAM_ERROR)) {
+        errno = EINVAL;
+        return 1;
+    }
+
+    uint64_t offset;
+    int      in = __output_store_open(store, id, stream, &offset, length);
+    if (in < 0)
+        return errno != 0;
+
+    (void) close(in);
+    return 0;
+}
+
+int output_store_read_range(const output_store_t *store,
+                            uint32_t              id,
+                            output_store_stream_t stream,
+                            uint64_t              first_byte,
+                            uint64_t              length,
+                            int                   fd) {
+    if (!store || (stream != OUTPUT_STORE_STREAM_OUTPUT && stream != OUTPUT_STORE_STREAM_ERROR)) {
+        errno = EINVAL;
+        return 1;
+    }
+
+    uint64_t offset, stream_length;
+    int      in = __output_store_open(store, id, stream, &offset, &stream_length);
+    if (in < 0)
+        return errno != 0;
+
+    if (first_byte >= stream_length)
+        length = 0;
+    else if (length > stream_length - first_byte)
+        length = stream_length - first_byte;
+
+    int ret        = __output_store_send(in, offset + first_byte, fd, length);
+    int errno_copy = errno;
+    (void) close(in);
+    errno = errno_copy;
+    return ret;
+}
+
+int output_store_read(const output_store_t *store,
+                      uint32_t              id,
+                      output_store_stream_t stream,
+                      int                   fd) {
+    return output_store_read_range(store, id, stream, 0, UINT64_MAX, fd);
+}
+
+/**
+ * @struct output_store_sweep_unit_t
+ * @brief  Output deleted as a whole by ::output_store_sweep (a task, or a shard of the packed
+ *         store).
+ *
+ * @var output_store_sweep_unit_t::first_id
+ *     @brief Lowest identifier of a task in the unit.
+ * @var output_store_sweep_unit_t::last_id
+ *     @brief Highest identifier of a task in the unit.
+ * @var output_store_sweep_unit_t::size
+ *     @brief Number of bytes in the unit's files.
+ * @var output_store_sweep_unit_t::modified
+ *     @brief Last time any of the unit's files were modified.
+ */
+typedef struct {
+    uint32_t first_id, last_id;
+    uint64_t size;
+    time_t   modified;
+} output_store_sweep_unit_t;
+
+/**
+ * @struct output_store_sweep_t
+ * @brief  State of an ::output_store_sweep call.
+ *
+ * @var output_store_sweep_t::units
+ *     @brief Units of output found in the store.
+ * @var output_store_sweep_t::count
+ *     @brief Number of elements in output_store_sweep_t::units.
+ * @var output_store_sweep_t::capacity
+ *     @brief Number of allocated elements in output_store_sweep_t::units.
+ * @var output_store_sweep_t::total_size
+ *     @brief Number of bytes in all files of the store, including ones that can't be deleted.
+ */
+typedef struct {
+    output_store_sweep_unit_t *units;
+    size_t                     count, capacity;
+    uint64_t                   total_size;
+} output_store_sweep_t;
+
+/**
+ * @brief  Adds a unit of output to the list of ones that may be deleted.
+ * @param  sweep State of the sweep. Mustn't be `NULL` (unchecked).
+ * @param  unit  Unit to be added. Mustn't be `NULL` (unchecked).
+ * @retval 0 Success.
+ * @retval 1 Allocation failure (`errno = ENOMEM`).
+ */
+int __output_store_sweep_add(output_store_sweep_t *sweep, const output_store_sweep_unit_t *unit) {
+    if (sweep->count == sweep->capacity) {
+        size_t                     new_capacity = sweep->capacity ? sweep->capacity * 2 : 256;
+        output_store_sweep_unit_t *new_units =
+            realloc(sweep->units, new_capacity * sizeof(output_store_sweep_unit_t));
+        if (!new_units)
+            return 1; /* errno = ENOMEM guaranteed */
+
+        sweep->units    = new_units;
+        sweep->capacity = new_capacity;
+    }
+
+    sweep->units[sweep->count++] = *unit;
+    return 0;
+}
+
+/**
+ * @brief  Parses the name of a file of the flat files backend.
+ * @param  name Name of the file. Mustn't be `NULL` (unchecked).
+ * @param  id   Where to write the identifier of the task to. Mustn't be `NULL` (unchecked).
+ * @retval 0 Success.
+ * @retval 1 Not the name of a task's output file.
+ */
+int __output_store_parse_file_name(const char *name, uint32_t *id) {
+    char         *integer_end;
+    unsigned long value = strtoul(name, &integer_end, 10);
+    if (*name < '0' || *name > '9' || value > UINT32_MAX ||
+        (strcmp(integer_end, ".out") != 0 && strcmp(integer_end, ".err") != 0))
+        return 1;
+
+    *id = value;
+    return 0;
+}
+
+/**
+ * @brief Compares two ::output_store_sweep_unit_t by their identifiers, for `qsort()`.
+ * @param a First unit. Mustn't be `NULL` (unchecked).
+ * @param b Second unit. Mustn't be `NULL` (unchecked).
+ * @return A negative number, `0` or a positive number, if @p a is older, as old or newer than @p b.
+ */
+int __output_store_sweep_compare(const void *a, const void *b) {
+    uint32_t a_id = ((const output_store_sweep_unit_t *) a)->first_id;
+    uint32_t b_id = ((const output_store_sweep_unit_t *) b)->first_id;
+    return (a_id > b_id) - (a_id < b_id);
+}
+
+/**
+ * @brief  Finds the tasks of the flat files backend.
+ * @param  store        Output store. Mustn't be `NULL` (unchecked).
+ * @param  first_active Identifier of the oldest task whose output can't be deleted.
+ * @param  sweep        Where to add the tasks to. Mustn't be `NULL` (unchecked).
+ * @retval 0 Success.
+ * @retval 1 Failure (check `errno`).
+ */
+int __output_store_files_scan(const output_store_t *store,
+                              uint32_t              first_active,
+                              output_store_sweep_t *sweep) {
+    DIR *dir = opendir(store->directory);
+    if (!dir)
+        return 1;
+
+    struct dirent *entry;
+    errno = 0;
+    while ((entry = readdir(dir))) {
+        uint32_t    id;
+        struct stat statbuf;
+        if (__output_store_parse_file_name(entry->d_name, &id) ||
+            fstatat(dirfd(dir), entry->d_name, &statbuf, AT_SYMLINK_NOFOLLOW) ||
+            !S_ISREG(statbuf.st_mode)) {
+            errno = 0;
+            continue;
+        }
+
+        sweep->total_size += statbuf.st_size;
+        output_store_sweep_unit_t unit = {.first_id = id,
+                                          .last_id  = id,
+                                          .size     = statbuf.st_size,
+                                          .modified = statbuf.st_mtime};
+        if (id < first_active && __output_store_sweep_add(sweep, &unit)) {
+            (void) closedir(dir);
+            return 1; /* errno = ENOMEM guaranteed */
+        }
+        errno = 0;
+    }
+
+    int errno_copy = errno;
+    (void) closedir(dir);
+    errno = errno_copy;
+    if (errno)
+        return 1;
+
+    /* Merge the streams of each task into a single unit */
+    qsort(sweep->units,
+          sweep->count,
+          sizeof(output_store_sweep_unit_t),
+          __output_store_sweep_compare);
+    size_t merged = 0;
+    for (size_t i = 0; i < sweep->count; ++i) {
+        output_store_sweep_unit_t *last = sweep->units + merged - 1;
+        if (merged && last->first_id == sweep->units[i].first_id) {
+            last->size += sweep->units[i].size;
+            if (sweep->units[i].modified > last->modified)
+                last->modified = sweep->units[i].modified;
+        } else {
+            sweep->units[merged++] = sweep->units[i];
+        }
+    }
+    sweep->count = merged;
+    return 0;
+}
+
+/**
+ * @brief   Measures a directory of the packed store.
+ * @details Only regular files directly in the directory are considered.
+ *
+ * @param path     Path to the directory. Mustn't be `NULL` (unchecked).
+ * @param size     Where to write the number of bytes in the directory to. Mustn't be `NULL`
+ *                 (unchecked).
+ * @param modified Where to write the last modification time of a file to. Mustn't be `NULL`
+ *                 (unchecked).
+ *
+ * @retval 0 Success.
+ * @retval 1 Failure (check `errno`).
+ */
+int __output_store_measure_directory(const char *path, uint64_t *size, time_t *modified) {
+    DIR *dir = opendir(path);
+    if (!dir)
+        return 1;
+
+    *size     = 0;
+    *modified = 0;
+
+    struct dirent *entry;
+    while ((entry = readdir(dir))) {
+        struct stat statbuf;
+        if (!fstatat(dirfd(dir), entry->d_name, &statbuf, AT_SYMLINK_NOFOLLOW) &&
+            S_ISREG(statbuf.st_mode)) {
+            *size += statbuf.st_size;
+            if (statbuf.st_mtime > *modified)
+                *modified = statbuf.st_mtime;
+        }
+    }
+
+    (void) closedir(dir);
+    return 0;
+}
+
+/**
+ * @brief  Parses the name of a directory of the packed store (a number below `1000`).
+ * @param  name   Name of the directory. Mustn't be `NULL` (unchecked).
+ * @param  number Where to write the number to. Mustn't be `NULL` (unchecked).
+ * @retval 0 Success.
+ * @retval 1 Not the name of a directory of the packed store.
+ */
+int __output_store_parse_directory_name(const char *name, uint32_t *number) {
+    char         *integer_end;
+    unsigned long value = strtoul(name, &integer_end, 10);
+    if (*name < '0' || *name > '9' || *integer_end || value >= 1000)
+        return 1;
+
+    *number = value;
+    return 0;
+}
+
+/**
+ * @brief  Finds the shards of the packed store.
+ * @param  store        Output store. Mustn't be `NULL` (unchecked).
+ * @param  first_active Identifier of the oldest task whose output can't be deleted.
+ * @param  sweep        Where to add the shards to. Mustn't be `NULL` (unchecked).
+ * @retval 0 Success.
+ * @retval 1 Failure (check `errno`).
+ */
+int __output_store_packed_scan(const output_store_t *store,
+                               uint32_t              first_active,
+                               output_store_sweep_t *sweep) {
+    char path[PATH_MAX];
+    snprintf(path, PATH_MAX, "%s/output", store->directory);
+    DIR *top_dir = opendir(path);
+    if (!top_dir)
+        return errno != ENOENT; /* No task has finished yet */
+
+    int            ret = 0;
+    struct dirent *top_entry;
+    while (!ret && (top_entry = readdir(top_dir))) {
+        uint32_t top;
+        if (__output_store_parse_directory_name(top_entry->d_name, &top))
+            continue;
+
+        snprintf(path, PATH_MAX, "%s/output/%" PRIu32, store->directory, top);
+        DIR *shard_dir = opendir(path);
+        if (!shard_dir)
+            continue; /* Deleted by a concurrent sweep */
+
+        struct dirent *shard_entry;
+        while (!ret && (shard_entry = readdir(shard_dir))) {
+            uint32_t bottom;
+            if (__output_store_parse_directory_name(shard_entry->d_name, &bottom))
+                continue;
+
+            uint64_t first_id = ((uint64_t) top * 1000 + bottom) * OUTPUT_STORE_SHARD_SIZE;
+            uint64_t last_id  = first_id + OUTPUT_STORE_SHARD_SIZE - 1;
+            if (last_id > UINT32_MAX)
+                last_id = UINT32_MAX;
+
+            output_store_sweep_unit_t unit = {.first_id = first_id, .last_id = last_id};
+            (void) __output_store_get_shard_path(store, first_id, 0, path);
+            if (__output_store_measure_directory(path, &unit.size, &unit.modified))
+                continue;
+
+            sweep->total_size += unit.size;
+            if (unit.last_id < first_active && __output_store_sweep_add(sweep, &unit))
+                ret = 1; /* errno = ENOMEM guaranteed */
+        }
+        (void) closedir(shard_dir);
+    }
+
+    int errno_copy = errno;
+    (void) closedir(top_dir);
+    errno = errno_copy;
+    if (!ret)
+        qsort(sweep->units,
+              sweep->count,
+              sizeof(output_store_sweep_unit_t),
+              __output_store_sweep_compare);
+    return ret;
+}
+
+/**
+ * @brief  Deletes a unit of output.
+ * @param  store Output store. Mustn't be `NULL` (unchecked).
+ * @param  unit  Unit to be deleted. Mustn't be `NULL` (unchecked).
+ * @return The number of files deleted.
+ */
+size_t __output_store_delete_unit(const output_store_t            *store,
+                                  const output_store_sweep_unit_t *unit) {
+    char   path[PATH_MAX];
+    size_t deleted = 0;
+    if (store->backend == OUTPUT_STORE_BACKEND_FILES) {
+        for (output_store_stream_t i = 0; i < OUTPUT_STORE_STREAM_COUNT; ++i) {
+            __output_store_get_file_path(store, unit->first_id, i, path);
+            deleted += !unlink(path);
+        }
+        return deleted;
+    }
+
+    (void) __output_store_get_shard_path(store, unit->first_id, 0, path);
+    DIR *dir = opendir(path);
+    if (!dir)
+        return 0;
+
+    struct dirent *entry;
+    while ((entry = readdir(dir)))
+        deleted += !unlinkat(dirfd(dir), entry->d_name, 0);
+    (void) closedir(dir);
+
+    /* Remove the shard's directory, and its parent when it's the last shard in it */
+    (void) rmdir(path);
+    *strrchr(path, '/') = '\0';
+    (void) rmdir(path);
+    return deleted;
+}
+
+/**
+ * @brief Records a batch of deletions in the store's `retention.log`.
+ *
+ * @param store    Output store. Mustn't be `NULL` (unchecked).
+ * @param first_id Lowest identifier of a task whose output was deleted.
+ * @param last_id  Highest identifier of a task whose output was deleted.
+ * @param files    Number of files deleted.
+ * @param size     Number of bytes deleted.
+ *
+ * @retval 0 Success.
+ * @retval 1 Failure (check `errno`).
+ */
+int __output_store_record_batch(const output_store_t *store,
+                                uint32_t              first_id,
+                                uint32_t              last_id,
+                                size_t                files,
+                                uint64_t              size) {
+    char path[PATH_MAX];
+    if (snprintf(path, PATH_MAX, "%s/retention.log", store->directory) >= PATH_MAX) {
+        errno = ENAMETOOLONG;
+        return 1;
+    }
+
+    int fd = open(path, O_WRONLY | O_CREAT | O_APPEND, 0640);
+    if (fd < 0)
+        return 1;
+
+    char line[128];
+    int  length = snprintf(line,
+                          sizeof(line),
+                          "%lld %" PRIu32 "-%" PRIu32 " %zu files %" PRIu64 " bytes\n",
+                          (long long) time(NULL),
+                          first_id,
+                          last_id,
+                          files,
+                          size);
+
+    int ret        = write(fd, line, length) != length;
+    int errno_copy = errno;
+    (void) close(fd);
+    errno = errno_copy;
+    return ret;
+}
+
+int output_store_sweep(const output_store_t           *store,
+                       const output_store_retention_t *retention,
+                       uint32_t                        first_active,
+                       uint32_t                        next_id) {
+    if (!store || !retention) {
+        errno = EINVAL;
+        return 1;
+    }
+
+    output_store_sweep_t sweep = {0};
+    int                  ret   = store->backend == OUTPUT_STORE_BACKEND_PACKED
+                                     ? __output_store_packed_scan(store, first_active, &sweep)
+                                     : __output_store_files_scan(store, first_active, &sweep);
+    if (ret) {
+        int errno_copy = errno;
+        free(sweep.units);
+        errno = errno_copy;
+        return 1;
+    }
+
+    time_t   now         = time(NULL);
+    uint32_t batch_first = 0, batch_last = 0;
+    size_t   batch_files = 0;
+    uint64_t batch_size  = 0;
+    for (size_t i = 0; i < sweep.count; ++i) {
+        const output_store_sweep_unit_t *unit = sweep.units + i;
+
+        int expired =
+            (retention->keep_last &&
+             (uint64_t) unit->last_id + retention->keep_last < next_id) ||
+            (retention->maximum_age && now - unit->modified >= retention->maximum_age) ||
+            (retention->maximum_size && sweep.total_size > retention->maximum_size);
+        if (!expired)
+            continue;
+
+        size_t deleted = __output_store_delete_unit(store, unit);
+        if (!deleted)
+            continue; /* Deleted by a concurrent sweep */
+        sweep.total_size -= unit->size < sweep.total_size ? unit->size : sweep.total_size;
+
+        if (!batch_files)
+            batch_first = unit->first_id;
+        batch_last   = unit->last_id;
+        batch_files += deleted;
+        batch_size  += unit->size;
+
+        if (batch_files >= OUTPUT_STORE_SWEEP_BATCH_SIZE) {
+            ret |= __output_store_record_batch(store,
+                                               batch_first,
+                                               batch_last,
+                                               batch_files,
+                                               batch_size);
+            batch_files = 0;
+            batch_size  = 0;
+
+            /* Leave the disk to running tasks for a while */
+            struct timespec pause = {.tv_sec = 0, .tv_nsec = OUTPUT_STORE_SWEEP_PAUSE};
+            (void) nanosleep(&pause, NULL);
+        }
+    }
+
+    if (batch_files)
+        ret |= __output_store_record_batch(store,
+                                           batch_first,
+                                           batch_last,
+                                           batch_files,
+                                           batch_size);
+
+    int errno_copy = errno;
+    free(sweep.units);
+    errno = errno_copy;
+    return ret;
+}
@@ -0,0 +1,378 @@
+/*
+ * Copyright 2024 Humberto Gomes, José Lopes, José Matos
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+/**
+ * @file  server/path_cache.c
+ * @brief Implementation of methods in server/path_cache.h
+ */
+
+#include <errno.h>
+#include <limits.h>
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/stat.h>
+#include <time.h>
+#include <unistd.h>
+
+#include "server/path_cache.h"
+
+/** @brief `$PATH` used when the variable isn't set (same as `execvp()` in glibc). */
+#define PATH_CACHE_DEFAULT_PATH "/bin:/usr/bin"
+
+/** @brief Initial number of slots in the hash table. Must be a power of two. */
+#define PATH_CACHE_INITIAL_CAPACITY 64
+
+/**
+ * @brief   Maximum number of cached programs.
+ * @details Clients can submit any number of different unknown programs, so the cache is emptied
+ *          when this limit is reached, instead of growing forever.
+ */
+#define PATH_CACHE_MAXIMUM_ENTRIES 4096
+
+/**
+ * @struct path_cache_entry_t
+ * @brief  A cached program location.
+ *
+ * @var path_cache_entry_t::name
+ *     @brief Name of the program. `NULL` for unused slots in the hash table.
+ * @var path_cache_entry_t::path
+ *     @brief Location of the executable, or `NULL` if the program couldn't be found.
+ */
+typedef struct {
+    char *name, *path;
+} path_cache_entry_t;
+
+/**
+ * @struct path_cache_directory_t
+ * @brief  A directory in `$PATH`.
+ *
+ * @var path_cache_directory_t::path
+ *     @brief Path to the directory (points to a string in path_cache_t::directory_strings).
+ * @var path_cache_directory_t::modification_time
+ *     @brief Last known modification time of the directory (`0` if it couldn't be `stat()`ed).
+ */
+typedef struct {
+    const char     *path;
+    struct timespec modification_time;
+} path_cache_directory_t;
+
+/**
+ * @struct path_cache_t
+ * @brief  State of the cache.
+ *
+ * @var path_cache_t::path_variable
+ *     @brief Copy of `$PATH` when path_cache_t::directories was built.
+ * @var path_cache_t::directory_strings
+ *     @brief Copy of path_cache_t::path_variable, with `:`s replaced by null terminators. Part of
+ *            the same allocation as path_cache_t::path_variable.
+ * @var path_cache_t::directories
+ *     @brief Directories in `$PATH`.
+ * @var path_cache_t::ndirectories
+ *     @brief Number of elements in path_cache_t::directories.
+ * @var path_cache_t::last_check
+ *     @brief When the modification times of path_cache_t::directories were last checked.
+ * @var path_cache_t::entries
+ *     @brief Hash table of cached programs (open addressing with linear probing).
+ * @var path_cache_t::capacity
+ *     @brief Number of slots in path_cache_t::entries (a power of two, or `0`).
+ * @var path_cache_t::count
+ *     @brief Number of used slots in path_cache_t::entries.
+ */
+typedef struct {
+    char                   *path_variable, *directory_strings;
+    path_cache_directory_t *directories;
+    size_t                  ndirectories;
+    struct timespec         last_check;
+
+    path_cache_entry_t *entries;
+    size_t              capacity, count;
+} path_cache_t;
+
+/** @brief The cache of this process. */
+static path_cache_t __path_cache = {0};
+
+/**
+ * @brief  Hashes a program name (FNV-1a).
+ * @param  name Name to be hashed. Mustn't be `NULL` (unchecked).
+ * @return The hash of @p name.
+ */
+size_t __path_cache_hash(const char *name) {
+    uint64_t hash = 14695981039346656037ULL;
+    for (; *name; ++name) {
+        hash ^= (uint8_t) *name;
+        hash *= 1099511628211ULL;
+    }
+    return (size_t) hash;
+}
+
+/** @brief Removes all programs from the cache, keeping the known `$PATH` directories. */
+void __path_cache_clear_entries(void) {
+    for (size_t i = 0; i < __path_cache.capacity; ++i) {
+        free(__path_cache.entries[i].name);
+        free(__path_cache.entries[i].path);
+    }
+    free(__path_cache.entries);
+
+    __path_cache.entries  = NULL;
+    __path_cache.capacity = 0;
+    __path_cache.count    = 0;
+}
+
+/**
+ * @brief Gets the modification time of a directory.
+ * @param path Path to the directory. Mustn't be `NULL` (unchecked).
+ * @param out  Where to write the modification time to (`0` on `stat()` failure). Mustn't be `NULL`
+ *             (unchecked).
+ */
+void __path_cache_get_modification_time(const char *path, struct timespec *out) {
+    struct stat statbuf;
+    if (stat(*path ? path : ".", &statbuf))
+        *out = (struct timespec) {0};
+    else
+        *out = statbuf.st_mtim;
+}
+
+/**
+ * @brief  Splits `$PATH` into directories and records their modification times.
+ * @param  path_variable Value of `$PATH`. Mustn't be `NULL` (unchecked).
+ * @retval 0 Success.
+ * @retval 1 Allocation failure (`errno = ENOMEM`).
+ */
+int __path_cache_load_directories(const char *path_variable) {
+    size_t length = strlen(path_variable) + 1, ndirectories = 1;
+    for (const char *c = path_variable; *c; ++c)
+        if (*c == ':')
+            ndirectories++;
+
+    char                   *copy        = malloc(2 * length);
+    path_cache_directory_t *directories = malloc(ndirectories * sizeof(path_cache_directory_t));
+    if (!copy || !directories) {
+        free(copy);
+        free(directories);
+        return 1; /* errno = ENOMEM guaranteed */
+    }
+    memcpy(copy, path_variable, length);
+    memcpy(copy + length, path_variable, length);
+
+    char *strings       = copy + length;
+    directories[0].path = strings;
+    for (size_t i = 0, j = 1; i < length - 1; ++i) {
+        if (strings[i] == ':') {
+            strings[i]            = '\0';
+            directories[j++].path = strings + i + 1;
+        }
+    }
+
+    for (size_t i = 0; i < ndirectories; ++i)
+        __path_cache_get_modification_time(directories[i].path, &directories[i].modification_time);
+
+    free(__path_cache.path_variable);
+    free(__path_cache.directories);
+    __path_cache.path_variable     = copy;
+    __path_cache.directory_strings = strings;
+    __path_cache.directories       = directories;
+    __path_cache.ndirectories      = ndirectories;
+    return 0;
+}
+
+/**
+ * @brief  Invalidates the cache if `$PATH` or any of its directories have changed.
+ * @retval 0 Success.
+ * @retval 1 Allocation failure (`errno = ENOMEM`).
+ */
+int __path_cache_validate(void) {
+    const char *path_variable = getenv("PATH");
+    if (!path_variable)
+        path_variable = PATH_CACHE_DEFAULT_PATH;
+
+    struct timespec now = {0};
+    (void) clock_gettime(CLOCK_MONOTONIC, &now);
+
+    if (!__path_cache.path_variable || strcmp(path_variable, __path_cache.path_variable) != 0) {
+        __path_cache_clear_entries();
+        __path_cache.last_check = now;
+        return __path_cache_load_directories(path_variable);
+    }
+
+    if (now.tv_sec - __path_cache.last_check.tv_sec < PATH_CACHE_RECHECK_INTERVAL)
+        return 0;
+    __path_cache.last_check = now;
+
+    int changed = 0;
+    for (size_t i = 0; i < __path_cache.ndirectories; ++i) {
+        path_cache_directory_t *directory = __path_cache.directories + i;
+        struct timespec         modification_time;
+        __path_cache_get_modification_time(directory->path, &modification_time);
+
+        if (modification_time.tv_sec != directory->modification_time.tv_sec ||
+            modification_time.tv_nsec != directory->modification_time.tv_nsec) {
+            directory->modification_time = modification_time;
+            changed                      = 1;
+        }
+    }
+
+    if (changed)
+        __path_cache_clear_entries();
+    return 0;
+}
+
+/**
+ * @brief  Checks if a file is an executable that can be run by this process.
+ * @param  path Path to the file. Mustn't be `NULL` (unchecked).
+ * @return Whether @p path is executable.
+ */
+int __path_cache_is_executable(const char *path) {
+    struct stat statbuf;
+    return stat(path, &statbuf) == 0 && S_ISREG(statbuf.st_mode) && access(path, X_OK) == 0;
+}
+
+/**
+ * @brief  Looks for a program in the directories of `$PATH`, without using the cache.
+ * @param  name Name of the program. Mustn't be `NULL` (unchecked).
+ * @return The location of the program, that must be `free()`d, or `NULL` on failure (check
+ *         `errno`).
+ *
+ * | `errno`  | Cause                       |
+ * | -------- | --------------------------- |
+ * | `ENOENT` | @p name couldn't be found.  |
+ * | `ENOMEM` | Allocation failure.         |
+ */
+char *__path_cache_search(const char *name) {
+    char candidate[PATH_MAX];
+    for (size_t i = 0; i < __path_cache.ndirectories; ++i) {
+        const char *directory = __path_cache.directories[i].path;
+        int         length    = snprintf(candidate,
+                                PATH_MAX,
+                                "%s%s%s",
+                                directory,
+                                *directory ? "/" : "",
+                                name);
+        if (length < 0 || length >= PATH_MAX)
+            continue;
+
+        if (__path_cache_is_executable(candidate)) {
+            char *ret = malloc(length + 1);
+            if (!ret)
+                return NULL; /* errno = ENOMEM guaranteed */
+
+            memcpy(ret, candidate, length + 1);
+            return ret;
+        }
+    }
+
+    errno = ENOENT;
+    return NULL;
+}
+
+/**
+ * @brief  Finds the slot in the hash table for a program.
+ * @param  name Name of the program. Mustn't be `NULL` (unchecked).
+ * @return The slot where @p name is, or an unused slot where it can be inserted. The hash table
+ *         mustn't be full nor have `0` capacity (unchecked).
+ */
+path_cache_entry_t *__path_cache_find_slot(const char *name) {
+    size_t mask = __path_cache.capacity - 1;
+    for (size_t i = __path_cache_hash(name) & mask;; i = (i + 1) & mask) {
+        path_cache_entry_t *entry = __path_cache.entries + i;
+        if (!entry->name || strcmp(entry->name, name) == 0)
+            return entry;
+    }
+}
+
+/**
+ * @brief  Makes sure there's space for a new program in the hash table.
+ * @retval 0 Success.
+ * @retval 1 Allocation failure (`errno = ENOMEM`).
+ */
+int __path_cache_reserve(void) {
+    if (__path_cache.count >= PATH_CACHE_MAXIMUM_ENTRIES)
+        __path_cache_clear_entries();
+
+    /* Keep the load factor under 3/4 */
+    if ((__path_cache.count + 1) * 4 <= __path_cache.capacity * 3)
+        return 0;
+
+    size_t              old_capacity = __path_cache.capacity;
+    path_cache_entry_t *old_entries  = __path_cache.entries;
+    size_t new_capacity = old_capacity ? old_capacity * 2 : PATH_CACHE_INITIAL_CAPACITY;
+
+    path_cache_entry_t *new_entries = calloc(new_capacity, sizeof(path_cache_entry_t));
+    if (!new_entries)
+        return 1; /* errno = ENOMEM guaranteed */
+
+    __path_cache.entries  = new_entries;
+    __path_cache.capacity = new_capacity;
+    for (size_t i = 0; i < old_capacity; ++i)
+        if (old_entries[i].name)
+            *__path_cache_find_slot(old_entries[i].name) = old_entries[i];
+
+    free(old_entries);
+    return 0;
+}
+
+const char *path_cache_resolve(const char *name) {
+    if (!name) {
+        errno = EINVAL;
+        return NULL;
+    }
+
+    if (!*name) {
+        errno = ENOENT;
+        return NULL;
+    }
+
+    if (strchr(name, '/')) {
+        if (__path_cache_is_executable(name))
+            return name;
+
+        errno = ENOENT;
+        return NULL;
+    }
+
+    if (__path_cache_validate() || __path_cache_reserve())
+        return NULL; /* errno = ENOMEM guaranteed */
+
+    path_cache_entry_t *entry = __path_cache_find_slot(name);
+    if (!entry->name) {
+        char *name_copy = malloc(strlen(name) + 1);
+        if (!name_copy)
+            return NULL; /* errno = ENOMEM guaranteed */
+        strcpy(name_copy, name);
+
+        char *path = __path_cache_search(name);
+        if (!path && errno == ENOMEM) {
+            free(name_copy);
+            return NULL;
+        }
+
+        entry->name = name_copy;
+        entry->path = path; /* NULL is cached too */
+        __path_cache.count++;
+    }
+
+    if (!entry->path)
+        errno = ENOENT;
+    return entry->path;
+}
+
+void path_cache_clear(void) {
+    __path_cache_clear_entries();
+    free(__path_cache.path_variable);
+    free(__path_cache.directories);
+    __path_cache = (path_cache_t) {0};
+}
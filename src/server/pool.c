@@ -0,0 +1,293 @@
+/*
+ * Copyright 2024 Humberto Gomes, José Lopes, José Matos
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+/**
+ * @file  server/pool.c
+ * @brief Implementation of methods in server/pool.h
+ */
+
+#include <errno.h>
+#include <stdint.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "server/pool.h"
+
+/**
+ * @brief   Size (and alignment) of a slab.
+ * @details Slabs are aligned to their size, so that the slab an object belongs to can be found by
+ *          masking the object's address.
+ */
+#define POOL_SLAB_SIZE (64 * 1024)
+
+/** @brief Alignment of objects in a slab. */
+#define POOL_OBJECT_ALIGNMENT 16
+
+/** @brief Offset of the first object in a slab, after the slab's header. */
+#define POOL_FIRST_OBJECT_OFFSET                                                                   \
+    ((sizeof(pool_slab_t) + POOL_OBJECT_ALIGNMENT - 1) & ~((size_t) POOL_OBJECT_ALIGNMENT - 1))
+
+/** @brief Number of objects of a size class (given its index) that fit in a slab. */
+#define POOL_OBJECTS_PER_SLAB(class_index)                                                         \
+    ((POOL_SLAB_SIZE - POOL_FIRST_OBJECT_OFFSET) /                                                 \
+     ((size_t) POOL_MINIMUM_OBJECT_SIZE << (class_index)))
+
+/** @brief Number of empty slabs kept by a size class to avoid system allocator calls. */
+#define POOL_RETAINED_EMPTY_SLABS 1
+
+/**
+ * @struct pool_free_object_t
+ * @brief  A free object in a slab, that points to the next free object in the same slab.
+ */
+typedef struct pool_free_object {
+    struct pool_free_object *next; /**< @brief Next free object in the slab. */
+} pool_free_object_t;
+
+/**
+ * @struct pool_slab_t
+ * @brief  Header at the start of every slab.
+ *
+ * @var pool_slab_t::previous
+ *     @brief Previous slab in pool_size_class_t::available.
+ * @var pool_slab_t::next
+ *     @brief Next slab in pool_size_class_t::available.
+ * @var pool_slab_t::free_list
+ *     @brief Free objects in this slab. `NULL` when the slab is full.
+ * @var pool_slab_t::used
+ *     @brief Number of objects allocated from this slab.
+ */
+typedef struct pool_slab {
+    struct pool_slab   *previous, *next;
+    pool_free_object_t *free_list;
+    size_t              used;
+} pool_slab_t;
+
+/**
+ * @struct pool_size_class_t
+ * @brief  Slabs of objects of the same size.
+ *
+ * @var pool_size_class_t::available
+ *     @brief Doubly-linked list of slabs with at least one free object.
+ * @var pool_size_class_t::empty_slabs
+ *     @brief Number of slabs in pool_size_class_t::available with no allocated objects.
+ * @var pool_size_class_t::statistics
+ *     @brief Usage counters of this size class.
+ */
+typedef struct {
+    pool_slab_t      *available;
+    size_t            empty_slabs;
+    pool_statistics_t statistics;
+} pool_size_class_t;
+
+/** @brief Size classes of all pools, followed by the counters of non-pooled objects. */
+static pool_size_class_t __pool_size_classes[POOL_SIZE_CLASS_COUNT + 1];
+
+/**
+ * @brief  Gets the size class for objects of a given size.
+ * @param  size Size of the object.
+ * @return The index of the size class, or ::POOL_SIZE_CLASS_COUNT if the object is too large.
+ */
+size_t __pool_get_size_class(size_t size) {
+    size_t class_index = 0, class_size = POOL_MINIMUM_OBJECT_SIZE;
+    while (class_size < size && class_index < POOL_SIZE_CLASS_COUNT) {
+        class_size *= 2;
+        class_index++;
+    }
+    return class_index;
+}
+
+/**
+ * @brief Unlinks a slab from pool_size_class_t::available.
+ * @param size_class Size class @p slab belongs to. Mustn't be `NULL` (unchecked).
+ * @param slab       Slab to be unlinked. Mustn't be `NULL` (unchecked).
+ */
+void __pool_slab_unlink(pool_size_class_t *size_class, pool_slab_t *slab) {
+    if (slab->previous)
+        slab->previous->next = slab->next;
+    else
+        size_class->available = slab->next;
+
+    if (slab->next)
+        slab->next->previous = slab->previous;
+    slab->previous = slab->next = NULL;
+}
+
+/**
+ * @brief Links a slab to the start of pool_size_class_t::available.
+ * @param size_class Size class @p slab belongs to. Mustn't be `NULL` (unchecked).
+ * @param slab       Slab to be linked. Mustn't be `NULL` (unchecked).
+ */
+void __pool_slab_link(pool_size_class_t *size_class, pool_slab_t *slab) {
+    slab->previous = NULL;
+    slab->next     = size_class->available;
+    if (size_class->available)
+        size_class->available->previous = slab;
+    size_class->available = slab;
+}
+
+/**
+ * @brief  Allocates a new empty slab and adds it to a size class.
+ * @param  class_index Index of the size class. Must be valid (unchecked).
+ * @return The new slab, or `NULL` on allocation failure (`errno = ENOMEM`).
+ */
+pool_slab_t *__pool_slab_new(size_t class_index) {
+    pool_size_class_t *size_class  = __pool_size_classes + class_index;
+    size_t             object_size = (size_t) POOL_MINIMUM_OBJECT_SIZE << class_index;
+
+    void *memory;
+    if (posix_memalign(&memory, POOL_SLAB_SIZE, POOL_SLAB_SIZE)) {
+        errno = ENOMEM;
+        return NULL;
+    }
+
+    pool_slab_t *slab = memory;
+    slab->used        = 0;
+    slab->free_list   = NULL;
+
+    /* Build the free list backwards, so that objects are handed out in address order */
+    size_t nobjects = POOL_OBJECTS_PER_SLAB(class_index);
+    for (size_t i = nobjects; i > 0; --i) {
+        pool_free_object_t *object = (pool_free_object_t *) ((uint8_t *) memory +
+                                                             POOL_FIRST_OBJECT_OFFSET +
+                                                             (i - 1) * object_size);
+        object->next    = slab->free_list;
+        slab->free_list = object;
+    }
+
+    __pool_slab_link(size_class, slab);
+    size_class->empty_slabs++;
+    size_class->statistics.slabs++;
+    size_class->statistics.free += nobjects;
+    size_class->statistics.system_allocations++;
+    return slab;
+}
+
+void *pool_allocate(size_t size) {
+    size_t             class_index = __pool_get_size_class(size);
+    pool_size_class_t *size_class  = __pool_size_classes + class_index;
+
+    if (class_index == POOL_SIZE_CLASS_COUNT) {
+        void *ret = malloc(size);
+        if (!ret)
+            return NULL; /* errno = ENOMEM guaranteed */
+
+        size_class->statistics.used++;
+        size_class->statistics.allocations++;
+        size_class->statistics.system_allocations++;
+        return ret;
+    }
+
+    pool_slab_t *slab = size_class->available;
+    if (!slab) {
+        slab = __pool_slab_new(class_index);
+        if (!slab)
+            return NULL; /* errno = ENOMEM guaranteed */
+    }
+
+    pool_free_object_t *ret = slab->free_list;
+    slab->free_list         = ret->next;
+    if (slab->used == 0)
+        size_class->empty_slabs--;
+    slab->used++;
+    if (!slab->free_list)
+        __pool_slab_unlink(size_class, slab);
+
+    size_class->statistics.used++;
+    size_class->statistics.free--;
+    size_class->statistics.allocations++;
+    return ret;
+}
+
+void pool_free(void *object, size_t size) {
+    if (!object)
+        return; /* Don't set errno, as that's not typical free behavior */
+
+    size_t             class_index = __pool_get_size_class(size);
+    pool_size_class_t *size_class  = __pool_size_classes + class_index;
+    size_class->statistics.used--;
+
+    if (class_index == POOL_SIZE_CLASS_COUNT) {
+        free(object);
+        return;
+    }
+
+    pool_slab_t *slab = (pool_slab_t *) ((uintptr_t) object & ~((uintptr_t) POOL_SLAB_SIZE - 1));
+    if (!slab->free_list)
+        __pool_slab_link(size_class, slab); /* Slab was full */
+
+    pool_free_object_t *free_object = object;
+    free_object->next               = slab->free_list;
+    slab->free_list                 = free_object;
+    slab->used--;
+    size_class->statistics.free++;
+
+    if (slab->used == 0) {
+        if (size_class->empty_slabs >= POOL_RETAINED_EMPTY_SLABS) {
+            __pool_slab_unlink(size_class, slab);
+            size_class->statistics.free -= POOL_OBJECTS_PER_SLAB(class_index);
+            size_class->statistics.slabs--;
+            free(slab);
+        } else {
+            size_class->empty_slabs++;
+        }
+    }
+}
+
+void *pool_reallocate(void *object, size_t old_size, size_t new_size) {
+    if (object && __pool_get_size_class(old_size) == __pool_get_size_class(new_size) &&
+        new_size <= POOL_MAXIMUM_OBJECT_SIZE)
+        return object; /* Same slot fits the new size */
+
+    void *ret = pool_allocate(new_size);
+    if (!ret)
+        return NULL; /* errno = ENOMEM guaranteed */
+
+    if (object) {
+        memcpy(ret, object, old_size < new_size ? old_size : new_size);
+        pool_free(object, old_size);
+    }
+    return ret;
+}
+
+char *pool_duplicate_string(const char *string) {
+    if (!string) {
+        errno = EINVAL;
+        return NULL;
+    }
+
+    size_t length = strlen(string) + 1;
+    char  *ret    = pool_allocate(length);
+    if (!ret)
+        return NULL; /* errno = ENOMEM guaranteed */
+
+    memcpy(ret, string, length);
+    return ret;
+}
+
+void pool_free_string(char *string) {
+    if (string)
+        pool_free(string, strlen(string) + 1);
+}
+
+void pool_get_statistics(pool_statistics_t out[POOL_SIZE_CLASS_COUNT + 1]) {
+    for (size_t i = 0; i <= POOL_SIZE_CLASS_COUNT; ++i) {
+        out[i] = __pool_size_classes[i].statistics;
+        if (i == POOL_SIZE_CLASS_COUNT)
+            out[i].object_size = 0;
+        else
+            out[i].object_size = (size_t) POOL_MINIMUM_OBJECT_SIZE << i;
+    }
+}
@@ -23,6 +23,7 @@
 #include <stdlib.h>
 #include <string.h>
 
+#include "server/pool.h"
 #include "server/program.h"
 
 /**
@@ -35,12 +36,21 @@
  *     @brief Number of arguments in program::argv.
  * @var program::capacity
  *     @brief Maximum number of arguments (plus `NULL` terminator) in program::argv before
- *            reallocation.
+ *            reallocation. `0` for programs created with ::program_new_in_place, that don't own
+ *            any memory.
+ * @var program::redirections
+ *     @brief Path of the file each standard stream is redirected to / from (`NULL` if not
+ *            redirected).
+ * @var program::append
+ *     @brief Whether each output redirection appends to its file instead of truncating it.
  */
 struct program {
     char **argv;
     size_t length;
     size_t capacity;
+
+    char *redirections[PROGRAM_REDIRECTION_COUNT];
+    int   append[PROGRAM_REDIRECTION_COUNT];
 };
 
 /** @brief Value of program::capacity for newly created empty programs. */
@@ -62,26 +72,27 @@ program_t *program_new_from_arguments(const char *const *arguments, ssize_t leng
             length++;
     }
 
-    program_t *ret = malloc(sizeof(program_t));
+    program_t *ret = pool_allocate(sizeof(program_t));
     if (!ret)
         return NULL; /* errno = ENOMEM guaranteed */
 
+    /* Space is also needed for the terminating NULL */
     ssize_t first_power = 1;
-    while (first_power < length)
+    while (first_power < length + 1)
         first_power *= 2;
     if (first_power < PROGRAM_INITIAL_CAPACITY)
         first_power = PROGRAM_INITIAL_CAPACITY;
 
     ret->length   = length;
     ret->capacity = first_power;
-    ret->argv     = malloc(sizeof(char *) * ret->capacity);
+    ret->argv     = pool_allocate(sizeof(char *) * ret->capacity);
     if (!ret->argv) {
-        free(ret); /* Won't modify errno = ENOMEM */
+        pool_free(ret, sizeof(program_t)); /* Won't modify errno = ENOMEM */
         return NULL;
     }
 
     for (ssize_t i = 0; i < length; ++i) {
-        ret->argv[i] = strdup(arguments[i]);
+        ret->argv[i] = pool_duplicate_string(arguments[i]);
         if (!ret->argv[i]) {
             ret->length = i;
             program_free(ret);
@@ -90,17 +101,55 @@ program_t *program_new_from_arguments(const char *const *arguments, ssize_t leng
     }
     ret->argv[length] = NULL;
 
+    for (size_t i = 0; i < PROGRAM_REDIRECTION_COUNT; ++i) {
+        ret->redirections[i] = NULL;
+        ret->append[i]       = 0;
+    }
+    return ret;
+}
+
+size_t program_get_in_place_size(size_t argc) {
+    return sizeof(program_t) + sizeof(char *) * (argc + 1);
+}
+
+program_t *program_new_in_place(void                   *memory,
+                                char                   *strings,
+                                const size_t           *offsets,
+                                const program_layout_t *layout) {
+    if (!memory || !strings || !offsets || !layout) {
+        errno = EINVAL;
+        return NULL;
+    }
+
+    program_t *ret = memory;
+    ret->argv      = (char **) (ret + 1);
+    ret->length    = layout->argument_count;
+    ret->capacity  = 0;
+
+    for (size_t i = 0; i < layout->argument_count; ++i)
+        ret->argv[i] = strings + offsets[i];
+    ret->argv[layout->argument_count] = NULL;
+
+    for (size_t i = 0; i < PROGRAM_REDIRECTION_COUNT; ++i) {
+        if (layout->redirections[i] == PROGRAM_NO_REDIRECTION)
+            ret->redirections[i] = NULL;
+        else
+            ret->redirections[i] = strings + layout->redirections[i];
+        ret->append[i] = layout->append[i];
+    }
     return ret;
 }
 
 void program_free(program_t *program) {
-    if (!program)
+    if (!program || program->capacity == 0)
         return; /* Don't set EINVAL, as that's normal free behavior. */
 
     for (size_t i = 0; i < program->length; ++i)
-        free(program->argv[i]);
-    free(program->argv);
-    free(program);
+        pool_free_string(program->argv[i]);
+    for (size_t i = 0; i < PROGRAM_REDIRECTION_COUNT; ++i)
+        pool_free_string(program->redirections[i]);
+    pool_free(program->argv, sizeof(char *) * program->capacity);
+    pool_free(program, sizeof(program_t));
 }
 
 program_t *program_clone(const program_t *program) {
@@ -108,24 +157,37 @@ program_t *program_clone(const program_t *program) {
         errno = EINVAL;
         return NULL;
     }
-    return program_new_from_arguments((const char *const *) program->argv, program->length);
+    program_t *ret =
+        program_new_from_arguments((const char *const *) program->argv, program->length);
+    if (!ret)
+        return NULL; /* errno = ENOMEM guaranteed */
+
+    for (program_redirection_t i = 0; i < PROGRAM_REDIRECTION_COUNT; ++i) {
+        if (program_set_redirection(ret, i, program->redirections[i], program->append[i])) {
+            program_free(ret);
+            return NULL; /* errno = ENOMEM guaranteed */
+        }
+    }
+    return ret;
 }
 
 int program_add_argument(program_t *program, const char *argument) {
-    if (!program || !argument) {
+    if (!program || !argument || program->capacity == 0) {
         errno = EINVAL;
         return 1;
     }
 
-    char *new_argument = strdup(argument);
+    char *new_argument = pool_duplicate_string(argument);
     if (!new_argument)
         return 1; /* errno = ENOMEM guaranteed */
 
     if (program->length >= program->capacity - 2) {
         size_t new_capacity = program->capacity * 2;
-        char **new_argv     = realloc(program->argv, sizeof(char *) * new_capacity);
+        char **new_argv     = pool_reallocate(program->argv,
+                                          sizeof(char *) * program->capacity,
+                                          sizeof(char *) * new_capacity);
         if (!new_argv) {
-            free(new_argument);
+            pool_free_string(new_argument);
             return 1; /* errno = ENOMEM guaranteed */
         }
 
@@ -139,6 +201,41 @@ int program_add_argument(program_t *program, const char *argument) {
     return 0;
 }
 
+int program_set_redirection(program_t            *program,
+                            program_redirection_t redirection,
+                            const char           *path,
+                            int                   append) {
+    if (!program || program->capacity == 0 || redirection >= PROGRAM_REDIRECTION_COUNT) {
+        errno = EINVAL;
+        return 1;
+    }
+
+    char *new_path = NULL;
+    if (path) {
+        new_path = pool_duplicate_string(path);
+        if (!new_path)
+            return 1; /* errno = ENOMEM guaranteed */
+    }
+
+    pool_free_string(program->redirections[redirection]);
+    program->redirections[redirection] = new_path;
+    program->append[redirection]       = append;
+    return 0;
+}
+
+const char *program_get_redirection(const program_t      *program,
+                                    program_redirection_t redirection,
+                                    int                  *append) {
+    if (!program || redirection >= PROGRAM_REDIRECTION_COUNT) {
+        errno = EINVAL;
+        return NULL;
+    }
+
+    if (append)
+        *append = program->append[redirection];
+    return program->redirections[redirection];
+}
+
 const char *const *program_get_arguments(const program_t *program) {
     if (!program) {
         errno = EINVAL;
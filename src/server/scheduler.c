@@ -26,9 +26,11 @@
 #include <sys/wait.h>
 #include <unistd.h>
 
+#include "metrics.h"
 #include "server/priority_queue.h"
 #include "server/scheduler.h"
 #include "server/task_runner.h"
+#include "trace.h"
 #include "util.h"
 
 /**
@@ -58,14 +60,14 @@ typedef struct {
  *     @brief Maximum number of tasks scheduled concurrently.
  * @var scheduler::slots
  *     @brief Slots where to dispatch tasks (as many as ::scheduler::ntasks).
- * @var scheduler::directory
- *     @brief Path to output directory.
+ * @var scheduler::store
+ *     @brief Where to store the output of tasks.
  */
 struct scheduler {
-    priority_queue_t *queue;
-    size_t            ntasks;
-    scheduler_slot_t *slots;
-    char             *directory;
+    priority_queue_t     *queue;
+    size_t                ntasks;
+    scheduler_slot_t     *slots;
+    const output_store_t *store;
 };
 
 /** @brief ::priority_queue_compare_function_t for ::SCHEDULER_POLICY_FCFS. */
@@ -88,8 +90,22 @@ int __scheduler_compare_sjf(const tagged_task_t *a, const tagged_task_t *b) {
     return (int64_t) tagged_task_get_expected_time(a) - (int64_t) tagged_task_get_expected_time(b);
 }
 
-scheduler_t *scheduler_new(scheduler_policy_t policy, size_t ntasks, const char *directory) {
-    if (!ntasks || !directory) {
+priority_queue_compare_function_t scheduler_get_compare_function(scheduler_policy_t policy) {
+    switch (policy) {
+        case SCHEDULER_POLICY_FCFS:
+            return __scheduler_compare_fcfs;
+        case SCHEDULER_POLICY_SJF:
+            return __scheduler_compare_sjf;
+        default:
+            errno = EINVAL;
+            return NULL;
+    }
+}
+
+scheduler_t *
+    scheduler_new(scheduler_policy_t policy, size_t ntasks, const output_store_t *store) {
+    priority_queue_compare_function_t compare = scheduler_get_compare_function(policy);
+    if (!ntasks || !compare) {
         errno = EINVAL;
         return NULL;
     }
@@ -98,18 +114,7 @@ scheduler_t *scheduler_new(scheduler_policy_t policy, size_t ntasks, const char
     if (!ret)
         return NULL; /* errno = ENOMEM guaranteed */
 
-    switch (policy) {
-        case SCHEDULER_POLICY_FCFS:
-            ret->queue = priority_queue_new(__scheduler_compare_fcfs);
-            break;
-        case SCHEDULER_POLICY_SJF:
-            ret->queue = priority_queue_new(__scheduler_compare_sjf);
-            break;
-        default:
-            errno = EINVAL;
-            free(ret);
-            return NULL;
-    }
+    ret->queue = priority_queue_new(compare);
     if (!ret->queue) {
         free(ret);
         return NULL; /* errno = ENOMEM guaranteed */
@@ -125,15 +130,7 @@ scheduler_t *scheduler_new(scheduler_policy_t policy, size_t ntasks, const char
         ret->slots[i].available = 1;
 
     ret->ntasks = ntasks;
-
-    ret->directory = strdup(directory);
-    if (!ret->directory) {
-        priority_queue_free(ret->queue);
-        free(ret->slots);
-        free(ret);
-        return NULL; /* errno = ENOMEM guaranteed */
-    }
-
+    ret->store  = store;
     return ret;
 }
 
@@ -147,7 +144,6 @@ void scheduler_free(scheduler_t *scheduler) {
     free(scheduler->slots);
 
     priority_queue_free(scheduler->queue);
-    free(scheduler->directory);
     free(scheduler);
 }
 
@@ -166,10 +162,35 @@ int scheduler_can_schedule_now(scheduler_t *scheduler) {
     return 0;
 }
 
+/**
+ * @brief  Forks a task runner for a dispatched task. The ::scheduler_dispatcher_t used by
+ *         ::scheduler_dispatch_possible.
+ * @param  task  Dispatched task. Mustn't be `NULL` (unchecked).
+ * @param  slot  Slot where @p task was dispatched to.
+ * @param  state The ::scheduler_t @p task was dispatched from. Mustn't be `NULL` (unchecked).
+ * @return The PID of the task runner, `-1` on failure (check `errno`).
+ */
+pid_t __scheduler_fork_runner(tagged_task_t *task, size_t slot, void *state) {
+    scheduler_t *scheduler = state;
+
+    pid_t p = fork();
+    if (p == 0)
+        _exit(task_runner_main(task, slot, scheduler->store));
+    else if (p < 0)
+        metrics_add(METRICS_COUNTER_FORK_FAILURES, 1);
+    return p;
+}
+
 ssize_t scheduler_dispatch_possible(scheduler_t *scheduler) {
-    if (!scheduler) {
+    return scheduler_dispatch_with(scheduler, __scheduler_fork_runner, scheduler);
+}
+
+ssize_t scheduler_dispatch_with(scheduler_t           *scheduler,
+                                scheduler_dispatcher_t dispatcher,
+                                void                  *state) {
+    if (!scheduler || !dispatcher) {
         errno = EINVAL;
-        return 1;
+        return -1;
     }
 
     tagged_task_t *task;
@@ -186,7 +207,7 @@ ssize_t scheduler_dispatch_possible(scheduler_t *scheduler) {
                            __func__,
                            tagged_task_get_id(task));
                 tagged_task_free(task);
-                return 1;
+                return -1;
             }
 
             tagged_task_free(task);
@@ -198,20 +219,28 @@ ssize_t scheduler_dispatch_possible(scheduler_t *scheduler) {
         scheduler->slots[slot_search].available = 0;
         scheduler->slots[slot_search].task      = task;
 
-        pid_t p = fork();
-        if (p == 0) {
-            _exit(task_runner_main(task, slot_search, scheduler->directory));
-        } else if (p < 0) {
+        /* Status procedures aren't traced nor counted */
+        size_t nprograms;
+        int    has_programs = task_get_programs(tagged_task_get_task(task), &nprograms) != NULL;
+        if (has_programs)
+            trace_event(TRACE_EVENT_DISPATCH, tagged_task_get_id(task), slot_search);
+
+        pid_t p = dispatcher(task, slot_search, state);
+        if (p < 0) {
             char error_msg[LINE_MAX] = {0};
             (void) strerror_r(errno, error_msg, LINE_MAX);
-            util_error("%s(): Task %" PRIu32 " was dropped: fork() failed: %s\n",
+            util_error("%s(): Task %" PRIu32 " was dropped: dispatch failed: %s\n",
                        __func__,
                        tagged_task_get_id(task),
                        error_msg);
+            scheduler->slots[slot_search].available = 1;
+            scheduler->slots[slot_search].task      = NULL;
             tagged_task_free(task);
-            return 1;
+            return -1;
         } else {
             scheduler->slots[slot_search].pid = p;
+            if (has_programs)
+                metrics_add(METRICS_COUNTER_DISPATCHED, 1);
         }
 
         dispatched++;
@@ -233,12 +262,14 @@ tagged_task_t *
         return NULL;
     }
 
-    if (waitpid(scheduler->slots[slot].pid, NULL, 0) < 0) {
+    /* Tasks dispatched without a process (PID 0) aren't waited for */
+    if (scheduler->slots[slot].pid && waitpid(scheduler->slots[slot].pid, NULL, 0) < 0) {
         util_error("waitpid(%ld) failed for (task %" PRIu32 ")!\n",
                    (long) scheduler->slots[slot].pid,
                    tagged_task_get_id(scheduler->slots[slot].task));
         tagged_task_free(scheduler->slots[slot].task);
         scheduler->slots[slot].available = 1;
+        scheduler->slots[slot].task      = NULL;
         return NULL; /* Keep errno */
     }
 
@@ -250,6 +281,20 @@ tagged_task_t *
     return ret;
 }
 
+pid_t scheduler_get_runner_pid(scheduler_t *scheduler, uint32_t id) {
+    if (!scheduler) {
+        errno = EINVAL;
+        return -1;
+    }
+
+    for (size_t i = 0; i < scheduler->ntasks; ++i)
+        if (!scheduler->slots[i].available && tagged_task_get_id(scheduler->slots[i].task) == id)
+            return scheduler->slots[i].pid;
+
+    errno = ESRCH;
+    return -1;
+}
+
 int scheduler_get_running_tasks(scheduler_t              *scheduler,
                                 scheduler_task_iterator_t callback,
                                 void                     *state) {
@@ -286,3 +331,21 @@ int scheduler_get_scheduled_tasks(scheduler_t              *scheduler,
     }
     return 0;
 }
+
+int scheduler_get_load(const scheduler_t *scheduler,
+                       size_t            *running,
+                       size_t            *queued,
+                       size_t            *slots) {
+    if (!scheduler || !running || !queued || !slots) {
+        errno = EINVAL;
+        return 1;
+    }
+
+    *running = 0;
+    for (size_t i = 0; i < scheduler->ntasks; ++i)
+        *running += !scheduler->slots[i].available;
+
+    (void) priority_queue_get_tasks(scheduler->queue, queued);
+    *slots = scheduler->ntasks;
+    return 0;
+}
@@ -20,13 +20,24 @@
  */
 
 #include <errno.h>
+#include <signal.h>
 #include <stdio.h>
+#include <stdlib.h>
 #include <string.h>
+#include <time.h>
+#include <unistd.h>
 
+#include "live_state.h"
+#include "metrics.h"
 #include "protocol.h"
-#include "server/log_file.h"
+#include "server/log_store.h"
+#include "server/metrics_file.h"
+#include "server/path_cache.h"
 #include "server/server_requests.h"
+#include "server/statistics.h"
 #include "server/status.h"
+#include "server/task_runner.h"
+#include "trace.h"
 #include "util.h"
 
 /**
@@ -35,6 +46,30 @@
  */
 #define SERVER_REQUESTS_MAX_RETRIES 16
 
+/** @brief Maximum number of status requests answered by a single status task. */
+#define SERVER_REQUESTS_MAXIMUM_STATUS_BATCH 1024
+
+/**
+ * @brief Maximum time (in nanoseconds) a status request waits for others to join its batch, when
+ *        the server is too busy to stop receiving messages.
+ */
+#define SERVER_REQUESTS_STATUS_BATCH_WINDOW 20000000
+
+/** @brief Minimum time (in seconds) between the starts of two sweeps of old task output. */
+#define SERVER_REQUESTS_SWEEP_INTERVAL 10
+
+/** @brief Minimum time (in seconds) between two writes of the metrics file. */
+#define SERVER_REQUESTS_METRICS_INTERVAL 5
+
+/**
+ * @brief   Set when the server receives `SIGTERM` or `SIGINT`, to stop listening for messages.
+ * @details This must be global to be accessible from ::__server_requests_on_termination_signal.
+ */
+static volatile sig_atomic_t __server_requests_terminating = 0;
+
+/** @brief PID of the server, to tell it apart from its children in signal handlers. */
+static pid_t __server_requests_pid = 0;
+
 /**
  * @struct server_state_t
  * @brief  The state of the server, made up by everything it needs to operate.
@@ -49,14 +84,161 @@
  *     @brief The identifier that will be attributed to the next scheduled task.
  * @var server_state_t::log
  *     @brief Where to log completed tasks to.
+ * @var server_state_t::statistics
+ *     @brief Running aggregates of completed tasks.
+ * @var server_state_t::policy
+ *     @brief Scheduling policy of server_state_t::scheduler.
+ * @var server_state_t::status_requests
+ *     @brief Status requests waiting to be answered together by the same status task.
+ * @var server_state_t::status_request_count
+ *     @brief Number of elements in server_state_t::status_requests.
+ * @var server_state_t::status_request_capacity
+ *     @brief Number of allocated elements in server_state_t::status_requests.
+ * @var server_state_t::status_batch_start
+ *     @brief When the first request in server_state_t::status_requests arrived.
+ * @var server_state_t::live_state
+ *     @brief Where the state of the server is published for local readers.
+ * @var server_state_t::store
+ *     @brief Where the output of tasks is stored.
+ * @var server_state_t::retention
+ *     @brief Limits on the output kept in server_state_t::store.
+ * @var server_state_t::last_sweep
+ *     @brief When the last sweep of old task output was started.
+ * @var server_state_t::compacting
+ *     @brief Number of log segments a status task is compacting (`0` when none is).
+ * @var server_state_t::metrics_path
+ *     @brief Where to write metrics to (`NULL` not to write them).
+ * @var server_state_t::last_metrics
+ *     @brief When the metrics file was last written.
  */
 typedef struct {
-    ipc_t       *ipc;
-    scheduler_t *scheduler, *status_scheduler;
-    uint32_t     next_task_id;
-    log_file_t  *log;
+    ipc_t                   *ipc;
+    scheduler_t             *scheduler, *status_scheduler;
+    uint32_t                 next_task_id;
+    log_store_t             *log;
+    statistics_t            *statistics;
+    scheduler_policy_t       policy;
+    status_request_t        *status_requests;
+    size_t                   status_request_count, status_request_capacity;
+    struct timespec          status_batch_start;
+    live_state_t            *live_state;
+    output_store_t          *store;
+    output_store_retention_t retention;
+    struct timespec          last_sweep;
+    size_t                   compacting;
+    const char              *metrics_path;
+    struct timespec          last_metrics;
 } server_state_t;
 
+/**
+ * @brief Copies a task to be published in a ::live_state_region_t.
+ *
+ * @param out   Where to copy the task to. Mustn't be `NULL` (unchecked).
+ * @param task  Task to be copied. Mustn't be `NULL` (unchecked).
+ * @param error Whether an error happened while running @p task.
+ */
+void __server_requests_copy_live_task(live_state_task_t   *out,
+                                      const tagged_task_t *task,
+                                      int                  error) {
+    out->id    = tagged_task_get_id(task);
+    out->error = error;
+    for (tagged_task_time_t i = 0; i <= TAGGED_TASK_TIME_COMPLETED; ++i) {
+        const struct timespec *time = tagged_task_get_time(task, i);
+        if (time)
+            out->times[i] = *time;
+        else
+            out->times[i] = (struct timespec) {0};
+    }
+
+    /* Truncate long command lines, always keeping the null terminator */
+    strncpy(out->command_line, tagged_task_get_command_line(task), LIVE_STATE_COMMAND_LENGTH - 1);
+    out->command_line[LIVE_STATE_COMMAND_LENGTH - 1] = '\0';
+}
+
+/**
+ * @brief Method called for every running task, to publish it in a ::live_state_region_t.
+ *
+ * @param task        Running task. Mustn't be `NULL` (unchecked).
+ * @param region_data The ::live_state_region_t being updated. Mustn't be `NULL` (unchecked).
+ *
+ * @retval 0 Success.
+ * @retval 1 No space for more tasks. Stop iterating.
+ */
+int __server_requests_publish_running_task(const tagged_task_t *task, void *region_data) {
+    live_state_region_t *region = region_data;
+    if (region->running == LIVE_STATE_MAXIMUM_SLOTS)
+        return 1;
+
+    __server_requests_copy_live_task(region->running_tasks + region->running++, task, 0);
+    return 0;
+}
+
+/**
+ * @brief Updates the state of the server published for local readers.
+ *
+ * @param state           State of the server. Mustn't be `NULL` (unchecked).
+ * @param completed       Task that has just completed, or `NULL` if there's none.
+ * @param error           Whether an error happened while running @p completed.
+ * @param running_changed Whether to publish the running tasks again.
+ */
+void __server_requests_publish(server_state_t      *state,
+                               const tagged_task_t *completed,
+                               int                  error,
+                               int                  running_changed) {
+    live_state_region_t *region = live_state_begin_update(state->live_state);
+
+    size_t running, queued, slots;
+    (void) scheduler_get_load(state->scheduler, &running, &queued, &slots);
+    region->slots        = slots;
+    region->queued       = queued;
+    region->next_task_id = state->next_task_id;
+
+    if (completed) {
+        __server_requests_copy_live_task(region->completions +
+                                             region->completed % LIVE_STATE_COMPLETIONS,
+                                         completed,
+                                         error);
+        region->completed++;
+        region->failed += error != 0;
+    }
+
+    if (running_changed) {
+        region->running = 0;
+        (void) scheduler_get_running_tasks(state->scheduler,
+                                           __server_requests_publish_running_task,
+                                           region);
+    }
+    region->running = running; /* Also counts tasks that didn't fit */
+
+    live_state_end_update(state->live_state);
+}
+
+/**
+ * @brief   Finds the first program in a task whose executable can't be found.
+ * @details Only the first pipeline of the task is checked, as earlier pipelines may create the
+ *          programs of later ones (`cc -o foo foo.c && ./foo`). For the same reason, only names
+ *          looked up in `$PATH` (without a `/`) are checked. Anything else is left for the task
+ *          runner to report.
+ *
+ * @param  task Task to be checked. Mustn't be `NULL` (unchecked).
+ * @return The name of the program, or `NULL` if all programs were found (or on allocation failure,
+ *         in which case the task runner will report any missing programs).
+ */
+const char *__server_requests_find_unknown_program(const tagged_task_t *task) {
+    const task_t           *inner = tagged_task_get_task(task);
+    size_t                  nprograms;
+    const program_t *const *programs = task_get_programs(inner, &nprograms);
+    for (size_t i = 0; i < nprograms; ++i) {
+        const char *name = program_get_arguments(programs[i])[0];
+        if (!strchr(name, '/') && !path_cache_resolve(name) && errno == ENOENT)
+            return name;
+
+        if (task_get_connector(inner, i) != TASK_CONNECTOR_PIPE)
+            break;
+    }
+    return NULL;
+}
+
 /**
  * @brief   Handles an incoming ::protocol_send_program_task_message_t.
  * @details Returns nothing, as all errors are printed to `stderr`.
@@ -103,6 +285,16 @@ void __server_requests_on_schedule_message(server_state_t *state, uint8_t *messa
         }
     }
 
+    /* Reject programs that can't be found now, instead of when the task is run */
+    char error_string[PROTOCOL_MAXIMUM_ERROR_LENGTH + 1] = "Parsing failure!\n";
+    if (!parsing_failure) {
+        const char *unknown_program = __server_requests_find_unknown_program(task);
+        if (unknown_program) {
+            snprintf(error_string, sizeof(error_string), "Unknown program: %s\n", unknown_program);
+            parsing_failure = 1;
+        }
+    }
+
     if (!parsing_failure) {
         if (scheduler_add_task(state->scheduler, task)) {
             /* Out of memory: don't try to inform the client. */
@@ -110,7 +302,10 @@ void __server_requests_on_schedule_message(server_state_t *state, uint8_t *messa
             tagged_task_free(task); /* Handles task = NULL in case of allocation failure */
             return;
         } else {
+            trace_event(TRACE_EVENT_ENQUEUE, state->next_task_id, 0);
+            metrics_add(METRICS_COUNTER_SUBMITTED, 1);
             state->next_task_id++;
+            __server_requests_publish(state, NULL, 0, 0);
         }
     }
     tagged_task_free(task);
@@ -124,7 +319,7 @@ void __server_requests_on_schedule_message(server_state_t *state, uint8_t *messa
     if (parsing_failure) {
         size_t                   error_message_size;
         protocol_error_message_t error_message;
-        protocol_error_message_new(&error_message, &error_message_size, "Parsing failure!\n");
+        protocol_error_message_new(&error_message, &error_message_size, error_string);
 
         if (ipc_send_retry(state->ipc,
                            &error_message,
@@ -145,6 +340,151 @@ void __server_requests_on_schedule_message(server_state_t *state, uint8_t *messa
     ipc_server_close_sending(state->ipc);
 }
 
+/**
+ * @brief Method called for every running or scheduled task, to find the oldest one.
+ *
+ * @param task     Running or scheduled task. Mustn't be `NULL` (unchecked).
+ * @param first_id Lowest identifier found so far (a `uint32_t *`). Mustn't be `NULL` (unchecked).
+ *
+ * @retval 0 Always, to keep iterating.
+ */
+int __server_requests_find_first_active(const tagged_task_t *task, void *first_id) {
+    uint32_t id = tagged_task_get_id(task);
+    if (id < *(uint32_t *) first_id)
+        *(uint32_t *) first_id = id;
+    return 0;
+}
+
+/**
+ * @brief   Starts a status task deleting old task output, if the retention policy requires it.
+ * @details Returns nothing, as all errors are printed to `stderr`. Sweeps are started at most every
+ *          ::SERVER_REQUESTS_SWEEP_INTERVAL seconds, and only when a status task can run now. If it
+ *          can't be started, it's attempted again on the next call.
+ *
+ * @param state State of the server. Mustn't be `NULL` (unchecked).
+ */
+void __server_requests_sweep(server_state_t *state) {
+    if (!state->retention.maximum_age && !state->retention.maximum_size &&
+        !state->retention.keep_last)
+        return;
+
+    struct timespec now;
+    (void) clock_gettime(CLOCK_MONOTONIC, &now);
+    if ((state->last_sweep.tv_sec || state->last_sweep.tv_nsec) &&
+        now.tv_sec - state->last_sweep.tv_sec < SERVER_REQUESTS_SWEEP_INTERVAL)
+        return;
+
+    if (!scheduler_can_schedule_now(state->status_scheduler))
+        return;
+
+    /* The sweep task is forked before this function returns, so its state can be on the stack */
+    status_sweep_state_t sweep_state = {.store        = state->store,
+                                        .retention    = state->retention,
+                                        .first_active = state->next_task_id,
+                                        .next_id      = state->next_task_id};
+    (void) scheduler_get_running_tasks(state->scheduler,
+                                       __server_requests_find_first_active,
+                                       &sweep_state.first_active);
+    (void) scheduler_get_scheduled_tasks(state->scheduler,
+                                         __server_requests_find_first_active,
+                                         &sweep_state.first_active);
+
+    tagged_task_t *task = tagged_task_new_from_procedure(status_sweep_main, &sweep_state, 0, 0);
+    if (!task) {
+        util_perror("__server_requests_sweep(): failed to create task");
+        return;
+    }
+
+    if (scheduler_add_task(state->status_scheduler, task))
+        util_perror("__server_requests_sweep(): scheduler failure");
+    else if (scheduler_dispatch_possible(state->status_scheduler) < 0)
+        util_perror("__server_requests_sweep(): scheduler failure");
+    else
+        state->last_sweep = now;
+    tagged_task_free(task);
+}
+
+/**
+ * @brief   Starts a status task compacting old segments of the log, if its size limit is exceeded.
+ * @details Returns nothing, as all errors are printed to `stderr`. Only one compaction runs at a
+ *          time, and the server only forgets the segments once the task reports having compacted
+ *          them (see ::__server_requests_on_compact_done).
+ *
+ * @param state State of the server. Mustn't be `NULL` (unchecked).
+ */
+void __server_requests_compact(server_state_t *state) {
+    if (state->compacting)
+        return;
+
+    size_t count = log_store_get_compactable(state->log);
+    if (!count || !scheduler_can_schedule_now(state->status_scheduler))
+        return;
+
+    /* The task is forked before this function returns, so its state can be on the stack */
+    status_compact_state_t compact_state = {.log = state->log, .count = count};
+    tagged_task_t *task = tagged_task_new_from_procedure(status_compact_main, &compact_state, 0, 0);
+    if (!task) {
+        util_perror("__server_requests_compact(): failed to create task");
+        return;
+    }
+
+    if (scheduler_add_task(state->status_scheduler, task))
+        util_perror("__server_requests_compact(): scheduler failure");
+    else if (scheduler_dispatch_possible(state->status_scheduler) < 0)
+        util_perror("__server_requests_compact(): scheduler failure");
+    else
+        state->compacting = count;
+    tagged_task_free(task);
+}
+
+/**
+ * @brief   Handles the end of a status task, forgetting the log segments it compacted, if it was
+ *          started by ::__server_requests_compact.
+ * @details If compaction failed, the segments are kept, to be compacted again later.
+ *
+ * @param state State of the server. Mustn't be `NULL` (unchecked).
+ * @param task  Status task that ended. Mustn't be `NULL` (unchecked).
+ * @param error Whether @p task reported a failure.
+ */
+void __server_requests_on_compact_done(server_state_t      *state,
+                                       const tagged_task_t *task,
+                                       int                  error) {
+    task_procedure_t procedure;
+    void            *procedure_state;
+    if (task_get_procedure(tagged_task_get_task(task), &procedure, &procedure_state) ||
+        procedure != status_compact_main)
+        return;
+
+    if (error)
+        util_error("%s(): failed to compact log, segments kept\n", __func__);
+    else
+        log_store_forget_segments(state->log, state->compacting);
+    state->compacting = 0;
+}
+
+/**
+ * @brief   Writes the metrics file, if metrics are being exported.
+ * @details Returns nothing, as all errors are printed to `stderr`. The file is written at most
+ *          every ::SERVER_REQUESTS_METRICS_INTERVAL seconds. It's small enough to be written by the
+ *          server itself, instead of a status task.
+ *
+ * @param state State of the server. Mustn't be `NULL` (unchecked).
+ */
+void __server_requests_write_metrics(server_state_t *state) {
+    if (!state->metrics_path)
+        return;
+
+    struct timespec now;
+    (void) clock_gettime(CLOCK_MONOTONIC, &now);
+    if ((state->last_metrics.tv_sec || state->last_metrics.tv_nsec) &&
+        now.tv_sec - state->last_metrics.tv_sec < SERVER_REQUESTS_METRICS_INTERVAL)
+        return;
+
+    state->last_metrics = now;
+    if (metrics_file_write(state->metrics_path, state->statistics, state->scheduler))
+        util_perror("__server_requests_write_metrics(): failed to write metrics");
+}
+
 /**
  * @brief   Handles an incoming ::protocol_task_done_message_t.
  * @details Returns nothing, as all errors are printed to `stderr`.
@@ -154,7 +494,8 @@ void __server_requests_on_schedule_message(server_state_t *state, uint8_t *messa
  * @param length  Number of bytes in @p message.
  */
 void __server_requests_on_done_message(server_state_t *state, uint8_t *message, size_t length) {
-    if (length != sizeof(protocol_task_done_message_t)) {
+    size_t nstages;
+    if (!protocol_task_done_message_check_length(length, &nstages)) {
         util_error("%s(): invalid message received!\n", __func__);
         return;
     }
@@ -168,17 +509,98 @@ void __server_requests_on_done_message(server_state_t *state, uint8_t *message,
         return;
     }
 
-    if (!fields->is_status)
-        if (log_file_write_task(state->log, task, fields->error))
+    /* Copy the stages out of the packed message, for them to be aligned */
+    tagged_task_stage_t stages[TAGGED_TASK_MAXIMUM_STAGES];
+    memcpy(stages, message + PROTOCOL_TASK_DONE_HEADER_LENGTH, nstages * sizeof(*stages));
+    if (nstages && tagged_task_set_stages(task, stages, nstages))
+        util_perror("__server_requests_on_done_message(): failed to store stage statistics");
+
+    if (!fields->is_status) {
+        uint32_t task_id = tagged_task_get_id(task);
+        trace_event(TRACE_EVENT_DONE, task_id, 0);
+        __server_requests_publish(state, task, fields->error, 1);
+        statistics_add_task(state->statistics, task, fields->error);
+
+        uint64_t trace_start = trace_begin();
+        if (log_store_write_task(state->log, task, fields->error))
             util_perror(
-                "__server_requests_on_done_message(): failed to log completed task to file");
+                "__server_requests_on_done_message(): failed to log completed task");
+        trace_end(TRACE_EVENT_LOG_WRITE, task_id, 0, trace_start);
+    } else {
+        __server_requests_on_compact_done(state, task, fields->error);
+    }
     tagged_task_free(task);
+
+    if (!fields->is_status) { /* Stored output and the log have grown */
+        __server_requests_sweep(state);
+        __server_requests_compact(state);
+        __server_requests_write_metrics(state);
+    }
 }
 
 /**
- * @brief   Handles an incoming ::PROTOCOL_C2S_STATUS message.
+ * @brief   Tells a client asking for the status of the server that it can't be answered.
  * @details Returns nothing, as all errors are printed to `stderr`.
  *
+ * @param state      State of the server. Mustn't be `NULL` (unchecked).
+ * @param client_pid PID of the client.
+ */
+void __server_requests_refuse_status(server_state_t *state, pid_t client_pid) {
+    if (ipc_server_open_sending(state->ipc, client_pid)) {
+        util_perror("__server_requests_refuse_status(): failed to open connection");
+        return;
+    }
+
+    size_t                   error_message_size;
+    protocol_error_message_t error_message;
+    protocol_error_message_new(&error_message, &error_message_size, "No capacity available!\n");
+
+    if (ipc_send_retry(state->ipc, &error_message, error_message_size, SERVER_REQUESTS_MAX_RETRIES))
+        util_perror("__server_requests_refuse_status(): failure sending message");
+
+    ipc_server_close_sending(state->ipc);
+}
+
+/**
+ * @brief   Starts a status task answering all pending status requests.
+ * @details Returns nothing, as all errors are printed to `stderr`. If no status task can be started
+ *          now, requests are kept pending until one finishes.
+ *
+ * @param state State of the server. Mustn't be `NULL` (unchecked).
+ */
+void __server_requests_dispatch_status_batch(server_state_t *state) {
+    if (!state->status_request_count || !scheduler_can_schedule_now(state->status_scheduler))
+        return;
+
+    /* The status task is forked before this function returns, so its state can be on the stack */
+    status_state_t status_state = {.log           = state->log,
+                                   .scheduler     = state->scheduler,
+                                   .requests      = state->status_requests,
+                                   .request_count = state->status_request_count};
+    tagged_task_t *task = tagged_task_new_from_procedure(status_main, &status_state, 0, 0);
+    if (!task) {
+        util_perror("__server_requests_dispatch_status_batch(): failed to create task");
+    } else if (scheduler_add_task(state->status_scheduler, task)) {
+        util_perror("__server_requests_dispatch_status_batch(): scheduler failure");
+        tagged_task_free(task);
+        task = NULL;
+    } else {
+        if (scheduler_dispatch_possible(state->status_scheduler) < 0)
+            util_perror("__server_requests_dispatch_status_batch(): scheduler failure");
+        tagged_task_free(task);
+    }
+
+    if (!task) /* Don't leave clients waiting forever */
+        for (size_t i = 0; i < state->status_request_count; ++i)
+            __server_requests_refuse_status(state, state->status_requests[i].client_pid);
+    state->status_request_count = 0;
+}
+
+/**
+ * @brief   Handles an incoming ::PROTOCOL_C2S_STATUS message.
+ * @details Returns nothing, as all errors are printed to `stderr`. The request is only added to
+ *          the pending batch, answered by ::__server_requests_dispatch_status_batch.
+ *
  * @param state   State of the server. Mustn't be `NULL` (unchecked).
  * @param message Bytes of the received message. Mustn't be `NULL` (unchecked).
  * @param length  Number of bytes in @p message.
@@ -188,45 +610,281 @@ void __server_requests_on_status_message(server_state_t *state, uint8_t *message
         util_error("%s(): invalid message received!\n", __func__);
         return;
     }
+    protocol_status_request_message_t *fields = (protocol_status_request_message_t *) message;
 
-    protocol_status_request_message_t *fields       = (protocol_status_request_message_t *) message;
-    status_state_t                     status_state = {.ipc        = state->ipc,
-                                                       .client_pid = fields->client_pid,
-                                                       .log        = state->log,
-                                                       .scheduler  = state->scheduler};
-    tagged_task_t *task = tagged_task_new_from_procedure(status_main, &status_state, 0, 0);
-    if (!task) {
-        util_perror("__server_requests_on_status_message(): failed to create task");
+    if (state->status_request_count == SERVER_REQUESTS_MAXIMUM_STATUS_BATCH) {
+        __server_requests_refuse_status(state, fields->client_pid);
         return;
     }
 
-    if (!scheduler_can_schedule_now(state->status_scheduler)) {
-        if (ipc_server_open_sending(state->ipc, fields->client_pid)) {
-            util_perror("__server_requests_on_status_message(): failed to open connection");
-            tagged_task_free(task);
+    if (state->status_request_count == state->status_request_capacity) {
+        size_t new_capacity =
+            state->status_request_capacity ? state->status_request_capacity * 2 : 16;
+        status_request_t *new_requests =
+            realloc(state->status_requests, new_capacity * sizeof(status_request_t));
+        if (!new_requests) {
+            util_perror("__server_requests_on_status_message(): failed to store request");
+            __server_requests_refuse_status(state, fields->client_pid);
             return;
         }
 
+        state->status_requests         = new_requests;
+        state->status_request_capacity = new_capacity;
+    }
+
+    if (!state->status_request_count)
+        (void) clock_gettime(CLOCK_MONOTONIC, &state->status_batch_start);
+
+    status_request_t *request = state->status_requests + state->status_request_count++;
+    request->client_pid       = fields->client_pid;
+    request->flags            = fields->flags;
+    request->first_id         = fields->first_id;
+    request->last_id          = fields->last_id;
+
+    if (state->status_request_count == SERVER_REQUESTS_MAXIMUM_STATUS_BATCH)
+        __server_requests_dispatch_status_batch(state);
+}
+
+/**
+ * @brief   Handles an incoming ::PROTOCOL_C2S_EXPORT message.
+ * @details Returns nothing, as all errors are printed to `stderr`. Exports aren't batched like
+ *          status requests, as each writes to a different file.
+ *
+ * @param state   State of the server. Mustn't be `NULL` (unchecked).
+ * @param message Bytes of the received message. Mustn't be `NULL` (unchecked).
+ * @param length  Number of bytes in @p message.
+ */
+void __server_requests_on_export_message(server_state_t *state, uint8_t *message, size_t length) {
+    size_t path_length;
+    if (!protocol_export_request_message_check_length(length, &path_length)) {
+        util_error("%s(): invalid message received!\n", __func__);
+        return;
+    }
+    protocol_export_request_message_t *fields = (protocol_export_request_message_t *) message;
+
+    if (!scheduler_can_schedule_now(state->status_scheduler)) {
+        __server_requests_refuse_status(state, fields->client_pid);
+        return;
+    }
+
+    /* The export task is forked before this function returns, so its state can be on the stack */
+    status_export_state_t export_state = {.ipc        = state->ipc,
+                                          .log        = state->log,
+                                          .client_pid = fields->client_pid,
+                                          .format     = fields->format,
+                                          .first_id   = fields->first_id,
+                                          .last_id    = fields->last_id};
+    memcpy(export_state.path, fields->path, path_length);
+    export_state.path[path_length] = '\0';
+
+    tagged_task_t *task = tagged_task_new_from_procedure(status_export_main, &export_state, 0, 0);
+    if (!task) {
+        util_perror("__server_requests_on_export_message(): failed to create task");
+        __server_requests_refuse_status(state, fields->client_pid);
+        return;
+    }
+
+    if (scheduler_add_task(state->status_scheduler, task)) {
+        util_perror("__server_requests_on_export_message(): scheduler failure");
+        __server_requests_refuse_status(state, fields->client_pid);
+    } else if (scheduler_dispatch_possible(state->status_scheduler) < 0) {
+        util_perror("__server_requests_on_export_message(): scheduler failure");
+    }
+    tagged_task_free(task);
+}
+
+/**
+ * @brief   Handles an incoming ::PROTOCOL_C2S_OUTPUT message.
+ * @details Returns nothing, as all errors are printed to `stderr`. Like exports, the output is sent
+ *          by a status task, so that large outputs don't stop the server from receiving messages.
+ *
+ * @param state   State of the server. Mustn't be `NULL` (unchecked).
+ * @param message Bytes of the received message. Mustn't be `NULL` (unchecked).
+ * @param length  Number of bytes in @p message.
+ */
+void __server_requests_on_output_message(server_state_t *state, uint8_t *message, size_t length) {
+    if (length != sizeof(protocol_output_request_message_t)) {
+        util_error("%s(): invalid message received!\n", __func__);
+        return;
+    }
+
+    /* Copy the message, for its fields to be aligned */
+    protocol_output_request_message_t fields;
+    memcpy(&fields, message, sizeof(fields));
+
+    if (!scheduler_can_schedule_now(state->status_scheduler)) {
+        __server_requests_refuse_status(state, fields.client_pid);
+        return;
+    }
+
+    /* The output task is forked before this function returns, so its state can be on the stack */
+    status_output_state_t output_state = {
+        .ipc        = state->ipc,
+        .store      = state->store,
+        .client_pid = fields.client_pid,
+        .id         = fields.id,
+        .stream     = fields.stream == STDERR_FILENO ? OUTPUT_STORE_STREAM_ERROR
+                                                     : OUTPUT_STORE_STREAM_OUTPUT,
+        .first_byte = fields.first_byte,
+        .last_byte  = fields.last_byte};
+
+    tagged_task_t *task = tagged_task_new_from_procedure(status_output_main, &output_state, 0, 0);
+    if (!task) {
+        util_perror("__server_requests_on_output_message(): failed to create task");
+        __server_requests_refuse_status(state, fields.client_pid);
+        return;
+    }
+
+    if (scheduler_add_task(state->status_scheduler, task)) {
+        util_perror("__server_requests_on_output_message(): scheduler failure");
+        __server_requests_refuse_status(state, fields.client_pid);
+    } else if (scheduler_dispatch_possible(state->status_scheduler) < 0) {
+        util_perror("__server_requests_on_output_message(): scheduler failure");
+    }
+    tagged_task_free(task);
+}
+
+/**
+ * @brief   Handles an incoming ::PROTOCOL_C2S_FOLLOW message.
+ * @details Returns nothing, as all errors are printed to `stderr`. The task's runner is the one
+ *          that opens the client's named pipes, after receiving ::TASK_RUNNER_FOLLOW_SIGNAL.
+ *
+ * @param state   State of the server. Mustn't be `NULL` (unchecked).
+ * @param message Bytes of the received message. Mustn't be `NULL` (unchecked).
+ * @param length  Number of bytes in @p message.
+ */
+void __server_requests_on_follow_message(server_state_t *state, uint8_t *message, size_t length) {
+    if (length != sizeof(protocol_follow_request_message_t)) {
+        util_error("%s(): invalid message received!\n", __func__);
+        return;
+    }
+    protocol_follow_request_message_t *fields = (protocol_follow_request_message_t *) message;
+
+    char  error_string[PROTOCOL_MAXIMUM_ERROR_LENGTH + 1] = {0};
+    pid_t runner_pid = scheduler_get_runner_pid(state->scheduler, fields->id);
+    if (runner_pid < 0) {
+        snprintf(error_string,
+                 sizeof(error_string),
+                 "Task %" PRIu32 " isn't running!\n",
+                 fields->id);
+    } else {
+        union sigval value = {.sival_int = fields->client_pid};
+        if (sigqueue(runner_pid, TASK_RUNNER_FOLLOW_SIGNAL, value))
+            snprintf(error_string, sizeof(error_string), "Failed to contact task runner!\n");
+    }
+
+    if (ipc_server_open_sending(state->ipc, fields->client_pid)) {
+        util_perror("__server_requests_on_follow_message(): failed to open connection");
+        return;
+    }
+
+    if (*error_string) {
         size_t                   error_message_size;
         protocol_error_message_t error_message;
-        protocol_error_message_new(&error_message, &error_message_size, "No capacity available!\n");
+        protocol_error_message_new(&error_message, &error_message_size, error_string);
 
         if (ipc_send_retry(state->ipc,
                            &error_message,
                            error_message_size,
                            SERVER_REQUESTS_MAX_RETRIES))
-            util_perror("__server_requests_on_status_message(): failure sending message");
+            util_perror("__server_requests_on_follow_message(): failure sending message");
+    } else {
+        protocol_following_message_t success_message = {.type       = PROTOCOL_S2C_FOLLOWING,
+                                                        .runner_pid = runner_pid};
+
+        if (ipc_send_retry(state->ipc,
+                           &success_message,
+                           sizeof(protocol_following_message_t),
+                           SERVER_REQUESTS_MAX_RETRIES))
+            util_perror("__server_requests_on_follow_message(): failure sending message");
+    }
+
+    ipc_server_close_sending(state->ipc);
+}
+
+/**
+ * @brief Summarizes a histogram to be sent to a client.
+ * @param histogram Histogram to be summarized. Mustn't be `NULL` (unchecked).
+ * @param out       Where to output the summary to. Mustn't be `NULL` (unchecked).
+ */
+void __server_requests_summarize_histogram(const statistics_histogram_t *histogram,
+                                           protocol_stats_time_t        *out) {
+    out->count = histogram->count;
+    out->mean  = histogram->count ? histogram->sum / histogram->count : 0;
+    out->min   = histogram->min;
+    out->p50   = statistics_histogram_get_percentile(histogram, 50.0);
+    out->p90   = statistics_histogram_get_percentile(histogram, 90.0);
+    out->p99   = statistics_histogram_get_percentile(histogram, 99.0);
+    out->max   = histogram->max;
+}
 
+/**
+ * @brief   Handles an incoming ::PROTOCOL_C2S_STATS message.
+ * @details Returns nothing, as all errors are printed to `stderr`. Unlike status requests, this is
+ *          answered by the main process, as the aggregates are already computed.
+ *
+ * @param state   State of the server. Mustn't be `NULL` (unchecked).
+ * @param message Bytes of the received message. Mustn't be `NULL` (unchecked).
+ * @param length  Number of bytes in @p message.
+ */
+void __server_requests_on_stats_message(server_state_t *state, uint8_t *message, size_t length) {
+    if (length != sizeof(protocol_stats_request_message_t)) {
+        util_error("%s(): invalid message received!\n", __func__);
+        return;
+    }
+    protocol_stats_request_message_t *fields = (protocol_stats_request_message_t *) message;
+
+    size_t running, queued, slots;
+    (void) scheduler_get_load(state->scheduler, &running, &queued, &slots);
+    protocol_stats_server_message_t server_message = {
+        .type    = PROTOCOL_S2C_STATS_SERVER,
+        .policy  = state->policy,
+        .slots   = slots,
+        .running = running,
+        .queued  = queued,
+        .uptime  = statistics_get_uptime(state->statistics)};
+
+    if (ipc_server_open_sending(state->ipc, fields->client_pid)) {
+        util_perror("__server_requests_on_stats_message(): failed to open connection");
+        return;
+    }
+
+    if (ipc_send_retry(state->ipc,
+                       &server_message,
+                       sizeof(protocol_stats_server_message_t),
+                       SERVER_REQUESTS_MAX_RETRIES)) {
+        util_perror("__server_requests_on_stats_message(): failure sending message");
         ipc_server_close_sending(state->ipc);
-    } else if (scheduler_add_task(state->status_scheduler, task)) {
-        util_perror("__server_requests_on_status_message(): scheduler failure");
-        tagged_task_free(task);
         return;
-    } else {
-        if (scheduler_dispatch_possible(state->status_scheduler) < 0)
-            util_perror("__server_requests_on_status_message(): scheduler failure");
-        tagged_task_free(task);
     }
+
+    for (size_t i = 0; i < STATISTICS_AGGREGATE_COUNT; ++i) {
+        const statistics_aggregate_t *aggregate = statistics_get_aggregate(state->statistics, i);
+
+        protocol_stats_message_t aggregate_message = {.type        = PROTOCOL_S2C_STATS,
+                                                      .task_count  = aggregate->task_count,
+                                                      .error_count = aggregate->error_count};
+        uint32_t                 min_expected_time, max_expected_time;
+        statistics_get_expected_time_range(i, &min_expected_time, &max_expected_time);
+        aggregate_message.min_expected_time = min_expected_time;
+        aggregate_message.max_expected_time = max_expected_time;
+
+        for (statistics_time_t j = 0; j < STATISTICS_TIME_COUNT; ++j) {
+            protocol_stats_time_t time; /* Aligned copy of a packed field */
+            __server_requests_summarize_histogram(aggregate->times + j, &time);
+            aggregate_message.times[j] = time;
+        }
+
+        if (ipc_send_retry(state->ipc,
+                           &aggregate_message,
+                           sizeof(protocol_stats_message_t),
+                           SERVER_REQUESTS_MAX_RETRIES)) {
+            util_perror("__server_requests_on_stats_message(): failure sending message");
+            break;
+        }
+    }
+
+    ipc_server_close_sending(state->ipc);
 }
 
 /**
@@ -236,13 +894,17 @@ void __server_requests_on_status_message(server_state_t *state, uint8_t *message
  * @param length     Number of bytes in @p message. Must be greater than `0` (unchecked).
  * @param state_data A pointer to a ::server_state_t. Mustn't be `NULL` (unchecked).
  *
- * @retval 0 Always, even on error, not to drop any message.
+ * @retval 0 Success, even on error, not to drop any message.
+ * @retval 1 The server was asked to terminate.
  */
 int __server_requests_on_message(uint8_t *message, size_t length, void *state_data) {
     server_state_t *state = state_data;
+    if (__server_requests_terminating)
+        return 1;
 
     /* Zero-length messages are disallowed in ipc layer */
-    protocol_c2s_msg_type type = (protocol_c2s_msg_type) message[0];
+    protocol_c2s_msg_type type        = (protocol_c2s_msg_type) message[0];
+    uint64_t              trace_start = trace_begin();
     switch (type) {
         case PROTOCOL_C2S_SEND_PROGRAM:
         case PROTOCOL_C2S_SEND_TASK:
@@ -254,49 +916,121 @@ int __server_requests_on_message(uint8_t *message, size_t length, void *state_da
         case PROTOCOL_C2S_STATUS:
             __server_requests_on_status_message(state, message, length);
             break;
+        case PROTOCOL_C2S_FOLLOW:
+            __server_requests_on_follow_message(state, message, length);
+            break;
+        case PROTOCOL_C2S_STATS:
+            __server_requests_on_stats_message(state, message, length);
+            break;
+        case PROTOCOL_C2S_EXPORT:
+            __server_requests_on_export_message(state, message, length);
+            break;
+        case PROTOCOL_C2S_OUTPUT:
+            __server_requests_on_output_message(state, message, length);
+            break;
         default:
             util_error("%s(): message with bad type received!\n", __func__);
             break;
     }
+    trace_end(TRACE_EVENT_MESSAGE, TRACE_NO_TASK, type, trace_start);
+
+    /* Don't let status requests wait for the end of a burst of messages from other clients */
+    if (state->status_request_count) {
+        struct timespec now;
+        (void) clock_gettime(CLOCK_MONOTONIC, &now);
+        int64_t waited = (int64_t) (now.tv_sec - state->status_batch_start.tv_sec) * 1000000000 +
+                         (now.tv_nsec - state->status_batch_start.tv_nsec);
+        if (waited >= SERVER_REQUESTS_STATUS_BATCH_WINDOW)
+            __server_requests_dispatch_status_batch(state);
+    }
 
     return 0;
 }
 
 /**
  * @brief   Called before waiting for new connections, which are always accepted.
- * @details This method also starts running scheduled tasks if there's any availability.
+ * @details This method also starts running scheduled tasks if there's any availability, and
+ *          answers all status requests received since the last time the server blocked. Old task
+ *          output is also deleted and metrics are written from time to time.
  *
  * @param state_data A pointer to a ::server_state_t. Mustn't be `NULL` (unchecked).
  *
- * @retval -1 Always. Refuse connection.
+ * @retval 0 Keep listening for new connections.
+ * @retval 1 The server was asked to terminate.
  */
 int __server_requests_before_block(void *state_data) {
     server_state_t *state = state_data;
+    if (__server_requests_terminating)
+        return 1;
+
     if (scheduler_dispatch_possible(state->scheduler) < 0) /* New task or old task terminated */
         util_perror("__server_requests_before_block(): scheduler failure");
-    return 0; /* Always keep listening for new connections */
+    __server_requests_publish(state, NULL, 0, 1);
+    __server_requests_dispatch_status_batch(state);
+    __server_requests_sweep(state);
+    __server_requests_compact(state);
+    __server_requests_write_metrics(state);
+    return 0;
+}
+
+/**
+ * @brief   Handler of `SIGTERM` and `SIGINT`.
+ * @details In the server, this interrupts the blocking `open()` or `read()` of ::ipc_listen, so
+ *          that it returns and everything is freed (namely, records not yet written to the log are
+ *          written). Children of the server that haven't called `exec()` terminate as usual.
+ *
+ * @param signum Signal received.
+ */
+void __server_requests_on_termination_signal(int signum) {
+    if (getpid() != __server_requests_pid) {
+        (void) signal(signum, SIG_DFL);
+        (void) raise(signum);
+        return;
+    }
+    __server_requests_terminating = 1;
 }
 
 /** @brief Maximum number of concurrent status tasks. */
 #define SERVER_REQUESTS_MAXIMUM_STATUS_TASKS 32
 
-int server_requests_listen(scheduler_policy_t policy, size_t ntasks, const char *directory) {
-    if (!directory) {
+int server_requests_listen(scheduler_policy_t              policy,
+                           size_t                          ntasks,
+                           const char                     *directory,
+                           output_store_backend_t          backend,
+                           const log_store_options_t      *log_options,
+                           const output_store_retention_t *retention,
+                           const char                     *metrics_path) {
+    if (!directory || !log_options || !retention) {
         errno = EINVAL;
         return 1;
     }
 
-    scheduler_t *scheduler = scheduler_new(policy, ntasks, directory);
+    /* Kept pending until task runners are ready to handle it */
+    sigset_t follow_signal;
+    (void) sigemptyset(&follow_signal);
+    (void) sigaddset(&follow_signal, TASK_RUNNER_FOLLOW_SIGNAL);
+    (void) sigprocmask(SIG_BLOCK, &follow_signal, NULL);
+
+    output_store_t *store = output_store_new(directory, backend);
+    if (!store) {
+        util_perror("server_requests_listen(): failed to create output store");
+        return 1;
+    }
+
+    scheduler_t *scheduler = scheduler_new(policy, ntasks, store);
     if (!scheduler) {
         util_perror("server_requests_listen(): failed to create main scheduler");
-        return 1; /* errno = EINVAL guaranteed */
+        output_store_free(store);
+        return 1;
     }
 
     scheduler_t *status_scheduler =
-        scheduler_new(SCHEDULER_POLICY_FCFS, SERVER_REQUESTS_MAXIMUM_STATUS_TASKS, "");
+        scheduler_new(SCHEDULER_POLICY_FCFS, SERVER_REQUESTS_MAXIMUM_STATUS_TASKS, NULL);
     if (!status_scheduler) {
         util_perror("server_requests_listen(): failed to create status scheduler");
-        return 1; /* errno = EINVAL guaranteed */
+        scheduler_free(scheduler);
+        output_store_free(store);
+        return 1;
     }
 
     ipc_t *ipc = ipc_new(IPC_ENDPOINT_SERVER);
@@ -306,31 +1040,85 @@ int server_requests_listen(scheduler_policy_t policy, size_t ntasks, const char
         else
             util_perror("server_requests_listen(): failed to open() server's FIFO");
 
+        scheduler_free(status_scheduler);
         scheduler_free(scheduler);
+        output_store_free(store);
         return 1;
     }
 
-    char log_path[PATH_MAX];
-    snprintf(log_path, PATH_MAX, "%s/log.bin", directory);
-    log_file_t *log = log_file_new(log_path, 1);
+    log_store_t *log = log_store_new(directory, log_options);
     if (!log) {
-        util_perror("server_requests_listen(): failed to open log file");
+        util_perror("server_requests_listen(): failed to open log");
+        scheduler_free(status_scheduler);
+        scheduler_free(scheduler);
+        output_store_free(store);
+        ipc_free(ipc);
+        return 1;
+    }
+
+    statistics_t *statistics = statistics_new();
+    if (!statistics) {
+        util_perror("server_requests_listen(): failed to create statistics");
+        log_store_free(log);
+        scheduler_free(status_scheduler);
         scheduler_free(scheduler);
+        output_store_free(store);
         ipc_free(ipc);
         return 1;
     }
 
+    live_state_t *live_state = live_state_new(getpid(), policy);
+    if (!live_state) {
+        util_perror("server_requests_listen(): failed to create shared state");
+        statistics_free(statistics);
+        log_store_free(log);
+        scheduler_free(status_scheduler);
+        scheduler_free(scheduler);
+        output_store_free(store);
+        ipc_free(ipc);
+        return 1;
+    }
+
+    /* Tracing and metrics are optional: the server can run without them */
+    if (trace_init(getpid()))
+        util_perror("server_requests_listen(): failed to create trace ring");
+    if (metrics_init())
+        util_perror("server_requests_listen(): failed to create metrics counters");
+
+    /* No SA_RESTART, so that blocking calls in ipc_listen() are interrupted */
+    struct sigaction termination_action = {0};
+    termination_action.sa_handler       = __server_requests_on_termination_signal;
+    (void) sigemptyset(&termination_action.sa_mask);
+    __server_requests_pid = getpid();
+    (void) sigaction(SIGTERM, &termination_action, NULL);
+    (void) sigaction(SIGINT, &termination_action, NULL);
+
     server_state_t state = {.ipc              = ipc,
                             .scheduler        = scheduler,
                             .status_scheduler = status_scheduler,
-                            .next_task_id     = 1,
-                            .log              = log};
-    if (ipc_listen(ipc, __server_requests_on_message, __server_requests_before_block, &state) == 1)
+                            .next_task_id     = log_store_get_next_id(log),
+                            .log              = log,
+                            .statistics       = statistics,
+                            .policy           = policy,
+                            .status_requests  = NULL,
+                            .live_state       = live_state,
+                            .store            = store,
+                            .retention        = *retention,
+                            .metrics_path     = metrics_path};
+    if (ipc_listen(ipc, __server_requests_on_message, __server_requests_before_block, &state) == 1 &&
+        !__server_requests_terminating)
         util_perror("server_requests_listen(): error opening connection");
 
-    log_file_free(log);
+    free(state.status_requests);
+    metrics_free();
+    trace_free();
+    live_state_free(live_state);
+    path_cache_clear();
+    statistics_free(statistics);
+    log_store_free(log);
     scheduler_free(status_scheduler);
     scheduler_free(scheduler);
+    output_store_free(store);
     ipc_free(ipc);
     return 0;
 }
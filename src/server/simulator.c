@@ -0,0 +1,413 @@
+/*
+ * Copyright 2024 Humberto Gomes, José Lopes, José Matos
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+/**
+ * @file  server/simulator.c
+ * @brief Implementation of methods in server/simulator.h
+ */
+
+#include <errno.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "server/simulator.h"
+#include "server/statistics.h"
+#include "server/tagged_task.h"
+
+/** @brief Initial capacity of the array of tasks read by ::simulator_read_workload. */
+#define SIMULATOR_INITIAL_CAPACITY 1024
+
+/**
+ * @brief  Parses a time in milliseconds and converts it to nanoseconds.
+ * @param  str Where to start parsing. Mustn't be `NULL` (unchecked).
+ * @param  end Where to output a pointer to the first character not parsed. Mustn't be `NULL`
+ *             (unchecked).
+ * @param  ns  Where to output the time (in nanoseconds) to. Mustn't be `NULL` (unchecked).
+ * @retval 0 Success.
+ * @retval 1 Invalid or too large number.
+ */
+int __simulator_parse_time(const char *str, char **end, uint64_t *ns) {
+    while (*str == ' ' || *str == '\t')
+        str++;
+    if (*str < '0' || *str > '9') /* strtoull() accepts signs */
+        return 1;
+
+    errno                 = 0;
+    unsigned long long ms = strtoull(str, end, 10);
+    if (errno || ms > UINT64_MAX / 1000000)
+        return 1;
+
+    *ns = (uint64_t) ms * 1000000;
+    return 0;
+}
+
+/**
+ * @brief  Parses a line of a workload.
+ * @param  line Line to be parsed, without the line terminator. Mustn't be `NULL` (unchecked).
+ * @param  task Where to output the parsed task to. Mustn't be `NULL` (unchecked).
+ * @retval 0 Success.
+ * @retval 1 Invalid line.
+ */
+int __simulator_parse_line(const char *line, simulator_task_t *task) {
+    char    *end;
+    uint64_t expected_time;
+    if (__simulator_parse_time(line, &end, &task->arrival) ||
+        __simulator_parse_time(end, &end, &expected_time) ||
+        __simulator_parse_time(end, &end, &task->runtime))
+        return 1;
+
+    end += strspn(end, " \t\r");
+    if (*end || expected_time / 1000000 > UINT32_MAX)
+        return 1;
+
+    task->expected_time = expected_time / 1000000;
+    return 0;
+}
+
+/**
+ * @brief   Compares two tasks by arrival time, for `qsort()`.
+ * @details simulator_task_t::dispatched holds the position of each task in the workload file, so
+ *          that the order of tasks arriving at the same time is kept.
+ */
+int __simulator_compare_arrival(const void *a, const void *b) {
+    const simulator_task_t *task_a = a, *task_b = b;
+    if (task_a->arrival != task_b->arrival)
+        return task_a->arrival < task_b->arrival ? -1 : 1;
+    return task_a->dispatched < task_b->dispatched ? -1 : task_a->dispatched > task_b->dispatched;
+}
+
+int simulator_read_workload(FILE *in, simulator_task_t **tasks, size_t *ntasks) {
+    if (!in || !tasks || !ntasks) {
+        errno = EINVAL;
+        return 1;
+    }
+
+    size_t            count = 0, capacity = SIMULATOR_INITIAL_CAPACITY, line_number = 0;
+    simulator_task_t *ret   = malloc(capacity * sizeof(simulator_task_t));
+    if (!ret)
+        return 1; /* errno = ENOMEM guaranteed */
+
+    char   *line      = NULL;
+    size_t  line_size = 0;
+    ssize_t line_length;
+    errno = 0;
+    while ((line_length = getline(&line, &line_size, in)) >= 0) {
+        line_number++;
+        if (line_length && line[line_length - 1] == '\n')
+            line[line_length - 1] = '\0';
+
+        const char *start = line + strspn(line, " \t\r");
+        if (!*start || *start == '#')
+            continue;
+
+        if (count == capacity) {
+            simulator_task_t *new_ret = realloc(ret, 2 * capacity * sizeof(simulator_task_t));
+            if (!new_ret) {
+                free(line);
+                free(ret);
+                return 1; /* errno = ENOMEM guaranteed */
+            }
+            ret = new_ret;
+            capacity *= 2;
+        }
+
+        if (__simulator_parse_line(start, ret + count) || count == UINT32_MAX) {
+            free(line);
+            free(ret);
+            *ntasks = line_number;
+            errno   = EILSEQ;
+            return 1;
+        }
+        ret[count].dispatched = count;
+        count++;
+    }
+    free(line);
+
+    if (ferror(in)) {
+        int errno2 = errno;
+        free(ret);
+        errno = errno2;
+        return 1;
+    }
+
+    qsort(ret, count, sizeof(simulator_task_t), __simulator_compare_arrival);
+    for (size_t i = 0; i < count; ++i)
+        ret[i].dispatched = ret[i].ended = 0;
+
+    *tasks  = ret;
+    *ntasks = count;
+    return 0;
+}
+
+/**
+ * @struct simulator_state_t
+ * @brief  State of a simulation.
+ *
+ * @var simulator_state_t::tasks
+ *     @brief Tasks being simulated, indexed by their identifiers.
+ * @var simulator_state_t::now
+ *     @brief Current value of the virtual clock, in nanoseconds.
+ * @var simulator_state_t::ends
+ *     @brief Min-heap of the times when running tasks end, with simulator_state_t::slots.
+ * @var simulator_state_t::slots
+ *     @brief Slots of the tasks in simulator_state_t::ends.
+ * @var simulator_state_t::running
+ *     @brief Number of running tasks (elements in simulator_state_t::ends).
+ */
+typedef struct {
+    simulator_task_t *tasks;
+    uint64_t          now;
+    uint64_t         *ends;
+    size_t           *slots;
+    size_t            running;
+} simulator_state_t;
+
+/**
+ * @brief Adds a running task to the heap of a simulation.
+ * @param state Simulation. Must have space for another task (unchecked).
+ * @param end   When the task ends, in nanoseconds.
+ * @param slot  Slot where the task is running.
+ */
+void __simulator_heap_push(simulator_state_t *state, uint64_t end, size_t slot) {
+    size_t i = state->running++;
+    while (i > 0 && state->ends[(i - 1) / 2] > end) {
+        state->ends[i]  = state->ends[(i - 1) / 2];
+        state->slots[i] = state->slots[(i - 1) / 2];
+        i               = (i - 1) / 2;
+    }
+    state->ends[i]  = end;
+    state->slots[i] = slot;
+}
+
+/**
+ * @brief  Removes the running task that ends first from the heap of a simulation.
+ * @param  state Simulation. Must have a running task (unchecked).
+ * @return The slot of the removed task.
+ */
+size_t __simulator_heap_pop(simulator_state_t *state) {
+    size_t   ret  = state->slots[0];
+    uint64_t end  = state->ends[--state->running];
+    size_t   slot = state->slots[state->running];
+
+    size_t i = 0;
+    while (2 * i + 1 < state->running) {
+        size_t child = 2 * i + 1;
+        if (child + 1 < state->running && state->ends[child + 1] < state->ends[child])
+            child++;
+        if (state->ends[child] >= end)
+            break;
+
+        state->ends[i]  = state->ends[child];
+        state->slots[i] = state->slots[child];
+        i               = child;
+    }
+    state->ends[i]  = end;
+    state->slots[i] = slot;
+    return ret;
+}
+
+/** @brief ::task_procedure_t of simulated tasks, which are never run. */
+int __simulator_procedure(void *state, size_t slot) {
+    (void) state;
+    (void) slot;
+    return 0;
+}
+
+/** @brief ::scheduler_dispatcher_t that starts running a task in virtual time. */
+pid_t __simulator_dispatch(tagged_task_t *task, size_t slot, void *state_data) {
+    simulator_state_t *state = state_data;
+    simulator_task_t  *sim   = state->tasks + tagged_task_get_id(task);
+
+    sim->dispatched = state->now;
+    sim->ended      = state->now + sim->runtime;
+    __simulator_heap_push(state, sim->ended, slot);
+    return 0; /* No process to wait for */
+}
+
+/**
+ * @brief Converts a time of the virtual clock to a `struct timespec`.
+ * @param ns   Time in nanoseconds.
+ * @param time Where to output the time to. Mustn't be `NULL` (unchecked).
+ */
+void __simulator_to_timespec(uint64_t ns, struct timespec *time) {
+    time->tv_sec  = ns / 1000000000;
+    time->tv_nsec = ns % 1000000000;
+}
+
+/**
+ * @brief  Adds the tasks arriving now to the scheduler.
+ * @param  scheduler Scheduler to add tasks to. Mustn't be `NULL` (unchecked).
+ * @param  state     Simulation. Mustn't be `NULL` (unchecked).
+ * @param  next      Index of the next task to arrive. Updated to the first task that hasn't
+ *                   arrived. Mustn't be `NULL` (unchecked).
+ * @param  ntasks    Number of tasks in simulator_state_t::tasks.
+ * @retval 0 Success.
+ * @retval 1 Allocation failure.
+ */
+int __simulator_add_arrivals(scheduler_t       *scheduler,
+                             simulator_state_t *state,
+                             size_t            *next,
+                             size_t             ntasks) {
+    struct timespec now;
+    __simulator_to_timespec(state->now, &now);
+
+    for (; *next < ntasks && state->tasks[*next].arrival == state->now; ++*next) {
+        tagged_task_t *task = tagged_task_new_from_procedure(__simulator_procedure,
+                                                             NULL,
+                                                             *next,
+                                                             state->tasks[*next].expected_time);
+        if (!task)
+            return 1;
+
+        (void) tagged_task_set_time(task, TAGGED_TASK_TIME_ARRIVED, &now); /* Ordering in FCFS */
+        int failed = scheduler_add_task(scheduler, task);
+        tagged_task_free(task);
+        if (failed)
+            return 1;
+    }
+    return 0;
+}
+
+int simulator_run(scheduler_policy_t policy, size_t slots, simulator_task_t *tasks, size_t ntasks) {
+    if (!tasks) {
+        errno = EINVAL;
+        return 1;
+    }
+    for (size_t i = 1; i < ntasks; ++i) {
+        if (tasks[i].arrival < tasks[i - 1].arrival) {
+            errno = EINVAL;
+            return 1;
+        }
+    }
+
+    scheduler_t *scheduler = scheduler_new(policy, slots, NULL);
+    if (!scheduler)
+        return 1; /* Keep errno */
+
+    simulator_state_t state = {.tasks   = tasks,
+                               .now     = 0,
+                               .ends    = malloc(slots * sizeof(uint64_t)),
+                               .slots   = malloc(slots * sizeof(size_t)),
+                               .running = 0};
+    if (!state.ends || !state.slots) {
+        free(state.ends);
+        free(state.slots);
+        scheduler_free(scheduler);
+        errno = ENOMEM;
+        return 1;
+    }
+
+    int    failed = 0;
+    size_t next   = 0;
+    while (!failed && (next < ntasks || state.running)) {
+        /* Jump to the next event. Completions go first, freeing slots for simultaneous arrivals */
+        state.now = next < ntasks ? tasks[next].arrival : UINT64_MAX;
+        if (state.running && state.ends[0] <= state.now)
+            state.now = state.ends[0];
+
+        while (state.running && state.ends[0] == state.now) {
+            struct timespec ended;
+            __simulator_to_timespec(state.now, &ended);
+            tagged_task_free(scheduler_mark_done(scheduler, __simulator_heap_pop(&state), &ended));
+        }
+
+        failed = __simulator_add_arrivals(scheduler, &state, &next, ntasks) ||
+                 scheduler_dispatch_with(scheduler, __simulator_dispatch, &state) < 0;
+    }
+
+    int errno2 = errno;
+    free(state.ends);
+    free(state.slots);
+    scheduler_free(scheduler);
+    errno = errno2;
+    return failed;
+}
+
+/**
+ * @brief Prints a time in milliseconds, with microsecond precision.
+ * @param out Where to print the time to. Mustn't be `NULL` (unchecked).
+ * @param ns  Time in nanoseconds.
+ */
+void __simulator_print_time(FILE *out, uint64_t ns) {
+    fprintf(out, " %" PRIu64 ".%03" PRIu64, ns / 1000000, ns / 1000 % 1000);
+}
+
+/**
+ * @brief Prints the distribution of a time over all tasks.
+ * @param out       Where to print the distribution to. Mustn't be `NULL` (unchecked).
+ * @param name      Name of the time. Mustn't be `NULL` (unchecked).
+ * @param histogram Values of the time. Mustn't be `NULL` (unchecked).
+ */
+void __simulator_print_histogram(FILE                         *out,
+                                 const char                   *name,
+                                 const statistics_histogram_t *histogram) {
+    fprintf(out, "(TIME) %s:", name);
+    __simulator_print_time(out, histogram->count ? histogram->sum / histogram->count : 0);
+    __simulator_print_time(out, histogram->min);
+    __simulator_print_time(out, statistics_histogram_get_percentile(histogram, 50));
+    __simulator_print_time(out, statistics_histogram_get_percentile(histogram, 90));
+    __simulator_print_time(out, statistics_histogram_get_percentile(histogram, 99));
+    __simulator_print_time(out, histogram->max);
+    fprintf(out, "\n");
+}
+
+void simulator_print_results(FILE                   *out,
+                             scheduler_policy_t      policy,
+                             size_t                  slots,
+                             const simulator_task_t *tasks,
+                             size_t                  ntasks,
+                             int                     print_tasks) {
+    fprintf(out, "(SIMULATION) POLICY SLOTS TASKS MAKESPAN UTILIZATION THROUGHPUT\n");
+    if (print_tasks)
+        fprintf(out, "(TASK) ID: ARRIVAL EXPECTED_TIME RUNTIME WAIT TURNAROUND\n");
+    fprintf(out, "(TIME) TIME: MEAN MIN P50 P90 P99 MAX\n");
+
+    statistics_histogram_t wait = {0}, turnaround = {0};
+    uint64_t               first_arrival = ntasks ? tasks[0].arrival : 0, last_end = 0;
+    double                 busy          = 0.0;
+    for (size_t i = 0; i < ntasks; ++i) {
+        const simulator_task_t *task = tasks + i;
+        statistics_histogram_add(&wait, task->dispatched - task->arrival);
+        statistics_histogram_add(&turnaround, task->ended - task->arrival);
+        busy += (double) task->runtime;
+        if (task->ended > last_end)
+            last_end = task->ended;
+
+        if (print_tasks) {
+            fprintf(out, "(TASK) %zu:", i);
+            __simulator_print_time(out, task->arrival);
+            fprintf(out, " %" PRIu32, task->expected_time);
+            __simulator_print_time(out, task->runtime);
+            __simulator_print_time(out, task->dispatched - task->arrival);
+            __simulator_print_time(out, task->ended - task->arrival);
+            fprintf(out, "\n");
+        }
+    }
+
+    uint64_t makespan = last_end - first_arrival;
+    fprintf(out,
+            "(SIMULATION) %s %zu %zu",
+            policy == SCHEDULER_POLICY_SJF ? "sjf" : "fcfs",
+            slots,
+            ntasks);
+    __simulator_print_time(out, makespan);
+    fprintf(out,
+            " %.1f%% %.3f/s\n",
+            makespan ? busy / ((double) makespan * (double) slots) * 100.0 : 0.0,
+            makespan ? (double) ntasks * 1e9 / (double) makespan : 0.0);
+    __simulator_print_histogram(out, "wait", &wait);
+    __simulator_print_histogram(out, "turnaround", &turnaround);
+}
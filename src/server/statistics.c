@@ -0,0 +1,222 @@
+/*
+ * Copyright 2024 Humberto Gomes, José Lopes, José Matos
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+/**
+ * @file  server/statistics.c
+ * @brief Implementation of methods in server/statistics.h
+ */
+
+#include <errno.h>
+#include <stdlib.h>
+
+#include "server/statistics.h"
+
+/**
+ * @struct statistics
+ * @brief  Running aggregates of the times of completed tasks.
+ *
+ * @var statistics::started
+ *     @brief When the aggregates were created (`CLOCK_MONOTONIC`).
+ * @var statistics::aggregates
+ *     @brief See ::STATISTICS_AGGREGATE_COUNT.
+ */
+struct statistics {
+    struct timespec        started;
+    statistics_aggregate_t aggregates[STATISTICS_AGGREGATE_COUNT];
+};
+
+/**
+ * @brief  Gets the bucket of a histogram a value is counted in.
+ * @param  value Value in nanoseconds.
+ * @return The index of the bucket in statistics_histogram_t::buckets.
+ */
+size_t __statistics_histogram_get_bucket(uint64_t value) {
+    if (value < STATISTICS_HISTOGRAM_SUB_BUCKETS)
+        return value;
+    if (value >> STATISTICS_HISTOGRAM_MAXIMUM_EXPONENT)
+        return STATISTICS_HISTOGRAM_BUCKETS - 1;
+
+    /* Values in [2^exponent, 2^(exponent + 1)) are split into linear sub-buckets */
+    int    exponent = 63 - __builtin_clzll(value);
+    int    shift    = exponent - STATISTICS_HISTOGRAM_SUB_BUCKET_BITS;
+    size_t sub      = (value >> shift) & (STATISTICS_HISTOGRAM_SUB_BUCKETS - 1);
+    return ((size_t) (shift + 1) << STATISTICS_HISTOGRAM_SUB_BUCKET_BITS) + sub;
+}
+
+/**
+ * @brief  Gets the value in the middle of a bucket of a histogram.
+ * @param  bucket Index of the bucket in statistics_histogram_t::buckets.
+ * @return The value in nanoseconds.
+ */
+uint64_t __statistics_histogram_get_bucket_value(size_t bucket) {
+    if (bucket < STATISTICS_HISTOGRAM_SUB_BUCKETS)
+        return bucket;
+
+    int      shift = (bucket >> STATISTICS_HISTOGRAM_SUB_BUCKET_BITS) - 1;
+    uint64_t sub   = bucket & (STATISTICS_HISTOGRAM_SUB_BUCKETS - 1);
+    uint64_t low   = (STATISTICS_HISTOGRAM_SUB_BUCKETS + sub) << shift;
+    return low + (((uint64_t) 1 << shift) >> 1);
+}
+
+void statistics_histogram_add(statistics_histogram_t *histogram, uint64_t value) {
+    if (!histogram->count || value < histogram->min)
+        histogram->min = value;
+    if (value > histogram->max)
+        histogram->max = value;
+
+    histogram->count++;
+    histogram->sum += value;
+    histogram->buckets[__statistics_histogram_get_bucket(value)]++;
+}
+
+void statistics_histogram_merge(statistics_histogram_t *dest, const statistics_histogram_t *src) {
+    if (!src->count)
+        return;
+
+    if (!dest->count || src->min < dest->min)
+        dest->min = src->min;
+    if (src->max > dest->max)
+        dest->max = src->max;
+
+    dest->count += src->count;
+    dest->sum += src->sum;
+    for (size_t i = 0; i < STATISTICS_HISTOGRAM_BUCKETS; ++i)
+        dest->buckets[i] += src->buckets[i];
+}
+
+uint64_t statistics_histogram_get_percentile(const statistics_histogram_t *histogram,
+                                             double                        percentile) {
+    if (!histogram->count)
+        return 0;
+
+    /* Rank (starting at 1) of the value to be found */
+    uint64_t rank = (uint64_t) (percentile / 100.0 * (double) histogram->count + 0.5);
+    if (rank < 1)
+        rank = 1;
+    else if (rank > histogram->count)
+        rank = histogram->count;
+
+    uint64_t seen = 0;
+    for (size_t i = 0; i < STATISTICS_HISTOGRAM_BUCKETS; ++i) {
+        seen += histogram->buckets[i];
+        if (seen >= rank) {
+            uint64_t value = __statistics_histogram_get_bucket_value(i);
+            if (value < histogram->min)
+                return histogram->min;
+            return value > histogram->max ? histogram->max : value;
+        }
+    }
+    return histogram->max; /* Unreachable, as all values are in some bucket */
+}
+
+uint64_t statistics_histogram_count_below(const statistics_histogram_t *histogram, uint64_t value) {
+    if (!histogram->count || value < histogram->min)
+        return 0;
+    if (value >= histogram->max)
+        return histogram->count;
+
+    uint64_t count = 0;
+    size_t   last  = __statistics_histogram_get_bucket(value);
+    for (size_t i = 0; i <= last; ++i)
+        count += histogram->buckets[i];
+    return count;
+}
+
+void statistics_get_expected_time_range(size_t index, uint32_t *min, uint32_t *max) {
+    if (index == 0) {
+        *min = 0;
+        *max = UINT32_MAX;
+        return;
+    }
+
+    /* Powers of ten: [0, 10), [10, 100), ..., [100000, UINT32_MAX] */
+    uint32_t power = 1;
+    for (size_t i = 0; i < index; ++i)
+        power *= 10;
+
+    *min = index == 1 ? 0 : power / 10;
+    *max = index == STATISTICS_AGGREGATE_COUNT - 1 ? UINT32_MAX : power - 1;
+}
+
+statistics_t *statistics_new(void) {
+    statistics_t *statistics = calloc(1, sizeof(statistics_t));
+    if (!statistics) {
+        errno = ENOMEM;
+        return NULL;
+    }
+
+    (void) clock_gettime(CLOCK_MONOTONIC, &statistics->started);
+    return statistics;
+}
+
+void statistics_free(statistics_t *statistics) {
+    free(statistics);
+}
+
+/**
+ * @brief   Adds a completed task to an aggregate.
+ * @details See ::statistics_add_task.
+ *
+ * @param aggregate Aggregate to be updated. Mustn't be `NULL` (unchecked).
+ * @param times     Result of calling ::tagged_task_get_time for every ::tagged_task_time_t.
+ *                  Mustn't be `NULL` (unchecked).
+ * @param error     Whether an error occurred while running the task.
+ */
+void __statistics_aggregate_add_task(statistics_aggregate_t *aggregate,
+                                     const struct timespec  *times[TAGGED_TASK_TIME_COMPLETED + 1],
+                                     int                     error) {
+    aggregate->task_count++;
+    if (error)
+        aggregate->error_count++;
+
+    for (statistics_time_t i = 0; i < STATISTICS_TIME_COUNT; ++i) {
+        /* Each time is the difference between consecutive ::tagged_task_time_t */
+        const struct timespec *start = times[i], *end = times[i + 1];
+        if (!start || !end)
+            continue;
+
+        int64_t difference =
+            (int64_t) (end->tv_sec - start->tv_sec) * 1000000000 + (end->tv_nsec - start->tv_nsec);
+        statistics_histogram_add(aggregate->times + i, difference < 0 ? 0 : (uint64_t) difference);
+    }
+}
+
+void statistics_add_task(statistics_t *statistics, const tagged_task_t *task, int error) {
+    const struct timespec *times[TAGGED_TASK_TIME_COMPLETED + 1];
+    for (tagged_task_time_t i = 0; i <= TAGGED_TASK_TIME_COMPLETED; ++i)
+        times[i] = tagged_task_get_time(task, i);
+
+    size_t   bucket        = 1;
+    uint32_t expected_time = tagged_task_get_expected_time(task);
+    for (uint32_t power = 10; bucket < STATISTICS_AGGREGATE_COUNT - 1 && expected_time >= power;
+         power *= 10)
+        bucket++;
+
+    __statistics_aggregate_add_task(statistics->aggregates, times, error);
+    __statistics_aggregate_add_task(statistics->aggregates + bucket, times, error);
+}
+
+const statistics_aggregate_t *statistics_get_aggregate(const statistics_t *statistics,
+                                                       size_t              index) {
+    return statistics->aggregates + index;
+}
+
+uint64_t statistics_get_uptime(const statistics_t *statistics) {
+    struct timespec now = {0};
+    (void) clock_gettime(CLOCK_MONOTONIC, &now);
+    return (uint64_t) (now.tv_sec - statistics->started.tv_sec) * 1000000000 +
+           (uint64_t) (now.tv_nsec - statistics->started.tv_nsec);
+}
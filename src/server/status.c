@@ -20,8 +20,20 @@
  */
 
 #include <errno.h>
+#include <fcntl.h>
+#include <inttypes.h>
+#include <signal.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/resource.h>
+#include <sys/stat.h>
+#include <time.h>
+#include <unistd.h>
 
 #include "protocol.h"
+#include "server/log_dump.h"
+#include "server/pool.h"
 #include "server/status.h"
 #include "server/tagged_task.h"
 #include "util.h"
@@ -35,135 +47,646 @@
 #define STATUS_MAX_RETRIES 16
 
 /**
- * @brief Sends a message to the client with information about a single task.
+ * @brief Maximum time, in milliseconds, that ::status_main waits for clients to start reading from
+ *        their named pipes.
+ */
+#define STATUS_CONNECT_TIMEOUT 1000
+
+/**
+ * @brief   Sends the usage counters of all memory pools to the client.
+ * @details As this runs in a child process, the counters are those of the parent at the time of
+ *          the `fork()`. `write()` errors are printed to `stderr` and ignored.
  *
- * @param ipc   Connection to the client. Mustn't be `NULL`.
- * @param error Whether an error happenned while running @p task.
- * @param task  Task to send to the client. Mustn't be `NULL`.
+ * @param ipc Connection to the client. Mustn't be `NULL` (unchecked).
+ */
+void __status_send_pool_statistics(ipc_t *ipc) {
+    pool_statistics_t statistics[POOL_SIZE_CLASS_COUNT + 1];
+    pool_get_statistics(statistics);
+
+    for (size_t i = 0; i <= POOL_SIZE_CLASS_COUNT; ++i) {
+        protocol_pool_status_message_t message = {
+            .type               = PROTOCOL_S2C_POOL_STATUS,
+            .object_size        = statistics[i].object_size,
+            .used               = statistics[i].used,
+            .free               = statistics[i].free,
+            .slabs              = statistics[i].slabs,
+            .allocations        = statistics[i].allocations,
+            .system_allocations = statistics[i].system_allocations};
+
+        if (ipc_send_retry(ipc, &message, sizeof(message), STATUS_MAX_RETRIES))
+            util_perror("__status_send_pool_statistics(): error while sending message to client");
+    }
+}
+
+/**
+ * @brief   Communicates to the parent server that the status task has terminated.
+ * @details Errors will be outputted to `stderr`.
  *
- * @retval 0 Success.
- * @retval 1 `write()` failure (check `errno`).
+ * @param slot  Slot in the scheduler where this task was scheduled.
+ * @param error Whether the task failed to do its job.
  *
- * | `errno`    | Cause                        |
- * | ---------- |  --------------------------- |
- * | `EINVAL`   | @p ipc or @p task is `NULL`. |
- * | other      | See `man 2 write`.           |
+ * @retval 0 Success.
+ * @retval 1 Failure (unspecified `errno`).
  */
-int __status_send_message(ipc_t *ipc, int error, const tagged_task_t *task) {
-    if (!ipc || !task) {
-        errno = EINVAL;
+int __status_warn_parent_result(size_t slot, int error) {
+    struct timespec time_ended = {0};
+    (void) clock_gettime(CLOCK_MONOTONIC, &time_ended);
+    protocol_task_done_message_t message = {.type       = PROTOCOL_C2S_TASK_DONE,
+                                            .slot       = slot,
+                                            .time_ended = time_ended,
+                                            .is_status  = 1,
+                                            .error      = error != 0};
+
+    ipc_t *ipc = ipc_new(IPC_ENDPOINT_CLIENT);
+    if (!ipc) {
+        util_perror("__status_warn_parent(): error while opening connection");
         return 1;
     }
 
-    const struct timespec *times[TAGGED_TASK_TIME_COMPLETED + 1];
-    for (tagged_task_time_t i = 0; i <= TAGGED_TASK_TIME_COMPLETED; ++i)
-        times[i] = tagged_task_get_time(task, i);
+    if (ipc_send_retry(ipc, &message, PROTOCOL_TASK_DONE_HEADER_LENGTH, STATUS_MAX_RETRIES)) {
+        util_perror("__staus_warn_parent(): error while sending message to parent");
+        ipc_free(ipc);
+        return 1;
+    }
+
+    ipc_free(ipc);
+    return 0;
+}
+
+/**
+ * @brief   Communicates to the parent server that the status task has terminated successfully.
+ * @details Errors will be outputted to `stderr`.
+ *
+ * @param slot Slot in the scheduler where this task was scheduled.
+ *
+ * @retval 0 Success.
+ * @retval 1 Failure (unspecified `errno`).
+ */
+int __status_warn_parent(size_t slot) {
+    return __status_warn_parent_result(slot, 0);
+}
+
+/**
+ * @struct status_output_t
+ * @brief  Clients to output messages about tasks to.
+ *
+ * @var status_output_t::connections
+ *     @brief Connections to the clients, `NULL` for clients that couldn't be reached.
+ * @var status_output_t::requests
+ *     @brief Request of each client in status_output_t::connections.
+ * @var status_output_t::count
+ *     @brief Number of elements in status_output_t::connections and status_output_t::requests.
+ * @var status_output_t::all_ids_only
+ *     @brief Whether to only output to clients that asked for all tasks.
+ */
+typedef struct {
+    ipc_t                 **connections;
+    const status_request_t *requests;
+    size_t                  count;
+    int                     all_ids_only;
+} status_output_t;
 
+/**
+ * @brief   Outputs a message about a task to every client that asked for it.
+ * @details Clients that can't be written to are printed to `stderr` and given up on, so that the
+ *          others are still answered.
+ *
+ * @param output    Clients to output the message to. Mustn't be `NULL` (unchecked).
+ * @param id        Identifier of the task.
+ * @param is_stages Whether @p message is a ::protocol_stage_status_message_t.
+ * @param message   Message to be output. Mustn't be `NULL` (unchecked).
+ * @param length    Number of bytes in @p message.
+ */
+void __status_output(status_output_t *output,
+                     uint32_t         id,
+                     int              is_stages,
+                     const void      *message,
+                     size_t           length) {
+    for (size_t i = 0; i < output->count; ++i) {
+        const status_request_t *request = output->requests + i;
+        if (!output->connections[i] || id < request->first_id || id > request->last_id ||
+            (is_stages && !(request->flags & PROTOCOL_STATUS_FLAG_STAGES)) ||
+            (output->all_ids_only && (request->first_id != 0 || request->last_id != UINT32_MAX)))
+            continue;
+
+        if (ipc_send_retry(output->connections[i], message, length, STATUS_MAX_RETRIES)) {
+            util_perror("__status_output(): error while sending message to client");
+            ipc_free(output->connections[i]);
+            output->connections[i] = NULL;
+        }
+    }
+}
+
+/**
+ * @brief Outputs a message with information about a single task.
+ *
+ * @param output       Clients to output the message to. Mustn't be `NULL` (unchecked).
+ * @param id           Identifier of the task.
+ * @param error        Whether an error happenned while running the task.
+ * @param command_line Command line of the task. Mustn't be `NULL` (unchecked).
+ * @param times        Result of calling ::tagged_task_get_time for every ::tagged_task_time_t.
+ *                     Mustn't be `NULL` (unchecked).
+ */
+void __status_output_task(status_output_t       *output,
+                          uint32_t               id,
+                          int                    error,
+                          const char            *command_line,
+                          const struct timespec *times[TAGGED_TASK_TIME_COMPLETED + 1]) {
     protocol_status_response_message_t message;
     size_t                             message_length;
     if (protocol_status_response_message_new(&message,
                                              &message_length,
-                                             tagged_task_get_command_line(task),
-                                             tagged_task_get_id(task),
+                                             command_line,
+                                             id,
                                              error,
                                              times)) {
         (void) protocol_status_response_message_new(&message,
                                                     &message_length,
                                                     "COMMAND LINE TOO LONG",
-                                                    tagged_task_get_id(task),
+                                                    id,
                                                     error,
                                                     times);
     }
 
-    if (ipc_send_retry(ipc, &message, message_length, STATUS_MAX_RETRIES)) {
-        util_perror("__status_send_message(): error while sending message to client");
-        return 1;
-    }
-    return 0;
+    __status_output(output, id, 0, &message, message_length);
 }
 
 /**
- * @brief Method called for every task in the log file.
+ * @brief   Outputs a message with the statistics of the stages of a task.
+ * @details Nothing is output for tasks without statistics.
  *
- * @param task      Task in log file. Mustn't be `NULL` (unchecked).
- * @param error     Whether an error happenned while running @p task.
- * @param state_ipc An `ipc_t *` to use for client communication. Mustn't be `NULL` (unchecked).
+ * @param output  Clients to output the message to. Mustn't be `NULL` (unchecked).
+ * @param id      Identifier of the task.
+ * @param stages  Statistics of the stages of the task. Mustn't be `NULL` (unchecked).
+ * @param nstages Number of elements in @p stages.
+ */
+void __status_output_stages(status_output_t           *output,
+                            uint32_t                   id,
+                            const tagged_task_stage_t *stages,
+                            size_t                     nstages) {
+    if (!nstages)
+        return;
+
+    protocol_stage_status_message_t message = {.type = PROTOCOL_S2C_STAGE_STATUS, .id = id};
+    memcpy(message.stages, stages, nstages * sizeof(tagged_task_stage_t));
+
+    __status_output(output,
+                    id,
+                    1,
+                    &message,
+                    PROTOCOL_STAGE_STATUS_HEADER_LENGTH + nstages * sizeof(tagged_task_stage_t));
+}
+
+/**
+ * @brief   Method called for every record in the log file.
+ * @details The record is output directly, without creating a ::tagged_task_t.
  *
- * @retval 0 Always successful, ignoring `write()` errors.
+ * @param record      Record in the log file. Mustn't be `NULL` (unchecked).
+ * @param output_data A `status_output_t *`. Mustn't be `NULL` (unchecked).
+ *
+ * @return Always `0`, as `write()` errors are ignored.
  */
-int __status_foreach_log_entry(const tagged_task_t *task, int error, void *state_ipc) {
-    (void) __status_send_message(state_ipc, error, task); /* Ignore writing failures */
+int __status_foreach_log_entry(const log_file_record_t *record, void *output_data) {
+    status_output_t *output = output_data;
+
+    char command_line[PROTOCOL_MAXIMUM_COMMAND_LENGTH + 1];
+    memcpy(command_line, record->command_line, record->command_length);
+    command_line[record->command_length] = '\0';
+
+    const struct timespec *times[TAGGED_TASK_TIME_COMPLETED + 1];
+    for (tagged_task_time_t i = 0; i <= TAGGED_TASK_TIME_COMPLETED; ++i)
+        times[i] = record->times[i].tv_sec || record->times[i].tv_nsec ? record->times + i : NULL;
+
+    __status_output_task(output, record->id, record->error, command_line, times);
+    __status_output_stages(output, record->id, record->stages, record->stage_count);
     return 0;
 }
 
 /**
  * @brief Method called for every task currently in the scheduler.
  *
- * @param task      Task in the scheduler (running or scheduled). Mustn't be `NULL` (unchecked).
- * @param state_ipc An `ipc_t *` to use for client communication. Mustn't be `NULL` (unchecked).
+ * @param task        Task in the scheduler (running or scheduled). Mustn't be `NULL` (unchecked).
+ * @param output_data A `status_output_t *`. Mustn't be `NULL` (unchecked).
  *
- * @retval 0 Always successful, ignoring `write()` errors.
+ * @return Always `0`, as `write()` errors are ignored.
  */
-int __status_foreach_scheduler_task(const tagged_task_t *task, void *state_ipc) {
-    (void) __status_send_message(state_ipc, 0, task); /* Ignore writing failures */
+int __status_foreach_scheduler_task(const tagged_task_t *task, void *output_data) {
+    const struct timespec *times[TAGGED_TASK_TIME_COMPLETED + 1];
+    for (tagged_task_time_t i = 0; i <= TAGGED_TASK_TIME_COMPLETED; ++i)
+        times[i] = tagged_task_get_time(task, i);
+
+    __status_output_task(output_data,
+                         tagged_task_get_id(task),
+                         0,
+                         tagged_task_get_command_line(task),
+                         times);
     return 0;
 }
 
 /**
- * @brief   Communicates to the parent server that the status task has terminated.
- * @details Errors will be outputted to `stderr`.
+ * @brief   Connects to the clients whose requests are being answered.
+ * @details Clients are retried in turns, as they may not be reading from their named pipes yet,
+ *          until all of them are connected to, are gone, or ::STATUS_CONNECT_TIMEOUT expires. Thus,
+ *          a client that died or stopped doesn't keep the others from being answered.
  *
- * @param slot Slot in the scheduler where this task was scheduled.
+ * @param state       State of the status program. Mustn't be `NULL` (unchecked).
+ * @param connections Where to output the connection to each client to (`NULL` for clients that
+ *                    couldn't be connected to). Mustn't be `NULL` (unchecked) and must be
+ *                    initialized with `NULL`s.
  *
- * @retval 0 Success.
- * @retval 1 Failure (unspecified `errno`).
+ * @return The number of clients connected to.
  */
-int __status_warn_parent(size_t slot) {
-    struct timespec time_ended = {0};
-    (void) clock_gettime(CLOCK_MONOTONIC, &time_ended);
-    protocol_task_done_message_t message = {.type       = PROTOCOL_C2S_TASK_DONE,
-                                            .slot       = slot,
-                                            .time_ended = time_ended,
-                                            .is_status  = 1,
-                                            .error      = 0};
+size_t __status_connect(const status_state_t *state, ipc_t **connections) {
+    int *given_up = calloc(state->request_count, sizeof(int));
+    if (!given_up) {
+        util_perror("__status_connect(): allocation failure");
+        return 0;
+    }
 
-    ipc_t *ipc = ipc_new(IPC_ENDPOINT_CLIENT);
-    if (!ipc) {
-        util_perror("__status_warn_parent(): error while opening connection");
-        return 1;
+    const struct timespec interval  = {.tv_sec = 0, .tv_nsec = 1000000};
+    size_t                connected = 0, waiting = state->request_count;
+    for (unsigned int turn = 0; waiting && turn <= STATUS_CONNECT_TIMEOUT; ++turn) {
+        if (turn)
+            (void) nanosleep(&interval, NULL);
+
+        for (size_t i = 0; i < state->request_count; ++i) {
+            if (connections[i] || given_up[i])
+                continue;
+
+            if ((connections[i] = ipc_server_connect(state->requests[i].client_pid))) {
+                connected++;
+                waiting--;
+            } else if (errno != EAGAIN) {
+                util_perror("__status_connect(): failed to connect to client");
+                given_up[i] = 1;
+                waiting--;
+            }
+        }
     }
 
-    if (ipc_send_retry(ipc, &message, sizeof(protocol_task_done_message_t), STATUS_MAX_RETRIES)) {
-        util_perror("__staus_warn_parent(): error while sending message to parent");
-        ipc_free(ipc);
+    if (waiting)
+        util_error("__status_connect(): %zu clients timed out\n", waiting);
+    free(given_up);
+    return connected;
+}
+
+int status_main(void *state_data, size_t slot) {
+    if (!state_data)
         return 1;
+
+    status_state_t *state       = (status_state_t *) state_data;
+    size_t          count       = state->request_count;
+    ipc_t         **connections = calloc(count, sizeof(ipc_t *));
+    if (!connections) {
+        util_perror("status_main(): allocation failure");
+        return __status_warn_parent(slot);
     }
 
-    ipc_free(ipc);
+    if (!__status_connect(state, connections)) {
+        free(connections);
+        return __status_warn_parent(slot);
+    }
+
+    /* The log is scanned only once for all clients asking for all tasks */
+    status_output_t output = {.connections  = connections,
+                              .requests     = state->requests,
+                              .count        = count,
+                              .all_ids_only = 1};
+    for (size_t i = 0; i < count; ++i) {
+        const status_request_t *request = state->requests + i;
+        if (connections[i] && request->first_id == 0 && request->last_id == UINT32_MAX) {
+            if (log_store_read_records(state->log,
+                                       0,
+                                       UINT32_MAX,
+                                       __status_foreach_log_entry,
+                                       &output))
+                util_perror("status_main(): failed to read from log. continuing");
+            break;
+        }
+    }
+
+    /* Other clients have their tasks looked up in the index */
+    for (size_t i = 0; i < count; ++i) {
+        const status_request_t *request = state->requests + i;
+        if (!connections[i] || (request->first_id == 0 && request->last_id == UINT32_MAX))
+            continue;
+
+        status_output_t client_output = {.connections  = connections + i,
+                                         .requests     = request,
+                                         .count        = 1,
+                                         .all_ids_only = 0};
+        if (log_store_lookup_records(state->log,
+                                     request->first_id,
+                                     request->last_id,
+                                     __status_foreach_log_entry,
+                                     &client_output))
+            util_perror("status_main(): failed to read from log. continuing");
+    }
+
+    output.all_ids_only = 0;
+    (void) scheduler_get_running_tasks(state->scheduler, __status_foreach_scheduler_task, &output);
+    (void) scheduler_get_scheduled_tasks(state->scheduler,
+                                         __status_foreach_scheduler_task,
+                                         &output);
+
+    for (size_t i = 0; i < count; ++i) {
+        if (!connections[i])
+            continue;
+        if (state->requests[i].flags & PROTOCOL_STATUS_FLAG_POOLS)
+            __status_send_pool_statistics(connections[i]);
+        ipc_free(connections[i]);
+    }
+
+    free(connections);
+    return __status_warn_parent(slot);
+}
+
+/** @brief Size of the buffer of the file written by ::status_export_main, in CSV format. */
+#define STATUS_EXPORT_BUFFER_SIZE (256 * 1024)
+
+/**
+ * @struct status_export_csv_t
+ * @brief  State of ::__status_export_csv_record.
+ *
+ * @var status_export_csv_t::options
+ *     @brief Format and filters of the dump.
+ * @var status_export_csv_t::out
+ *     @brief File being written to.
+ * @var status_export_csv_t::count
+ *     @brief Number of records written.
+ */
+typedef struct {
+    log_dump_options_t options;
+    FILE              *out;
+    size_t             count;
+} status_export_csv_t;
+
+/**
+ * @brief Method called for every record to be exported in CSV format.
+ *
+ * @param record     Record in the log file. Mustn't be `NULL` (unchecked).
+ * @param state_data A `status_export_csv_t *`. Mustn't be `NULL` (unchecked).
+ *
+ * @retval 0 Success.
+ * @retval 1 Output failure (check `errno`).
+ */
+int __status_export_csv_record(const log_file_record_t *record, void *state_data) {
+    status_export_csv_t *state = state_data;
+    if (log_dump_record(record, &state->options, state->out))
+        return 1; /* Keep errno */
+
+    state->count++;
     return 0;
 }
 
-int status_main(void *state_data, size_t slot) {
+/**
+ * @brief Writes completed tasks to a file in CSV format.
+ *
+ * @param state Export to be performed. Mustn't be `NULL` (unchecked).
+ * @param fd    Open file to write to. Closed by this function.
+ * @param count Where to write the number of tasks written to. Mustn't be `NULL` (unchecked).
+ *
+ * @retval 0 Success.
+ * @retval 1 Failure (check `errno`).
+ */
+int __status_export_csv(const status_export_state_t *state, int fd, size_t *count) {
+    FILE *out = fdopen(fd, "w");
+    if (!out) {
+        int errno2 = errno;
+        (void) close(fd);
+        errno = errno2;
+        return 1;
+    }
+    (void) setvbuf(out, NULL, _IOFBF, STATUS_EXPORT_BUFFER_SIZE);
+
+    status_export_csv_t csv = {.options = {.format   = LOG_DUMP_FORMAT_CSV,
+                                           .first_id = state->first_id,
+                                           .last_id  = state->last_id,
+                                           .since    = 0,
+                                           .until    = UINT64_MAX},
+                               .out     = out,
+                               .count   = 0};
+
+    int ret = log_dump_write_header(&csv.options, out) ||
+              log_store_read_records(state->log,
+                                     state->first_id,
+                                     state->last_id,
+                                     __status_export_csv_record,
+                                     &csv);
+    int errno2 = errno;
+    if (fclose(out) && !ret) {
+        ret    = 1;
+        errno2 = errno;
+    }
+
+    *count = csv.count;
+    errno  = errno2;
+    return ret;
+}
+
+/**
+ * @brief   Opens the file a client asked tasks to be exported to.
+ * @details The client creates the file before sending its request, so only empty regular files
+ *          (not FIFOs, devices, ...) owned by the client's user are opened, and symbolic links
+ *          aren't followed. Otherwise, clients could overwrite any file the server can write to.
+ *
+ * @param path       Path of the file. Mustn't be `NULL` (unchecked).
+ * @param client_uid User of the client, from the owner of its named pipe (see
+ *                   ::ipc_server_get_client_uid).
+ * @param statbuf    Where to write information about the file to. Mustn't be `NULL` (unchecked).
+ *
+ * @return A file descriptor open for writing on success, `-1` on failure (check `errno`).
+ *
+ * | `errno`  | Cause                                      |
+ * | -------- | ------------------------------------------ |
+ * | `EINVAL` | The file isn't a regular file.             |
+ * | `EEXIST` | The file isn't empty.                      |
+ * | `EACCES` | The file isn't owned by the client's user. |
+ * | other    | See `man 2 open` and `man 2 fstat`.        |
+ */
+int __status_export_open(const char *path, uid_t client_uid, struct stat *statbuf) {
+    int fd = open(path, O_WRONLY | O_NOFOLLOW);
+    if (fd < 0)
+        return -1; /* Keep errno */
+
+    int errno2 = 0;
+    if (fstat(fd, statbuf))
+        errno2 = errno;
+    else if (!S_ISREG(statbuf->st_mode))
+        errno2 = EINVAL;
+    else if (statbuf->st_size != 0)
+        errno2 = EEXIST;
+    else if (statbuf->st_uid != client_uid)
+        errno2 = EACCES;
+
+    if (errno2) {
+        (void) close(fd);
+        errno = errno2;
+        return -1;
+    }
+    return fd;
+}
+
+int status_export_main(void *state_data, size_t slot) {
     if (!state_data)
         return 1;
 
-    status_state_t *state = (status_state_t *) state_data;
+    status_export_state_t *state = (status_export_state_t *) state_data;
 
+    /* Opened first, as its owner is who the file is written for */
     if (ipc_server_open_sending(state->ipc, state->client_pid)) {
-        util_perror("status_main(): failed to open() connection with the client");
+        util_perror("status_export_main(): failed to open() connection with the client");
+        return __status_warn_parent(slot);
+    }
+
+    uid_t       client_uid;
+    struct stat statbuf;
+    int         fd = -1;
+    if (!ipc_server_get_client_uid(state->ipc, &client_uid))
+        fd = __status_export_open(state->path, client_uid, &statbuf);
+
+    char   error_string[PROTOCOL_MAXIMUM_ERROR_LENGTH + 1] = {0};
+    size_t count                                           = 0;
+    if (fd < 0) {
+        snprintf(error_string, sizeof(error_string), "Failed to open file: %s\n", strerror(errno));
+    } else if (state->format == PROTOCOL_EXPORT_FORMAT_LOG) {
+        if (log_store_export_records(state->log, state->first_id, state->last_id, fd, &count) ||
+            fstat(fd, &statbuf))
+            snprintf(error_string, sizeof(error_string), "Failed to export: %s\n", strerror(errno));
+        (void) close(fd);
+    } else if (__status_export_csv(state, fd, &count) || stat(state->path, &statbuf)) {
+        snprintf(error_string, sizeof(error_string), "Failed to export: %s\n", strerror(errno));
+    }
+
+    if (*error_string) {
+        size_t                   error_message_size;
+        protocol_error_message_t error_message;
+        protocol_error_message_new(&error_message, &error_message_size, error_string);
+
+        if (ipc_send_retry(state->ipc, &error_message, error_message_size, STATUS_MAX_RETRIES))
+            util_perror("status_export_main(): error while sending message to client");
+    } else {
+        protocol_exported_message_t message = {.type       = PROTOCOL_S2C_EXPORTED,
+                                               .task_count = count,
+                                               .size       = statbuf.st_size};
+
+        if (ipc_send_retry(state->ipc, &message, sizeof(message), STATUS_MAX_RETRIES))
+            util_perror("status_export_main(): error while sending message to client");
+    }
+
+    ipc_server_close_sending(state->ipc);
+    return __status_warn_parent(slot);
+}
+
+/**
+ * @brief   Opens the named pipe a client reads the output of a task from.
+ * @details The pipe is left non-blocking, so that a client that stops reading can't hold a status
+ *          slot forever (see ::OUTPUT_STORE_WRITE_TIMEOUT).
+ *
+ * @param  client_pid PID of the client.
+ * @param  stream     Stream of the task the client asked for.
+ * @return A non-blocking file descriptor open for writing, or `-1` on failure (check `errno`).
+ */
+int __status_output_open_fifo(pid_t client_pid, output_store_stream_t stream) {
+    char path[PATH_MAX];
+    (void) ipc_get_follow_fifo_path(client_pid,
+                                    stream == OUTPUT_STORE_STREAM_OUTPUT ? STDOUT_FILENO
+                                                                         : STDERR_FILENO,
+                                    path);
+
+    /* Non-blocking, as the client may have given up */
+    return open(path, O_WRONLY | O_NONBLOCK);
+}
+
+int status_output_main(void *state_data, size_t slot) {
+    if (!state_data)
         return 1;
+
+    status_output_state_t *state = (status_output_state_t *) state_data;
+
+    char     error_string[PROTOCOL_MAXIMUM_ERROR_LENGTH + 1] = {0};
+    uint64_t length = 0, size = 0;
+    int      fifo   = -1;
+    if (output_store_get_length(state->store, state->id, state->stream, &length)) {
+        if (errno == ENOENT)
+            snprintf(error_string,
+                     sizeof(error_string),
+                     "No output stored for task %" PRIu32 "!\n",
+                     state->id);
+        else
+            snprintf(error_string,
+                     sizeof(error_string),
+                     "Failed to read output: %s\n",
+                     strerror(errno));
+    } else if ((fifo = __status_output_open_fifo(state->client_pid, state->stream)) < 0) {
+        snprintf(error_string, sizeof(error_string), "Failed to open named pipe!\n");
+    } else if (state->first_byte < length) {
+        size = (state->last_byte < length ? state->last_byte + 1 : length) - state->first_byte;
     }
 
-    if (log_file_read_tasks(state->log, __status_foreach_log_entry, state->ipc))
-        util_perror("status_main(): failed to read from log file. continuing");
+    if (ipc_server_open_sending(state->ipc, state->client_pid)) {
+        util_perror("status_output_main(): failed to open() connection with the client");
+        if (fifo >= 0)
+            (void) close(fifo);
+        return __status_warn_parent(slot);
+    }
 
-    (void) scheduler_get_running_tasks(state->scheduler,
-                                       __status_foreach_scheduler_task,
-                                       state->ipc);
-    (void) scheduler_get_scheduled_tasks(state->scheduler,
-                                         __status_foreach_scheduler_task,
-                                         state->ipc);
+    int sent = 0;
+    if (*error_string) {
+        size_t                   error_message_size;
+        protocol_error_message_t error_message;
+        protocol_error_message_new(&error_message, &error_message_size, error_string);
 
+        if (ipc_send_retry(state->ipc, &error_message, error_message_size, STATUS_MAX_RETRIES))
+            util_perror("status_output_main(): error while sending message to client");
+    } else {
+        protocol_output_message_t message = {.type = PROTOCOL_S2C_OUTPUT, .size = size};
+
+        if (ipc_send_retry(state->ipc, &message, sizeof(message), STATUS_MAX_RETRIES))
+            util_perror("status_output_main(): error while sending message to client");
+        else
+            sent = 1;
+    }
     ipc_server_close_sending(state->ipc);
+
+    if (sent) {
+        /* A client that stops reading mustn't kill this process */
+        (void) signal(SIGPIPE, SIG_IGN);
+        if (output_store_read_range(state->store,
+                                    state->id,
+                                    state->stream,
+                                    state->first_byte,
+                                    size,
+                                    fifo))
+            util_perror("status_output_main(): failed to send output to client");
+    }
+
+    if (fifo >= 0)
+        (void) close(fifo);
     return __status_warn_parent(slot);
 }
+
+int status_sweep_main(void *state_data, size_t slot) {
+    if (!state_data)
+        return 1;
+
+    status_sweep_state_t *state = (status_sweep_state_t *) state_data;
+    (void) setpriority(PRIO_PROCESS, 0, 19);
+
+    if (output_store_sweep(state->store, &state->retention, state->first_active, state->next_id))
+        util_perror("status_sweep_main(): failed to delete old output");
+    return __status_warn_parent(slot);
+}
+
+int status_compact_main(void *state_data, size_t slot) {
+    if (!state_data)
+        return 1;
+
+    status_compact_state_t *state = (status_compact_state_t *) state_data;
+    (void) setpriority(PRIO_PROCESS, 0, 19);
+
+    int error = log_store_compact(state->log, state->count);
+    if (error)
+        util_perror("status_compact_main(): failed to compact log");
+    return __status_warn_parent_result(slot, error);
+}
@@ -24,32 +24,88 @@
 #include <string.h>
 
 #include "server/command_parser.h"
+#include "server/pool.h"
 #include "server/tagged_task.h"
 
 /**
- * @struct tagged_task
- * @brief  A task (see ::task_t) with extra information needed for task management.
+ * @struct tagged_task_payload_t
+ * @brief  Immutable part of a ::tagged_task_t, shared between all of its copies.
  *
- * @var tagged_task::task
+ * @var tagged_task_payload_t::task
  *     @brief Task (single program / pipeline / procedure) that needs to be run.
- * @var tagged_task::command_line
- *     @brief  Command line that was parsed to originate a task.
- *     @details This will have another value for procedure tasks.
- * @var tagged_task::id
+ * @var tagged_task_payload_t::id
  *     @brief Identifier of the task.
- * @var tagged_task::expected_time
+ * @var tagged_task_payload_t::expected_time
  *     @brief Time that the execution of the task is supposed to take (reported by the client).
- * @var tagged_task::times
- *     @brief Timestamps associated with events regarding the processes of task execution.
+ * @var tagged_task_payload_t::references
+ *     @brief Number of ::tagged_task_t's pointing to this payload. It's freed when it reaches `0`.
+ * @var tagged_task_payload_t::command_line
+ *     @brief   Command line that was parsed to originate a task.
+ *     @details This will have another value for procedure tasks. Allocated together with the
+ *              payload itself.
  */
-struct tagged_task {
+typedef struct {
     task_t  *task;
-    char    *command_line;
     uint32_t id, expected_time;
+    size_t   references;
+    char     command_line[];
+} tagged_task_payload_t;
 
-    struct timespec times[TAGGED_TASK_TIME_COMPLETED + 1];
+/**
+ * @struct tagged_task
+ * @brief  A task (see ::task_t) with extra information needed for task management.
+ *
+ * @var tagged_task::payload
+ *     @brief Immutable information about the task, shared with all its clones.
+ * @var tagged_task::times
+ *     @brief   Timestamps associated with events regarding the processes of task execution.
+ *     @details Unlike tagged_task::payload, these belong to each copy of the task.
+ * @var tagged_task::stages
+ *     @brief Statistics of the programs in the task, once it has been run. Can be `NULL`.
+ * @var tagged_task::nstages
+ *     @brief Number of elements in tagged_task::stages.
+ */
+struct tagged_task {
+    tagged_task_payload_t *payload;
+    struct timespec        times[TAGGED_TASK_TIME_COMPLETED + 1];
+    tagged_task_stage_t   *stages;
+    size_t                 nstages;
 };
 
+/**
+ * @brief Creates a new tagged task with a payload that has no ::task_t yet.
+ *
+ * @param command_line  Command line to be copied to the payload. Mustn't be `NULL` (unchecked).
+ * @param id            Identifier of the task.
+ * @param expected_time Time the client expects this task to consume in execution.
+ *
+ * @return A new tagged task on success, `NULL` on allocation failure (`errno = ENOMEM`).
+ */
+tagged_task_t *
+    __tagged_task_new_empty(const char *command_line, uint32_t id, uint32_t expected_time) {
+    tagged_task_t *ret = pool_allocate(sizeof(tagged_task_t));
+    if (!ret)
+        return NULL; /* errno = ENOMEM guaranteed */
+
+    size_t command_length = strlen(command_line);
+    ret->payload          = pool_allocate(sizeof(tagged_task_payload_t) + command_length + 1);
+    if (!ret->payload) {
+        pool_free(ret, sizeof(tagged_task_t));
+        return NULL; /* errno = ENOMEM guaranteed */
+    }
+
+    ret->payload->task          = NULL;
+    ret->payload->id            = id;
+    ret->payload->expected_time = expected_time;
+    ret->payload->references    = 1;
+    memcpy(ret->payload->command_line, command_line, command_length + 1);
+
+    memset(ret->times, 0, sizeof(ret->times));
+    ret->stages  = NULL;
+    ret->nstages = 0;
+    return ret;
+}
+
 tagged_task_t *tagged_task_new_from_command_line(const char *command_line,
                                                  uint32_t    id,
                                                  uint32_t    expected_time) {
@@ -58,24 +114,15 @@ tagged_task_t *tagged_task_new_from_command_line(const char *command_line,
         return NULL;
     }
 
-    tagged_task_t *ret = malloc(sizeof(tagged_task_t));
+    tagged_task_t *ret = __tagged_task_new_empty(command_line, id, expected_time);
     if (!ret)
         return NULL; /* errno = ENOMEM guaranteed */
 
-    ret->id            = id;
-    ret->expected_time = expected_time;
-    memset(ret->times, 0, sizeof(ret->times));
-
-    ret->command_line = strdup(command_line);
-    if (!ret->command_line) {
-        free(ret);
-        return NULL; /* errno = ENOMEM guaranteed */
-    }
-
-    ret->task = command_parser_parse_task(command_line);
-    if (!ret->task) {
-        free(ret->command_line);
-        free(ret);
+    ret->payload->task = command_parser_parse_task(command_line);
+    if (!ret->payload->task) {
+        int errno2 = errno;
+        tagged_task_free(ret);
+        errno = errno2;
         return NULL; /* EILSEQ or ENOMEM */
     }
 
@@ -91,24 +138,13 @@ tagged_task_t *tagged_task_new_from_procedure(task_procedure_t procedure,
         return NULL;
     }
 
-    tagged_task_t *ret = malloc(sizeof(tagged_task_t));
+    tagged_task_t *ret = __tagged_task_new_empty("PROCEDURE TASK", id, expected_time);
     if (!ret)
         return NULL; /* errno = ENOMEM guaranteed */
 
-    ret->id            = id;
-    ret->expected_time = expected_time;
-    memset(ret->times, 0, sizeof(ret->times));
-
-    ret->command_line = strdup("PROCEDURE TASK");
-    if (!ret->command_line) {
-        free(ret);
-        return NULL; /* errno = ENOMEM guaranteed */
-    }
-
-    ret->task = task_new_from_procedure(procedure, state);
-    if (!ret->task) {
-        free(ret->command_line);
-        free(ret);
+    ret->payload->task = task_new_from_procedure(procedure, state);
+    if (!ret->payload->task) {
+        tagged_task_free(ret);
         return NULL; /* errno = ENOMEM guaranteed */
     }
 
@@ -119,9 +155,14 @@ void tagged_task_free(tagged_task_t *task) {
     if (!task)
         return; /* Don't set errno, as that's not typical free behavior */
 
-    task_free(task->task);
-    free(task->command_line);
-    free(task);
+    task->payload->references--;
+    if (task->payload->references == 0) {
+        task_free(task->payload->task);
+        pool_free(task->payload,
+                  sizeof(tagged_task_payload_t) + strlen(task->payload->command_line) + 1);
+    }
+    pool_free(task->stages, task->nstages * sizeof(tagged_task_stage_t));
+    pool_free(task, sizeof(tagged_task_t));
 }
 
 tagged_task_t *tagged_task_clone(const tagged_task_t *task) {
@@ -130,27 +171,20 @@ tagged_task_t *tagged_task_clone(const tagged_task_t *task) {
         return NULL;
     }
 
-    tagged_task_t *ret = malloc(sizeof(tagged_task_t));
+    tagged_task_t *ret = pool_allocate(sizeof(tagged_task_t));
     if (!ret)
         return NULL; /* errno = ENOMEM guaranteed */
 
-    ret->id            = task->id;
-    ret->expected_time = task->expected_time;
-    memcpy(ret->times, task->times, sizeof(task->times));
-
-    ret->command_line = strdup(task->command_line);
-    if (!ret->command_line) {
-        free(ret); /* errno = ENOMEM guaranteed */
-        return NULL;
-    }
-
-    ret->task = task_clone(task->task);
-    if (!ret->task) {
-        free(ret->command_line);
-        free(ret);
+    ret->stages  = NULL;
+    ret->nstages = 0;
+    if (task->stages && tagged_task_set_stages(ret, task->stages, task->nstages)) {
+        pool_free(ret, sizeof(tagged_task_t));
         return NULL; /* errno = ENOMEM guaranteed */
     }
 
+    ret->payload = task->payload;
+    ret->payload->references++;
+    memcpy(ret->times, task->times, sizeof(task->times));
     return ret;
 }
 
@@ -159,7 +193,7 @@ const task_t *tagged_task_get_task(const tagged_task_t *task) {
         errno = EINVAL;
         return NULL;
     }
-    return task->task;
+    return task->payload->task;
 }
 
 const char *tagged_task_get_command_line(const tagged_task_t *task) {
@@ -167,7 +201,7 @@ const char *tagged_task_get_command_line(const tagged_task_t *task) {
         errno = EINVAL;
         return NULL;
     }
-    return task->command_line;
+    return task->payload->command_line;
 }
 
 uint32_t tagged_task_get_id(const tagged_task_t *task) {
@@ -175,7 +209,7 @@ uint32_t tagged_task_get_id(const tagged_task_t *task) {
         errno = EINVAL;
         return (uint32_t) -1;
     }
-    return task->id;
+    return task->payload->id;
 }
 
 uint32_t tagged_task_get_expected_time(const tagged_task_t *task) {
@@ -183,7 +217,7 @@ uint32_t tagged_task_get_expected_time(const tagged_task_t *task) {
         errno = EINVAL;
         return (uint32_t) -1;
     }
-    return task->expected_time;
+    return task->payload->expected_time;
 }
 
 const struct timespec *tagged_task_get_time(const tagged_task_t *task, tagged_task_time_t id) {
@@ -212,3 +246,33 @@ int tagged_task_set_time(tagged_task_t *task, tagged_task_time_t id, const struc
         task->times[id].tv_sec = task->times[id].tv_nsec = 0;
     return 0;
 }
+
+const tagged_task_stage_t *tagged_task_get_stages(const tagged_task_t *task, size_t *count) {
+    if (!task || !count) {
+        errno = EINVAL;
+        return NULL;
+    }
+
+    *count = task->nstages;
+    return task->stages;
+}
+
+int tagged_task_set_stages(tagged_task_t *task, const tagged_task_stage_t *stages, size_t count) {
+    if (!task || !stages || count > TAGGED_TASK_MAXIMUM_STAGES) {
+        errno = EINVAL;
+        return 1;
+    }
+
+    tagged_task_stage_t *new_stages = NULL;
+    if (count) {
+        new_stages = pool_allocate(count * sizeof(tagged_task_stage_t));
+        if (!new_stages)
+            return 1; /* errno = ENOMEM guaranteed */
+        memcpy(new_stages, stages, count * sizeof(tagged_task_stage_t));
+    }
+
+    pool_free(task->stages, task->nstages * sizeof(tagged_task_stage_t));
+    task->stages  = new_stages;
+    task->nstages = count;
+    return 0;
+}
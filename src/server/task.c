@@ -21,7 +21,9 @@
 
 #include <errno.h>
 #include <stdlib.h>
+#include <string.h>
 
+#include "server/pool.h"
 #include "server/task.h"
 
 /**
@@ -41,6 +43,14 @@
  *     @details Will be `NULL` if task::programs has a value.
  * @var task::procedure_state
  *     @brief Argument that will passed to task::procedure.
+ * @var task::connectors
+ *     @brief   How each program in task::programs is connected to the next one.
+ *     @details When `NULL`, all programs form a single pipeline.
+ * @var task::in_place_size
+ *     @brief   Size of the single allocation containing the task, its programs and their
+ *              arguments, for tasks created with ::task_new_from_string_table.
+ *     @details `0` for other tasks, whose programs (and task::connectors) are separate
+ *              allocations.
  */
 struct task {
     program_t **programs;
@@ -49,8 +59,14 @@ struct task {
 
     task_procedure_t procedure;
     void            *procedure_state;
+
+    task_connector_t *connectors;
+    size_t            in_place_size;
 };
 
+/** @brief Rounds a size up to a multiple of the size of a pointer, to keep objects aligned. */
+#define TASK_ALIGN_SIZE(size) (((size) + sizeof(void *) - 1) & ~(sizeof(void *) - 1))
+
 /** @brief Value of task::capacity for newly created empty tasks. */
 #define TASK_INITIAL_CAPACITY 8
 
@@ -64,7 +80,7 @@ task_t *task_new_from_programs(const program_t *const *programs, size_t length)
         return NULL;
     }
 
-    task_t *ret = malloc(sizeof(task_t));
+    task_t *ret = pool_allocate(sizeof(task_t));
     if (!ret)
         return NULL; /* errno = ENOMEM guaranteed */
 
@@ -76,9 +92,9 @@ task_t *task_new_from_programs(const program_t *const *programs, size_t length)
 
     ret->length   = length;
     ret->capacity = first_power;
-    ret->programs = malloc(sizeof(program_t *) * ret->capacity);
+    ret->programs = pool_allocate(sizeof(program_t *) * ret->capacity);
     if (!ret->programs) {
-        free(ret); /* Won't modify errno = ENOMEM */
+        pool_free(ret, sizeof(task_t)); /* Won't modify errno = ENOMEM */
         return NULL;
     }
 
@@ -93,6 +109,57 @@ task_t *task_new_from_programs(const program_t *const *programs, size_t length)
 
     ret->procedure       = NULL;
     ret->procedure_state = NULL;
+    ret->connectors      = NULL;
+    ret->in_place_size   = 0;
+    return ret;
+}
+
+task_t *task_new_from_string_table(const char                  *strings,
+                                   size_t                       strings_length,
+                                   const size_t                *offsets,
+                                   const task_program_layout_t *layouts,
+                                   size_t                       nprograms) {
+    if (!strings || !offsets || !layouts || nprograms == 0) {
+        errno = EINVAL;
+        return NULL;
+    }
+
+    /* Layout: task, program array, connector array, programs (with their argv), strings */
+    size_t connectors_offset = sizeof(task_t) + sizeof(program_t *) * nprograms;
+    size_t size = connectors_offset + TASK_ALIGN_SIZE(sizeof(task_connector_t) * nprograms);
+    for (size_t i = 0; i < nprograms; ++i)
+        size += program_get_in_place_size(layouts[i].program.argument_count);
+    size_t strings_offset = size;
+    size += strings_length;
+
+    task_t *ret = pool_allocate(size);
+    if (!ret)
+        return NULL; /* errno = ENOMEM guaranteed */
+
+    char *memory     = (char *) ret;
+    char *ret_string = memory + strings_offset;
+    memcpy(ret_string, strings, strings_length);
+
+    ret->programs        = (program_t **) (ret + 1);
+    ret->length          = nprograms;
+    ret->capacity        = nprograms;
+    ret->procedure       = NULL;
+    ret->procedure_state = NULL;
+    ret->connectors      = (task_connector_t *) (memory + connectors_offset);
+    ret->in_place_size   = size;
+
+    char *program_memory =
+        memory + connectors_offset + TASK_ALIGN_SIZE(sizeof(task_connector_t) * nprograms);
+    for (size_t i = 0; i < nprograms; ++i) {
+        size_t argument_count = layouts[i].program.argument_count;
+        ret->programs[i] =
+            program_new_in_place(program_memory, ret_string, offsets, &layouts[i].program);
+        ret->connectors[i] = i == nprograms - 1 ? TASK_CONNECTOR_NONE : layouts[i].connector;
+
+        program_memory += program_get_in_place_size(argument_count);
+        offsets += argument_count;
+    }
+
     return ret;
 }
 
@@ -102,7 +169,7 @@ task_t *task_new_from_procedure(task_procedure_t procedure, void *state) {
         return NULL;
     }
 
-    task_t *ret = malloc(sizeof(task_t));
+    task_t *ret = pool_allocate(sizeof(task_t));
     if (!ret)
         return NULL; /* errno = ENOMEM guaranteed */
 
@@ -110,6 +177,8 @@ task_t *task_new_from_procedure(task_procedure_t procedure, void *state) {
     ret->length = ret->capacity = 0;
     ret->procedure              = procedure;
     ret->procedure_state        = state;
+    ret->connectors             = NULL;
+    ret->in_place_size          = 0;
     return ret;
 }
 
@@ -117,12 +186,18 @@ void task_free(task_t *task) {
     if (!task)
         return; /* Don't set EINVAL, as that's normal free behavior. */
 
+    if (task->in_place_size) {
+        pool_free(task, task->in_place_size); /* Programs live in the same allocation */
+        return;
+    }
+
     if (task->programs) {
         for (size_t i = 0; i < task->length; ++i)
             program_free(task->programs[i]);
-        free(task->programs);
+        pool_free(task->programs, sizeof(program_t *) * task->capacity);
     }
-    free(task);
+    pool_free(task->connectors, sizeof(task_connector_t) * task->length);
+    pool_free(task, sizeof(task_t));
 }
 
 task_t *task_clone(const task_t *task) {
@@ -131,14 +206,25 @@ task_t *task_clone(const task_t *task) {
         return NULL;
     }
 
-    if (task->programs)
-        return task_new_from_programs((const program_t *const *) task->programs, task->length);
-    else
+    if (!task->programs)
         return task_new_from_procedure(task->procedure, task->procedure_state);
+
+    task_t *ret =
+        task_new_from_programs((const program_t *const *) task->programs, task->length);
+    if (!ret || !task->connectors)
+        return ret; /* errno = ENOMEM guaranteed on failure */
+
+    ret->connectors = pool_allocate(sizeof(task_connector_t) * task->length);
+    if (!ret->connectors) {
+        task_free(ret);
+        return NULL; /* errno = ENOMEM guaranteed */
+    }
+    memcpy(ret->connectors, task->connectors, sizeof(task_connector_t) * task->length);
+    return ret;
 }
 
 int task_add_program(task_t *task, const program_t *program) {
-    if (!task || !program || !task->programs) {
+    if (!task || !program || !task->programs || task->connectors) {
         errno = EINVAL;
         return 1;
     }
@@ -149,9 +235,13 @@ int task_add_program(task_t *task, const program_t *program) {
 
     if (task->length >= task->capacity) {
         size_t      new_capacity = task->capacity * 2;
-        program_t **new_programs = realloc(task->programs, sizeof(program_t *) * new_capacity);
-        if (!new_programs)
+        program_t **new_programs = pool_reallocate(task->programs,
+                                                   sizeof(program_t *) * task->capacity,
+                                                   sizeof(program_t *) * new_capacity);
+        if (!new_programs) {
+            program_free(new_program);
             return 1; /* errno = ENOMEM guaranteed */
+        }
 
         task->capacity = new_capacity;
         task->programs = new_programs;
@@ -172,6 +262,18 @@ const program_t *const *task_get_programs(const task_t *task, size_t *count) {
     return (const program_t *const *) task->programs;
 }
 
+task_connector_t task_get_connector(const task_t *task, size_t index) {
+    if (!task || !task->programs || index >= task->length) {
+        errno = EINVAL;
+        return TASK_CONNECTOR_NONE;
+    }
+
+    if (task->connectors)
+        return task->connectors[index];
+    else
+        return index == task->length - 1 ? TASK_CONNECTOR_NONE : TASK_CONNECTOR_PIPE;
+}
+
 int task_get_procedure(const task_t *task, task_procedure_t *procedure, void **state) {
     if (!task || !task->procedure) {
         errno = EINVAL;
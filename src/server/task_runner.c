@@ -19,26 +19,138 @@
  * @brief Implementation of methods in server/task_runner.h
  */
 
+/* Needed for wait4(), tee() and F_SETPIPE_SZ */
+#define _GNU_SOURCE
+
 #include <errno.h>
 #include <fcntl.h>
+#include <limits.h>
+#include <poll.h>
 #include <stdarg.h>
 #include <stdio.h>
+#include <stdlib.h>
 #include <string.h>
+#include <sys/ioctl.h>
+#include <sys/resource.h>
 #include <sys/wait.h>
 #include <unistd.h>
 
+#include "metrics.h"
 #include "protocol.h"
+#include "server/path_cache.h"
 #include "server/task_runner.h"
+#include "trace.h"
 #include "util.h"
 
-/** @brief Waits for all children of the current process. */
-void __task_runner_wait_all_children(void) {
-    while (1) {
-        errno   = 0;
-        pid_t p = wait(NULL);
-        if (p < 0 && errno == ECHILD) /* No more children */
-            break;
+/** @brief Size of the buffers of the pipes between programs. `0` for the system's default. */
+static size_t __task_runner_pipe_size = 0;
+
+/** @brief Maximum number of clients following the output of a task at the same time. */
+#define TASK_RUNNER_MAXIMUM_FOLLOWERS 16
+
+/**
+ * @brief   Size of the buffers of the named pipes of clients following a task.
+ * @details Larger than the default, so that clients are less likely to fall behind the task and be
+ *          removed. Failure to set it (above `/proc/sys/fs/pipe-max-size`) is ignored.
+ */
+#define TASK_RUNNER_FOLLOWER_PIPE_SIZE (1024 * 1024)
+
+/**
+ * @brief   Whether a program may have terminated since the runner last reaped its children.
+ * @details Set by ::__task_runner_on_child_signal. Signals are only delivered while the runner
+ *          waits in `ppoll()`, so no other synchronization is needed.
+ */
+static volatile sig_atomic_t __task_runner_child_terminated = 0;
+
+/** @brief PIDs of the clients that asked to follow this task, queued by the signal handler. */
+static pid_t __task_runner_follow_requests[TASK_RUNNER_MAXIMUM_FOLLOWERS];
+
+/** @brief Number of elements in ::__task_runner_follow_requests. */
+static volatile sig_atomic_t __task_runner_follow_request_count = 0;
+
+/**
+ * @struct task_runner_execution_t
+ * @brief  Progress of the programs of a task, whose pipelines are run one at a time.
+ *
+ * @var task_runner_execution_t::task
+ *     @brief Task being run.
+ * @var task_runner_execution_t::out
+ *     @brief File descriptor for the `stdout` of the task.
+ * @var task_runner_execution_t::err
+ *     @brief File descriptor for the `stderr` of the task.
+ * @var task_runner_execution_t::pipes
+ *     @brief Read ends of the pipes that task_runner_execution_t::out and
+ *            task_runner_execution_t::err write to (`-1` when closed or when the output isn't
+ *            stored).
+ * @var task_runner_execution_t::slot
+ *     @brief Slot in the scheduler where the task was scheduled.
+ * @var task_runner_execution_t::stages
+ *     @brief Where to record the statistics of the programs in the task.
+ * @var task_runner_execution_t::pids
+ *     @brief PIDs of the programs in the task, indexed like them (`-1` when not running).
+ * @var task_runner_execution_t::start
+ *     @brief Index of the first program of the current pipeline.
+ * @var task_runner_execution_t::end
+ *     @brief Index of the last program of the current pipeline.
+ * @var task_runner_execution_t::running
+ *     @brief Number of programs in the current pipeline that haven't been reaped.
+ * @var task_runner_execution_t::status
+ *     @brief Exit status of the last pipeline that was run.
+ */
+typedef struct {
+    const tagged_task_t *task;
+    int                  out, err, pipes[OUTPUT_STORE_STREAM_COUNT];
+    size_t               slot;
+    tagged_task_stage_t *stages;
+
+    pid_t *pids;
+    size_t start, end, running;
+    int    status;
+} task_runner_execution_t;
+
+/**
+ * @brief Converts a `struct timeval` to microseconds.
+ * @param time Time to be converted. Mustn't be `NULL` (unchecked).
+ */
+uint64_t __task_runner_timeval_to_us(const struct timeval *time) {
+    return (uint64_t) time->tv_sec * 1000000 + (uint64_t) time->tv_usec;
+}
+
+/**
+ * @brief   Applies a program's redirections to the current process.
+ * @details Meant to be called in the child, before `exec()`. Errors are printed to `stderr`.
+ *
+ * @param program Program whose redirections are applied. Mustn't be `NULL` (unchecked).
+ *
+ * @retval 0 Success.
+ * @retval 1 Failure to open a file.
+ */
+int __task_runner_redirect(const program_t *program) {
+    for (program_redirection_t i = 0; i < PROGRAM_REDIRECTION_COUNT; ++i) {
+        int         append;
+        const char *path = program_get_redirection(program, i, &append);
+        if (!path)
+            continue;
+
+        int flags = O_RDONLY;
+        if (i != PROGRAM_REDIRECTION_INPUT)
+            flags = O_CREAT | O_WRONLY | (append ? O_APPEND : O_TRUNC);
+
+        int fd = open(path, flags, 0640);
+        if (fd < 0) {
+            char error_msg[LINE_MAX] = {0};
+            (void) strerror_r(errno, error_msg, LINE_MAX);
+            util_error("%s(): failed to open \"%s\": %s\n", __func__, path, error_msg);
+            return 1;
+        }
+
+        /* PROGRAM_REDIRECTION_* values match the standard file descriptor numbers */
+        if (fd != (int) i) {
+            dup2(fd, i);
+            close(fd);
+        }
     }
+    return 0;
 }
 
 /**
@@ -50,23 +162,33 @@ void __task_runner_wait_all_children(void) {
  * @param err     `stderr` file descriptor to be duplicated.
  * @param ...     File descriptors to be closed by the child. Terminated with `-1`.
  *
- * @retval 0 Success.
- * @retval 1 Failure (check `errno`).
+ * @return The PID of the child, or `-1` on failure (check `errno`). Failure to find the program
+ *         isn't reported here, but by the child, that writes an error message to @p err.
  *
  * | `errno`  | Cause                 |
  * | -------- | --------------------- |
  * | `EINVAL` | @p program is `NULL`. |
  * | other    | See `man 2 fork`.     |
  */
-int __task_runner_spawn(const program_t *program, int in, int out, int err, ...) {
+pid_t __task_runner_spawn(const program_t *program, int in, int out, int err, ...) {
     if (!program) {
         errno = EINVAL;
-        return 1;
+        return -1;
     }
 
+    /* Resolved before fork(), so that the cache stays warm in the runner for the next programs */
     const char *const *args = program_get_arguments(program);
+    const char        *path = path_cache_resolve(args[0]);
     pid_t              p    = fork();
     if (p == 0) {
+        /* Undo the runner's signal setup, as ignored signals are kept across exec() */
+        sigset_t runner_signals;
+        (void) sigemptyset(&runner_signals);
+        (void) sigaddset(&runner_signals, TASK_RUNNER_FOLLOW_SIGNAL);
+        (void) sigaddset(&runner_signals, SIGCHLD);
+        (void) sigprocmask(SIG_UNBLOCK, &runner_signals, NULL);
+        (void) signal(SIGPIPE, SIG_DFL);
+
         va_list close_fds;
         va_start(close_fds, err);
         int close_fd;
@@ -90,13 +212,23 @@ int __task_runner_spawn(const program_t *program, int in, int out, int err, ...)
             close(err);
         }
 
-        execvp(args[0], (char *const *) (uintptr_t) args);
+        if (__task_runner_redirect(program))
+            _exit(1);
+
+        /* These error messages will end up in the stderr file */
+        if (!path) {
+            util_error("%s(): program \"%s\" not found!\n", __func__, args[0]);
+            _exit(1);
+        }
 
-        /* This error message will end up in the stderr file */
-        util_error("%s(): exec(\"%s\") failed!\n", __func__, args[0]);
+        trace_event(TRACE_EVENT_EXEC, TRACE_NO_TASK, 0);
+        execv(path, (char *const *) (uintptr_t) args);
+        util_error("%s(): exec(\"%s\") failed!\n", __func__, path);
         _exit(1);
+    } else if (p < 0) {
+        metrics_add(METRICS_COUNTER_FORK_FAILURES, 1);
     }
-    return p < 0;
+    return p;
 }
 
 /**
@@ -111,13 +243,18 @@ int __task_runner_spawn(const program_t *program, int in, int out, int err, ...)
  * @brief   Communicates to the parent server that the task has terminated.
  * @details Errors (even those recovered from) will be outputted to `stderr`.
  *
- * @param slot  Slot in the scheduler where this task was scheduled.
- * @param error Whether an error occurred while running the task.
+ * @param slot    Slot in the scheduler where this task was scheduled.
+ * @param error   Whether an error occurred while running the task.
+ * @param stages  Statistics of the programs in the task. Can be `NULL` if @p nstages is `0`.
+ * @param nstages Number of elements in @p stages. At most ::TAGGED_TASK_MAXIMUM_STAGES.
  *
  * @retval 0 Success.
  * @retval 1 Failure (unspecified `errno`).
  */
-int __task_runner_warn_parent(size_t slot, int error) {
+int __task_runner_warn_parent(size_t                     slot,
+                              int                        error,
+                              const tagged_task_stage_t *stages,
+                              size_t                     nstages) {
     struct timespec time_ended = {0};
     (void) clock_gettime(CLOCK_MONOTONIC, &time_ended);
     protocol_task_done_message_t message = {.type       = PROTOCOL_C2S_TASK_DONE,
@@ -125,6 +262,8 @@ int __task_runner_warn_parent(size_t slot, int error) {
                                             .time_ended = time_ended,
                                             .is_status  = 0,
                                             .error      = error};
+    if (nstages)
+        memcpy(message.stages, stages, nstages * sizeof(tagged_task_stage_t));
 
     ipc_t *ipc = ipc_new(IPC_ENDPOINT_CLIENT);
     if (!ipc) {
@@ -134,89 +273,532 @@ int __task_runner_warn_parent(size_t slot, int error) {
 
     if (ipc_send_retry(ipc,
                        &message,
-                       sizeof(protocol_task_done_message_t),
+                       PROTOCOL_TASK_DONE_HEADER_LENGTH + nstages * sizeof(tagged_task_stage_t),
                        TASK_RUNNER_WARN_PARENT_MAX_RETRIES)) {
         util_perror("__task_runner_warn_parent(): error while sending message");
         ipc_free(ipc);
         return 1;
     }
 
+    trace_event(TRACE_EVENT_DONE_SENT, TRACE_NO_TASK, 0);
     ipc_free(ipc);
     return 0;
 }
 
-int task_runner_main(tagged_task_t *task, size_t slot, const char *directory) {
-    uint32_t                task_id = tagged_task_get_id(task);
+/**
+ * @brief   Handles a failure to set up a pipeline, by waiting for the programs already spawned and
+ *          warning the server. Doesn't return.
+ * @details The pipes with the task's output are closed first, so that programs writing to them
+ *          terminate instead of blocking forever.
+ *
+ * @param execution Programs of the task being run. Mustn't be `NULL` (unchecked).
+ * @param function  Name of the function that failed.
+ */
+void __task_runner_pipeline_failure(task_runner_execution_t *execution, const char *function) {
+    char error_msg[LINE_MAX] = {0};
+    (void) strerror_r(errno, error_msg, LINE_MAX);
+    util_error("__task_runner_spawn_pipeline(): %s() failed: %s\n", function, error_msg);
+
+    for (output_store_stream_t i = 0; i < OUTPUT_STORE_STREAM_COUNT; ++i)
+        if (execution->pipes[i] >= 0)
+            (void) close(execution->pipes[i]);
+
+    while (wait(NULL) >= 0 || errno == EINTR) /* May block forever */
+        ;
+    __task_runner_warn_parent(execution->slot, 1, NULL, 0);
+    _exit(1);
+}
+
+/**
+ * @brief Records when a program in a task started running.
+ * @param stages Statistics of the programs in the task. Mustn't be `NULL` (unchecked).
+ * @param index  Index of the program in the task.
+ */
+void __task_runner_stage_started(tagged_task_stage_t *stages, size_t index) {
+    if (index < TAGGED_TASK_MAXIMUM_STAGES) {
+        (void) clock_gettime(CLOCK_MONOTONIC, &stages[index].started);
+        stages[index].executed = 1;
+    }
+}
+
+/**
+ * @brief   Spawns the programs of the current pipeline, without waiting for them.
+ * @details On `pipe()` or `fork()` failure, the parent is warned and the process `_exit()`s.
+ *
+ * @param execution Programs of the task being run, whose task_runner_execution_t::start and
+ *                  task_runner_execution_t::end delimit the pipeline. Mustn't be `NULL`
+ *                  (unchecked).
+ * @param programs  Programs in the task. Mustn't be `NULL` (unchecked).
+ */
+void __task_runner_spawn_pipeline(task_runner_execution_t *execution,
+                                  const program_t *const  *programs) {
+    int in = STDIN_FILENO;
+    for (size_t i = execution->start; i < execution->end; ++i) {
+        int fds[2];
+        if (pipe(fds))
+            __task_runner_pipeline_failure(execution, "pipe");
+
+        /* Validated by task_runner_set_pipe_size(), so failure isn't expected */
+        if (__task_runner_pipe_size)
+            (void) fcntl(fds[STDOUT_FILENO], F_SETPIPE_SZ, (int) __task_runner_pipe_size);
+
+        __task_runner_stage_started(execution->stages, i);
+        execution->pids[i] = __task_runner_spawn(programs[i],
+                                                 in,
+                                                 fds[STDOUT_FILENO],
+                                                 execution->err,
+                                                 fds[STDIN_FILENO],
+                                                 execution->out,
+                                                 -1);
+        if (execution->pids[i] < 0)
+            __task_runner_pipeline_failure(execution, "fork");
+        execution->running++;
+
+        if (in != STDIN_FILENO)
+            (void) close(in);
+        (void) close(fds[STDOUT_FILENO]);
+        in = fds[STDIN_FILENO];
+    }
+
+    size_t last = execution->end;
+    __task_runner_stage_started(execution->stages, last);
+    execution->pids[last] =
+        __task_runner_spawn(programs[last], in, execution->out, execution->err, -1);
+    if (execution->pids[last] < 0)
+        __task_runner_pipeline_failure(execution, "fork");
+    execution->running++;
+
+    if (in != STDIN_FILENO)
+        (void) close(in);
+}
+
+/**
+ * @brief   Starts the next pipeline of a task that should run, according to `&&` and `;`.
+ * @details Pipelines after a `&&` are skipped if the pipeline before them failed.
+ *
+ * @param execution Programs of the task being run, with no pipeline running. Mustn't be `NULL`
+ *                  (unchecked).
+ *
+ * @retval 0 A pipeline was started.
+ * @retval 1 All pipelines in the task have been run.
+ */
+int __task_runner_start_pipeline(task_runner_execution_t *execution) {
     size_t                  nprograms;
-    const program_t *const *programs = task_get_programs(tagged_task_get_task(task), &nprograms);
-    if (!programs) {
-        task_procedure_t procedure;
-        void            *state;
-        task_get_procedure(tagged_task_get_task(task), &procedure, &state);
-        return procedure(state, slot);
+    const task_t           *inner_task = tagged_task_get_task(execution->task);
+    const program_t *const *programs   = task_get_programs(inner_task, &nprograms);
+    while (execution->start < nprograms) {
+        size_t start = execution->start, end = start;
+        while (end < nprograms - 1 && task_get_connector(inner_task, end) == TASK_CONNECTOR_PIPE)
+            end++;
+        execution->end = end;
+
+        if (start == 0 || task_get_connector(inner_task, start - 1) != TASK_CONNECTOR_AND ||
+            execution->status == 0) {
+            __task_runner_spawn_pipeline(execution, programs);
+            return 0;
+        }
+        execution->start = end + 1;
     }
+    return 1;
+}
 
-    if (!nprograms)
-        return 1;
+/**
+ * @brief   Reaps the programs of a task that have terminated, without blocking.
+ * @details The statistics of reaped programs are recorded, and the next pipeline is started once
+ *          all programs in the current one have been reaped.
+ *
+ * @param execution Programs of the task being run. Mustn't be `NULL` (unchecked).
+ *
+ * @retval 0 Programs are still running.
+ * @retval 1 All pipelines in the task have been run.
+ */
+int __task_runner_reap(task_runner_execution_t *execution) {
+    while (execution->running) {
+        int           status;
+        struct rusage usage;
+        pid_t         p = wait4(-1, &status, WNOHANG, &usage);
+        if (p < 0 && errno == EINTR)
+            continue;
+        else if (p <= 0) /* No more terminated children */
+            return 0;
 
-    char outpath[PATH_MAX];
-    snprintf(outpath, PATH_MAX, "%s/%" PRIu32 ".out", directory, task_id);
-    int out = open(outpath, O_CREAT | O_WRONLY | O_TRUNC, 0640);
-    if (out < 0) {
-        util_perror(
-            "task_runner_main(): failed to create output file - redirecting output to stdout");
-        out = STDOUT_FILENO;
+        size_t i = execution->start;
+        while (i <= execution->end && execution->pids[i] != p)
+            i++;
+        if (i > execution->end)
+            continue;
+
+        execution->pids[i] = -1;
+        execution->running--;
+        if (i == execution->end)
+            execution->status = WIFEXITED(status) ? WEXITSTATUS(status) : 1;
+
+        if (i < TAGGED_TASK_MAXIMUM_STAGES) {
+            tagged_task_stage_t *stage = execution->stages + i;
+            (void) clock_gettime(CLOCK_MONOTONIC, &stage->ended);
+            stage->user_time             = __task_runner_timeval_to_us(&usage.ru_utime);
+            stage->system_time           = __task_runner_timeval_to_us(&usage.ru_stime);
+            stage->maximum_resident_size = usage.ru_maxrss; /* Already in KiB on Linux */
+            stage->exit_status = WIFEXITED(status) ? WEXITSTATUS(status) : -WTERMSIG(status);
+        }
+
+        if (!execution->running) {
+            execution->start = execution->end + 1;
+            if (__task_runner_start_pipeline(execution))
+                return 1;
+        }
     }
+    return 1;
+}
 
-    char errpath[PATH_MAX];
-    snprintf(errpath, PATH_MAX, "%s/%" PRIu32 ".err", directory, task_id);
-    int err = open(errpath, O_CREAT | O_WRONLY | O_TRUNC, 0640);
-    if (err < 0) {
-        util_perror(
-            "task_runner_main(): failed to create output file - redirecting output to stdout");
-        err = STDERR_FILENO;
+int task_runner_set_pipe_size(size_t size) {
+#ifdef F_SETPIPE_SZ
+    if (size > INT_MAX) {
+        errno = EINVAL;
+        return 1;
     }
 
-    int in = 0;
-    for (size_t i = 0; i < nprograms - 1; ++i) {
+    if (size) {
+        /* Try it on a pipe, so that the size is rejected now and not while running a task */
         int fds[2];
-        if (pipe(fds)) {
-            char error_msg[LINE_MAX] = {0};
-            (void) strerror_r(errno, error_msg, LINE_MAX);
-            util_error("%s(): pipe() failed: %s\n", __func__, error_msg);
+        if (pipe(fds))
+            return 1;
 
-            __task_runner_wait_all_children(); /* May block forever */
-            __task_runner_warn_parent(slot, 1);
-            _exit(1);
+        int ret        = fcntl(fds[STDOUT_FILENO], F_SETPIPE_SZ, (int) size) < 0;
+        int errno_copy = errno;
+        (void) close(fds[STDIN_FILENO]);
+        (void) close(fds[STDOUT_FILENO]);
+        errno = errno_copy;
+        if (ret)
+            return 1;
+    }
+
+    __task_runner_pipe_size = size;
+    return 0;
+#else
+    if (size) {
+        errno = ENOTSUP;
+        return 1;
+    }
+    return 0;
+#endif
+}
+
+/**
+ * @brief   Signal handler for ::TASK_RUNNER_FOLLOW_SIGNAL.
+ * @details Only queues the client's PID in ::__task_runner_follow_requests, to be handled by the
+ *          loop in ::__task_runner_run_programs. Requests beyond ::TASK_RUNNER_MAXIMUM_FOLLOWERS
+ *          between two iterations of that loop are dropped.
+ *
+ * @param signum  Always ::TASK_RUNNER_FOLLOW_SIGNAL.
+ * @param info    Information about the signal, whose value is the PID of the client.
+ * @param context Unused.
+ */
+void __task_runner_on_follow_signal(int signum, siginfo_t *info, void *context) {
+    (void) signum;
+    (void) context;
+
+    if (__task_runner_follow_request_count < TASK_RUNNER_MAXIMUM_FOLLOWERS)
+        __task_runner_follow_requests[__task_runner_follow_request_count++] =
+            info->si_value.sival_int;
+}
+
+/**
+ * @brief Signal handler for `SIGCHLD`, that sets ::__task_runner_child_terminated.
+ * @param signum Always `SIGCHLD`.
+ */
+void __task_runner_on_child_signal(int signum) {
+    (void) signum;
+    __task_runner_child_terminated = 1;
+}
+
+/**
+ * @brief   Starts streaming the output of the task to a client.
+ * @details The client's named pipes are always opened, even if they're immediately closed (the task
+ *          can't be followed or one of its outputs has already ended), so that the client sees
+ *          them hang up.
+ *
+ * @param followers  Named pipes of the clients following the task (`-1` when closed). Mustn't be
+ *                   `NULL` (unchecked).
+ * @param client_pid PID of the client.
+ * @param pipes      Read ends of the pipes with the task's output (`-1` when closed). Mustn't be
+ *                   `NULL` (unchecked).
+ */
+void __task_runner_add_follower(int       followers[TASK_RUNNER_MAXIMUM_FOLLOWERS]
+                                                   [OUTPUT_STORE_STREAM_COUNT],
+                                pid_t     client_pid,
+                                const int pipes[OUTPUT_STORE_STREAM_COUNT]) {
+    size_t slot = 0;
+    while (slot < TASK_RUNNER_MAXIMUM_FOLLOWERS &&
+           (followers[slot][OUTPUT_STORE_STREAM_OUTPUT] >= 0 ||
+            followers[slot][OUTPUT_STORE_STREAM_ERROR] >= 0))
+        slot++;
+
+    int fds[OUTPUT_STORE_STREAM_COUNT];
+    for (output_store_stream_t i = 0; i < OUTPUT_STORE_STREAM_COUNT; ++i) {
+        char path[PATH_MAX];
+        (void) ipc_get_follow_fifo_path(client_pid,
+                                        i == OUTPUT_STORE_STREAM_OUTPUT ? STDOUT_FILENO
+                                                                        : STDERR_FILENO,
+                                        path);
+
+        /* Non-blocking, so that a slow client can't stall the task */
+        fds[i] = open(path, O_WRONLY | O_NONBLOCK | O_CLOEXEC);
+        if (fds[i] >= 0)
+            (void) fcntl(fds[i], F_SETPIPE_SZ, TASK_RUNNER_FOLLOWER_PIPE_SIZE);
+
+        if (fds[i] >= 0 && (slot == TASK_RUNNER_MAXIMUM_FOLLOWERS || pipes[i] < 0)) {
+            (void) close(fds[i]);
+            fds[i] = -1;
         }
+    }
 
-        if (__task_runner_spawn(programs[i],
-                                in,
-                                fds[STDOUT_FILENO],
-                                err,
-                                fds[STDIN_FILENO],
-                                out,
-                                -1)) {
-            char error_msg[LINE_MAX] = {0};
-            (void) strerror_r(errno, error_msg, LINE_MAX);
-            util_error("%s(): fork() failed: %s\n", __func__, error_msg);
+    if (slot < TASK_RUNNER_MAXIMUM_FOLLOWERS)
+        memcpy(followers[slot], fds, sizeof(fds));
+}
 
-            __task_runner_wait_all_children(); /* May block forever */
-            __task_runner_warn_parent(slot, 1);
-            _exit(1);
+/**
+ * @brief Stops streaming the output of the task to a client.
+ * @param follower Named pipes of the client (`-1` when closed). Mustn't be `NULL` (unchecked).
+ */
+void __task_runner_remove_follower(int follower[OUTPUT_STORE_STREAM_COUNT]) {
+    for (output_store_stream_t i = 0; i < OUTPUT_STORE_STREAM_COUNT; ++i) {
+        if (follower[i] >= 0)
+            (void) close(follower[i]);
+        follower[i] = -1;
+    }
+}
+
+/**
+ * @brief   Moves the data available in a pipe with the task's output to where it's stored.
+ * @details The data is first `tee()`d to all followers. Followers that can't keep up are removed,
+ *          as the task isn't stalled for them.
+ *
+ * @param pipe      Read end of the pipe with the task's output.
+ * @param writer    Where to store the output of the task. Mustn't be `NULL` (unchecked).
+ * @param stream    Which output of the task @p pipe refers to.
+ * @param followers Named pipes of the clients following the task (`-1` when closed). Mustn't be
+ *                  `NULL` (unchecked).
+ *
+ * @retval 0 Success.
+ * @retval 1 End-of-file or failure, after which @p pipe must be closed.
+ */
+int __task_runner_forward(int                    pipe,
+                          output_store_writer_t *writer,
+                          output_store_stream_t  stream,
+                          int followers[TASK_RUNNER_MAXIMUM_FOLLOWERS][OUTPUT_STORE_STREAM_COUNT]) {
+    int available = 0;
+    if (ioctl(pipe, FIONREAD, &available) || available == 0)
+        return 1; /* Nothing to read despite poll() means that all writers left */
+
+    for (size_t i = 0; i < TASK_RUNNER_MAXIMUM_FOLLOWERS; ++i) {
+        if (followers[i][stream] < 0)
+            continue;
+
+        ssize_t teed;
+        do {
+            teed = tee(pipe, followers[i][stream], available, SPLICE_F_NONBLOCK);
+        } while (teed < 0 && errno == EINTR);
+
+        if (teed != available)
+            __task_runner_remove_follower(followers[i]);
+    }
+
+    while (available > 0) {
+        ssize_t moved = output_store_write(writer, stream, pipe, available);
+        if (moved <= 0) {
+            util_perror("__task_runner_forward(): failed to store task output");
+            return 1;
         }
+        available -= moved;
+    }
+    return 0;
+}
 
-        if (i != 0) /* Don't close stdin */
-            (void) close(in);
-        (void) close(fds[STDOUT_FILENO]);
-        in = fds[STDIN_FILENO];
+/**
+ * @brief   Runs all pipelines in a task, separated by `&&` and `;`, until they terminate.
+ * @details Programs are reaped on `SIGCHLD` by the same `ppoll()` loop that stores the task's
+ *          output and streams it to followers, so that no process other than the programs
+ *          themselves is needed. Signals are only handled while waiting in `ppoll()`. Errors are
+ *          printed to `stderr`.
+ *
+ * @param execution Programs of the task to be run. Its task_runner_execution_t::pipes are closed by
+ *                  this function, as are task_runner_execution_t::out and
+ *                  task_runner_execution_t::err when @p writer isn't `NULL`. Mustn't be `NULL`
+ *                  (unchecked).
+ * @param writer    Where to store the output of the task. `NULL` if the task's output goes
+ *                  directly to the runner's `stdout` and `stderr`, in which case it can't be
+ *                  followed.
+ *
+ * @retval 0 Success.
+ * @retval 1 Failure.
+ */
+int __task_runner_run_programs(task_runner_execution_t *execution, output_store_writer_t *writer) {
+    struct sigaction child_action  = {.sa_handler = __task_runner_on_child_signal,
+                                      .sa_flags   = SA_NOCLDSTOP};
+    struct sigaction follow_action = {.sa_sigaction = __task_runner_on_follow_signal,
+                                      .sa_flags     = SA_SIGINFO};
+    (void) sigemptyset(&child_action.sa_mask);
+    (void) sigemptyset(&follow_action.sa_mask);
+    (void) sigaction(SIGCHLD, &child_action, NULL);
+    (void) sigaction(TASK_RUNNER_FOLLOW_SIGNAL, &follow_action, NULL);
+
+    sigset_t handled_signals, wait_mask;
+    (void) sigemptyset(&handled_signals);
+    (void) sigaddset(&handled_signals, SIGCHLD);
+    (void) sigaddset(&handled_signals, TASK_RUNNER_FOLLOW_SIGNAL);
+    (void) sigprocmask(SIG_BLOCK, &handled_signals, &wait_mask);
+    (void) sigdelset(&wait_mask, SIGCHLD);
+    if (writer) /* Otherwise, followers are handled by clients, that check if the runner is alive */
+        (void) sigdelset(&wait_mask, TASK_RUNNER_FOLLOW_SIGNAL);
+
+    int followers[TASK_RUNNER_MAXIMUM_FOLLOWERS][OUTPUT_STORE_STREAM_COUNT];
+    memset(followers, -1, sizeof(followers));
+
+    int *pipes = execution->pipes, ret = 0;
+    int  done  = __task_runner_start_pipeline(execution);
+    while (1) {
+        if (done && writer && execution->out >= 0) {
+            /* Only the programs' copies were left, so the pipes now reach end-of-file */
+            (void) close(execution->out);
+            (void) close(execution->err);
+            execution->out = execution->err = -1;
+        }
+
+        if (done && pipes[OUTPUT_STORE_STREAM_OUTPUT] < 0 && pipes[OUTPUT_STORE_STREAM_ERROR] < 0)
+            break;
+
+        struct pollfd pfds[OUTPUT_STORE_STREAM_COUNT];
+        for (output_store_stream_t i = 0; i < OUTPUT_STORE_STREAM_COUNT; ++i)
+            pfds[i] = (struct pollfd){.fd = pipes[i], .events = POLLIN};
+
+        int ready = ppoll(pfds, OUTPUT_STORE_STREAM_COUNT, NULL, &wait_mask);
+        if (ready < 0 && errno != EINTR) {
+            util_perror("__task_runner_run_programs(): ppoll() failed");
+            ret = 1;
+            break;
+        }
+
+        if (__task_runner_child_terminated) {
+            __task_runner_child_terminated = 0;
+            if (!done)
+                done = __task_runner_reap(execution);
+        }
+
+        for (sig_atomic_t i = 0; i < __task_runner_follow_request_count; ++i)
+            __task_runner_add_follower(followers, __task_runner_follow_requests[i], pipes);
+        __task_runner_follow_request_count = 0;
+
+        for (output_store_stream_t i = 0; ready > 0 && i < OUTPUT_STORE_STREAM_COUNT; ++i) {
+            if (!pfds[i].revents || !__task_runner_forward(pipes[i], writer, i, followers))
+                continue;
+
+            (void) close(pipes[i]);
+            pipes[i] = -1;
+            for (size_t j = 0; j < TASK_RUNNER_MAXIMUM_FOLLOWERS; ++j) {
+                if (followers[j][i] >= 0)
+                    (void) close(followers[j][i]);
+                followers[j][i] = -1;
+            }
+        }
+    }
+
+    for (size_t i = 0; i < TASK_RUNNER_MAXIMUM_FOLLOWERS; ++i)
+        __task_runner_remove_follower(followers[i]);
+    for (output_store_stream_t i = 0; i < OUTPUT_STORE_STREAM_COUNT; ++i)
+        if (pipes[i] >= 0)
+            (void) close(pipes[i]);
+    if (writer && execution->out >= 0) {
+        (void) close(execution->out);
+        (void) close(execution->err);
+    }
+    return ret;
+}
+
+/**
+ * @brief   Runs a task whose output can be followed by clients.
+ * @details The output of the programs goes through pipes drained by this process (see
+ *          ::__task_runner_run_programs). Failures are printed to `stderr`.
+ *
+ * @param execution Programs of the task to be run. Mustn't be `NULL` (unchecked).
+ * @param writer    Where to store the output of the task. Mustn't be `NULL` (unchecked).
+ *
+ * @retval 0 Success.
+ * @retval 1 Failure.
+ */
+int __task_runner_run_followable(task_runner_execution_t *execution,
+                                 output_store_writer_t   *writer) {
+    int output_pipes[OUTPUT_STORE_STREAM_COUNT][2];
+    if (pipe(output_pipes[OUTPUT_STORE_STREAM_OUTPUT])) {
+        util_perror("__task_runner_run_followable(): pipe() failed");
+        return 1;
+    } else if (pipe(output_pipes[OUTPUT_STORE_STREAM_ERROR])) {
+        util_perror("__task_runner_run_followable(): pipe() failed");
+        (void) close(output_pipes[OUTPUT_STORE_STREAM_OUTPUT][STDIN_FILENO]);
+        (void) close(output_pipes[OUTPUT_STORE_STREAM_OUTPUT][STDOUT_FILENO]);
+        return 1;
+    }
+
+    /* Only the runner keeps these. Spawned programs get their own copies of the write ends */
+    for (output_store_stream_t i = 0; i < OUTPUT_STORE_STREAM_COUNT; ++i) {
+        (void) fcntl(output_pipes[i][STDIN_FILENO], F_SETFD, FD_CLOEXEC);
+        (void) fcntl(output_pipes[i][STDOUT_FILENO], F_SETFD, FD_CLOEXEC);
+        execution->pipes[i] = output_pipes[i][STDIN_FILENO];
+    }
+    execution->out = output_pipes[OUTPUT_STORE_STREAM_OUTPUT][STDOUT_FILENO];
+    execution->err = output_pipes[OUTPUT_STORE_STREAM_ERROR][STDOUT_FILENO];
+
+    /* Clients following a tee() into a closed pipe mustn't kill the runner */
+    (void) signal(SIGPIPE, SIG_IGN);
+    return __task_runner_run_programs(execution, writer);
+}
+
+int task_runner_main(tagged_task_t *task, size_t slot, const output_store_t *store) {
+    uint32_t                task_id = tagged_task_get_id(task);
+    size_t                  nprograms;
+    const program_t *const *programs = task_get_programs(tagged_task_get_task(task), &nprograms);
+    if (!programs) {
+        task_procedure_t procedure;
+        void            *state;
+        task_get_procedure(tagged_task_get_task(task), &procedure, &state);
+        return procedure(state, slot);
     }
 
-    __task_runner_spawn(programs[nprograms - 1], in, out, err, -1);
+    if (!nprograms)
+        return 1;
+
+    trace_set_task(task_id);
+    trace_event(TRACE_EVENT_FORK, task_id, slot);
+
+    tagged_task_stage_t     stages[TAGGED_TASK_MAXIMUM_STAGES] = {0};
+    task_runner_execution_t execution                          = {
+                                 .task   = task,
+                                 .out    = STDOUT_FILENO,
+                                 .err    = STDERR_FILENO,
+                                 .pipes  = {-1, -1},
+                                 .slot   = slot,
+                                 .stages = stages,
+                                 .pids   = malloc(nprograms * sizeof(pid_t)),
+    };
+    if (!execution.pids) {
+        util_perror("task_runner_main(): malloc() failed");
+        return __task_runner_warn_parent(slot, 1, NULL, 0);
+    }
 
-    __task_runner_wait_all_children(); /* May block forever */
+    output_store_writer_t *writer = output_store_begin_task(store, task_id);
+    int                    error  = 0;
+    if (writer) {
+        error = __task_runner_run_followable(&execution, writer);
+        if (output_store_end_task(writer))
+            util_perror("task_runner_main(): failed to store task output");
+    } else {
+        util_perror(
+            "task_runner_main(): failed to create output files - redirecting output to stdout");
+        error = __task_runner_run_programs(&execution, NULL);
+    }
+    free(execution.pids);
 
-    (void) close(err);
-    (void) close(out);
-    return __task_runner_warn_parent(slot, 0);
+    size_t nstages =
+        nprograms < TAGGED_TASK_MAXIMUM_STAGES ? nprograms : TAGGED_TASK_MAXIMUM_STAGES;
+    return __task_runner_warn_parent(slot, error, stages, error ? 0 : nstages);
 }
@@ -0,0 +1,361 @@
+/*
+ * Copyright 2024 Humberto Gomes, José Lopes, José Matos
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+/**
+ * @file  trace.c
+ * @brief Implementation of methods in trace.h
+ */
+
+#include <errno.h>
+#include <fcntl.h>
+#include <inttypes.h>
+#include <signal.h>
+#include <stdlib.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <time.h>
+#include <unistd.h>
+
+#include "trace.h"
+
+/** @brief Ring mapped by ::trace_init, inherited by all children of the server. */
+static trace_region_t *__trace_region = NULL;
+
+/** @brief Task attributed to events in this process by ::trace_set_task. */
+static uint32_t __trace_task_id = TRACE_NO_TASK;
+
+/** @brief Names of each ::trace_event_type_t, in exported traces. */
+static const char *const __trace_event_names[TRACE_EVENT_TYPE_COUNT] =
+    {"frame read", "message", "enqueue", "dispatch", "fork", "exec", "done sent", "done",
+     "log write"};
+
+/** @brief Categories of each ::trace_event_type_t, in exported traces. */
+static const char *const __trace_event_categories[TRACE_EVENT_TYPE_COUNT] =
+    {"ipc", "ipc", "scheduler", "scheduler", "runner", "runner", "runner", "server", "server"};
+
+/** @brief Names of trace_event_t::arg for each ::trace_event_type_t (`NULL` when unused). */
+static const char *const __trace_event_arg_names[TRACE_EVENT_TYPE_COUNT] =
+    {"frames", "type", NULL, "slot", "slot", NULL, NULL, NULL, NULL};
+
+int trace_init(pid_t server_pid) {
+    if (__trace_region) {
+        errno = EEXIST;
+        return 1;
+    }
+
+    /* Server can read and write, everyone else can read. Always create a new file. */
+    (void) unlink(TRACE_PATH);
+    int fd = open(TRACE_PATH, O_RDWR | O_CREAT | O_EXCL | O_NOFOLLOW, 0644);
+    if (fd < 0)
+        return 1;
+
+    if (ftruncate(fd, sizeof(trace_region_t))) {
+        int errno2 = errno;
+        (void) close(fd);
+        (void) unlink(TRACE_PATH);
+        errno = errno2;
+        return 1;
+    }
+
+    void *map = mmap(NULL, sizeof(trace_region_t), PROT_READ | PROT_WRITE, MAP_SHARED, fd, 0);
+    (void) close(fd); /* The mapping keeps the file open */
+    if (map == MAP_FAILED) {
+        int errno2 = errno;
+        (void) unlink(TRACE_PATH);
+        errno = errno2;
+        return 1;
+    }
+
+    /* The file starts zeroed: disabled and with no events */
+    __trace_region             = map;
+    __trace_region->version    = TRACE_VERSION;
+    __trace_region->server_pid = server_pid;
+    return 0;
+}
+
+void trace_free(void) {
+    if (!__trace_region)
+        return; /* Don't set errno, as that's not typical free behavior. */
+
+    (void) munmap(__trace_region, sizeof(trace_region_t));
+    (void) unlink(TRACE_PATH);
+    __trace_region = NULL;
+}
+
+void trace_set_task(uint32_t task_id) {
+    __trace_task_id = task_id;
+}
+
+/**
+ * @brief  Gets the current time, as stored in events.
+ * @return The value of `CLOCK_MONOTONIC`, in nanoseconds.
+ */
+uint64_t __trace_now(void) {
+    struct timespec now;
+    (void) clock_gettime(CLOCK_MONOTONIC, &now);
+    return (uint64_t) now.tv_sec * 1000000000 + now.tv_nsec;
+}
+
+/**
+ * @brief  Checks if events should be recorded by this process.
+ * @retval 0 No.
+ * @retval 1 Yes.
+ */
+int __trace_is_enabled(void) {
+    return __trace_region && __atomic_load_n(&__trace_region->enabled, __ATOMIC_RELAXED);
+}
+
+/**
+ * @brief   Writes an event to the ring.
+ * @details Processes reserve positions in the ring atomically, so they never write to the same
+ *          event at the same time, unless the ring wraps around during a write.
+ *
+ * @param type      Type of the event.
+ * @param task_id   Identifier of the task the event is about, or ::TRACE_NO_TASK.
+ * @param arg       Extra information about the event.
+ * @param timestamp When the event started, in nanoseconds.
+ * @param duration  Duration of the event in nanoseconds.
+ */
+void __trace_record(trace_event_type_t type,
+                    uint32_t           task_id,
+                    uint32_t           arg,
+                    uint64_t           timestamp,
+                    uint64_t           duration) {
+    uint64_t       index = __atomic_fetch_add(&__trace_region->next, 1, __ATOMIC_RELAXED);
+    trace_event_t *event = __trace_region->events + index % TRACE_CAPACITY;
+
+    /* Readers discard the event while it's being written */
+    __atomic_store_n(&event->sequence, 0, __ATOMIC_RELAXED);
+    __atomic_thread_fence(__ATOMIC_RELEASE);
+
+    event->timestamp = timestamp;
+    event->duration  = duration;
+    event->pid       = getpid();
+    event->task_id   = task_id == TRACE_NO_TASK ? __trace_task_id : task_id;
+    event->type      = type;
+    event->arg       = arg;
+    __atomic_store_n(&event->sequence, index + 1, __ATOMIC_RELEASE);
+}
+
+void trace_event(trace_event_type_t type, uint32_t task_id, uint32_t arg) {
+    if (__trace_is_enabled())
+        __trace_record(type, task_id, arg, __trace_now(), 0);
+}
+
+uint64_t trace_begin(void) {
+    return __trace_is_enabled() ? __trace_now() : 0;
+}
+
+void trace_end(trace_event_type_t type, uint32_t task_id, uint32_t arg, uint64_t start) {
+    if (start && __trace_region) {
+        uint64_t now = __trace_now();
+        __trace_record(type, task_id, arg, start, now - start);
+    }
+}
+
+/**
+ * @brief Maps the ring of a running server.
+ *
+ * @param writable Whether the mapping must be writable.
+ *
+ * @return The mapped region, or `NULL` on failure (check `errno`: `ENOENT` and `ESRCH` when there's
+ *         no server running, `EPROTO` for an unknown layout).
+ */
+trace_region_t *__trace_map(int writable) {
+    int fd = open(TRACE_PATH, writable ? O_RDWR : O_RDONLY);
+    if (fd < 0)
+        return NULL;
+
+    struct stat statbuf;
+    if (fstat(fd, &statbuf)) {
+        int errno2 = errno;
+        (void) close(fd);
+        errno = errno2;
+        return NULL;
+    }
+    if (statbuf.st_size != sizeof(trace_region_t)) {
+        (void) close(fd);
+        errno = EPROTO;
+        return NULL;
+    }
+
+    trace_region_t *region = mmap(NULL,
+                                  sizeof(trace_region_t),
+                                  writable ? PROT_READ | PROT_WRITE : PROT_READ,
+                                  MAP_SHARED,
+                                  fd,
+                                  0);
+    (void) close(fd);
+    if (region == MAP_FAILED)
+        return NULL;
+
+    int errno2 = 0;
+    if (__atomic_load_n(&region->version, __ATOMIC_RELAXED) != TRACE_VERSION)
+        errno2 = EPROTO;
+    else if (kill(region->server_pid, 0) && errno == ESRCH)
+        errno2 = ESRCH;
+
+    if (errno2) {
+        (void) munmap(region, sizeof(trace_region_t));
+        errno = errno2;
+        return NULL;
+    }
+    return region;
+}
+
+int trace_set_enabled(int enabled) {
+    trace_region_t *region = __trace_map(1);
+    if (!region)
+        return 1;
+
+    __atomic_store_n(&region->enabled, enabled != 0, __ATOMIC_RELEASE);
+    (void) munmap(region, sizeof(trace_region_t));
+    return 0;
+}
+
+/**
+ * @brief  Copies the events of a ring that were completely written.
+ * @param  region Ring to copy events from. Mustn't be `NULL` (unchecked).
+ * @param  out    Where to copy the events to, with space for ::TRACE_CAPACITY events. Mustn't be
+ *                `NULL` (unchecked).
+ * @return The number of events copied, from the oldest to the newest.
+ */
+size_t __trace_copy_events(const trace_region_t *region, trace_event_t *out) {
+    uint64_t next  = __atomic_load_n(&region->next, __ATOMIC_ACQUIRE);
+    uint64_t first = next > TRACE_CAPACITY ? next - TRACE_CAPACITY : 0;
+
+    size_t count = 0;
+    for (uint64_t i = first; i < next; ++i) {
+        const trace_event_t *event    = region->events + i % TRACE_CAPACITY;
+        uint64_t             sequence = __atomic_load_n(&event->sequence, __ATOMIC_ACQUIRE);
+        if (sequence != i + 1)
+            continue; /* Being written, or already overwritten */
+
+        out[count] = *event;
+        __atomic_thread_fence(__ATOMIC_ACQUIRE); /* Copy done before reading the sequence again */
+        if (__atomic_load_n(&event->sequence, __ATOMIC_RELAXED) == sequence)
+            count++;
+    }
+    return count;
+}
+
+/**
+ * @brief Writes a timestamp in microseconds, as used in Chrome trace-event JSON.
+ * @param out         Where to write the timestamp to. Mustn't be `NULL` (unchecked).
+ * @param nanoseconds Timestamp in nanoseconds.
+ */
+void __trace_print_microseconds(FILE *out, uint64_t nanoseconds) {
+    fprintf(out, "%" PRIu64 ".%03" PRIu64, nanoseconds / 1000, nanoseconds % 1000);
+}
+
+/**
+ * @brief Writes an event as Chrome trace-event JSON objects.
+ *
+ * @param out        Where to write the event to. Mustn't be `NULL` (unchecked).
+ * @param event      Event to be written. Mustn't be `NULL` (unchecked).
+ * @param server_pid PID of the server, used as the PID of all events.
+ */
+void __trace_print_event(FILE *out, const trace_event_t *event, int64_t server_pid) {
+    /* Name the threads of task runners and programs after their task */
+    if (event->type == TRACE_EVENT_FORK || event->type == TRACE_EVENT_EXEC)
+        fprintf(out,
+                ",\n{\"name\": \"thread_name\", \"ph\": \"M\", \"pid\": %" PRId64
+                ", \"tid\": %" PRId32 ", \"args\": {\"name\": \"%s (task %" PRIu32 ")\"}}",
+                server_pid,
+                event->pid,
+                event->type == TRACE_EVENT_FORK ? "runner" : "program",
+                event->task_id);
+
+    fprintf(out,
+            ",\n{\"name\": \"%s\", \"cat\": \"%s\", \"ph\": \"%s\", \"ts\": ",
+            __trace_event_names[event->type],
+            __trace_event_categories[event->type],
+            event->duration ? "X" : "i");
+    __trace_print_microseconds(out, event->timestamp);
+    if (event->duration) {
+        fprintf(out, ", \"dur\": ");
+        __trace_print_microseconds(out, event->duration);
+    } else {
+        fprintf(out, ", \"s\": \"t\"");
+    }
+    fprintf(out,
+            ", \"pid\": %" PRId64 ", \"tid\": %" PRId32 ", \"args\": {",
+            server_pid,
+            event->pid);
+
+    const char *arg_name = __trace_event_arg_names[event->type];
+    if (event->task_id != TRACE_NO_TASK)
+        fprintf(out, "\"task\": %" PRIu32 "%s", event->task_id, arg_name ? ", " : "");
+    if (arg_name)
+        fprintf(out, "\"%s\": %" PRIu32, arg_name, event->arg);
+    fprintf(out, "}}");
+
+    /* A slice of a task's own track, from when it's queued until the server sees it's done */
+    if (event->task_id != TRACE_NO_TASK &&
+        (event->type == TRACE_EVENT_ENQUEUE || event->type == TRACE_EVENT_DONE)) {
+        fprintf(out,
+                ",\n{\"name\": \"task %" PRIu32 "\", \"cat\": \"task\", \"ph\": \"%s\", \"id\": "
+                "%" PRIu32 ", \"ts\": ",
+                event->task_id,
+                event->type == TRACE_EVENT_ENQUEUE ? "b" : "e",
+                event->task_id);
+        __trace_print_microseconds(out, event->timestamp);
+        fprintf(out, ", \"pid\": %" PRId64 ", \"tid\": %" PRId64 "}", server_pid, server_pid);
+    }
+}
+
+int trace_dump(FILE *out, size_t *event_count) {
+    if (!out) {
+        errno = EINVAL;
+        return 1;
+    }
+
+    trace_event_t *events = malloc(TRACE_CAPACITY * sizeof(trace_event_t));
+    if (!events)
+        return 1; /* errno = ENOMEM guaranteed */
+
+    trace_region_t *region = __trace_map(0);
+    if (!region) {
+        int errno2 = errno;
+        free(events);
+        errno = errno2;
+        return 1;
+    }
+
+    int64_t server_pid = region->server_pid;
+    size_t  count      = __trace_copy_events(region, events);
+    (void) munmap(region, sizeof(trace_region_t));
+
+    fprintf(out,
+            "{\"displayTimeUnit\": \"ns\", \"traceEvents\": [\n"
+            "{\"name\": \"process_name\", \"ph\": \"M\", \"pid\": %" PRId64 ", \"tid\": %" PRId64
+            ", \"args\": {\"name\": \"orchestrator\"}},\n"
+            "{\"name\": \"thread_name\", \"ph\": \"M\", \"pid\": %" PRId64 ", \"tid\": %" PRId64
+            ", \"args\": {\"name\": \"server\"}}",
+            server_pid,
+            server_pid,
+            server_pid,
+            server_pid);
+    for (size_t i = 0; i < count; ++i)
+        if (events[i].type < TRACE_EVENT_TYPE_COUNT)
+            __trace_print_event(out, events + i, server_pid);
+    fprintf(out, "\n]}\n");
+    free(events);
+
+    if (event_count)
+        *event_count = count;
+    return ferror(out) ? 1 : 0;
+}
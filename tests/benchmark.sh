@@ -16,7 +16,8 @@
 # See the License for the specific language governing permissions and
 # limitations under the License.
 
-# This test benchmarks different scheduling policies.
+# This test benchmarks different scheduling policies. For a faster comparison on larger workloads,
+# without running any tasks, see `orchestrator simulate`.
 
 . "$(dirname "$0")/utils.sh" || exit 1
 
@@ -52,6 +53,7 @@ for sched in "sjf" "fcfs"; do
 		while read -r line; do remove_units "$line"; done | \
 		xargs -n 5 | \
 		tr ' ' ','
+	./bin/client stats | grep '^(\(SERVER\|TASKS\|TIME\)) [^A-Z]'
 
 	stop_orchestrator true "$orchestrator_pid"
 done
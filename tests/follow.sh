@@ -0,0 +1,50 @@
+#!/bin/bash
+# |
+# \_ bash is used so that the server can be spawned as a daemon.
+
+# Copyright 2024 Humberto Gomes, José Lopes, José Matos
+#
+# Licensed under the Apache License, Version 2.0 (the "License");
+# you may not use this file except in compliance with the License.
+# You may obtain a copy of the License at
+#
+#     http://www.apache.org/licenses/LICENSE-2.0
+#
+# Unless required by applicable law or agreed to in writing, software
+# distributed under the License is distributed on an "AS IS" BASIS,
+# WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+# See the License for the specific language governing permissions and
+# limitations under the License.
+
+# Test for client follow. Follows a task that writes to stdout and stderr over a few seconds, and
+# checks that what was streamed matches the end of the task's stored output.
+
+. "$(dirname "$0")/utils.sh" || exit 1
+
+orchestrator_pid=$(start_orchestrator 1 fcfs "/dev/null") || exit 1
+
+./bin/client execute 100 -p \
+	"sh -c 'for i in \$(seq 10); do echo out\$i; echo err\$i >&2; sleep 0.3; done'" > /dev/null
+sleep 0.5
+./bin/client follow 1 > /tmp/follow.out 2> /tmp/follow.err
+follow_status=$?
+./bin/client follow 1 > /dev/null 2>&1 && follow_done_status=0 || follow_done_status=1
+stop_orchestrator true "$orchestrator_pid"
+
+found_error=false
+if [ "$follow_status" -ne 0 ] || [ "$follow_done_status" -eq 0 ]; then
+	echo "Test failure: wrong exit status" 1>&2
+	found_error=true
+fi
+
+for stream in out err; do
+	streamed="$(cat "/tmp/follow.$stream")"
+	stored="$(tail -n "$(wc -l < "/tmp/follow.$stream")" "/tmp/orchestrator/1.$stream")"
+	if [ -z "$streamed" ] || [ "$streamed" != "$stored" ]; then
+		echo "Test failure: streamed $stream differs from stored $stream" 1>&2
+		found_error=true
+	fi
+done
+rm -f /tmp/follow.out /tmp/follow.err
+
+$found_error || echo "All follow tests passed!"
@@ -24,7 +24,8 @@ MAX_LENGTH=4067 # To know this value, run ./bin/client execute 100 -u ""
 
 orchestrator_pid=$(start_orchestrator 1 fcfs "/dev/null") || exit 1
 
-message="$(yes | tr -d '\n' | head -c"$MAX_LENGTH")"
+# Starts with a program that exists, as tasks with unknown programs are rejected
+message="echo $(yes | tr -d '\n' | head -c"$((MAX_LENGTH - 5))")"
 ./bin/client execute 100 -u "$(echo "$message" | head -c$((MAX_LENGTH - 20)))" > /dev/null 2>&1 || \
 	echo "MAX_LENGTH too long" 1>&2
 ./bin/client execute 100 -u "$message" > /dev/null 2>&1 || \
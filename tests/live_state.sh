@@ -0,0 +1,52 @@
+#!/bin/bash
+# |
+# \_ bash is used so that the server can be spawned as a daemon.
+
+# Copyright 2024 Humberto Gomes, José Lopes, José Matos
+#
+# Licensed under the Apache License, Version 2.0 (the "License");
+# you may not use this file except in compliance with the License.
+# You may obtain a copy of the License at
+#
+#     http://www.apache.org/licenses/LICENSE-2.0
+#
+# Unless required by applicable law or agreed to in writing, software
+# distributed under the License is distributed on an "AS IS" BASIS,
+# WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+# See the License for the specific language governing permissions and
+# limitations under the License.
+
+# Test for the state the server publishes in shared memory (client status --local). Checks running,
+# queued and completed tasks are reported without contacting the server.
+
+. "$(dirname "$0")/utils.sh" || exit 1
+
+orchestrator_pid=$(start_orchestrator 1 fcfs "/dev/null") || exit 1
+for i in $(seq 1 100); do
+	./bin/client execute 5 -u "echo $i" > /dev/null || exit 1
+done
+while pgrep -P "$orchestrator_pid" > /dev/null; do sleep 0.5; done
+./bin/client execute 5 -u "sleep 2" > /dev/null || exit 1
+./bin/client execute 5 -u "echo queued" > /dev/null || exit 1
+sleep 0.5
+busy_status="$(./bin/client status --local)"
+range_status="$(./bin/client status --local 90-95 | tail -n +4 | cut -d' ' -f2 | tr -d '\n')"
+stop_orchestrator true "$orchestrator_pid"
+
+found_error=false
+if ! echo "$busy_status" | grep -q '^(SERVER) fcfs 1 1 1 100 0$' ||
+	! echo "$busy_status" | grep -q '^(EXECUTING) 101: "sleep 2"' ||
+	[ "$(echo "$busy_status" | grep -c '^(DONE) ')" -ne 64 ] ||
+	! echo "$busy_status" | grep -q '^(DONE) 100: "echo 100"'; then
+
+	echo "Test failure: wrong live state" 1>&2
+	echo "$busy_status" 1>&2
+	found_error=true
+fi
+
+if [ "$range_status" != "90:91:92:93:94:95:" ]; then
+	echo "Test failure: wrong tasks in ranged live state ($range_status)" 1>&2
+	found_error=true
+fi
+
+$found_error || echo "All live state tests passed!"
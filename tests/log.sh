@@ -0,0 +1,70 @@
+#!/bin/bash
+# |
+# \_ bash is used so that the server can be spawned as a daemon.
+
+# Copyright 2024 Humberto Gomes, José Lopes, José Matos
+#
+# Licensed under the Apache License, Version 2.0 (the "License");
+# you may not use this file except in compliance with the License.
+# You may obtain a copy of the License at
+#
+#     http://www.apache.org/licenses/LICENSE-2.0
+#
+# Unless required by applicable law or agreed to in writing, software
+# distributed under the License is distributed on an "AS IS" BASIS,
+# WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+# See the License for the specific language governing permissions and
+# limitations under the License.
+
+# Test for the segmented log (log_store.c). Runs tasks with very small log segments, restarts the
+# server, and checks that identifiers keep growing, that old tasks are still reported, and that the
+# oldest segments were compacted. Ranges of tasks are also queried through the task index.
+
+. "$(dirname "$0")/utils.sh" || exit 1
+
+LOG_OPTIONS="files --log-segment-size 512 --log-max-size 2048"
+
+orchestrator_pid=$(start_orchestrator 1 fcfs "/dev/null" "$LOG_OPTIONS") || exit 1
+for i in $(seq 1 50); do
+	./bin/client execute 100 -u "echo $i" > /dev/null || exit 1
+done
+# With a single slot, the server may have no children between two tasks
+until ./bin/client status 50 | grep -q '^(DONE) 50:'; do sleep 0.2; done
+stop_orchestrator true "$orchestrator_pid"
+
+# Restart without start_orchestrator, that would delete the server's directory
+nohup "./bin/orchestrator" "/tmp/orchestrator" 1 fcfs $LOG_OPTIONS 0<&- &> "/dev/null" &
+orchestrator_pid=$!
+sleep 0.5
+new_task="$(./bin/client execute 100 -u "echo restarted")"
+until ./bin/client status 51 | grep -q '^(DONE) 51:'; do sleep 0.2; done
+status="$(./bin/client status)"
+range_status="$(./bin/client status 49-51 | tail -n +2 | cut -d' ' -f2 | tr -d '\n')"
+compacted_status="$(./bin/client status 1 | tail -n +2)"
+stop_orchestrator true "$orchestrator_pid"
+wait "$orchestrator_pid" # Child of this script, unlike servers from start_orchestrator
+
+found_error=false
+if [ "$new_task" != "Task 51 scheduled" ]; then
+	echo "Test failure: identifiers restarted ($new_task)" 1>&2
+	found_error=true
+fi
+
+if ! echo "$status" | grep -q '^(DONE) 50: "echo 50"' ||
+	! echo "$status" | grep -q '^(DONE) 51: "echo restarted"'; then
+
+	echo "Test failure: tasks missing from status" 1>&2
+	found_error=true
+fi
+
+if ! [ -s /tmp/orchestrator/log/summaries.bin ] || echo "$status" | grep -q '^(DONE) 1: '; then
+	echo "Test failure: old segments weren't compacted" 1>&2
+	found_error=true
+fi
+
+if [ "$range_status" != "49:50:51:" ] || [ -n "$compacted_status" ]; then
+	echo "Test failure: wrong tasks in ranged status ($range_status)" 1>&2
+	found_error=true
+fi
+
+$found_error || echo "All log tests passed!"
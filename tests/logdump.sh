@@ -0,0 +1,74 @@
+#!/bin/bash
+# |
+# \_ bash is used so that the server can be spawned as a daemon.
+
+# Copyright 2024 Humberto Gomes, José Lopes, José Matos
+#
+# Licensed under the Apache License, Version 2.0 (the "License");
+# you may not use this file except in compliance with the License.
+# You may obtain a copy of the License at
+#
+#     http://www.apache.org/licenses/LICENSE-2.0
+#
+# Unless required by applicable law or agreed to in writing, software
+# distributed under the License is distributed on an "AS IS" BASIS,
+# WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+# See the License for the specific language governing permissions and
+# limitations under the License.
+
+# Test for the log exporter (bin/logdump). Runs some tasks, and checks that the exported CSV and
+# JSON Lines contain the right tasks, also when filtering by completion time. Exports written by the
+# server (client status --export) must match what bin/logdump outputs.
+
+. "$(dirname "$0")/utils.sh" || exit 1
+
+orchestrator_pid=$(start_orchestrator 1 fcfs "/dev/null") || exit 1
+start_ns="$(date +%s%N)"
+for i in $(seq 1 10); do
+	./bin/client execute 100 -u "echo \"$i\"" > /dev/null || exit 1
+done
+while pgrep -P "$orchestrator_pid" > /dev/null; do sleep 0.5; done
+export_dir="$(mktemp -d)"
+log_export="$(./bin/client status --export "$export_dir/tasks.log" 2-9)"
+csv_export="$(./bin/client status --export "$export_dir/tasks.csv" --csv)"
+stop_orchestrator true "$orchestrator_pid"
+
+csv="$(./bin/logdump /tmp/orchestrator/log/*.log)"
+jsonl="$(./bin/logdump --jsonl --ids 3-5 /tmp/orchestrator/log/*.log)"
+since_csv="$(./bin/logdump --since "$start_ns" /tmp/orchestrator/log/*.log)"
+until_csv="$(./bin/logdump --until "$start_ns" /tmp/orchestrator/log/*.log)"
+exported_csv="$(cat "$export_dir/tasks.csv")"
+exported_log_csv="$(./bin/logdump "$export_dir/tasks.log")"
+rm -r "$export_dir"
+
+found_error=false
+if [ "$(echo "$csv" | wc -l)" -ne 11 ] ||
+	! echo "$csv" | head -n 1 | grep -q '^id,expected_time_ms,' ||
+	! echo "$csv" | grep -q '^10,100,0,.*,1,"echo ""10"""$'; then
+
+	echo "Test failure: wrong CSV output" 1>&2
+	found_error=true
+fi
+
+if [ "$(echo "$jsonl" | grep -o '^{"id": [0-9]*' | cut -d' ' -f2 | tr '\n' ' ')" != "3 4 5 " ] ||
+	! echo "$jsonl" | grep -q '"command_line": "echo \\"4\\""}$'; then
+
+	echo "Test failure: wrong JSON Lines output" 1>&2
+	found_error=true
+fi
+
+if [ "$csv_export" != "Exported 10 tasks ($(echo "$exported_csv" | wc -c) bytes)" ] ||
+	[ "$exported_csv" != "$csv" ] ||
+	[ "$(echo "$log_export" | cut -d' ' -f2)" != "8" ] ||
+	[ "$exported_log_csv" != "$(./bin/logdump --ids 2-9 /tmp/orchestrator/log/*.log)" ]; then
+
+	echo "Test failure: wrong server-side exports ($log_export, $csv_export)" 1>&2
+	found_error=true
+fi
+
+if [ "$since_csv" != "$csv" ] || [ "$(echo "$until_csv" | wc -l)" -ne 1 ]; then
+	echo "Test failure: wrong completion time window" 1>&2
+	found_error=true
+fi
+
+$found_error || echo "All logdump tests passed!"
@@ -0,0 +1,72 @@
+#!/bin/bash
+# |
+# \_ bash is used so that the server can be spawned as a daemon.
+
+# Copyright 2024 Humberto Gomes, José Lopes, José Matos
+#
+# Licensed under the Apache License, Version 2.0 (the "License");
+# you may not use this file except in compliance with the License.
+# You may obtain a copy of the License at
+#
+#     http://www.apache.org/licenses/LICENSE-2.0
+#
+# Unless required by applicable law or agreed to in writing, software
+# distributed under the License is distributed on an "AS IS" BASIS,
+# WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+# See the License for the specific language governing permissions and
+# limitations under the License.
+
+# Test for the export of metrics. Runs a few tasks (one of which fails) on a server writing metrics
+# to a file, and checks the counters, gauges and histograms in the file.
+
+. "$(dirname "$0")/utils.sh" || exit 1
+
+metrics_file="/tmp/orchestrator_metrics.prom"
+rm -f "$metrics_file"
+orchestrator_pid=$(start_orchestrator 2 fcfs "/dev/null" "--metrics-file $metrics_file") || exit 1
+
+for i in $(seq 1 4); do
+	./bin/client execute 100 -u "echo $i" > /dev/null || exit 1
+done
+./bin/client execute 100 -p "cat /nonexistent | cat" > /dev/null || exit 1
+until ./bin/client status 5 | grep -q -e DONE -e FAILED; do sleep 0.5; done
+
+./bin/client execute 100 -u "sleep 0.5" > /dev/null || exit 1
+until ./bin/client status 6 | grep -q DONE; do sleep 0.5; done
+
+# The file is written at most every 5 seconds, when a task completes or before the server blocks
+sleep 6
+./bin/client status 1 > /dev/null
+sleep 0.5
+metrics="$(cat "$metrics_file" 2> /dev/null)"
+stop_orchestrator true "$orchestrator_pid"
+
+found_error=false
+check_metric() {
+	if ! echo "$metrics" | grep -q "^orchestrator_$1 $2$"; then
+		echo "Test failure: wrong value of $1 (expected $2)" 1>&2
+		found_error=true
+	fi
+}
+
+check_metric tasks_submitted_total 6
+check_metric tasks_dispatched_total 6
+check_metric tasks_completed_total 6
+check_metric ipc_dropped_frames_total 0
+check_metric fork_failures_total 0
+check_metric queue_depth 0
+check_metric busy_slots 0
+check_metric slots 2
+check_metric 'task_latency_seconds_count{phase="execute"}' 6
+check_metric 'task_latency_seconds_bucket{phase="execute",le="+Inf"}' 6
+check_metric 'task_latency_seconds_bucket{phase="execute",le="0.000100000"}' 0
+
+if ! echo "$metrics" | grep -q '^# TYPE orchestrator_task_latency_seconds histogram$' ||
+	[ -f "$metrics_file.tmp" ]; then
+
+	echo "Test failure: invalid metrics file" 1>&2
+	found_error=true
+fi
+
+rm -f "$metrics_file"
+$found_error || echo "All metrics tests passed!"
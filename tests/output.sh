@@ -0,0 +1,67 @@
+#!/bin/bash
+# |
+# \_ bash is used so that the server can be spawned as a daemon.
+
+# Copyright 2024 Humberto Gomes, José Lopes, José Matos
+#
+# Licensed under the Apache License, Version 2.0 (the "License");
+# you may not use this file except in compliance with the License.
+# You may obtain a copy of the License at
+#
+#     http://www.apache.org/licenses/LICENSE-2.0
+#
+# Unless required by applicable law or agreed to in writing, software
+# distributed under the License is distributed on an "AS IS" BASIS,
+# WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+# See the License for the specific language governing permissions and
+# limitations under the License.
+
+# Test for the packed output store (output_store.c). Launches the server with the packed backend,
+# runs many concurrent tasks, and checks that the output of each one can be read back intact, both
+# locally and by clients (client output).
+
+. "$(dirname "$0")/utils.sh" || exit 1
+
+TASK_COUNT=200
+
+orchestrator_pid=$(start_orchestrator 8 fcfs "/dev/null" packed) || exit 1
+
+for i in $(seq 1 "$TASK_COUNT"); do
+	./bin/client execute 100 -p "seq $i ; ls /nonexistent/$i" > /dev/null || exit 1
+done
+./bin/client execute 100 -u "seq 1000000" > /dev/null || exit 1
+until ./bin/client status "$((TASK_COUNT + 1))" | grep -q DONE; do sleep 0.5; done
+
+client_out="$(./bin/client output 150)"
+client_err="$(./bin/client output 150 --stderr)"
+client_range="$(./bin/client output 150 10-19)"
+client_tail="$(./bin/client output 150 500)"
+client_large="$(./bin/client output "$((TASK_COUNT + 1))" | md5sum)"
+./bin/client output "$((TASK_COUNT + 2))" > /dev/null 2>&1 && missing_status=0 || missing_status=1
+stop_orchestrator true "$orchestrator_pid"
+
+found_error=false
+if [ "$client_out" != "$(seq 150)" ] || ! echo "$client_err" | grep -q "/150'" ||
+	[ "$client_range" != "$(seq 150 | head -c 20 | tail -c 10)" ] ||
+	[ "$client_tail" != "$(seq 150 | tail -c +501)" ] ||
+	[ "$client_large" != "$(seq 1000000 | md5sum)" ] || [ "$missing_status" -eq 0 ]; then
+
+	echo "Test failure: wrong output sent to client" 1>&2
+	found_error=true
+fi
+
+for i in $(seq 1 "$TASK_COUNT"); do
+	if [ "$(./bin/orchestrator read-output /tmp/orchestrator "$i" out packed)" != "$(seq "$i")" ] ||
+		! ./bin/orchestrator read-output /tmp/orchestrator "$i" err packed | grep -q "/$i'"; then
+
+		echo "Test failure: task $i" 1>&2
+		found_error=true
+	fi
+done
+
+if [ "$(find /tmp/orchestrator -name '*.out' -o -name '*.err' | wc -l)" -ne 0 ]; then
+	echo "Test failure: per-task files were created" 1>&2
+	found_error=true
+fi
+
+$found_error || echo "All output store tests passed!"
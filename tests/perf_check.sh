@@ -0,0 +1,208 @@
+#!/bin/bash
+# |
+# \_ bash is used so that the server can be spawned as a daemon.
+
+# Copyright 2024 Humberto Gomes, José Lopes, José Matos
+#
+# Licensed under the Apache License, Version 2.0 (the "License");
+# you may not use this file except in compliance with the License.
+# You may obtain a copy of the License at
+#
+#     http://www.apache.org/licenses/LICENSE-2.0
+#
+# Unless required by applicable law or agreed to in writing, software
+# distributed under the License is distributed on an "AS IS" BASIS,
+# WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+# See the License for the specific language governing permissions and
+# limitations under the License.
+
+# End-to-end latency regression checks. Runs a fixed set of workloads, each on a new server with
+# its output in a temporary directory, and collects per-phase latencies from `client stats --json`
+# and the client's side. Results are compared against the baseline in tests/perf_baseline.json,
+# where every metric has its own tolerance: a regression is a latency over `ratio` times its
+# `baseline` plus `slack_ns`. Run with PERF_UPDATE=1 to replace the baselines with the results,
+# keeping the tolerances already in the file (new metrics get `perf_default_tolerance`).
+#
+# The baseline file must keep one metric per line, as it's parsed with awk.
+
+. "$(dirname "$0")/utils.sh" || exit 1
+
+baseline="tests/perf_baseline.json"
+perf_default_tolerance='"ratio": 1.5, "slack_ns": 1000000'
+output_dir="$(mktemp -d)" || exit 1
+results="$output_dir/results"
+orchestrator_pid=""
+
+# Stops any server left running by a failed step and deletes the temporary directory.
+perf_cleanup() {
+	if [ -n "$orchestrator_pid" ] && kill -0 "$orchestrator_pid" 2> /dev/null; then
+		stop_orchestrator false "$orchestrator_pid"
+		wait "$orchestrator_pid" 2> /dev/null
+	fi
+	rm -rf "$output_dir"
+}
+trap perf_cleanup EXIT
+
+# Starts a server in the temporary directory, and waits for it to accept connections.
+#
+# $1 - Number of tasks run concurrently.
+# $2 - Scheduling policy (fcfs / sjf).
+perf_start() {
+	if pgrep "orchestrator" > /dev/null; then
+		echo "Orchestrator already running!" 1>&2
+		exit 1
+	fi
+
+	rm -rf "$output_dir/server" "/tmp/orchestrator.fifo"
+	nohup "./bin/orchestrator" "$output_dir/server" "$1" "$2" 0<&- &> "/dev/null" &
+	orchestrator_pid=$!
+	until [ -p "/tmp/orchestrator.fifo" ]; do sleep 0.1; done
+}
+
+# Waits for a task to complete, and stops the server after recording its latencies.
+#
+# $1   - Name of the workload.
+# $2   - Identifier of the last task in the workload.
+# $3.. - Phases to record (C2S / WAIT / EXECUTE / S2S).
+perf_finish() {
+	until ./bin/client status "$2" | grep -q -e DONE -e FAILED; do sleep 0.2; done
+
+	# Only the aggregate of all tasks, the first one
+	stats="$(./bin/client stats --json | sed 's/, {"expected_time".*//')"
+	workload="$1"
+	shift 2
+	for phase in "$@"; do
+		times="$(echo "$stats" | grep -o "\"$phase\": {[^}]*}")"
+		for percentile in p50 p90; do
+			value="$(echo "$times" | grep -o "\"${percentile}_ns\": [0-9]*" | grep -o '[0-9]*$')"
+			echo "$workload.$(echo "$phase" | tr '[:upper:]' '[:lower:]')_${percentile}_ns $value" \
+				>> "$results"
+		done
+	done
+
+	stop_orchestrator true "$orchestrator_pid"
+	wait "$orchestrator_pid" 2> /dev/null
+	orchestrator_pid=""
+	while pgrep "orchestrator" > /dev/null; do sleep 0.1; done # Runners still exiting
+}
+
+# Prints the current time in nanoseconds.
+perf_now() {
+	date +%s%N
+}
+
+echo "Running tiny-task flood ..."
+perf_start 8 fcfs
+start="$(perf_now)"
+for _ in $(seq 1 500); do
+	./bin/client execute 1 -u "true" > /dev/null || exit 1
+done
+echo "flood.submit_ns $((($(perf_now) - start) / 500))" >> "$results"
+perf_finish flood 500 C2S WAIT S2S
+
+echo "Running mixed SJF load ..."
+perf_start 4 sjf
+# Waiting times are dominated by the sleeps of other tasks, so only IPC latencies are checked
+for _ in $(seq 1 4); do # Occupy all slots, so that all other tasks are queued
+	./bin/client execute 1000 -u "sleep 1" > /dev/null || exit 1
+done
+for i in $(seq 1 200); do
+	time_ms=$((i * 37 % 20 + 1))
+	./bin/client execute "$time_ms" -u "sleep 0.$(printf "%03d" "$time_ms")" > /dev/null || exit 1
+done
+perf_finish sjf 204 C2S S2S
+
+echo "Running status requests under load ..."
+perf_start 4 fcfs
+for _ in $(seq 1 300); do
+	./bin/client execute 10 -u "sleep 0.01" > /dev/null || exit 1
+done &
+submitter_pid=$!
+for _ in $(seq 1 30); do
+	start="$(perf_now)"
+	./bin/client status > /dev/null
+	echo "$(($(perf_now) - start))"
+done | sort -n > "$output_dir/status"
+wait "$submitter_pid"
+echo "status.request_p50_ns $(sed -n 15p "$output_dir/status")" >> "$results"
+echo "status.request_p90_ns $(sed -n 27p "$output_dir/status")" >> "$results"
+perf_finish status 300 C2S S2S
+
+echo "Running long pipelines ..."
+perf_start 4 fcfs
+for _ in $(seq 1 100); do
+	./bin/client execute 10 -p "echo x$(printf ' | cat%.0s' $(seq 1 15))" > /dev/null || exit 1
+done
+perf_finish pipelines 100 C2S EXECUTE S2S
+
+if [ "$PERF_UPDATE" = 1 ]; then
+	awk -v default_tolerance="$perf_default_tolerance" '
+		FNR == NR {
+			if (match($0, /"ratio": [0-9.]+, "slack_ns": [0-9]+/)) {
+				split($0, field, "\"")
+				tolerances[field[2]] = substr($0, RSTART, RLENGTH)
+			}
+			next
+		}
+
+		{
+			tolerance = ($1 in tolerances) ? tolerances[$1] : default_tolerance
+			printf "%s        \"%s\": {\"baseline\": %s, %s}", (FNR > 1 ? ",\n" : ""), $1, $2,
+				tolerance
+		}
+
+		BEGIN { print "{\n    \"metrics\": {" }
+		END   { print "\n    }\n}" }
+	' "$baseline" "$results" > "$output_dir/baseline" || exit 1
+	mv "$output_dir/baseline" "$baseline" || exit 1
+	echo "Baseline updated in $baseline"
+	exit 0
+fi
+
+# Compare every value in the baseline with the results
+awk '
+	FNR == NR {
+		results[$1] = $2
+		next
+	}
+
+	match($0, /"[a-z0-9_.]+": {"baseline": [0-9]+, "ratio": [0-9.]+, "slack_ns": [0-9]+}/) {
+		split(substr($0, RSTART, RLENGTH), field, /[":,{} ]+/)
+		name           = field[2]
+		names[++count] = name
+		baseline[name] = field[4]
+		ratio[name]    = field[6]
+		slack[name]    = field[8]
+	}
+
+	END {
+		failed = 0
+		printf "%-28s %12s %12s %7s %7s\n", "METRIC", "BASELINE", "RESULT", "RATIO", "LIMIT"
+		for (i = 1; i <= count; ++i) {
+			name = names[i]
+			if (!(name in results) || results[name] == "") {
+				printf "%-28s %12d %12s %7s %7s  MISSING\n", name, baseline[name], "-", "-", "-"
+				failed = 1
+				continue
+			}
+
+			status = ""
+			limit  = baseline[name] * ratio[name] + slack[name]
+			if (results[name] > limit) {
+				status = "  REGRESSION"
+				failed = 1
+			}
+			printf "%-28s %12d %12d %6.2fx %6.2fx%s\n", name, baseline[name], results[name],
+				baseline[name] ? results[name] / baseline[name] : 0,
+				baseline[name] ? limit / baseline[name] : 0, status
+		}
+		exit failed
+	}
+' "$results" "$baseline"
+comparison_status=$?
+
+if [ "$comparison_status" -ne 0 ]; then
+	echo "Performance regressions found (limit: ratio * baseline + slack_ns)!" 1>&2
+	exit 1
+fi
+echo "No performance regressions found!"
@@ -0,0 +1,57 @@
+#!/bin/bash
+# |
+# \_ bash is used so that the server can be spawned as a daemon.
+
+# Copyright 2024 Humberto Gomes, José Lopes, José Matos
+#
+# Licensed under the Apache License, Version 2.0 (the "License");
+# you may not use this file except in compliance with the License.
+# You may obtain a copy of the License at
+#
+#     http://www.apache.org/licenses/LICENSE-2.0
+#
+# Unless required by applicable law or agreed to in writing, software
+# distributed under the License is distributed on an "AS IS" BASIS,
+# WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+# See the License for the specific language governing permissions and
+# limitations under the License.
+
+# Test for the output retention policy. Runs tasks on a server that only keeps the output of the
+# last 5 tasks, and checks that the output of older tasks is deleted by the background sweeper.
+
+. "$(dirname "$0")/utils.sh" || exit 1
+
+orchestrator_pid=$(start_orchestrator 2 fcfs "/dev/null" "--output-keep-last 5") || exit 1
+
+for i in $(seq 1 20); do
+	./bin/client execute 100 -u "echo $i" > /dev/null || exit 1
+done
+until ./bin/client status 20 | grep -q DONE; do sleep 0.5; done
+
+# Sweeps are at most 10 seconds apart, and the next one is started when a task completes
+sleep 11
+./bin/client execute 100 -u "echo 21" > /dev/null || exit 1
+until [ -f /tmp/orchestrator/retention.log ] && ! [ -f /tmp/orchestrator/16.out ]; do
+	sleep 0.5
+	[ "$((tries += 1))" -gt 20 ] && break
+done
+
+kept="$(cd /tmp/orchestrator && ls -- *.out | sort -n | tr '\n' ' ')"
+./bin/client output 3 > /dev/null 2>&1 && deleted_status=0 || deleted_status=1
+kept_output="$(./bin/client output 18)"
+stop_orchestrator true "$orchestrator_pid"
+
+found_error=false
+if [ "$kept" != "17.out 18.out 19.out 20.out 21.out " ] || [ "$deleted_status" -eq 0 ] ||
+	[ "$kept_output" != "18" ]; then
+
+	echo "Test failure: wrong output kept ($kept)" 1>&2
+	found_error=true
+fi
+
+if ! grep -q " 1-16 32 files " /tmp/orchestrator/retention.log; then
+	echo "Test failure: deletions weren't recorded" 1>&2
+	found_error=true
+fi
+
+$found_error || echo "All retention tests passed!"
@@ -0,0 +1,57 @@
+#!/bin/bash
+# |
+# \_ bash is used so that the server can be spawned as a daemon.
+
+# Copyright 2024 Humberto Gomes, José Lopes, José Matos
+#
+# Licensed under the Apache License, Version 2.0 (the "License");
+# you may not use this file except in compliance with the License.
+# You may obtain a copy of the License at
+#
+#     http://www.apache.org/licenses/LICENSE-2.0
+#
+# Unless required by applicable law or agreed to in writing, software
+# distributed under the License is distributed on an "AS IS" BASIS,
+# WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+# See the License for the specific language governing permissions and
+# limitations under the License.
+
+# Test for the simulation of scheduling policies. Simulates a small workload, whose schedule is
+# known, with both policies, and checks the waiting time of every task.
+
+. "$(dirname "$0")/utils.sh" || exit 1
+
+workload="# arrival expected runtime
+0 1000 1000
+0 500 500
+
+0 100 100
+10 50 50"
+
+found_error=false
+check_waits() {
+	waits="$(echo "$workload" | ./bin/orchestrator simulate - "$1" "$2" | \
+		awk '$1 == "(TASK)" && $2 != "ID:" { printf "%s ", $6 }')"
+	if [ "$waits" != "$3" ]; then
+		echo "Test failure: wrong waits with $1 $2 slot(s) ($waits)" 1>&2
+		found_error=true
+	fi
+}
+
+check_waits 1 fcfs "0.000 1000.000 1500.000 1590.000 "
+check_waits 1 sjf "650.000 150.000 0.000 90.000 "
+check_waits 2 sjf "150.000 0.000 0.000 90.000 "
+
+if ! echo "$workload" | ./bin/orchestrator simulate - 1 sjf --summary | \
+	grep -q "^(SIMULATION) sjf 1 4 1650.000 100.0% 2.424/s$"; then
+
+	echo "Test failure: wrong aggregates" 1>&2
+	found_error=true
+fi
+
+if echo "0 10 x" | ./bin/orchestrator simulate - 1 sjf > /dev/null 2>&1; then
+	echo "Test failure: invalid workload accepted" 1>&2
+	found_error=true
+fi
+
+$found_error || echo "All simulation tests passed!"
@@ -0,0 +1,53 @@
+#!/bin/bash
+# |
+# \_ bash is used so that the server can be spawned as a daemon.
+
+# Copyright 2024 Humberto Gomes, José Lopes, José Matos
+#
+# Licensed under the Apache License, Version 2.0 (the "License");
+# you may not use this file except in compliance with the License.
+# You may obtain a copy of the License at
+#
+#     http://www.apache.org/licenses/LICENSE-2.0
+#
+# Unless required by applicable law or agreed to in writing, software
+# distributed under the License is distributed on an "AS IS" BASIS,
+# WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+# See the License for the specific language governing permissions and
+# limitations under the License.
+
+# Test for the running aggregates of completed tasks (client stats). Runs tasks with different
+# expected times and checks the task counts of each aggregate.
+
+. "$(dirname "$0")/utils.sh" || exit 1
+
+orchestrator_pid=$(start_orchestrator 2 fcfs "/dev/null") || exit 1
+for i in $(seq 1 10); do
+	./bin/client execute 5 -u "echo $i" > /dev/null || exit 1
+done
+for i in $(seq 1 5); do
+	./bin/client execute 500 -u "echo $i" > /dev/null || exit 1
+done
+while pgrep -P "$orchestrator_pid" > /dev/null; do sleep 0.5; done
+stats="$(./bin/client stats)"
+json="$(./bin/client stats --json)"
+stop_orchestrator true "$orchestrator_pid"
+
+found_error=false
+if ! echo "$stats" | grep -q '^(SERVER) fcfs 2 0 0 0.0% ' ||
+	! echo "$stats" | grep -q '^(TASKS) all: 15 0 ' ||
+	! echo "$stats" | grep -q '^(TASKS) 0-9ms: 10 0 ' ||
+	! echo "$stats" | grep -q '^(TASKS) 100-999ms: 5 0 ' ||
+	[ "$(echo "$stats" | grep -c '^(TIME) all\.')" -ne 4 ]; then
+
+	echo "Test failure: wrong aggregates" 1>&2
+	echo "$stats" 1>&2
+	found_error=true
+fi
+
+if ! echo "$json" | grep -q '^{"policy": "fcfs", .*"aggregates": \[.*"tasks": 15, .*\]}$'; then
+	echo "Test failure: wrong JSON output" 1>&2
+	found_error=true
+fi
+
+$found_error || echo "All stats tests passed!"
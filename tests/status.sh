@@ -17,7 +17,7 @@
 # limitations under the License.
 
 # This test attempts to stress the status functionalty by forcing the transfer of lots of
-# information.
+# information, to many clients at the same time.
 
 . "$(dirname "$0")/utils.sh" || exit 1
 
@@ -28,4 +28,16 @@ for i in $(seq 1 5000); do
 done
 
 ./bin/client status
+
+status_dir="$(mktemp -d)"
+for i in $(seq 1 100); do
+	./bin/client status > "$status_dir/$i" 2>&1 &
+done
+wait
+incomplete="$(wc -l "$status_dir"/* | grep -cv -e '^ *5001 ' -e ' total$')"
+rm -r "$status_dir"
 stop_orchestrator true "$orchestrator_pid"
+
+if [ "$incomplete" -ne 0 ]; then
+	echo "Test failure: $incomplete concurrent status requests weren't fully answered" 1>&2
+fi
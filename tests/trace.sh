@@ -0,0 +1,71 @@
+#!/bin/bash
+# |
+# \_ bash is used so that the server can be spawned as a daemon.
+
+# Copyright 2024 Humberto Gomes, José Lopes, José Matos
+#
+# Licensed under the Apache License, Version 2.0 (the "License");
+# you may not use this file except in compliance with the License.
+# You may obtain a copy of the License at
+#
+#     http://www.apache.org/licenses/LICENSE-2.0
+#
+# Unless required by applicable law or agreed to in writing, software
+# distributed under the License is distributed on an "AS IS" BASIS,
+# WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+# See the License for the specific language governing permissions and
+# limitations under the License.
+
+# Test for runtime tracing. Runs a few tasks with tracing enabled, and checks that the exported
+# trace is valid JSON with the path of every task through the server.
+
+. "$(dirname "$0")/utils.sh" || exit 1
+
+orchestrator_pid=$(start_orchestrator 2 fcfs "/dev/null") || exit 1
+
+./bin/client execute 100 -u "echo untraced" > /dev/null || exit 1
+until ./bin/client status 1 | grep -q DONE; do sleep 0.5; done
+./bin/client trace on || exit 1
+for i in $(seq 1 5); do
+	./bin/client execute 100 -p "echo $i | cat" > /dev/null || exit 1
+done
+until ./bin/client status 6 | grep -q DONE; do sleep 0.5; done
+./bin/client trace off || exit 1
+./bin/client execute 100 -u "echo untraced" > /dev/null || exit 1
+until ./bin/client status 7 | grep -q DONE; do sleep 0.5; done
+
+./bin/client trace dump /tmp/orchestrator_trace.json > /dev/null
+dump_status=$?
+stop_orchestrator true "$orchestrator_pid"
+
+found_error=false
+if [ "$dump_status" -ne 0 ] || ! python3 -m json.tool /tmp/orchestrator_trace.json > /dev/null; then
+	echo "Test failure: invalid trace exported" 1>&2
+	found_error=true
+fi
+
+for event in "frame read" message enqueue dispatch fork exec "done sent" done "log write"; do
+	if ! grep -q "\"name\": \"$event\"" /tmp/orchestrator_trace.json; then
+		echo "Test failure: no \"$event\" events" 1>&2
+		found_error=true
+	fi
+done
+
+# Each pipeline has two programs, and only tasks 2 to 6 were traced
+for i in $(seq 2 6); do
+	if [ "$(grep -c "\"name\": \"exec\".*\"task\": $i}" /tmp/orchestrator_trace.json)" -ne 2 ] ||
+		! grep -q "\"name\": \"task $i\".*\"ph\": \"b\"" /tmp/orchestrator_trace.json ||
+		! grep -q "\"name\": \"task $i\".*\"ph\": \"e\"" /tmp/orchestrator_trace.json; then
+
+		echo "Test failure: task $i wasn't traced" 1>&2
+		found_error=true
+	fi
+done
+
+if grep -q -e "\"task\": 1[,}]" -e "\"task\": 7[,}]" /tmp/orchestrator_trace.json; then
+	echo "Test failure: events recorded while tracing was disabled" 1>&2
+	found_error=true
+fi
+
+rm -f /tmp/orchestrator_trace.json
+$found_error || echo "All tracing tests passed!"
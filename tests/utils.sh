@@ -42,6 +42,7 @@ assert_installed_command() {
 # $1 - Number of concurrent tasks.
 # $2 - Scheduling policy (fcfs / sjf).
 # $3 - Output redirection.
+# $4 - Output store backend (files / packed). Optional.
 #
 # stdout - PID of the orchestrator, nothing on failure.
 # return - 0 on success, 1 on failure.
@@ -52,17 +53,21 @@ start_orchestrator() {
 	fi
 
 	rm -rf "/tmp/"*".fifo" "/tmp/orchestrator" > /dev/null 2>&1
-	nohup "./bin/orchestrator" "/tmp/orchestrator" "$1" "$2" 0<&- &> "$3" &
+	nohup "./bin/orchestrator" "/tmp/orchestrator" "$1" "$2" $4 0<&- &> "$3" &
 	pgrep "orchestrator"
 	return 0
 }
 
-# Waits for the orchestrator daemon to have no children left and kills it.
+# Waits for the orchestrator daemon to have no children left, kills it and waits for it to finish
+# writing its log.
 #
 # $1 - Whether to wait for all the child processes to have terminated.
 # $2 - Orchestrator's PID.
 stop_orchestrator() {
 	$1 && while pgrep -P "$2" > /dev/null; do sleep 1; done
 	kill "$2"
-	rm "/tmp/orchestrator.fifo" > "/dev/null" 2>&1
+	while kill -0 "$2" 2> /dev/null && ! grep -q '^State:.*Z' "/proc/$2/status" 2> /dev/null; do
+		sleep 0.1
+	done
+	rm -f "/tmp/orchestrator.fifo" "/tmp/orchestrator.state" "/tmp/orchestrator.trace"
 }